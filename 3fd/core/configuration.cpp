@@ -351,8 +351,24 @@ namespace core
                     // XPath /configuration/framework/gc:
                     xml::QueryElement("gc", xml::Optional, {
                         ParseKeyValue("msgLoopSleepTimeoutMilisecs", settings.framework.gc.msgLoopSleepTimeoutMilisecs = 100),
+                        ParseKeyValue("msgBatchSize", settings.framework.gc.msgBatching.size = 0),
+                        ParseKeyValue("msgBatchFlushTimeoutMillisecs", settings.framework.gc.msgBatching.flushTimeoutMillisecs = 10),
+                        ParseKeyValue("msgRingCapacityLog2", settings.framework.gc.msgRing.capacityLog2 = 14),
+                        ParseKeyValue("msgRingFullPolicy", settings.framework.gc.msgRing.fullPolicy = "overflow"),
+                        ParseKeyValue("msgRingWakeUpThreshold", settings.framework.gc.msgRing.wakeUpThreshold = 4096),
+                        ParseKeyValue("msgRingBackpressureThreshold", settings.framework.gc.msgRing.backpressureThreshold = 0),
+                        ParseKeyValue("cycleCollectionThreshold", settings.framework.gc.cycleCollection.threshold = 0),
+                        ParseKeyValue("cycleCollectionIntervalMillisecs", settings.framework.gc.cycleCollection.intervalMillisecs = 100),
+                        ParseKeyValue("parallelMarkingThreads", settings.framework.gc.parallelMarking.numThreads = 0),
+                        ParseKeyValue("parallelMarkingMinCandidates", settings.framework.gc.parallelMarking.minCandidates = 4096),
+                        ParseKeyValue("shards", settings.framework.gc.numShards = 1),
+                        ParseKeyValue("finalizerThreads", settings.framework.gc.numFinalizerThreads = 0),
+                        ParseKeyValue("statsLogIntervalSecs", settings.framework.gc.statsLogIntervalSecs = 0),
                         ParseKeyValue("memoryBlocksPoolInitialSize", settings.framework.gc.memBlocksMemPool.initialSize = 128),
                         ParseKeyValue("memoryBlocksPoolGrowingFactor", settings.framework.gc.memBlocksMemPool.growingFactor = 1.0),
+                        ParseKeyValue("memoryBlocksPoolShrinkIntervalMillisecs", settings.framework.gc.memBlocksMemPool.shrinkIntervalMillisecs = 5000),
+                        ParseKeyValue("memoryBlocksPoolLowWaterMark", settings.framework.gc.memBlocksMemPool.lowWaterMark = 0.5F),
+                        ParseKeyValue("memoryBlocksPoolHighWaterMark", settings.framework.gc.memBlocksMemPool.highWaterMark = 0.75F),
                         ParseKeyValue("sptrObjsHashTabInitSizeLog2", settings.framework.gc.sptrObjectsHashTable.initialSizeLog2 = 8),
                         ParseKeyValue("sptrObjsHashTabLoadFactorThreshold", settings.framework.gc.sptrObjectsHashTable.loadFactorThreshold = 0.7F)
                     }),
@@ -79,11 +79,46 @@ namespace core
                 struct
                 {
                     uint32_t msgLoopSleepTimeoutMilisecs;
+
+                    struct
+                    {
+                        uint32_t size;
+                        uint32_t flushTimeoutMillisecs;
+                    } msgBatching;
+
+                    struct
+                    {
+                        uint32_t capacityLog2;
+                        string   fullPolicy;
+                        uint32_t wakeUpThreshold;
+                        uint32_t backpressureThreshold;
+                    } msgRing;
+
+                    struct
+                    {
+                        uint32_t threshold;
+                        uint32_t intervalMillisecs;
+                    } cycleCollection;
+
+                    struct
+                    {
+                        uint32_t numThreads;
+                        uint32_t minCandidates;
+                    } parallelMarking;
+
+                    uint32_t numShards;
+
+                    uint32_t numFinalizerThreads;
+
+                    uint32_t statsLogIntervalSecs;
                         
                     struct
                     {
                         uint32_t initialSize;
                         float    growingFactor;
+                        uint32_t shrinkIntervalMillisecs;
+                        float    lowWaterMark;
+                        float    highWaterMark;
                     } memBlocksMemPool;
                         
                     struct
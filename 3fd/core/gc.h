@@ -2,12 +2,22 @@
 #define GC_H
 
 #include <3fd/core/gc_memorydigraph.h>
+#include <3fd/core/gc_digraphshards.h>
+#include <3fd/core/gc_finalizerpool.h>
+#include <3fd/core/gc_messagesring.h>
 #include <3fd/utils/concurrency.h>
-#include <3fd/utils/lockfreequeue.h>
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <exception>
+#include <future>
+#include <memory>
 #include <thread>
 #include <mutex>
+#include <string>
+#include <vector>
 
 /* Convention:
 
@@ -20,39 +30,252 @@ namespace _3fd
 namespace memory
 {
     /// <summary>
-    /// The interface that all GC messages must implement.
+    /// Implements the garbage collector engine.
     /// </summary>
-    class INTFOPT IMessage
+    class GarbageCollector 
     {
     public:
 
-        virtual ~IMessage() {}
+        /// <summary>
+        /// Holds statistics about the operation of the GC.
+        /// </summary>
+        struct Statistics
+        {
+            /// <summary>
+            /// How many messages are currently waiting to be processed.
+            /// </summary>
+            size_t messagesBacklog;
 
-        virtual void Execute(MemoryDigraph &graph) = 0;
-    };
+            /// <summary>
+            /// The largest backlog of messages found by the GC thread upon wake-up.
+            /// </summary>
+            size_t peakMessagesBacklog;
+
+            /// <summary>
+            /// How many times the GC thread was woken up because of the backlog of messages.
+            /// </summary>
+            uint64_t demandWakeUpsCount;
+
+            /// <summary>
+            /// How many times the GC thread was woken up by the timeout of the message loop.
+            /// </summary>
+            uint64_t timedWakeUpsCount;
+
+            /// <summary>
+            /// How many times a thread had to wait for the GC, either because the
+            /// messages ring was full, or because the backlog was too large.
+            /// </summary>
+            uint64_t producerWaitsCount;
+
+            /// <summary>
+            /// How many messages have been processed, indexed by <see cref="MessageType"/>.
+            /// </summary>
+            std::array<uint64_t, messageTypesCount> messagesProcessedCount;
+
+            /// <summary>
+            /// How many memory blocks are managed.
+            /// </summary>
+            size_t verticesCount;
+
+            /// <summary>
+            /// How many <see cref="sptr"/> objects are registered.
+            /// </summary>
+            size_t sptrObjectsCount;
+
+            /// <summary>
+            /// How many <see cref="gc_vector"/> objects are registered.
+            /// </summary>
+            size_t edgeSetsCount;
+
+            /// <summary>
+            /// The total size of the memory blocks managed.
+            /// </summary>
+            uint64_t managedBytes;
+
+            /// <summary>
+            /// The total size of the memory blocks collected so far.
+            /// </summary>
+            uint64_t freedBytes;
+
+            /// <summary>
+            /// The total size of the memory of the pool of vertices handed back to the system so far.
+            /// </summary>
+            uint64_t vertexPoolReleasedBytes;
+
+            /// <summary>
+            /// How many times the candidates for collection have been analysed.
+            /// </summary>
+            uint64_t collectionsCount;
+
+            /// <summary>
+            /// How many vertices have been visited by the analysis of reachability
+            /// in all collections so far, and in the last one.
+            /// </summary>
+            uint64_t visitsCount;
+            uint64_t lastCollectionVisitsCount;
+
+            /// <summary>
+            /// How many iterations the message loop of the GC thread has completed.
+            /// </summary>
+            uint64_t loopIterationsCount;
+
+            /// <summary>
+            /// How long the GC thread has been busy in the last iteration of the
+            /// message loop, in the longest one, and in all of them together.
+            /// </summary>
+            std::chrono::microseconds lastLoopIterationTime;
+            std::chrono::microseconds peakLoopIterationTime;
+            std::chrono::microseconds totalLoopIterationTime;
+
+            /// <summary>
+            /// How many objects collected are waiting for the finalizer threads,
+            /// or being finalized, and the largest amount of them so far.
+            /// </summary>
+            size_t finalizationBacklog;
+            size_t peakFinalizationBacklog;
+
+            /// <summary>
+            /// How many objects collected have been finalized by the finalizer threads.
+            /// </summary>
+            uint64_t finalizedObjectsCount;
+
+            /// <summary>
+            /// How long it took from the collection of an object until the finalizer threads
+            /// were done with it, for the last object, for the one that took the longest,
+            /// and for all of them together.
+            /// </summary>
+            std::chrono::microseconds lastFinalizationLatency;
+            std::chrono::microseconds peakFinalizationLatency;
+            std::chrono::microseconds totalFinalizationLatency;
+        };
 
-    /// <summary>
-    /// Implements the garbage collector engine.
-    /// </summary>
-    class GarbageCollector 
-    {
     private:
 
-        std::thread                     m_thread;
-        std::exception_ptr              m_error;
-        MemoryDigraph                   m_memoryDigraph;
-        utils::LockFreeQueue<IMessage>  m_messagesQueue;
-        utils::Event                    m_terminationEvent;
+        /// <summary>
+        /// Enumerates what a thread can do when the messages ring is full.
+        /// </summary>
+        enum class RingFullPolicy { Spin, Block, Overflow };
+
+        std::thread         m_thread;
+        std::exception_ptr  m_error;
+        std::atomic<bool>   m_stopped;
+        MemoryDigraph       m_memoryDigraph;
+        MessagesRing        m_messagesRing;
+        utils::Event        m_wakeUpEvent;
+        std::atomic<bool>   m_terminate;
+
+        RingFullPolicy m_ringFullPolicy;
+
+        // Overflow of the messages ring:
+        std::mutex m_overflowMutex;
+        std::vector<Message> m_overflowList;
+
+        std::atomic<size_t> m_overflowedCount;
+
+        // Threads blocked because the messages ring is full or the backlog is too large:
+        std::mutex m_ringSpaceMutex;
+        std::condition_variable m_ringSpaceCondition;
+        std::atomic<uint32_t> m_blockedProducersCount;
+
+        // Wake-up of the GC thread on demand:
+        std::atomic<bool> m_wakeUpPending;
+        uint32_t m_wakeUpThreshold;
+        uint32_t m_backpressureThreshold;
+
+        // Deferred collection of cycles:
+        uint32_t m_cycleCollectionThreshold;
+        std::chrono::milliseconds m_cycleCollectionInterval;
+        std::chrono::steady_clock::time_point m_lastCycleCollectionTime;
+
+        // Collection of the whole graph with parallel marking:
+        std::unique_ptr<ParallelMarker> m_parallelMarker;
+        uint32_t m_parallelMarkingMinCandidates;
+
+        // Execution of messages split among shards, unless there is only one:
+        std::unique_ptr<DigraphShards> m_shards;
+
+        // How many messages the GC thread and the finalizer threads have emitted, to settle fences:
+        std::atomic<uint64_t> m_selfEmittedCount;
+
+        // Statistics:
+        std::atomic<size_t> m_peakMessagesBacklog;
+        std::atomic<uint64_t> m_demandWakeUpsCount;
+        std::atomic<uint64_t> m_timedWakeUpsCount;
+        std::atomic<uint64_t> m_producerWaitsCount;
+
+        // Statistics kept by the GC thread, and published as a snapshot under the lock:
+        Statistics m_gcThreadStats;
+        Statistics m_statsSnapshot;
+        mutable std::mutex m_statsMutex;
+
+        std::chrono::seconds m_statsLogInterval;
+        std::chrono::steady_clock::time_point m_lastStatsLogTime;
+
+        uint32_t m_generation;
+        uint32_t m_msgBatchSize;
+        std::chrono::milliseconds m_msgBatchFlushTimeout;
+
+        /* Finalization of the objects collected by a pool of threads, unless there are none.
+        Their destructors emit messages, so the pool must be the first member to go: */
+        std::unique_ptr<FinalizerPool> m_finalizers;
 
         GarbageCollector();
 
         void GCThreadProc();
 
+        void ConsumeMessages();
+
+        void Execute(const Message &message);
+
+        bool ExecuteBatch();
+
+        void PublishStatistics();
+
+        void LogStatistics(const Statistics &stats);
+
+        bool CollectCycles(bool forced = false);
+
+        struct FenceRequest;
+
+        void HandleFence(const Message &message);
+
+        std::future<void> PostFence(bool collect, HeapSnapshot *snapshot = nullptr);
+
+        bool WaitForFence(std::future<void> &fence, const std::chrono::milliseconds *timeout);
+
+        void NotifyBlockedProducers();
+
+        void WakeUpGCThread();
+
+        size_t GetMessagesBacklog() const;
+
+        void PublishMessages(const Message *messages, size_t count, bool mustNotWait);
+
+        void ApplyBackpressure();
+
+        void SendMessage(const Message &message);
+
+        void SendEdgesMessage(MessageType type, void *containerAddr, void *const *pointedAddrs, size_t count);
+
+        void PublishIdleThreadMessages();
+
+        void PublishAllThreadMessages();
+
+        // Batching of messages per thread:
+
+        struct ThreadMessagesBuffer;
+        static thread_local ThreadMessagesBuffer threadMsgBuffer;
+
+        // The buffers of all threads that batch messages, so the GC thread can publish them:
+        static std::mutex threadMsgBuffersMutex;
+        static std::vector<ThreadMessagesBuffer *> threadMsgBuffers;
+
         // Singleton needs:
 
         static std::mutex        singleInstanceCreationMutex;
         static GarbageCollector *uniqueObjectPtr;
         static GarbageCollector *CreateInstance();
+        static uint32_t          generationsCount;
 
     public:
 
@@ -73,6 +296,8 @@ namespace memory
 
         void UpdateReference(void *leftSptrObjAddr, void *rightSptrObjAddr);
 
+        void MoveReference(void *leftSptrObjAddr, void *rightSptrObjAddr);
+
         void ReleaseReference(void *sptrObjAddr);
 
         void UnregisterAbortedObject(void *sptrObjAddr);
@@ -81,7 +306,44 @@ namespace memory
 
         void RegisterSptrCopy(void *leftSptrObjAddr, void *rightSptrObjAddr);
 
+        void RegisterSptrMove(void *leftSptrObjAddr, void *rightSptrObjAddr);
+
+        void RegisterSptrWithNewObject(
+            void *sptrObjAddr,
+            void *pointedAddr,
+            size_t blockSize,
+            FreeMemProc freeMemCallback
+        );
+
         void UnregisterSptr(void *sptrObjAddr);
+
+        WeakRefBlock *AcquireWeakReference(void *pointedAddr);
+
+        void RegisterSptrOnWeakLock(void *sptrObjAddr, void *memBlockAddr);
+
+        void RegisterEdgeSet(void *containerAddr);
+
+        void AddEdges(void *containerAddr, void *const *pointedAddrs, size_t count);
+
+        void RemoveEdges(void *containerAddr, void *const *pointedAddrs, size_t count);
+
+        void SwapEdgeSets(void *leftContainerAddr, void *rightContainerAddr);
+
+        void UnregisterEdgeSet(void *containerAddr);
+
+        void PublishThreadMessages();
+
+        void Flush();
+
+        bool Flush(std::chrono::milliseconds timeout);
+
+        void Collect();
+
+        bool Collect(std::chrono::milliseconds timeout);
+
+        void ExportHeapSnapshot(const std::string &filePath);
+
+        Statistics GetStatistics() const;
     };
 
 }// end of namespace memory
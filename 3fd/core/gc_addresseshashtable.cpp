@@ -2,137 +2,242 @@
 #include "gc_addresseshashtable.h"
 #include "configuration.h"
 
+#include <algorithm>
+#include <utility>
+
 namespace _3fd
 {
 namespace memory
 {
     using core::AppConfig;
 
+    // How many buckets of the old table to migrate along with each insertion or removal:
+    static const size_t migrationStepSize(16);
+
     /// <summary>
-    /// Initializes a new instance of the <see cref="AddressesHashTable"/> class.
+    /// Initializes a new instance of the <see cref="AddressesHashTable"/> class,
+    /// using the settings of the framework configuration.
     /// </summary>
     AddressesHashTable::AddressesHashTable() :
-        m_elementsCount(0),
-        m_outHashSizeInBits(0)
+        AddressesHashTable(
+            AppConfig::GetSettings().framework.gc.sptrObjectsHashTable.initialSizeLog2,
+            AppConfig::GetSettings().framework.gc.sptrObjectsHashTable.loadFactorThreshold)
+    {}
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="AddressesHashTable"/> class.
+    /// </summary>
+    /// <param name="initialSizeLog2">The base 2 logarithm of the initial amount of buckets.</param>
+    /// <param name="loadFactorThreshold">The load factor above which the table expands.</param>
+    AddressesHashTable::AddressesHashTable(uint32_t initialSizeLog2, float loadFactorThreshold) :
+        m_migrationPos(0),
+        m_bucketsToMigrate(0),
+        m_initialSizeInBits(std::max(initialSizeLog2, 4U)),
+        m_loadFactorThreshold(std::min(loadFactorThreshold, 0.95F)),
+        m_maxElementsCount(0),
+        m_minElementsCount(0)
     {}
 
     /// <summary>
-    /// Hashes a key using the FNV1a algorithm modified for outputs smaller than 16 bits.
+    /// Hashes a key by multiplication with the golden ratio (Fibonacci hashing).
     /// </summary>
     /// <param name="key">The key.</param>
-    /// <returns>The hashed key.</returns>
-    size_t AddressesHashTable::Hash(void *key)
+    /// <param name="sizeInBits">The size of the returned hash in bits.</param>
+    /// <returns>The hashed key, which is the index of its home bucket.</returns>
+    size_t AddressesHashTable::Hash(void *key, uint32_t sizeInBits)
     {
-        uint32_t hash = 2166136261; // use the FNV offset basis for 32 bits hashes
-
-        for (int bitsToShift = ((sizeof key) - 1) * 8;
-                bitsToShift >= 0;
-                bitsToShift -= 8)
-        {
-            auto octet = (reinterpret_cast<uintptr_t> (key) >> bitsToShift) & 255;
-            hash ^= octet;
-            hash *= 16777619; // use the FNV prime for 32 bits hashes
-        }
+#   if SIZE_MAX > UINT32_MAX
+        const uintptr_t goldenRatio(11400714819323198485ULL);
+#   else
+        const uintptr_t goldenRatio(2654435769U);
+#   endif
+        /* The key is the address of a pointer, so the lower bits are always zero and
+        are discarded. Then the upper bits of the product are the ones that depend on
+        every bit of the key, and consecutive keys spread evenly over the buckets: */
+        const uint32_t alignmentBits = (sizeof(void *) == 8) ? 3 : 2;
+        auto product = (reinterpret_cast<uintptr_t> (key) >> alignmentBits) * goldenRatio;
+        return static_cast<size_t> (product >> (sizeof(uintptr_t) * 8 - sizeInBits));
+    }
 
-        return hash;
+    /// <summary>
+    /// Gets how far the element in a bucket is from its home bucket.
+    /// </summary>
+    /// <param name="table">The table.</param>
+    /// <param name="idx">The index of the bucket, which must not be vacant.</param>
+    /// <returns>The distance in buckets.</returns>
+    size_t AddressesHashTable::GetProbeDistance(const Table &table, size_t idx)
+    {
+        auto homeIdx = Hash(table.buckets[idx].GetSptrObjectAddr(), table.sizeInBits);
+        return (idx - homeIdx) & (table.buckets.size() - 1);
     }
 
     /// <summary>
-    /// XOR-fold's a hash to adapt to the bucket array size.
+    /// Finds the element for a key in a table.
     /// </summary>
-    /// <param name="hash">The hash.</param>
-    /// <param name="outHashSizeInBits">The size of the returned hash in bits.</param>
-    /// <returns>The xor-folded hash.</returns>
-    size_t AddressesHashTable::XorFold(size_t hash, uint32_t outHashSizeInBits)
+    /// <param name="table">The table.</param>
+    /// <param name="key">The key.</param>
+    /// <returns>The element, or <c>nullptr</c> if not present.</returns>
+    AddressesHashTable::Element *
+    AddressesHashTable::Find(Table &table, void *key)
     {
-        const uint32_t maskForLowerBits = (1UL << outHashSizeInBits) - 1;
-        return ((hash >> outHashSizeInBits) ^ hash) & maskForLowerBits;
+        if (table.elementsCount == 0)
+            return nullptr;
+
+        const auto mask = table.buckets.size() - 1;
+        auto idx = Hash(key, table.sizeInBits);
+
+        for (size_t distance = 0; true; ++distance)
+        {
+            auto &bucket = table.buckets[idx];
+
+            if (bucket.GetSptrObjectAddr() == key)
+                return &bucket;
+
+            /* Stop at a vacant bucket, or at an element closer to its home
+            than the key would be, because the key would have taken its place: */
+            if (bucket.GetSptrObjectAddr() == nullptr || GetProbeDistance(table, idx) < distance)
+                return nullptr;
+
+            idx = (idx + 1) & mask;
+        }
     }
 
     /// <summary>
-    /// Expands the hash table to twice its size.
+    /// Places an element in a table, displacing those closer to their home buckets.
     /// </summary>
-    void AddressesHashTable::ExpandTable()
+    /// <param name="table">The table.</param>
+    /// <param name="newElement">The element to place.</param>
+    /// <returns>Where the element was placed.</returns>
+    AddressesHashTable::Element &
+    AddressesHashTable::Place(Table &table, const Element &newElement)
     {
-        if (m_bucketArray.empty() == false)
+        const auto mask = table.buckets.size() - 1;
+        auto element = newElement;
+        auto idx = Hash(element.GetSptrObjectAddr(), table.sizeInBits);
+        size_t distance(0);
+        Element *placedAt(nullptr);
+
+        while (true)
         {
-            ++m_outHashSizeInBits;
-            std::vector<Element> newArray(1 << m_outHashSizeInBits);
+            auto &bucket = table.buckets[idx];
 
-            // Rehash the table to the new array:
-            for (auto &element : m_bucketArray)
+            if (bucket.GetSptrObjectAddr() == nullptr)
             {
-                if (element.GetSptrObjectAddr() != nullptr)
-                {
-                    auto hashedKey = Hash(element.GetSptrObjectAddr());
-                    auto idx = XorFold(hashedKey, m_outHashSizeInBits);
-
-                    if (newArray[idx].GetSptrObjectAddr() == nullptr)
-                        newArray[idx] = element;
-                    else
-                    {// Linear probe:
-                        do
-                        {
-                            if (++idx < newArray.size())
-                                continue;
-                            else
-                                idx = 0;
-                        }
-                        while (newArray[idx].GetSptrObjectAddr() != nullptr);
-
-                        newArray[idx] = element;
-                    }
-                }
+                bucket = element;
+                ++table.elementsCount;
+                return (placedAt != nullptr) ? *placedAt : bucket;
             }
 
-            m_bucketArray.swap(newArray);
+            // take the bucket from an element that is closer to its home:
+            auto bucketDistance = GetProbeDistance(table, idx);
+            if (bucketDistance < distance)
+            {
+                std::swap(bucket, element);
+                distance = bucketDistance;
+
+                if (placedAt == nullptr)
+                    placedAt = &bucket;
+            }
+
+            ++distance;
+            idx = (idx + 1) & mask;
         }
-        else
-        {// Allocate the bucket array for the first time:
-            m_outHashSizeInBits = AppConfig::GetSettings().framework.gc.sptrObjectsHashTable.initialSizeLog2;
-            m_bucketArray.resize(1 << m_outHashSizeInBits);
+    }
+
+    /// <summary>
+    /// Removes an element from a table, and shifts back the
+    /// following elements that are not in their home buckets.
+    /// </summary>
+    /// <param name="table">The table.</param>
+    /// <param name="idx">The index of the element to remove.</param>
+    void AddressesHashTable::Erase(Table &table, size_t idx)
+    {
+        const auto mask = table.buckets.size() - 1;
+        auto nextIdx = (idx + 1) & mask;
+
+        while (table.buckets[nextIdx].GetSptrObjectAddr() != nullptr
+               && GetProbeDistance(table, nextIdx) > 0)
+        {
+            table.buckets[idx] = table.buckets[nextIdx];
+            idx = nextIdx;
+            nextIdx = (nextIdx + 1) & mask;
         }
+
+        table.buckets[idx] = Element();
+        --table.elementsCount;
     }
 
     /// <summary>
-    /// Shrinks the hash table to half its size.
+    /// Replaces the bucket array by a new one, and starts moving the elements there.
     /// </summary>
-    void AddressesHashTable::ShrinkTable()
+    /// <param name="newSizeInBits">The base 2 logarithm of the new amount of buckets.</param>
+    void AddressesHashTable::Resize(uint32_t newSizeInBits)
     {
-        --m_outHashSizeInBits;
-        const auto newSize = 1 << m_outHashSizeInBits;
-        _ASSERTE(newSize >= m_elementsCount); // Can only shrink the table if the new table can fit all currently stored elements
+        // a resize can only start when the previous one is complete:
+        MigrateBuckets(m_bucketsToMigrate);
+
+        m_oldTable = std::move(m_table);
 
-        std::vector<Element> newArray(newSize);
+        m_table = Table();
+        m_table.sizeInBits = newSizeInBits;
+        m_table.buckets.resize(static_cast<size_t> (1) << newSizeInBits);
 
-        // Rehash the table to the new array:
-        for (auto &element : m_bucketArray)
+        m_maxElementsCount = std::max(static_cast<size_t> (m_table.buckets.size() * m_loadFactorThreshold), static_cast<size_t> (1));
+        m_minElementsCount = static_cast<size_t> (m_table.buckets.size() * m_loadFactorThreshold / 3);
+
+        if (m_oldTable.elementsCount == 0)
         {
-            if (element.GetSptrObjectAddr() == nullptr)
-                continue;
-            else
+            m_oldTable = Table();
+            return;
+        }
+
+        /* The migration goes in ranges of whole clusters, so what is left of the old table
+        can still be probed. Start from the home bucket of an element or from a vacant one: */
+        m_migrationPos = 0;
+        while (!IsClusterStart(m_oldTable, m_migrationPos))
+            ++m_migrationPos;
+
+        m_bucketsToMigrate = m_oldTable.buckets.size();
+    }
+
+    /// <summary>
+    /// Moves elements from the old bucket array to the current one.
+    /// </summary>
+    /// <param name="count">
+    /// How many buckets to migrate. The migration goes on beyond
+    /// that until the end of a cluster, so nothing is split apart.
+    /// </param>
+    void AddressesHashTable::MigrateBuckets(size_t count)
+    {
+        if (m_bucketsToMigrate == 0)
+            return;
+
+        const auto mask = m_oldTable.buckets.size() - 1;
+
+        do
+        {
+            auto &bucket = m_oldTable.buckets[m_migrationPos];
+
+            if (bucket.GetSptrObjectAddr() != nullptr)
             {
-                auto hashedKey = Hash(element.GetSptrObjectAddr());
-                auto idx = XorFold(hashedKey, m_outHashSizeInBits);
-
-                if (newArray[idx].GetSptrObjectAddr() == nullptr)
-                    newArray[idx] = element;
-                else
-                {// Linear probe:
-                    do
-                    {
-                        if (++idx < newArray.size())
-                            continue;
-                        else
-                            idx = 0;
-                    } while (newArray[idx].GetSptrObjectAddr() != nullptr);
-
-                    newArray[idx] = element;
-                }
+                Place(m_table, bucket);
+                bucket = Element();
+                --m_oldTable.elementsCount;
             }
+
+            m_migrationPos = (m_migrationPos + 1) & mask;
+            --m_bucketsToMigrate;
+
+            if (count > 0)
+                --count;
         }
+        while (m_bucketsToMigrate > 0 && (count > 0 || !IsClusterStart(m_oldTable, m_migrationPos)));
 
-        m_bucketArray.swap(newArray);
+        if (m_oldTable.elementsCount == 0)
+        {
+            m_oldTable = Table();
+            m_bucketsToMigrate = 0;
+        }
     }
 
     /// <summary>
@@ -152,47 +257,14 @@ namespace memory
     AddressesHashTable::Element &
     AddressesHashTable::Insert(void *sptrObjectAddr, Vertex *pointedMemBlock, Vertex *containerMemBlock)
     {
-        if (CalculateLoadFactor() > AppConfig::GetSettings().framework.gc.sptrObjectsHashTable.loadFactorThreshold
-            || m_bucketArray.empty())
-        {
-            ExpandTable();
-        }
-
-        auto hashedKey = Hash(sptrObjectAddr);
-        auto idx = XorFold(hashedKey, m_outHashSizeInBits);
-
-        /* The code below could be simplified, but it will be kept this way so as to prevent
-        misprediction of instructions. However, that should not be a concern if the compiler
-        in use will apply PGO.*/
-
-        if (m_bucketArray[idx].GetSptrObjectAddr() == nullptr)
-        {
-            ++m_elementsCount;
-            return m_bucketArray[idx] = Element(sptrObjectAddr, pointedMemBlock, containerMemBlock);
-        }
-        else // Linear probe:
-        {
-            auto &element = m_bucketArray[idx];
-            auto displacedElement = element;
-
-            // Place the new element in the first hashed index
-            element = Element(sptrObjectAddr, pointedMemBlock, containerMemBlock);
-            ++m_elementsCount;
+        MigrateBuckets(migrationStepSize);
 
-            // And move the displaced element to the first vacant position:
-            do
-            {
-                if (++idx < m_bucketArray.size())
-                    continue;
-                else
-                    idx = 0;
-            } while (m_bucketArray[idx].GetSptrObjectAddr() != nullptr);
-
-            m_bucketArray[idx] = displacedElement;
+        if (m_table.buckets.empty())
+            Resize(m_initialSizeInBits);
+        else if (GetElementsCount() >= m_maxElementsCount)
+            Resize(m_table.sizeInBits + 1);
 
-            // Return a reference inserted element:
-            return element;
-        }
+        return Place(m_table, Element(sptrObjectAddr, pointedMemBlock, containerMemBlock));
     }
 
     /// <summary>
@@ -205,23 +277,13 @@ namespace memory
     AddressesHashTable::Element &
     AddressesHashTable::Lookup(void *sptrObjectAddr)
     {
-        auto hashedKey = Hash(sptrObjectAddr);
-        auto idx = XorFold(hashedKey, m_outHashSizeInBits);
+        auto element = Find(m_table, sptrObjectAddr);
 
-        if (m_bucketArray[idx].GetSptrObjectAddr() == sptrObjectAddr)
-            return m_bucketArray[idx];
-        else
-        {// Linear probe:
-            do
-            {
-                if (++idx < m_bucketArray.size())
-                    continue;
-                else
-                    idx = 0;
-            } while (m_bucketArray[idx].GetSptrObjectAddr() != sptrObjectAddr);
+        if (element == nullptr)
+            element = Find(m_oldTable, sptrObjectAddr);
 
-            return m_bucketArray[idx];
-        }
+        _ASSERTE(element != nullptr); // the pointer must have been inserted before
+        return *element;
     }
 
     /// <summary>
@@ -230,18 +292,29 @@ namespace memory
     /// <param name="element">A reference to the element remove.</param>
     void AddressesHashTable::Remove(Element &element)
     {
-        // element reference must at least belong to the array of buckets:
-        _ASSERTE(m_elementsCount > 0
-                    && &element >= &m_bucketArray[0]
-                    && &element < &m_bucketArray[0] + m_bucketArray.size());
+        // element reference must at least belong to one of the arrays of buckets:
+        if (!m_table.buckets.empty()
+            && &element >= &m_table.buckets[0]
+            && &element < &m_table.buckets[0] + m_table.buckets.size())
+        {
+            Erase(m_table, &element - &m_table.buckets[0]);
+        }
+        else
+        {
+            _ASSERTE(m_oldTable.elementsCount > 0
+                     && &element >= &m_oldTable.buckets[0]
+                     && &element < &m_oldTable.buckets[0] + m_oldTable.buckets.size());
+
+            Erase(m_oldTable, &element - &m_oldTable.buckets[0]);
+        }
 
-        element = Element();
-        --m_elementsCount;
+        MigrateBuckets(migrationStepSize);
 
-        if (m_outHashSizeInBits > AppConfig::GetSettings().framework.gc.sptrObjectsHashTable.initialSizeLog2
-            && CalculateLoadFactor() < AppConfig::GetSettings().framework.gc.sptrObjectsHashTable.loadFactorThreshold / 3)
+        if (m_table.sizeInBits > m_initialSizeInBits
+            && m_bucketsToMigrate == 0
+            && GetElementsCount() < m_minElementsCount)
         {
-            ShrinkTable();
+            Resize(m_table.sizeInBits - 1);
         }
     }
 
@@ -257,5 +330,22 @@ namespace memory
         Remove(element);
     }
 
+    /// <summary>
+    /// Iterates over each element in the table, in no particular order,
+    /// including those not yet migrated from the old table.
+    /// </summary>
+    /// <param name="callback">The callback to invoke for each element.</param>
+    void AddressesHashTable::ForEach(const std::function<void(const Element &)> &callback) const
+    {
+        for (auto table : { &m_table, &m_oldTable })
+        {
+            for (auto &element : table->buckets)
+            {
+                if (element.GetSptrObjectAddr() != nullptr)
+                    callback(element);
+            }
+        }
+    }
+
 }// end of namespace memory
-}// end of namespace _3fd
\ No newline at end of file
+}// end of namespace _3fd
@@ -4,18 +4,28 @@
 #include <3fd/core/gc_vertex.h>
 #include <vector>
 #include <cstdint>
+#include <functional>
 
 namespace _3fd
 {
 namespace memory
 {
     /// <summary>
-    /// This class uses hash table data structure (with open addressing and linear probing) to store information about 
+    /// This class uses hash table data structure (with open addressing and Robin Hood probing) to store information about 
     /// the <see cref="sptr" /> objects managed by the GC. It was not converted to a template because it was designed 
     /// very specifically (optimized) for its job. The implementation could be more "OOP/C++ like", but the concern here 
     /// is to save memory. If you find yourself wishing to change its model to make it more OOP compliant, remember it 
     /// was designed that way so as to save something around 8 or 16 bytes per element added to the table.
     /// </summary>
+    /// <remarks>
+    /// The home bucket of a key comes from a multiplicative (Fibonacci) hash. On insertion, an element
+    /// takes the bucket of any element closer to its own home, which keeps the probe sequences short and
+    /// lets a lookup stop as soon as it finds such an element. Removal shifts the following elements back,
+    /// so there are no tombstones. The distance of an element from its home is not stored, but computed
+    /// from its key, which is cheap for this hash and costs no memory. When the table is resized, the elements move to the new bucket array
+    /// a few buckets at a time, along with the next insertions and removals, rather than all at once.
+    /// References to elements remain valid until the next insertion or removal.
+    /// </remarks>
     class AddressesHashTable
     {
     public:
@@ -84,32 +94,64 @@ namespace memory
 
     private:
 
-        std::vector<Element> m_bucketArray;
-        size_t m_elementsCount;
-        uint32_t m_outHashSizeInBits;
+        /// <summary>
+        /// An array of buckets, where vacant buckets have a null key.
+        /// </summary>
+        struct Table
+        {
+            std::vector<Element> buckets;
+            size_t elementsCount;
+            uint32_t sizeInBits;
+
+            Table() :
+                elementsCount(0),
+                sizeInBits(0)
+            {}
+        };
+
+        Table m_table;
+
+        // the table whose elements are being moved to the current one, after a resize:
+        Table m_oldTable;
+        size_t m_migrationPos;
+        size_t m_bucketsToMigrate;
+
+        uint32_t m_initialSizeInBits;
+        float m_loadFactorThreshold;
+
+        // the amounts of elements that make the table expand or shrink:
+        size_t m_maxElementsCount;
+        size_t m_minElementsCount;
+
+        static size_t Hash(void *key, uint32_t sizeInBits);
+
+        static size_t GetProbeDistance(const Table &table, size_t idx);
 
         /// <summary>
-        /// Calculates the load factor.
+        /// Tells whether a bucket starts a cluster, by being vacant or holding an element in its home.
         /// </summary>
-        /// <returns>The current load factor of the table.</returns>
-        float CalculateLoadFactor() const
+        static bool IsClusterStart(const Table &table, size_t idx)
         {
-            if (m_bucketArray.empty() == false)
-                return ((float)m_elementsCount) / m_bucketArray.size();
-            else
-                return 0.0;
+            return table.buckets[idx].GetSptrObjectAddr() == nullptr
+                || GetProbeDistance(table, idx) == 0;
         }
 
-        static size_t Hash(void *key);
-        static size_t XorFold(size_t hash, uint32_t outHashSizeInBits);
+        static Element *Find(Table &table, void *key);
+
+        static Element &Place(Table &table, const Element &newElement);
+
+        static void Erase(Table &table, size_t idx);
 
-        void ExpandTable();
-        void ShrinkTable();
+        void Resize(uint32_t newSizeInBits);
+
+        void MigrateBuckets(size_t count);
 
     public:
 
         AddressesHashTable();
 
+        AddressesHashTable(uint32_t initialSizeLog2, float loadFactorThreshold);
+
 		AddressesHashTable(const AddressesHashTable &) = delete;
 
         Element &Insert(void *sptrObjectAddr,
@@ -121,6 +163,16 @@ namespace memory
         void Remove(Element &element);
 
         void Remove(void *sptrObjectAddr);
+
+        void ForEach(const std::function<void(const Element &)> &callback) const;
+
+        /// <summary>
+        /// Gets the amount of elements in the table.
+        /// </summary>
+        size_t GetElementsCount() const
+        {
+            return m_table.elementsCount + m_oldTable.elementsCount;
+        }
     };
 
 }// end of namespace memory
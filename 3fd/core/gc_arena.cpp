@@ -0,0 +1,484 @@
+#include "pch.h"
+#include "gc_arena.h"
+#include "gc.h"
+#include "exceptions.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <sstream>
+
+namespace _3fd
+{
+namespace memory
+{
+    thread_local gc_arena *gc_arena::innermost(nullptr);
+
+    /// <summary>
+    /// The memory of arenas abandoned because of escaped references. It is never freed,
+    /// but kept reachable, so tools detecting leaks do not report it as one.
+    /// </summary>
+    static std::vector<void *> *abandonedChunks(nullptr);
+
+    static std::mutex abandonedChunksMutex;
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="gc_arena"/> class,
+    /// which becomes the innermost arena of the calling thread.
+    /// </summary>
+    /// <param name="initialChunkSize">The size of the first chunk of memory, which doubles for each one after.</param>
+    gc_arena::gc_arena(size_t initialChunkSize) :
+        m_outer(innermost),
+        m_nextAddr(nullptr),
+        m_nextChunkSize(std::max<size_t>(initialChunkSize, 256)),
+        m_allocatedBytes(0),
+        m_externalRefsCount(0)
+    {
+        innermost = this;
+    }
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="gc_arena"/> class.
+    /// The objects in the arena are destroyed in the reverse order of their
+    /// creation, then its memory is freed, unless any reference escaped.
+    /// In that case, the objects are abandoned, but the ones managed by
+    /// the GC they reference are released, so they do not leak.
+    /// </summary>
+    gc_arena::~gc_arena()
+    {
+        _ASSERTE(innermost == this); // scopes must be nested in the same thread
+
+        if (m_externalRefsCount > 0)
+        {
+            std::ostringstream oss;
+            oss << m_externalRefsCount << " safe pointer(s) escaped the scope of a GC arena, whose "
+                << m_allocatedBytes << " bytes in " << m_objects.size() << " object(s) are abandoned";
+
+            core::Logger::Write(oss.str(), core::Logger::PRIO_CRITICAL);
+
+            try
+            {
+                auto &gc = GarbageCollector::GetInstance();
+
+                /* The safe pointers in the abandoned objects would otherwise hold the objects
+                   managed by the GC forever, just like roots. They are made null, so the escaped
+                   pointer cannot reach an object the GC might collect from now on. A safe pointer
+                   is laid out as the address it references. */
+                for (void *sptrObjAddr : m_gcSptrs)
+                {
+                    gc.UnregisterSptr(sptrObjAddr);
+                    *static_cast<void **> (sptrObjAddr) = nullptr;
+                }
+
+                // the same goes for the containers, whose whole sets of edges are removed:
+                for (auto &entry : m_edgeSets)
+                {
+                    gc.UnregisterEdgeSet(entry.first);
+                    (*entry.second)(entry.first);
+                }
+            }
+            catch (...) {} // the objects referenced then leak along with the arena
+
+            try
+            {
+                std::lock_guard<std::mutex> lock(abandonedChunksMutex);
+
+                if (abandonedChunks == nullptr)
+                    abandonedChunks = new std::vector<void *>();
+
+                for (auto &chunk : m_chunks)
+                    abandonedChunks->push_back(chunk.begin);
+            }
+            catch (...) {} // the memory is lost anyway
+
+            innermost = m_outer;
+            return;
+        }
+
+        // the destructors might release references to objects in outer arenas, so this is still the innermost:
+        for (auto iter = m_objects.rbegin(); iter != m_objects.rend(); ++iter)
+            (*iter->destroy)(iter->addr);
+
+        for (auto &chunk : m_chunks)
+            free(chunk.begin);
+
+        innermost = m_outer;
+    }
+
+    /// <summary>
+    /// Allocates memory from this arena.
+    /// </summary>
+    /// <param name="size">The size of the memory.</param>
+    /// <param name="alignment">The alignment of the memory, which must be a power of two.</param>
+    /// <returns>The memory address.</returns>
+    void *gc_arena::Allocate(size_t size, size_t alignment)
+    {
+        if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+        {
+            std::ostringstream oss;
+            oss << "Requested alignment of " << alignment << " bytes is not a power of 2";
+            throw core::AppException<std::invalid_argument>("Invalid alignment for memory of GC arena", oss.str());
+        }
+
+        if (!m_chunks.empty())
+        {
+            auto addr = reinterpret_cast<char *> (
+                (reinterpret_cast<uintptr_t> (m_nextAddr) + alignment - 1) & ~static_cast<uintptr_t> (alignment - 1)
+            );
+
+            if (addr + size <= m_chunks.back().end)
+            {
+                m_nextAddr = addr + size;
+                m_allocatedBytes += size;
+                return addr;
+            }
+        }
+
+        // chunks from malloc are aligned for any fundamental type, so only stricter alignments need room:
+        size_t padding = (alignment > alignof(std::max_align_t)) ? alignment : 0;
+        size_t chunkSize = std::max(m_nextChunkSize, size + padding);
+
+        auto begin = static_cast<char *> (malloc(chunkSize));
+        if (begin == nullptr)
+            throw std::bad_alloc();
+
+        try
+        {
+            m_chunks.push_back(Chunk{ begin, begin + chunkSize });
+        }
+        catch (...)
+        {
+            free(begin);
+            throw;
+        }
+
+        m_nextChunkSize *= 2;
+
+        auto addr = reinterpret_cast<char *> (
+            (reinterpret_cast<uintptr_t> (begin) + alignment - 1) & ~static_cast<uintptr_t> (alignment - 1)
+        );
+
+        m_nextAddr = addr + size;
+        m_allocatedBytes += size;
+        return addr;
+    }
+
+    /// <summary>
+    /// Finds the arena of the calling thread containing a memory address.
+    /// </summary>
+    /// <param name="addr">The memory address.</param>
+    /// <returns>The arena, or <c>nullptr</c> when none contains the address.</returns>
+    gc_arena *gc_arena::Find(const void *addr)
+    {
+        auto charAddr = static_cast<const char *> (addr);
+
+        for (auto arena = innermost; arena != nullptr; arena = arena->m_outer)
+        {
+            // the latest chunks are the largest ones:
+            for (auto iter = arena->m_chunks.rbegin(); iter != arena->m_chunks.rend(); ++iter)
+            {
+                if (charAddr >= iter->begin && charAddr < iter->end)
+                    return arena;
+            }
+        }
+
+        return nullptr;
+    }
+
+    /// <summary>
+    /// Counts a reference to an object in an arena, if made by a safe pointer located elsewhere.
+    /// </summary>
+    /// <param name="sptrArena">The arena where the safe pointer is, if any.</param>
+    /// <param name="objArena">The arena where the object is, if any.</param>
+    void gc_arena::AddRef(gc_arena *sptrArena, gc_arena *objArena)
+    {
+        if (objArena != nullptr && objArena != sptrArena)
+            ++objArena->m_externalRefsCount;
+    }
+
+    /// <summary>
+    /// Undoes <see cref="AddRef"/>.
+    /// </summary>
+    /// <param name="sptrArena">The arena where the safe pointer is, if any.</param>
+    /// <param name="objArena">The arena where the object is, if any.</param>
+    void gc_arena::ReleaseRef(gc_arena *sptrArena, gc_arena *objArena)
+    {
+        if (objArena != nullptr && objArena != sptrArena)
+        {
+            _ASSERTE(objArena->m_externalRefsCount > 0);
+            --objArena->m_externalRefsCount;
+        }
+    }
+
+    /// <summary>
+    /// Keeps track of a safe pointer in an arena that is known to the GC.
+    /// </summary>
+    /// <param name="sptrArena">The arena where the safe pointer is, if any.</param>
+    /// <param name="sptrObjAddr">The address of the safe pointer.</param>
+    void gc_arena::TrackGCSptr(gc_arena *sptrArena, void *sptrObjAddr)
+    {
+        if (sptrArena != nullptr)
+            sptrArena->m_gcSptrs.insert(sptrObjAddr);
+    }
+
+    /// <summary>
+    /// Undoes <see cref="TrackGCSptr"/>.
+    /// </summary>
+    /// <param name="sptrArena">The arena where the safe pointer is, if any.</param>
+    /// <param name="sptrObjAddr">The address of the safe pointer.</param>
+    void gc_arena::UntrackGCSptr(gc_arena *sptrArena, void *sptrObjAddr)
+    {
+        if (sptrArena != nullptr)
+            sptrArena->m_gcSptrs.erase(sptrObjAddr);
+    }
+
+    /*
+        The remaining functions keep the GC informed about the safe pointers, when the calling thread
+        is in the scope of an arena. A safe pointer is known to the GC when it is not located in an arena,
+        or when it references an object managed by the GC. Otherwise, the GC only sees a null pointer.
+    */
+
+    /// <summary>
+    /// Detaches a safe pointer from the object it references, as far as the GC and the arenas are concerned.
+    /// </summary>
+    /// <param name="sptrObjAddr">The address of the safe pointer.</param>
+    /// <param name="sptrArena">The arena where the safe pointer is, if any.</param>
+    /// <param name="pointedAddr">The object referenced by the safe pointer.</param>
+    void gc_arena::Detach(void *sptrObjAddr, gc_arena *sptrArena, const void *pointedAddr)
+    {
+        if (pointedAddr == nullptr)
+            return;
+
+        auto objArena = Find(pointedAddr);
+
+        if (objArena != nullptr)
+            ReleaseRef(sptrArena, objArena);
+        else if (sptrArena != nullptr)
+        {
+            GarbageCollector::GetInstance().UnregisterSptr(sptrObjAddr);
+            UntrackGCSptr(sptrArena, sptrObjAddr);
+        }
+        else
+            GarbageCollector::GetInstance().ReleaseReference(sptrObjAddr);
+    }
+
+    /// <summary>
+    /// Registers a new safe pointer to nothing.
+    /// </summary>
+    void gc_arena::RegisterSptr(void *sptrObjAddr)
+    {
+        if (Find(sptrObjAddr) == nullptr)
+            GarbageCollector::GetInstance().RegisterSptr(sptrObjAddr, nullptr);
+    }
+
+    /// <summary>
+    /// Registers a new safe pointer as copy of another.
+    /// </summary>
+    void gc_arena::RegisterSptrCopy(void *sptrObjAddr, void *otherSptrObjAddr, const void *pointedAddr)
+    {
+        auto sptrArena = Find(sptrObjAddr);
+        auto objArena = (pointedAddr != nullptr) ? Find(pointedAddr) : nullptr;
+
+        if (pointedAddr != nullptr && objArena == nullptr)
+        {
+            GarbageCollector::GetInstance().RegisterSptrCopy(sptrObjAddr, otherSptrObjAddr);
+            TrackGCSptr(sptrArena, sptrObjAddr);
+            return;
+        }
+
+        if (sptrArena == nullptr)
+            GarbageCollector::GetInstance().RegisterSptr(sptrObjAddr, nullptr);
+
+        AddRef(sptrArena, objArena);
+    }
+
+    /// <summary>
+    /// Registers a new safe pointer that takes over the reference of another.
+    /// </summary>
+    void gc_arena::RegisterSptrMove(void *sptrObjAddr, void *otherSptrObjAddr, const void *pointedAddr)
+    {
+        auto sptrArena = Find(sptrObjAddr);
+        auto otherArena = Find(otherSptrObjAddr);
+        auto objArena = (pointedAddr != nullptr) ? Find(pointedAddr) : nullptr;
+
+        if (pointedAddr != nullptr && objArena == nullptr)
+        {
+            auto &gc = GarbageCollector::GetInstance();
+            gc.RegisterSptrMove(sptrObjAddr, otherSptrObjAddr);
+            TrackGCSptr(sptrArena, sptrObjAddr);
+
+            // the other is left pointing nothing, which the GC must not know in an arena:
+            if (otherArena != nullptr)
+            {
+                gc.UnregisterSptr(otherSptrObjAddr);
+                UntrackGCSptr(otherArena, otherSptrObjAddr);
+            }
+
+            return;
+        }
+
+        if (sptrArena == nullptr)
+            GarbageCollector::GetInstance().RegisterSptr(sptrObjAddr, nullptr);
+
+        AddRef(sptrArena, objArena);
+        ReleaseRef(otherArena, objArena);
+    }
+
+    /// <summary>
+    /// Registers a new safe pointer to an object just created in the innermost arena.
+    /// </summary>
+    void gc_arena::RegisterSptrWithNewObject(void *sptrObjAddr)
+    {
+        auto sptrArena = Find(sptrObjAddr);
+
+        if (sptrArena == nullptr)
+            GarbageCollector::GetInstance().RegisterSptr(sptrObjAddr, nullptr);
+
+        AddRef(sptrArena, innermost);
+    }
+
+    /// <summary>
+    /// Unregisters a safe pointer that is gone.
+    /// </summary>
+    void gc_arena::UnregisterSptr(void *sptrObjAddr, const void *pointedAddr)
+    {
+        auto sptrArena = Find(sptrObjAddr);
+        auto objArena = (pointedAddr != nullptr) ? Find(pointedAddr) : nullptr;
+
+        if (sptrArena == nullptr || (pointedAddr != nullptr && objArena == nullptr))
+        {
+            GarbageCollector::GetInstance().UnregisterSptr(sptrObjAddr);
+            UntrackGCSptr(sptrArena, sptrObjAddr);
+        }
+
+        ReleaseRef(sptrArena, objArena);
+    }
+
+    /// <summary>
+    /// Makes a safe pointer reference the object of another.
+    /// </summary>
+    void gc_arena::UpdateReference(void *sptrObjAddr, const void *pointedAddr,
+                                   void *otherSptrObjAddr, const void *otherPointedAddr)
+    {
+        auto sptrArena = Find(sptrObjAddr);
+        auto otherObjArena = (otherPointedAddr != nullptr) ? Find(otherPointedAddr) : nullptr;
+
+        if (otherPointedAddr != nullptr && otherObjArena == nullptr)
+        {
+            auto objArena = (pointedAddr != nullptr) ? Find(pointedAddr) : nullptr;
+            auto &gc = GarbageCollector::GetInstance();
+
+            if (sptrArena == nullptr || (pointedAddr != nullptr && objArena == nullptr))
+                gc.UpdateReference(sptrObjAddr, otherSptrObjAddr);
+            else
+                gc.RegisterSptrCopy(sptrObjAddr, otherSptrObjAddr);
+
+            TrackGCSptr(sptrArena, sptrObjAddr);
+            ReleaseRef(sptrArena, objArena);
+            return;
+        }
+
+        Detach(sptrObjAddr, sptrArena, pointedAddr);
+        AddRef(sptrArena, otherObjArena);
+    }
+
+    /// <summary>
+    /// Makes a safe pointer take over the reference of another.
+    /// </summary>
+    void gc_arena::MoveReference(void *sptrObjAddr, const void *pointedAddr,
+                                 void *otherSptrObjAddr, const void *otherPointedAddr)
+    {
+        auto sptrArena = Find(sptrObjAddr);
+        auto otherArena = Find(otherSptrObjAddr);
+        auto otherObjArena = (otherPointedAddr != nullptr) ? Find(otherPointedAddr) : nullptr;
+
+        if (otherPointedAddr != nullptr && otherObjArena == nullptr)
+        {
+            auto objArena = (pointedAddr != nullptr) ? Find(pointedAddr) : nullptr;
+            auto &gc = GarbageCollector::GetInstance();
+
+            if (sptrArena == nullptr || (pointedAddr != nullptr && objArena == nullptr))
+                gc.MoveReference(sptrObjAddr, otherSptrObjAddr);
+            else
+                gc.RegisterSptrMove(sptrObjAddr, otherSptrObjAddr);
+
+            TrackGCSptr(sptrArena, sptrObjAddr);
+
+            if (otherArena != nullptr)
+            {
+                gc.UnregisterSptr(otherSptrObjAddr);
+                UntrackGCSptr(otherArena, otherSptrObjAddr);
+            }
+
+            ReleaseRef(sptrArena, objArena);
+            return;
+        }
+
+        Detach(sptrObjAddr, sptrArena, pointedAddr);
+        AddRef(sptrArena, otherObjArena);
+        ReleaseRef(otherArena, otherObjArena);
+    }
+
+    /// <summary>
+    /// Registers a new <see cref="gc_vector"/> object with the GC,
+    /// keeping track of it when located in an arena.
+    /// </summary>
+    /// <param name="containerAddr">The address of the container.</param>
+    /// <param name="abandon">The callback that empties the container, should the arena be abandoned.</param>
+    void gc_arena::RegisterEdgeSet(void *containerAddr, AbandonProc abandon)
+    {
+        auto &gc = GarbageCollector::GetInstance();
+        gc.RegisterEdgeSet(containerAddr);
+
+        auto arena = IsActive() ? Find(containerAddr) : nullptr;
+        if (arena == nullptr)
+            return;
+
+        try
+        {
+            arena->m_edgeSets.emplace(containerAddr, abandon);
+        }
+        catch (...)
+        {
+            // the container does not get destroyed when its constructor throws:
+            gc.UnregisterEdgeSet(containerAddr);
+            throw;
+        }
+    }
+
+    /// <summary>
+    /// Unregisters a <see cref="gc_vector"/> object that is gone.
+    /// </summary>
+    /// <param name="containerAddr">The address of the container.</param>
+    void gc_arena::UnregisterEdgeSet(void *containerAddr)
+    {
+        GarbageCollector::GetInstance().UnregisterEdgeSet(containerAddr);
+
+        auto arena = IsActive() ? Find(containerAddr) : nullptr;
+        if (arena != nullptr)
+            arena->m_edgeSets.erase(containerAddr);
+    }
+
+    /// <summary>
+    /// Makes a safe pointer reference nothing.
+    /// </summary>
+    void gc_arena::ReleaseReference(void *sptrObjAddr, const void *pointedAddr)
+    {
+        Detach(sptrObjAddr, Find(sptrObjAddr), pointedAddr);
+    }
+
+    /// <summary>
+    /// Makes a safe pointer reference an object just created in the innermost arena.
+    /// </summary>
+    void gc_arena::AcquireNewObject(void *sptrObjAddr, const void *pointedAddr)
+    {
+        auto sptrArena = Find(sptrObjAddr);
+        Detach(sptrObjAddr, sptrArena, pointedAddr);
+        AddRef(sptrArena, innermost);
+    }
+
+}// end of namespace memory
+}// end of namespace _3fd
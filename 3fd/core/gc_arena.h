@@ -0,0 +1,233 @@
+#ifndef GC_ARENA_H // header guard
+#define GC_ARENA_H
+
+#include <3fd/core/gc_common.h>
+#include <3fd/core/preprocessing.h>
+
+#include <cstddef>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace _3fd
+{
+namespace memory
+{
+    template <typename Type> class sptr_base;
+
+    /// <summary>
+    /// Destroys an object created in a <see cref="gc_arena"/>.
+    /// This is compiled by the client code compiler.
+    /// </summary>
+    /// <param name="addr">The memory address.</param>
+    template <typename X>
+    void DestroyArenaObject(void *addr)
+    {
+        static_cast<X *> (addr)->X::~X();
+    }
+
+    /// <summary>
+    /// Destroys an array created in a <see cref="gc_arena"/>.
+    /// This is compiled by the client code compiler.
+    /// </summary>
+    /// <param name="addr">The memory address, where the array header is.</param>
+    template <typename X>
+    void DestroyArenaArray(void *addr)
+    {
+        auto header = static_cast<GCArrayHeader *> (addr);
+        auto elements = reinterpret_cast<X *> (static_cast<char *> (addr) + header->elementsOffset);
+
+        for (auto idx = header->count; idx > 0; --idx)
+            elements[idx - 1].X::~X();
+    }
+
+    /// <summary>
+    /// A scope in which the objects created by the calling thread, with the <see cref="has"/>
+    /// macro, <see cref="make_sptr"/> or <see cref="make_sptr_array"/>, are allocated from an
+    /// arena, rather than managed by the GC. They are all destroyed and freed at once when the
+    /// scope ends, which suits data that dies together, like that of a request.
+    /// </summary>
+    /// <remarks>
+    /// Objects in the arena are not vertices of the graph of the GC, and safe pointers inside them
+    /// are not known to the GC, unless they reference an object managed by it, which they then hold
+    /// just like roots. So the references among the objects in the arena cost no messages. Safe
+    /// pointers elsewhere, such as in the stack, can reference objects in the arena, but those must
+    /// be gone before the scope ends, as the arena counts them. A reference left by then has escaped
+    /// the scope, which is reported, and the memory of the arena is abandoned rather than freed, so
+    /// the escaped pointer remains valid. The abandoned objects are not destroyed, but the safe
+    /// pointers and the <see cref="gc_vector"/> objects inside them release the objects managed
+    /// by the GC, and become empty. Objects in the arena cannot be weakly referenced, must not
+    /// be handed over to other threads, and scopes must be nested in the same thread.
+    /// </remarks>
+    class gc_arena
+    {
+    private:
+
+        template <typename OtherType> friend class sptr_base;
+
+        template <typename OtherType> friend class gc_vector;
+
+        typedef void (*DestroyProc)(void *addr);
+
+        /// <summary>
+        /// Empties a container abandoned along with the arena, without telling the GC.
+        /// </summary>
+        typedef void (*AbandonProc)(void *containerAddr);
+
+        /// <summary>
+        /// A piece of memory from which the objects are allocated.
+        /// </summary>
+        struct Chunk
+        {
+            char *begin;
+            char *end;
+        };
+
+        /// <summary>
+        /// An object to destroy at the end of the scope.
+        /// </summary>
+        struct Object
+        {
+            void *addr;
+            DestroyProc destroy;
+        };
+
+        /// <summary>
+        /// The innermost arena of the calling thread.
+        /// </summary>
+        static thread_local gc_arena *innermost;
+
+        gc_arena *m_outer;
+
+        std::vector<Chunk> m_chunks;
+        char *m_nextAddr;
+        size_t m_nextChunkSize;
+        size_t m_allocatedBytes;
+
+        std::vector<Object> m_objects;
+
+        /// <summary>
+        /// How many safe pointers located elsewhere reference objects in this arena.
+        /// </summary>
+        size_t m_externalRefsCount;
+
+        /// <summary>
+        /// The safe pointers in this arena that reference objects managed by the GC.
+        /// </summary>
+        std::unordered_set<void *> m_gcSptrs;
+
+        /// <summary>
+        /// The containers of safe pointers in this arena, which the GC holds as roots.
+        /// </summary>
+        std::unordered_map<void *, AbandonProc> m_edgeSets;
+
+        void *Allocate(size_t size, size_t alignment);
+
+        static gc_arena *Find(const void *addr);
+
+        static void AddRef(gc_arena *sptrArena, gc_arena *objArena);
+
+        static void ReleaseRef(gc_arena *sptrArena, gc_arena *objArena);
+
+        static void Detach(void *sptrObjAddr, gc_arena *sptrArena, const void *pointedAddr);
+
+        static void TrackGCSptr(gc_arena *sptrArena, void *sptrObjAddr);
+
+        static void UntrackGCSptr(gc_arena *sptrArena, void *sptrObjAddr);
+
+        /// <summary>
+        /// Determines whether the calling thread is in the scope of any arena.
+        /// </summary>
+        static bool IsActive() { return innermost != nullptr; }
+
+        /// <summary>
+        /// Creates an object in the innermost arena of the calling thread.
+        /// </summary>
+        /// <param name="size">The size of the memory for the object.</param>
+        /// <param name="alignment">The alignment of the memory for the object.</param>
+        /// <param name="destroy">The callback that destroys the object, unless trivially destructible.</param>
+        /// <param name="construct">Constructs the object in the given memory.</param>
+        /// <returns>The memory address of the object.</returns>
+        template <typename ObjectType, typename Construct>
+        static void *CreateObject(size_t size, size_t alignment, DestroyProc destroy, const Construct &construct)
+        {
+            auto arena = innermost;
+            void *memAddr = arena->Allocate(size, alignment);
+
+            if (std::is_trivially_destructible<ObjectType>::value)
+            {
+                construct(memAddr);
+                return memAddr;
+            }
+
+            // room for the object in the list is made first, so it cannot fail once constructed:
+            arena->m_objects.push_back(Object{ memAddr, nullptr });
+
+            try
+            {
+                construct(memAddr);
+            }
+            catch (...)
+            {
+                arena->m_objects.pop_back();
+                throw;
+            }
+
+            arena->m_objects.back().destroy = destroy;
+            return memAddr;
+        }
+
+        static void RegisterSptr(void *sptrObjAddr);
+
+        static void RegisterSptrCopy(void *sptrObjAddr, void *otherSptrObjAddr, const void *pointedAddr);
+
+        static void RegisterSptrMove(void *sptrObjAddr, void *otherSptrObjAddr, const void *pointedAddr);
+
+        static void RegisterSptrWithNewObject(void *sptrObjAddr);
+
+        static void UnregisterSptr(void *sptrObjAddr, const void *pointedAddr);
+
+        static void UpdateReference(void *sptrObjAddr, const void *pointedAddr,
+                                    void *otherSptrObjAddr, const void *otherPointedAddr);
+
+        static void MoveReference(void *sptrObjAddr, const void *pointedAddr,
+                                  void *otherSptrObjAddr, const void *otherPointedAddr);
+
+        static void ReleaseReference(void *sptrObjAddr, const void *pointedAddr);
+
+        static void AcquireNewObject(void *sptrObjAddr, const void *pointedAddr);
+
+        static void RegisterEdgeSet(void *containerAddr, AbandonProc abandon);
+
+        static void UnregisterEdgeSet(void *containerAddr);
+
+    public:
+
+        explicit gc_arena(size_t initialChunkSize = 4096);
+
+        gc_arena(const gc_arena &) = delete;
+
+        ~gc_arena();
+
+        /// <summary>
+        /// Gets the total size of the memory allocated for objects in this arena.
+        /// </summary>
+        size_t GetAllocatedBytes() const { return m_allocatedBytes; }
+
+        /// <summary>
+        /// Gets how many safe pointers located elsewhere currently reference objects in
+        /// this arena. This must be zero by the end of the scope, otherwise they escaped.
+        /// </summary>
+        size_t GetExternalRefsCount() const { return m_externalRefsCount; }
+
+        /// <summary>
+        /// Determines whether a memory address is in an arena of the calling thread.
+        /// </summary>
+        static bool IsArenaMemory(const void *addr) { return IsActive() && Find(addr) != nullptr; }
+    };
+
+}// end of namespace memory
+}// end of namespace _3fd
+
+#endif // end of header guard
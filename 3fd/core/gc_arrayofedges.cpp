@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "gc_arrayofedges.h"
+#include "gc_vertex.h"
 #include "preprocessing.h"
 #include <algorithm>
 #include <cstdlib>
@@ -16,7 +17,7 @@ namespace _3fd
         /// </summary>
         /// <param name="begin">An iterator to the first position in the array interval to sort.</param>
         /// <param name="end">An iterator to one past the last position in the array interval to sort.</param>
-        static void InsertionSort(void **begin, void **end)
+        static void InsertionSort(uint32_t *begin, uint32_t *end)
         {
             auto &right = end;
             while (begin < --right)
@@ -38,12 +39,9 @@ namespace _3fd
         /// </summary>
         /// <param name="left">An iterator to the first position in the array interval to search.</param>
         /// <param name="right">An iterator to one past the last position in the array interval to search.</param>
-        /// <param name="what">
-        /// The memory address value to look for.
-        /// Addresses of root vertices must have the least significant bit set.
-        /// </param>
+        /// <param name="what">The vertex handle to look for.</param>
         /// <returns>An iterator to the position where it was found, otherwise, <c>nullptr</c>.</returns>
-        static void **Search(void **left, void **right, void *what)
+        static uint32_t *Search(uint32_t *left, uint32_t *right, uint32_t what)
         {
             // Use scan if the vector is small enough:
             auto size = right - left;
@@ -73,10 +71,9 @@ namespace _3fd
         /// Initializes a new instance of the <see cref="ArrayOfEdges"/> class.
         /// </summary>
         ArrayOfEdges::ArrayOfEdges() :
-            m_array(nullptr),
-            m_arraySize(0),
-            m_arrayCapacity(0),
-            m_rootCount(0)
+            m_regularCount(0),
+            m_rootCount(0),
+            m_onHeap(0)
         {}
 
         /// <summary>
@@ -84,62 +81,58 @@ namespace _3fd
         /// </summary>
         ArrayOfEdges::~ArrayOfEdges()
         {
-            if (m_array != nullptr)
-                free(m_array);
+            if (m_onHeap)
+                free(m_heapArray);
         }
 
         /// <summary>
-        /// Implementation to create a new edge.
+        /// Moves the edges to a storage of another capacity, which
+        /// is the inline one when small enough, otherwise, in the heap.
         /// </summary>
-        /// <param name="vtx">The address of the vertex to connect.</param>
-        void ArrayOfEdges::CreateEdgeImpl(void *vtx)
+        /// <param name="newCapacity">The new capacity, which must fit all the edges.</param>
+        /// <returns>
+        /// <c>true</c> if the storage has been replaced, otherwise,
+        /// <c>false</c>, when there is no memory available for it.
+        /// </returns>
+        bool ArrayOfEdges::Reallocate(uint32_t newCapacity)
         {
-            if (m_arrayCapacity > m_arraySize) // there is room in the array
-            {
-                m_array[m_arraySize++] = vtx;
-            }
-            else if (m_arrayCapacity > 0) // it must expand the array so as to make room
-            {
-                m_arrayCapacity *= 2;
-                auto temp = (void **)realloc(m_array, m_arrayCapacity * sizeof(void *));
+            _ASSERTE(newCapacity >= m_regularCount);
 
-                if (temp != nullptr)
-                    m_array = temp;
-                else
-                    throw std::bad_alloc();
+            auto oldArray = GetArray();
+            auto oldHeapArray = m_onHeap ? m_heapArray : nullptr;
 
-                m_array[m_arraySize++] = vtx;
-            }
-            else // the array is not yet allocated
+            if (newCapacity > inlineCapacity)
             {
-                m_array = (void **)malloc(sizeof(void *));
+                auto newHeapArray = static_cast<uint32_t *> (malloc((newCapacity + 1) * sizeof(uint32_t)));
+                if (newHeapArray == nullptr)
+                    return false;
 
-                if (m_array != nullptr)
-                    m_array[0] = vtx;
-                else
-                    throw std::bad_alloc();
-
-                m_arrayCapacity = m_arraySize = 1;
-                return;
+                newHeapArray[0] = newCapacity;
+                std::copy(oldArray, oldArray + m_regularCount, newHeapArray + 1);
+                m_heapArray = newHeapArray;
+                m_onHeap = 1;
+            }
+            else
+            {
+                // the heap pointer overlaps the inline storage, so it was saved before copying:
+                std::copy(oldArray, oldArray + m_regularCount, m_inlineArray);
+                m_onHeap = 0;
             }
 
-            // keep the array sorted
-            InsertionSort(m_array, m_array + m_arraySize);
+            if (oldHeapArray != nullptr)
+                free(oldHeapArray);
+
+            return true;
         }
 
         /// <summary>
-        /// Implementation to remove an edge.
+        /// Makes room for one more edge with a regular vertex, if the array is full.
         /// </summary>
-        /// <param name="vtx">The vertex to remove.</param>
-        void ArrayOfEdges::RemoveEdgeImpl(void *vtx)
+        void ArrayOfEdges::EvaluateExpandCapacity()
         {
-            auto where = Search(m_array, m_array + m_arraySize--, vtx);
-            _ASSERTE(where != nullptr); // cannot handle removal of unexistent edge
-
-            for (auto idx = where - m_array; idx < m_arraySize; ++idx)
-                m_array[idx] = m_array[idx + 1];
-
-            EvaluateShrinkCapacity();
+            auto capacity = GetCapacity();
+            if (m_regularCount == capacity && !Reallocate(capacity * 2))
+                throw std::bad_alloc();
         }
 
         /// <summary>
@@ -147,26 +140,21 @@ namespace _3fd
         /// </summary>
         void ArrayOfEdges::EvaluateShrinkCapacity()
         {
-            if (m_arraySize < m_arrayCapacity / 4)
-            {
-                m_arrayCapacity /= 2;
-                auto temp = (void **)realloc(m_array, m_arrayCapacity * sizeof(void *));
-
-                if (temp != nullptr)
-                    m_array = temp;
-                else
-                    throw std::bad_alloc();
-            }
+            /* Failing to shrink is harmless, because the current storage can still be used.
+            When the capacity gets down to the inline one, no memory is needed at all. */
+            auto capacity = GetCapacity();
+            if (capacity > inlineCapacity && m_regularCount < capacity / 4)
+                Reallocate(capacity / 2);
         }
 
         /// <summary>
         /// Adds an edge with a root vertex.
         /// </summary>
-        /// <param name="vtxRoot">The root vertex.</param>
-        void ArrayOfEdges::AddEdge(void *vtxRoot)
+        /// <param name="vtxRoot">The root vertex, which is not kept.</param>
+        void ArrayOfEdges::AddEdge(void * /* vtxRoot */)
         {
-            CreateEdgeImpl(vtxRoot);
             ++m_rootCount;
+            _ASSERTE(m_rootCount > 0); // overflow
         }
 
         /// <summary>
@@ -175,16 +163,24 @@ namespace _3fd
         /// <param name="vtxRegular">The regular vertex starting the edge.</param>
         void ArrayOfEdges::AddEdge(Vertex *vtxRegular)
         {
-            CreateEdgeImpl(vtxRegular);
+            _ASSERTE(vtxRegular->GetHandle() != VertexTable::invalidHandle); // vertex must come from the table
+
+            EvaluateExpandCapacity();
+
+            auto array = GetArray();
+            array[m_regularCount++] = vtxRegular->GetHandle();
+
+            // keep the array sorted
+            InsertionSort(array, array + m_regularCount);
         }
 
         /// <summary>
         /// Removes an edge with a root vertex.
         /// </summary>
-        /// <param name="vtxFrom">The root vertex.</param>
-        void ArrayOfEdges::RemoveEdge(void *vtxRoot)
+        /// <param name="vtxRoot">The root vertex, which is not kept.</param>
+        void ArrayOfEdges::RemoveEdge(void * /* vtxRoot */)
         {
-            RemoveEdgeImpl(vtxRoot);
+            _ASSERTE(m_rootCount > 0); // cannot handle removal of unexistent edge
             --m_rootCount;
         }
 
@@ -194,7 +190,14 @@ namespace _3fd
         /// <param name="vtxFrom">The regular vertex.</param>
         void ArrayOfEdges::RemoveEdge(Vertex *vtxRegular)
         {
-            RemoveEdgeImpl(vtxRegular);
+            auto array = GetArray();
+            auto where = Search(array, array + m_regularCount, vtxRegular->GetHandle());
+            _ASSERTE(where != nullptr && where != array + m_regularCount); // cannot handle removal of unexistent edge
+
+            std::copy(where + 1, array + m_regularCount, where);
+            --m_regularCount;
+
+            EvaluateShrinkCapacity();
         }
 
         /// <summary>
@@ -202,8 +205,13 @@ namespace _3fd
         /// </summary>
         void ArrayOfEdges::Clear()
         {
-            m_arraySize = m_rootCount = 0;
-            EvaluateShrinkCapacity();
+            m_regularCount = m_rootCount = 0;
+
+            if (m_onHeap)
+            {
+                free(m_heapArray);
+                m_onHeap = 0;
+            }
         }
 
         /// <summary>
@@ -212,7 +220,7 @@ namespace _3fd
         /// <returns>The amount of edges stored in this array.</returns>
         uint32_t ArrayOfEdges::Size() const
         {
-            return m_arraySize;
+            return m_regularCount + m_rootCount;
         }
 
         /// <summary>
@@ -228,7 +236,7 @@ namespace _3fd
 
         /// <summary>
         /// Iterates over each edge with regular vertex in this array.
-        /// This can only be used when this array has no edges with root vertices.
+        /// The edges with root vertices are only counted, hence not visited.
         /// </summary>
         /// <param name="callback">
         /// The callback to invoke for each vertex with an edge in this array.
@@ -236,14 +244,12 @@ namespace _3fd
         /// </param>
         void ArrayOfEdges::ForEachRegular(const std::function<bool(Vertex *)> &callback)
         {
-            /* if any edge with root vertex is present,
-            the cast below will be invalid for such edge */
-            _ASSERTE(!HasRootEdges());
+            auto array = GetArray();
 
             uint32_t idx(0);
-            while (idx < m_arraySize)
+            while (idx < m_regularCount)
             {
-                auto vertex = static_cast<Vertex *> (m_array[idx++]);
+                auto vertex = Vertex::FromHandle(array[idx++]);
                 
                 if (!callback(vertex))
                     break;
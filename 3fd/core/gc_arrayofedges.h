@@ -8,7 +8,8 @@
     The convention here is
 
     + Regular vertices are passed as 'Vertex *'
-    + Root vertices are passed as 'void *'
+    + Root vertices are passed as 'void *', but only counted
+    + Regular vertices are stored as their 32-bit handles
     + Memory addresses in general are handled as 'void *'
 */
 namespace _3fd
@@ -21,27 +22,60 @@ namespace memory
     /// A dinamically resizable array of edges,
     /// for implementation of directed graphs.
     /// </summary>
+    /// <remarks>
+    /// Edges with regular vertices are kept sorted as the 32-bit handles of the vertices,
+    /// whereas edges with root vertices are just counted, since the traversal of the graph
+    /// never needs to know where the roots are. The first edges are kept inline, and the
+    /// storage only spills to the heap beyond <see cref="inlineCapacity"/>.
+    /// </remarks>
     class ArrayOfEdges
     {
     private:
 
         /// <summary>
-        /// Holds pointers to all vertices, that represent receiving edges.
+        /// How many edges fit in the storage inside the object itself.
         /// </summary>
-        void **m_array;
+        static const uint32_t inlineCapacity = 2;
 
-        uint32_t m_arraySize;
+        /// <summary>
+        /// Holds the handles of the regular vertices, that represent receiving edges.
+        /// It is inline while the capacity does not exceed <see cref="inlineCapacity"/>.
+        /// In the heap, the first element is the capacity, followed by the handles.
+        /// </summary>
+        union
+        {
+            uint32_t m_inlineArray[inlineCapacity];
+            uint32_t *m_heapArray;
+        };
 
-        uint32_t m_arrayCapacity;
+        /// <summary>
+        /// Counting of how many regular vertices are in the array.
+        /// </summary>
+        uint32_t m_regularCount;
 
         /// <summary>
         /// Counting of how many root vertices are in the array.
         /// </summary>
-        uint32_t m_rootCount;
+        uint32_t m_rootCount : 31;
+
+        /// <summary>
+        /// Whether the storage is in the heap.
+        /// </summary>
+        uint32_t m_onHeap : 1;
+
+        uint32_t *GetArray()
+        {
+            return m_onHeap ? m_heapArray + 1 : m_inlineArray;
+        }
+
+        uint32_t GetCapacity() const
+        {
+            return m_onHeap ? m_heapArray[0] : inlineCapacity;
+        }
 
-        void CreateEdgeImpl(void *vtx);
+        bool Reallocate(uint32_t newCapacity);
 
-        void RemoveEdgeImpl(void *vtx);
+        void EvaluateExpandCapacity();
 
         void EvaluateShrinkCapacity();
 
@@ -2,6 +2,7 @@
 #define GC_COMMON_H
 
 #include <cstdlib>
+#include <new>
 
 namespace _3fd
 {
@@ -9,6 +10,8 @@ namespace memory
 {
     typedef void (*FreeMemProc)(void *addr, bool destroy);
 
+    void FreeMemoryFromGCHeap(void *addr);
+
     /// <summary>
     /// Frees memory allocated by the GC.
     /// This is compiled by the client code compiler.
@@ -22,15 +25,80 @@ namespace memory
         if (destroy)
             ptr->X::~X();
 
-#    ifdef _WIN32
-        _aligned_free(ptr);
-#    else
-        free(ptr);
-#    endif
+        FreeMemoryFromGCHeap(ptr);
+    }
+
+    /// <summary>
+    /// Precedes the elements of an array allocated by the GC.
+    /// Its size keeps the elements aligned as the blocks of the GC heap.
+    /// </summary>
+    struct alignas(16) GCArrayHeader
+    {
+        size_t count;
+        size_t elementsOffset;
+    };
+
+    /// <summary>
+    /// Gets where the elements of an array allocated by the GC start, counting from its memory block.
+    /// </summary>
+    /// <param name="alignment">The alignment of the elements, which is a power of 2.</param>
+    /// <returns>The offset of the elements.</returns>
+    inline size_t GetArrayElementsOffset(size_t alignment)
+    {
+        return (alignment > sizeof(GCArrayHeader)) ? alignment : sizeof(GCArrayHeader);
+    }
+
+    /// <summary>
+    /// Writes the header in the beginning of the memory block of an array allocated by the GC.
+    /// When the elements are further ahead because of their alignment, the header is repeated
+    /// right before them, where the safe pointers look for it.
+    /// </summary>
+    /// <param name="addr">The memory address.</param>
+    /// <param name="count">How many elements the array has.</param>
+    /// <param name="elementsOffset">The offset of the elements, as given by <see cref="GetArrayElementsOffset"/>.</param>
+    /// <returns>The address where the elements start.</returns>
+    inline void *InitArrayHeaders(void *addr, size_t count, size_t elementsOffset)
+    {
+        auto header = new (addr) GCArrayHeader;
+        header->count = count;
+        header->elementsOffset = elementsOffset;
+
+        auto elements = static_cast<char *> (addr) + elementsOffset;
+
+        if (elementsOffset > sizeof(GCArrayHeader))
+            new (elements - sizeof(GCArrayHeader)) GCArrayHeader(*header);
+
+        return elements;
+    }
+
+    /// <summary>
+    /// Frees memory allocated by the GC for an array.
+    /// This is compiled by the client code compiler.
+    /// </summary>
+    /// <param name="addr">The memory address, where the array header is.</param>
+    template <typename X>
+    void FreeArrayMemAddr(void *addr, bool destroy = true)
+    {
+        auto header = static_cast<GCArrayHeader *> (addr);
+
+        if (destroy)
+        {
+            auto elements = reinterpret_cast<X *> (static_cast<char *> (addr) + header->elementsOffset);
+
+            for (auto idx = header->count; idx > 0; --idx)
+                elements[idx - 1].X::~X();
+        }
+
+        FreeMemoryFromGCHeap(addr);
     }
 
+    size_t GetArrayBlockSize(size_t count, size_t elementSize, size_t elementsOffset);
+
+    void *AllocMemoryFromGCHeap(size_t size, size_t alignment);
+
     void *AllocMemoryAndRegisterWithGC(
         size_t size,
+        size_t alignment,
         void *sptrObjAddr,
         FreeMemProc freeMemCallback
     );
@@ -0,0 +1,685 @@
+#include "pch.h"
+#include "gc_digraphshards.h"
+
+#include <algorithm>
+
+namespace _3fd
+{
+namespace memory
+{
+    // How many messages a batch takes at most:
+    static const size_t maxBatchSize(4096);
+
+    // Batches with less messages than this are executed by the requesting thread alone:
+    static const size_t minBatchSizeForWorkers(256);
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="DigraphShards"/> class.
+    /// </summary>
+    /// <param name="numShards">
+    /// How many shards there are, hence how many threads update them,
+    /// including the one that requests the execution of the messages.
+    /// </param>
+    DigraphShards::DigraphShards(uint32_t numShards) :
+        m_jobNumber(0),
+        m_busyWorkers(0),
+        m_terminate(false),
+        m_updatedPointersShardsCount(0),
+        m_graph(nullptr)
+    {
+        numShards = std::max(numShards, 1U);
+
+        for (uint32_t idx = 0; idx < numShards; ++idx)
+            m_shards.emplace_back(new Shard(numShards));
+
+        m_batch.reserve(maxBatchSize);
+        m_rightPointedMemBlocks.reserve(maxBatchSize);
+
+        // the thread requesting the execution has the shard zero:
+        for (uint32_t id = 1; id < numShards; ++id)
+            m_workers.emplace_back(&DigraphShards::WorkerProc, this, id);
+    }
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="DigraphShards"/> class.
+    /// </summary>
+    DigraphShards::~DigraphShards()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_jobMutex);
+            m_terminate = true;
+        }
+
+        m_jobStartCondition.notify_all();
+
+        for (auto &worker : m_workers)
+            worker.join();
+    }
+
+    /// <summary>
+    /// Gets the shard that owns a pointer or a vertex.
+    /// </summary>
+    /// <param name="addr">The address of either the pointer or the vertex.</param>
+    /// <returns>The index of the shard.</returns>
+    uint32_t DigraphShards::GetShardOf(const void *addr) const
+    {
+        /* The hash table of pointers in a shard takes the upper bits of a multiplicative
+        hash, so the shards cannot be told by those bits, or else each table would only
+        use a fraction of its buckets. Mix all bits instead (finalizer of MurmurHash3): */
+        auto key = static_cast<uint64_t> (reinterpret_cast<uintptr_t> (addr));
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ULL;
+        key ^= key >> 33;
+
+        return static_cast<uint32_t> (((key & 0xffffffffULL) * m_shards.size()) >> 32);
+    }
+
+    /// <summary>
+    /// Gets the shard that owns the pointer or the edge set a message applies to.
+    /// </summary>
+    /// <param name="message">The message.</param>
+    /// <returns>The index of the shard.</returns>
+    uint32_t DigraphShards::GetShardOf(const Message &message) const
+    {
+        switch (message.type)
+        {
+        case MessageType::EdgeSetRegistration:
+        case MessageType::EdgesAddition:
+        case MessageType::EdgesRemoval:
+        case MessageType::EdgeSetSwap:
+        case MessageType::EdgeSetUnregistration:
+            return 0;
+        default:
+            return GetShardOf(message.sptrObjAddr);
+        }
+    }
+
+    /// <summary>
+    /// Determines whether a batch of messages is due for execution.
+    /// </summary>
+    bool DigraphShards::IsBatchFull() const
+    {
+        return m_batch.size() >= maxBatchSize;
+    }
+
+    /// <summary>
+    /// Gets how many pointers are in all shards.
+    /// </summary>
+    size_t DigraphShards::GetPointersCount() const
+    {
+        size_t count(0);
+        for (auto &shard : m_shards)
+            count += shard->sptrObjects.GetElementsCount();
+
+        return count;
+    }
+
+    /// <summary>
+    /// Iterates over each pointer in the shards, which must have no batch in execution.
+    /// </summary>
+    /// <param name="callback">The callback to invoke for each pointer.</param>
+    void DigraphShards::ForEachPointer(const std::function<void(const AddressesHashTable::Element &)> &callback) const
+    {
+        for (auto &shard : m_shards)
+            shard->sptrObjects.ForEach(callback);
+    }
+
+    /// <summary>
+    /// Adds a message to the batch. The vertex of a new object
+    /// is added to the graph right away, as there can be no
+    /// pointer in the batch already referring to its memory.
+    /// </summary>
+    /// <remarks>
+    /// Weak references are handled right away as well, because no memory is
+    /// collected before the end of the batch, when the pointer produced by a
+    /// lock already references the memory block, which can then be unlocked.
+    /// </remarks>
+    /// <param name="message">The message to add.</param>
+    /// <param name="graph">The memory graph.</param>
+    void DigraphShards::Enqueue(const Message &message, MemoryDigraph &graph)
+    {
+        _ASSERTE(message.type != MessageType::Fence); // fences are handled by the GC itself
+
+        switch (message.type)
+        {
+        case MessageType::NewObject:
+        case MessageType::SptrNewObjectRegistration:
+            graph.AddRegularVertex(message.otherAddr, message.blockSize, message.freeMemCallback);
+            break;
+
+        case MessageType::WeakReferenceRegistration:
+            graph.AddWeakReferences(message.otherAddr);
+            return;
+
+        case MessageType::SptrWeakLockRegistration:
+            graph.UnlockWeakReference(message.otherAddr);
+            m_batch.push_back(Message{ MessageType::SptrRegistration, message.sptrObjAddr, message.otherAddr, 0, nullptr });
+            return;
+
+        default:
+            break;
+        }
+
+        m_batch.push_back(message);
+    }
+
+    /// <summary>
+    /// Determines whether a message has the address of another
+    /// <see cref="sptr"/> object in its right side.
+    /// </summary>
+    /// <param name="type">The type of message.</param>
+    static bool HasRightSptr(MessageType type)
+    {
+        switch (type)
+        {
+        case MessageType::ReferenceUpdate:
+        case MessageType::ReferenceMove:
+        case MessageType::SptrCopyRegistration:
+        case MessageType::SptrMoveRegistration:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    /// <summary>
+    /// Executes the messages in the batch, which is left empty.
+    /// </summary>
+    /// <param name="graph">The memory graph.</param>
+    void DigraphShards::ExecuteBatch(MemoryDigraph &graph)
+    {
+        if (m_batch.empty())
+            return;
+
+        m_graph = &graph;
+        m_rightPointedMemBlocks.assign(m_batch.size(), nullptr);
+
+        /* For a small batch, waking up the workers takes longer than the work
+        itself. Go through the messages in order, executing the part of each
+        shard, which never waits because the right side always goes first: */
+        if (m_workers.empty() || m_batch.size() < minBatchSizeForWorkers)
+        {
+            for (size_t msgIndex = 0; msgIndex < m_batch.size(); ++msgIndex)
+            {
+                auto &message = m_batch[msgIndex];
+                auto leftShardId = GetShardOf(message);
+
+                if (HasRightSptr(message.type))
+                {
+                    auto rightShardId = GetShardOf(message.otherAddr);
+                    UpdatePointers(rightShardId, msgIndex);
+
+                    if (rightShardId == leftShardId)
+                        continue;
+                }
+
+                UpdatePointers(leftShardId, msgIndex);
+            }
+
+            for (uint32_t id = 0; id < m_shards.size(); ++id)
+                UpdateVertices(id);
+        }
+        else
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_jobMutex);
+                m_updatedPointersShardsCount = 0;
+                m_busyWorkers = static_cast<uint32_t> (m_workers.size());
+                ++m_jobNumber;
+            }
+
+            m_jobStartCondition.notify_all();
+
+            DoWork(0);
+
+            std::unique_lock<std::mutex> lock(m_jobMutex);
+            m_jobEndCondition.wait(lock, [this]() { return m_busyWorkers == 0; });
+        }
+
+        for (auto &shard : m_shards)
+        {
+            if (shard->error != nullptr)
+            {
+                auto error = shard->error;
+                shard->error = nullptr;
+                std::rethrow_exception(error);
+            }
+        }
+
+        // Settle the changed vertices, which might collect memory:
+        for (auto &shard : m_shards)
+        {
+            for (auto memBlock : shard->changedVertices)
+                graph.SettleChanges(memBlock);
+
+            shard->changedVertices.clear();
+
+            for (auto &changes : shard->changesTo)
+                changes.clear();
+
+            shard->progress.store(0, std::memory_order_relaxed);
+        }
+
+        m_batch.clear();
+    }
+
+    /// <summary>
+    /// Executed by each thread of the pool, which waits
+    /// for a batch of messages and updates its shard.
+    /// </summary>
+    /// <param name="id">The identifier of the thread, which is the index of its shard.</param>
+    void DigraphShards::WorkerProc(uint32_t id)
+    {
+        uint64_t lastJobNumber(0);
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_jobMutex);
+                m_jobStartCondition.wait(lock, [this, lastJobNumber]()
+                {
+                    return m_terminate || m_jobNumber != lastJobNumber;
+                });
+
+                if (m_terminate)
+                    return;
+
+                lastJobNumber = m_jobNumber;
+            }
+
+            DoWork(id);
+
+            std::lock_guard<std::mutex> lock(m_jobMutex);
+            if (--m_busyWorkers == 0)
+                m_jobEndCondition.notify_one();
+        }
+    }
+
+    /// <summary>
+    /// Updates the pointers of a shard, and then its vertices once
+    /// all shards are done with the pointers. Errors are kept in
+    /// the shard, so the other threads never wait for it in vain.
+    /// </summary>
+    /// <param name="id">The identifier of the thread, which is the index of its shard.</param>
+    void DigraphShards::DoWork(uint32_t id)
+    {
+        auto &shard = *m_shards[id];
+
+        try
+        {
+            UpdatePointers(id);
+        }
+        catch (...)
+        {
+            shard.error = std::current_exception();
+            shard.progress.store(SIZE_MAX, std::memory_order_release);
+        }
+
+        /* A batch large enough for the workers keeps the shards busy for long, and
+        unevenly so, hence those done with the pointers sleep until the last one: */
+        {
+            std::unique_lock<std::mutex> lock(m_jobMutex);
+
+            if (++m_updatedPointersShardsCount == m_shards.size())
+                m_updatedPointersCondition.notify_all();
+            else
+            {
+                m_updatedPointersCondition.wait(lock, [this]()
+                {
+                    return m_updatedPointersShardsCount == m_shards.size();
+                });
+            }
+        }
+
+        if (shard.error != nullptr)
+            return;
+
+        try
+        {
+            UpdateVertices(id);
+        }
+        catch (...)
+        {
+            shard.error = std::current_exception();
+        }
+    }
+
+    /// <summary>
+    /// Goes through all messages in the batch updating the pointers of a shard.
+    /// </summary>
+    /// <param name="id">The index of the shard.</param>
+    void DigraphShards::UpdatePointers(uint32_t id)
+    {
+        for (size_t msgIndex = 0; msgIndex < m_batch.size(); ++msgIndex)
+            UpdatePointers(id, msgIndex);
+    }
+
+    /// <summary>
+    /// Executes the part of a message that concerns the pointers of a shard.
+    /// </summary>
+    /// <param name="id">The index of the shard.</param>
+    /// <param name="msgIndex">The index of the message in the batch.</param>
+    void DigraphShards::UpdatePointers(uint32_t id, size_t msgIndex)
+    {
+        auto &shard = *m_shards[id];
+        auto &message = m_batch[msgIndex];
+        auto ownsLeftSptr = (GetShardOf(message) == id);
+
+        Vertex *rightPointedMemBlock(nullptr);
+
+        if (HasRightSptr(message.type))
+        {
+            auto rightShardId = GetShardOf(message.otherAddr);
+
+            if (rightShardId == id)
+            {
+                auto &rightSptrObjHashTableElem = shard.sptrObjects.Lookup(message.otherAddr);
+                rightPointedMemBlock = rightSptrObjHashTableElem.GetPointedMemBlock();
+                m_rightPointedMemBlocks[msgIndex] = rightPointedMemBlock;
+
+                /* The pointer in the left side takes over the reference in this same message,
+                so the pointed memory block does not become unreachable by losing this edge: */
+                if (message.type == MessageType::ReferenceMove
+                    || message.type == MessageType::SptrMoveRegistration)
+                {
+                    UnmakeReference(shard, rightSptrObjHashTableElem, 0, msgIndex);
+                }
+            }
+            else if (ownsLeftSptr)
+            {
+                auto &rightShard = *m_shards[rightShardId];
+
+                while (rightShard.progress.load(std::memory_order_acquire) <= msgIndex)
+                    std::this_thread::yield();
+
+                rightPointedMemBlock = m_rightPointedMemBlocks[msgIndex];
+            }
+        }
+
+        if (ownsLeftSptr)
+        {
+            auto &sptrObjects = shard.sptrObjects;
+            const uint8_t lostIncomingEdge = Vertex::LostIncomingEdge;
+
+            switch (message.type)
+            {
+            case MessageType::NewObject:
+            {
+                auto &sptrObjHashTableElem = sptrObjects.Lookup(message.sptrObjAddr);
+                UnmakeReference(shard, sptrObjHashTableElem, lostIncomingEdge, msgIndex);
+                MakeReference(shard, sptrObjHashTableElem, m_graph->GetVertex(message.otherAddr), msgIndex);
+                break;
+            }
+            case MessageType::ReferenceUpdate:
+            case MessageType::ReferenceMove:
+            {
+                auto &sptrObjHashTableElem = sptrObjects.Lookup(message.sptrObjAddr);
+                UnmakeReference(shard, sptrObjHashTableElem, lostIncomingEdge, msgIndex);
+
+                if (rightPointedMemBlock != nullptr)
+                    MakeReference(shard, sptrObjHashTableElem, rightPointedMemBlock, msgIndex);
+
+                break;
+            }
+            case MessageType::ReferenceRelease:
+                UnmakeReference(shard, sptrObjects.Lookup(message.sptrObjAddr), lostIncomingEdge, msgIndex);
+                break;
+
+            case MessageType::AbortedObject:
+                UnmakeReference(shard, sptrObjects.Lookup(message.sptrObjAddr),
+                                lostIncomingEdge | Vertex::AbortedObject, msgIndex);
+                break;
+
+            case MessageType::SptrRegistration:
+            case MessageType::SptrNewObjectRegistration:
+            {
+                auto containerMemBlock = m_graph->GetContainerVertex(message.sptrObjAddr); // null if root
+                auto &sptrObjHashTableElem = sptrObjects.Insert(message.sptrObjAddr, nullptr, containerMemBlock);
+
+                if (message.otherAddr != nullptr)
+                {
+                    // might point inside the memory block, as for an object taken from a gc_vector:
+                    auto pointedMemBlock = m_graph->GetContainerVertex(message.otherAddr);
+                    _ASSERTE(pointedMemBlock != nullptr); // must not have been collected
+                    MakeReference(shard, sptrObjHashTableElem, pointedMemBlock, msgIndex);
+                }
+
+                break;
+            }
+            case MessageType::SptrCopyRegistration:
+            case MessageType::SptrMoveRegistration:
+            {
+                auto containerMemBlock = m_graph->GetContainerVertex(message.sptrObjAddr); // null if root
+                auto &sptrObjHashTableElem = sptrObjects.Insert(message.sptrObjAddr, nullptr, containerMemBlock);
+
+                if (rightPointedMemBlock != nullptr)
+                    MakeReference(shard, sptrObjHashTableElem, rightPointedMemBlock, msgIndex);
+
+                break;
+            }
+            case MessageType::SptrUnregistration:
+            {
+                auto &sptrObjHashTableElem = sptrObjects.Lookup(message.sptrObjAddr);
+                UnmakeReference(shard, sptrObjHashTableElem, lostIncomingEdge, msgIndex);
+                sptrObjects.Remove(sptrObjHashTableElem);
+                break;
+            }
+            case MessageType::EdgeSetRegistration:
+            case MessageType::EdgesAddition:
+            case MessageType::EdgesRemoval:
+            case MessageType::EdgeSetSwap:
+            case MessageType::EdgeSetUnregistration:
+                UpdateEdgeSet(shard, message, msgIndex);
+                break;
+
+            default:
+                _ASSERTE(false); // unknown type of message
+                break;
+            }
+        }
+
+        shard.progress.store(msgIndex + 1, std::memory_order_release);
+    }
+
+    /// <summary>
+    /// Sets the connection between a pointer and its referred memory block,
+    /// recording the creation of the edge for the shard of the vertex.
+    /// </summary>
+    /// <param name="shard">The shard owning the pointer.</param>
+    /// <param name="sptrObjHashTableElem">A hashtable element which represents the pointer.</param>
+    /// <param name="pointedMemBlock">The vertex representing the referred memory block.</param>
+    /// <param name="msgIndex">The index of the message in the batch.</param>
+    void DigraphShards::MakeReference(Shard &shard,
+                                      AddressesHashTable::Element &sptrObjHashTableElem,
+                                      Vertex *pointedMemBlock,
+                                      size_t msgIndex)
+    {
+        sptrObjHashTableElem.SetPointedMemBlock(pointedMemBlock);
+
+        if (sptrObjHashTableElem.IsRoot())
+        {
+            RecordChange(shard, msgIndex, ChangeType::AddRootEdge, 0,
+                         pointedMemBlock, sptrObjHashTableElem.GetSptrObjectAddr());
+        }
+        else
+        {
+            auto originatorVtx = sptrObjHashTableElem.GetContainerMemBlock();
+            RecordChange(shard, msgIndex, ChangeType::IncrementOutgoingEdgeCount, 0, originatorVtx, nullptr);
+            RecordChange(shard, msgIndex, ChangeType::AddRegularEdge, 0, pointedMemBlock, originatorVtx);
+        }
+    }
+
+    /// <summary>
+    /// Unsets the connection between a pointer and its referred memory block,
+    /// recording the removal of the edge for the shard of the vertex.
+    /// </summary>
+    /// <param name="shard">The shard owning the pointer.</param>
+    /// <param name="sptrObjHashTableElem">A hashtable element which represents the pointer.</param>
+    /// <param name="pendingChanges">
+    /// The <see cref="Vertex::PendingChange"/> flags to leave in the referred memory block.
+    /// </param>
+    /// <param name="msgIndex">The index of the message in the batch.</param>
+    void DigraphShards::UnmakeReference(Shard &shard,
+                                        AddressesHashTable::Element &sptrObjHashTableElem,
+                                        uint8_t pendingChanges,
+                                        size_t msgIndex)
+    {
+        auto receivingVtx = sptrObjHashTableElem.GetPointedMemBlock();
+        sptrObjHashTableElem.SetPointedMemBlock(nullptr);
+
+        if (receivingVtx == nullptr)
+            return;
+
+        if (sptrObjHashTableElem.IsRoot())
+        {
+            RecordChange(shard, msgIndex, ChangeType::RemoveRootEdge, pendingChanges,
+                         receivingVtx, sptrObjHashTableElem.GetSptrObjectAddr());
+        }
+        else
+        {
+            auto originatorVtx = sptrObjHashTableElem.GetContainerMemBlock();
+            RecordChange(shard, msgIndex, ChangeType::DecrementOutgoingEdgeCount,
+                         Vertex::LostOutgoingEdge, originatorVtx, nullptr);
+            RecordChange(shard, msgIndex, ChangeType::RemoveRegularEdge, pendingChanges,
+                         receivingVtx, originatorVtx);
+        }
+    }
+
+    /// <summary>
+    /// Updates the set of edges of a container of safe pointers, recording the
+    /// changes to the edges for the shards of the vertices.
+    /// </summary>
+    /// <param name="shard">The shard owning the edge sets.</param>
+    /// <param name="message">The message for the edge set.</param>
+    /// <param name="msgIndex">The index of the message in the batch.</param>
+    void DigraphShards::UpdateEdgeSet(Shard &shard, const Message &message, size_t msgIndex)
+    {
+        m_edgeChanges.clear();
+        m_graph->UpdateEdgeSet(message, m_edgeChanges);
+
+        for (auto &change : m_edgeChanges)
+        {
+            if (change.origin == nullptr)
+            {
+                if (change.added)
+                    RecordChange(shard, msgIndex, ChangeType::AddRootEdge, 0, change.target, change.containerAddr);
+                else
+                {
+                    RecordChange(shard, msgIndex, ChangeType::RemoveRootEdge,
+                                 Vertex::LostIncomingEdge, change.target, change.containerAddr);
+                }
+            }
+            else if (change.added)
+            {
+                RecordChange(shard, msgIndex, ChangeType::IncrementOutgoingEdgeCount, 0, change.origin, nullptr);
+                RecordChange(shard, msgIndex, ChangeType::AddRegularEdge, 0, change.target, change.origin);
+            }
+            else
+            {
+                RecordChange(shard, msgIndex, ChangeType::DecrementOutgoingEdgeCount,
+                             Vertex::LostOutgoingEdge, change.origin, nullptr);
+                RecordChange(shard, msgIndex, ChangeType::RemoveRegularEdge,
+                             Vertex::LostIncomingEdge, change.target, change.origin);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Records a change to a vertex for the shard that owns it.
+    /// </summary>
+    void DigraphShards::RecordChange(Shard &shard,
+                                     size_t msgIndex,
+                                     ChangeType type,
+                                     uint8_t pendingChanges,
+                                     Vertex *memBlock,
+                                     void *origin)
+    {
+        shard.changesTo[GetShardOf(memBlock)].push_back(
+            VertexChange{ static_cast<uint32_t> (msgIndex), type, pendingChanges, memBlock, origin }
+        );
+    }
+
+    /// <summary>
+    /// Applies to the vertices of a shard the changes recorded for them by all
+    /// shards, in the order of the messages, and keeps the changed vertices.
+    /// </summary>
+    /// <param name="id">The index of the shard.</param>
+    void DigraphShards::UpdateVertices(uint32_t id)
+    {
+        auto &shard = *m_shards[id];
+        const auto numShards = m_shards.size();
+
+        std::vector<size_t> positions(numShards, 0);
+
+        while (true)
+        {
+            /* Merge the lists of changes by the index of the message, taking from the
+            one with the lowest index until it goes past the lowest index in the others: */
+            size_t from(numShards);
+            uint32_t lowest(UINT32_MAX);
+            uint32_t nextLowest(UINT32_MAX);
+
+            for (size_t idx = 0; idx < numShards; ++idx)
+            {
+                auto &changes = m_shards[idx]->changesTo[id];
+                if (positions[idx] == changes.size())
+                    continue;
+
+                auto msgIndex = changes[positions[idx]].msgIndex;
+                if (msgIndex < lowest)
+                {
+                    nextLowest = lowest;
+                    lowest = msgIndex;
+                    from = idx;
+                }
+                else if (msgIndex < nextLowest)
+                    nextLowest = msgIndex;
+            }
+
+            if (from == numShards)
+                break;
+
+            auto &changes = m_shards[from]->changesTo[id];
+            auto &pos = positions[from];
+
+            do
+            {
+                auto &change = changes[pos];
+                auto memBlock = change.memBlock;
+
+                switch (change.type)
+                {
+                case ChangeType::AddRootEdge:
+                    memBlock->ReceiveEdgeFrom(change.origin);
+                    break;
+                case ChangeType::AddRegularEdge:
+                    memBlock->ReceiveEdgeFrom(static_cast<Vertex *> (change.origin));
+                    break;
+                case ChangeType::RemoveRootEdge:
+                    memBlock->RemoveEdgeFrom(change.origin);
+                    break;
+                case ChangeType::RemoveRegularEdge:
+                    memBlock->RemoveEdgeFrom(static_cast<Vertex *> (change.origin));
+                    break;
+                case ChangeType::IncrementOutgoingEdgeCount:
+                    memBlock->IncrementOutgoingEdgeCount();
+                    break;
+                case ChangeType::DecrementOutgoingEdgeCount:
+                    memBlock->DecrementOutgoingEdgeCount();
+                    break;
+                default:
+                    _ASSERTE(false); // unknown type of change
+                    break;
+                }
+
+                if (change.pendingChanges != 0 && memBlock->AddPendingChanges(change.pendingChanges))
+                    shard.changedVertices.push_back(memBlock);
+            }
+            while (++pos < changes.size() && changes[pos].msgIndex <= nextLowest);
+        }
+    }
+
+}// end of namespace memory
+}// end of namespace _3fd
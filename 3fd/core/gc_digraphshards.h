@@ -0,0 +1,194 @@
+#ifndef GC_DIGRAPHSHARDS_H // header guard
+#define GC_DIGRAPHSHARDS_H
+
+#include <3fd/core/gc_memorydigraph.h>
+#include <3fd/core/gc_addresseshashtable.h>
+#include <3fd/core/gc_messages.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace _3fd
+{
+namespace memory
+{
+    /// <summary>
+    /// Splits the execution of the GC messages among shards of the memory graph, each
+    /// one updated by a thread of its own. A shard owns the <see cref="sptr"/> objects
+    /// whose addresses hash to it, as well as the edges received by the vertices that
+    /// hash to it. The thread requesting the execution takes part as the first shard,
+    /// so the pool has one thread less than the amount of shards.
+    /// </summary>
+    /// <remarks>
+    /// The messages are executed in batches, and the batch goes through three phases. First,
+    /// every shard goes through the whole batch in order, updating the pointers it owns, and
+    /// records the changes they imply to the edges of the vertices, sorted by the shard that
+    /// owns the vertex. When a pointer takes the vertex of a pointer in another shard, it waits
+    /// for that shard to get there. Next, every shard applies in order the changes recorded for
+    /// its vertices by all shards. At last, the requesting thread settles the changed vertices:
+    /// those left without incoming edges are collected, and those that lost an edge become
+    /// candidates for reachability analysis. So the outcome is the same of executing the
+    /// messages one by one, except that no memory is collected before the end of the batch.
+    /// The edge sets of the containers of safe pointers are all owned by the first shard,
+    /// because they come in few messages, each one changing many edges.
+    /// </remarks>
+    class DigraphShards
+    {
+    private:
+
+        /// <summary>
+        /// Enumerates the changes to a vertex implied by the update of a pointer.
+        /// </summary>
+        enum class ChangeType : uint8_t
+        {
+            AddRootEdge,
+            AddRegularEdge,
+            RemoveRootEdge,
+            RemoveRegularEdge,
+            IncrementOutgoingEdgeCount,
+            DecrementOutgoingEdgeCount
+        };
+
+        /// <summary>
+        /// A change to a vertex, recorded by the shard owning the pointer
+        /// for the shard owning the vertex.
+        /// </summary>
+        struct VertexChange
+        {
+            uint32_t msgIndex;
+            ChangeType type;
+
+            /// <summary>
+            /// The <see cref="Vertex::PendingChange"/> flags the change leaves in the vertex.
+            /// </summary>
+            uint8_t pendingChanges;
+
+            Vertex *memBlock;
+
+            /// <summary>
+            /// Where the added or removed edge comes from, which is either
+            /// the address of a root pointer, or the container vertex.
+            /// </summary>
+            void *origin;
+        };
+
+        /// <summary>
+        /// The pointers in a shard, plus the work it has done over the batch.
+        /// </summary>
+        struct Shard
+        {
+            /// <summary>
+            /// How many messages of the batch this shard has gone through.
+            /// </summary>
+            alignas(64) std::atomic<size_t> progress;
+
+            AddressesHashTable sptrObjects;
+
+            /// <summary>
+            /// The changes recorded by this shard, per shard owning the vertex.
+            /// </summary>
+            std::vector<std::vector<VertexChange>> changesTo;
+
+            std::vector<Vertex *> changedVertices;
+
+            std::exception_ptr error;
+
+            Shard(uint32_t numShards) :
+                progress(0),
+                changesTo(numShards)
+            {}
+        };
+
+        std::vector<std::unique_ptr<Shard>> m_shards;
+        std::vector<std::thread> m_workers;
+
+        std::mutex m_jobMutex;
+        std::condition_variable m_jobStartCondition;
+        std::condition_variable m_jobEndCondition;
+        uint64_t m_jobNumber;
+        uint32_t m_busyWorkers;
+        bool m_terminate;
+
+        // The barrier between updating the pointers and updating the vertices, also under the job lock:
+        std::condition_variable m_updatedPointersCondition;
+        uint32_t m_updatedPointersShardsCount;
+
+        std::vector<Message> m_batch;
+
+        /// <summary>
+        /// For each message in the batch, the vertex pointed by the
+        /// <see cref="sptr"/> object in the right side of the operation.
+        /// </summary>
+        std::vector<Vertex *> m_rightPointedMemBlocks;
+
+        /// <summary>
+        /// The changes to the edges implied by a message for the edge sets.
+        /// </summary>
+        std::vector<EdgeSets::EdgeChange> m_edgeChanges;
+
+        MemoryDigraph *m_graph;
+
+        uint32_t GetShardOf(const void *addr) const;
+
+        uint32_t GetShardOf(const Message &message) const;
+
+        void WorkerProc(uint32_t id);
+
+        void DoWork(uint32_t id);
+
+        void UpdatePointers(uint32_t id);
+
+        void UpdatePointers(uint32_t id, size_t msgIndex);
+
+        void MakeReference(Shard &shard, AddressesHashTable::Element &sptrObjHashTableElem,
+                           Vertex *pointedMemBlock, size_t msgIndex);
+
+        void UnmakeReference(Shard &shard, AddressesHashTable::Element &sptrObjHashTableElem,
+                             uint8_t pendingChanges, size_t msgIndex);
+
+        void UpdateEdgeSet(Shard &shard, const Message &message, size_t msgIndex);
+
+        void RecordChange(Shard &shard, size_t msgIndex, ChangeType type,
+                          uint8_t pendingChanges, Vertex *memBlock, void *origin);
+
+        void UpdateVertices(uint32_t id);
+
+    public:
+
+        DigraphShards(uint32_t numShards);
+
+        DigraphShards(const DigraphShards &) = delete;
+
+        ~DigraphShards();
+
+        /// <summary>
+        /// Gets how many shards there are.
+        /// </summary>
+        uint32_t GetNumShards() const { return static_cast<uint32_t> (m_shards.size()); }
+
+        /// <summary>
+        /// Determines whether the batch has no messages.
+        /// </summary>
+        bool IsBatchEmpty() const { return m_batch.empty(); }
+
+        bool IsBatchFull() const;
+
+        size_t GetPointersCount() const;
+
+        void ForEachPointer(const std::function<void(const AddressesHashTable::Element &)> &callback) const;
+
+        void Enqueue(const Message &message, MemoryDigraph &graph);
+
+        void ExecuteBatch(MemoryDigraph &graph);
+    };
+
+}// end of namespace memory
+}// end of namespace _3fd
+
+#endif // end of header guard
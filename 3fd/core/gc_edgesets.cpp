@@ -0,0 +1,188 @@
+#include "pch.h"
+#include "gc_edgesets.h"
+
+#include <algorithm>
+
+namespace _3fd
+{
+namespace memory
+{
+    /// <summary>
+    /// Gets the set of edges of a container, which must be registered.
+    /// </summary>
+    /// <param name="containerAddr">The address of the container.</param>
+    /// <returns>The set of edges.</returns>
+    EdgeSets::EdgeSet &EdgeSets::Lookup(void *containerAddr)
+    {
+        auto iter = m_sets.find(containerAddr);
+        _ASSERTE(iter != m_sets.end()); // the container must have been registered
+        return iter->second;
+    }
+
+    /// <summary>
+    /// Appends the changes for edges from the same origin to several vertices.
+    /// </summary>
+    /// <param name="containerAddr">The address of the container.</param>
+    /// <param name="origin">The vertex the edges start from, or <c>nullptr</c> for a root.</param>
+    /// <param name="targets">The handles of the receiving vertices.</param>
+    /// <param name="added">Whether the edges are added, rather than removed.</param>
+    /// <param name="changes">Where to append the changes.</param>
+    void EdgeSets::AddChanges(void *containerAddr,
+                              Vertex *origin,
+                              const std::vector<uint32_t> &targets,
+                              bool added,
+                              std::vector<EdgeChange> &changes)
+    {
+        for (auto handle : targets)
+            changes.push_back(EdgeChange{ origin, containerAddr, Vertex::FromHandle(handle), added });
+    }
+
+    /// <summary>
+    /// Registers a container, with no edges yet.
+    /// </summary>
+    /// <param name="containerAddr">The address of the container.</param>
+    /// <param name="origin">
+    /// The vertex representing the memory block that contains the container, or <c>nullptr</c> if none does.
+    /// </param>
+    void EdgeSets::Insert(void *containerAddr, Vertex *origin)
+    {
+        _ASSERTE(m_sets.find(containerAddr) == m_sets.end()); // a container cannot be registered twice
+        m_sets.emplace(containerAddr, EdgeSet{ origin, {} });
+    }
+
+    /// <summary>
+    /// Unregisters a container, removing all its edges.
+    /// </summary>
+    /// <param name="containerAddr">The address of the container.</param>
+    /// <param name="changes">Where to append the changes to the edges.</param>
+    void EdgeSets::Remove(void *containerAddr, std::vector<EdgeChange> &changes)
+    {
+        auto iter = m_sets.find(containerAddr);
+        _ASSERTE(iter != m_sets.end()); // the container must have been registered
+
+        AddChanges(containerAddr, iter->second.origin, iter->second.targets, false, changes);
+        m_sets.erase(iter);
+    }
+
+    /// <summary>
+    /// Adds edges to the set of a container.
+    /// </summary>
+    /// <param name="containerAddr">The address of the container.</param>
+    /// <param name="targets">The handles of the receiving vertices, which get sorted.</param>
+    /// <param name="changes">Where to append the changes to the edges.</param>
+    void EdgeSets::AddEdges(void *containerAddr, std::vector<uint32_t> &targets, std::vector<EdgeChange> &changes)
+    {
+        if (targets.empty())
+            return;
+
+        auto &set = Lookup(containerAddr);
+        std::sort(targets.begin(), targets.end());
+
+        auto middle = set.targets.size();
+        set.targets.insert(set.targets.end(), targets.begin(), targets.end());
+
+        // newer vertices tend to have greater handles, so the merge is seldom needed:
+        if (middle > 0 && set.targets[middle - 1] > targets.front())
+        {
+            std::inplace_merge(set.targets.begin(),
+                               set.targets.begin() + middle,
+                               set.targets.end());
+        }
+
+        AddChanges(containerAddr, set.origin, targets, true, changes);
+    }
+
+    /// <summary>
+    /// Removes edges from the set of a container.
+    /// </summary>
+    /// <param name="containerAddr">The address of the container.</param>
+    /// <param name="targets">
+    /// The handles of the receiving vertices, which get replaced by those of the edges removed.
+    /// A handle present more than once removes as many edges. A handle not in the set, such as
+    /// <see cref="VertexTable::invalidHandle"/>, stands for a vertex no longer found by address,
+    /// and removes the edge to any collected vertex instead.
+    /// </param>
+    /// <param name="changes">Where to append the changes to the edges.</param>
+    void EdgeSets::RemoveEdges(void *containerAddr, std::vector<uint32_t> &targets, std::vector<EdgeChange> &changes)
+    {
+        if (targets.empty())
+            return;
+
+        auto &set = Lookup(containerAddr);
+        std::sort(targets.begin(), targets.end());
+
+        // compact the set in place, from the first handle to remove onwards, and the handles found too:
+        auto to = std::lower_bound(set.targets.begin(), set.targets.end(), targets.front());
+        auto toRemove = targets.begin();
+        size_t removedCount(0);
+
+        for (auto from = to; from != set.targets.end(); ++from)
+        {
+            while (toRemove != targets.end() && *toRemove < *from)
+                ++toRemove;
+
+            if (toRemove != targets.end() && *toRemove == *from)
+                targets[removedCount++] = *toRemove++;
+            else
+                *to++ = *from;
+        }
+
+        set.targets.erase(to, set.targets.end());
+
+        /* The objects not found have been collected along with the container, and so has
+        any other object it holds just like them, hence the edges to any of those will do: */
+        if (removedCount < targets.size())
+        {
+            to = set.targets.begin();
+
+            for (auto from = to; from != set.targets.end(); ++from)
+            {
+                if (removedCount < targets.size() && Vertex::FromHandle(*from)->AreReprObjResourcesReleased())
+                    targets[removedCount++] = *from;
+                else
+                    *to++ = *from;
+            }
+
+            _ASSERTE(removedCount == targets.size()); // every edge removed must have been in the set
+            set.targets.erase(to, set.targets.end());
+        }
+
+        AddChanges(containerAddr, set.origin, targets, false, changes);
+    }
+
+    /// <summary>
+    /// Exchanges the edges of two containers. If they do not start from the
+    /// same place, each edge is added from its new origin before it is removed
+    /// from the former, so no receiving vertex is left without it meanwhile.
+    /// </summary>
+    /// <param name="leftContainerAddr">The address of a container.</param>
+    /// <param name="rightContainerAddr">The address of the other container.</param>
+    /// <param name="changes">Where to append the changes to the edges.</param>
+    void EdgeSets::Swap(void *leftContainerAddr, void *rightContainerAddr, std::vector<EdgeChange> &changes)
+    {
+        auto &left = Lookup(leftContainerAddr);
+        auto &right = Lookup(rightContainerAddr);
+
+        left.targets.swap(right.targets);
+
+        if (left.origin == right.origin)
+            return;
+
+        AddChanges(leftContainerAddr, left.origin, left.targets, true, changes);
+        AddChanges(rightContainerAddr, right.origin, right.targets, true, changes);
+        AddChanges(rightContainerAddr, right.origin, left.targets, false, changes);
+        AddChanges(leftContainerAddr, left.origin, right.targets, false, changes);
+    }
+
+    /// <summary>
+    /// Iterates over the registered containers.
+    /// </summary>
+    /// <param name="callback">The callback to invoke with the address and the edges of each container.</param>
+    void EdgeSets::ForEach(const std::function<void(void *, const EdgeSet &)> &callback) const
+    {
+        for (auto &entry : m_sets)
+            callback(entry.first, entry.second);
+    }
+
+}// end of namespace memory
+}// end of namespace _3fd
@@ -0,0 +1,107 @@
+#ifndef GC_EDGESETS_H // header guard
+#define GC_EDGESETS_H
+
+#include <3fd/core/gc_vertex.h>
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace _3fd
+{
+namespace memory
+{
+    /// <summary>
+    /// Keeps the edges reported by the <see cref="gc_vector"/> objects, each one as a set of
+    /// edges starting from the memory block that contains the container, or from a root when
+    /// none does. A container is registered once, instead of a pointer per object it holds.
+    /// </summary>
+    /// <remarks>
+    /// A set keeps the handles of the receiving vertices sorted, so a batch of edges is added
+    /// or removed in a single pass. A container might hold an object more than once, so there
+    /// can be repeated handles. Just like the pointers cache the vertices they reference, the
+    /// handles retrieve the receiving vertices even after they are collected, which they can
+    /// only be along with the container, whose destructor then removes the whole set. Until
+    /// then, removals are resolved through the set, since the addresses find those no more.
+    /// This was designed for SINGLE-THREAD access.
+    /// </remarks>
+    class EdgeSets
+    {
+    public:
+
+        /// <summary>
+        /// A change to an edge of a set, which the caller applies to the vertices.
+        /// </summary>
+        struct EdgeChange
+        {
+            /// <summary>
+            /// The vertex the edge starts from, or <c>nullptr</c> for a root.
+            /// </summary>
+            Vertex *origin;
+
+            /// <summary>
+            /// The address of the container, which stands for the root.
+            /// </summary>
+            void *containerAddr;
+
+            Vertex *target;
+            bool added;
+        };
+
+        /// <summary>
+        /// The edges of a container.
+        /// </summary>
+        struct EdgeSet
+        {
+            /// <summary>
+            /// The vertex the edges start from, or <c>nullptr</c> for a root.
+            /// </summary>
+            Vertex *origin;
+
+            /// <summary>
+            /// The handles of the receiving vertices, sorted.
+            /// </summary>
+            std::vector<uint32_t> targets;
+        };
+
+    private:
+
+        std::unordered_map<void *, EdgeSet> m_sets;
+
+        EdgeSet &Lookup(void *containerAddr);
+
+        static void AddChanges(void *containerAddr,
+                               Vertex *origin,
+                               const std::vector<uint32_t> &targets,
+                               bool added,
+                               std::vector<EdgeChange> &changes);
+
+    public:
+
+        EdgeSets() = default;
+
+        EdgeSets(const EdgeSets &) = delete;
+
+        void Insert(void *containerAddr, Vertex *origin);
+
+        void Remove(void *containerAddr, std::vector<EdgeChange> &changes);
+
+        void AddEdges(void *containerAddr, std::vector<uint32_t> &targets, std::vector<EdgeChange> &changes);
+
+        void RemoveEdges(void *containerAddr, std::vector<uint32_t> &targets, std::vector<EdgeChange> &changes);
+
+        void Swap(void *leftContainerAddr, void *rightContainerAddr, std::vector<EdgeChange> &changes);
+
+        void ForEach(const std::function<void(void *, const EdgeSet &)> &callback) const;
+
+        /// <summary>
+        /// Gets how many containers are registered.
+        /// </summary>
+        size_t GetCount() const { return m_sets.size(); }
+    };
+
+}// end of namespace memory
+}// end of namespace _3fd
+
+#endif // end of header guard
@@ -0,0 +1,210 @@
+#include "pch.h"
+#include "gc_finalizerpool.h"
+#include "exceptions.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace _3fd
+{
+namespace memory
+{
+    /// <summary>
+    /// Initializes a new instance of the <see cref="FinalizerPool"/> class.
+    /// </summary>
+    /// <param name="numThreads">How many threads finalize the objects.</param>
+    /// <param name="threadStartCallback">Invoked by each thread of the pool once it starts.</param>
+    /// <param name="batchDoneCallback">Invoked by a thread of the pool whenever it finishes a batch.</param>
+    FinalizerPool::FinalizerPool(uint32_t numThreads,
+                                 const std::function<void()> &threadStartCallback,
+                                 const std::function<void()> &batchDoneCallback) :
+        m_threadStartCallback(threadStartCallback),
+        m_batchDoneCallback(batchDoneCallback),
+        m_busyWorkers(0),
+        m_terminate(false),
+        m_backlog(0),
+        m_peakBacklog(0),
+        m_finalizedCount(0),
+        m_lastLatency(0),
+        m_peakLatency(0),
+        m_totalLatency(0)
+    {
+        numThreads = std::max(numThreads, 1U);
+
+        for (uint32_t idx = 0; idx < numThreads; ++idx)
+            m_workers.emplace_back(&FinalizerPool::WorkerProc, this);
+    }
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="FinalizerPool"/> class.
+    /// The objects left are finalized before the threads are gone.
+    /// </summary>
+    FinalizerPool::~FinalizerPool()
+    {
+        Submit();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_terminate = true;
+        }
+
+        m_workCondition.notify_all();
+
+        for (auto &worker : m_workers)
+            worker.join();
+    }
+
+    /// <summary>
+    /// Adds an object to the batch yet to submit.
+    /// Executed by the GC dedicated thread.
+    /// </summary>
+    /// <param name="memAddr">The address of the memory block of the object.</param>
+    /// <param name="freeMemCallback">The callback that frees the memory block.</param>
+    /// <param name="destroy">Whether the destructor of the object is to be invoked.</param>
+    void FinalizerPool::Add(void *memAddr, FreeMemProc freeMemCallback, bool destroy)
+    {
+        if (m_openBatch.objects.empty())
+            m_openBatch.openTime = std::chrono::steady_clock::now();
+
+        m_openBatch.objects.push_back(Finalization{ memAddr, freeMemCallback, destroy });
+    }
+
+    /// <summary>
+    /// Submits the objects added so far to the threads of the pool, as a single batch.
+    /// Executed by the GC dedicated thread.
+    /// </summary>
+    void FinalizerPool::Submit()
+    {
+        if (m_openBatch.objects.empty())
+            return;
+
+        auto count = m_openBatch.objects.size();
+        auto backlog = m_backlog.fetch_add(count, std::memory_order_relaxed) + count;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(std::move(m_openBatch));
+
+            if (backlog > m_peakBacklog)
+                m_peakBacklog = backlog;
+        }
+
+        m_openBatch.objects.clear();
+        m_workCondition.notify_one();
+    }
+
+    /// <summary>
+    /// Submits the objects added so far, and waits for all objects to be finalized.
+    /// Executed by the GC dedicated thread.
+    /// </summary>
+    void FinalizerPool::WaitForIdle()
+    {
+        Submit();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idleCondition.wait(lock, [this]() { return m_queue.empty() && m_busyWorkers == 0; });
+    }
+
+    /// <summary>
+    /// Executed by each thread of the pool, which
+    /// takes batches of objects and finalizes them.
+    /// </summary>
+    void FinalizerPool::WorkerProc()
+    {
+        m_threadStartCallback();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        while (true)
+        {
+            m_workCondition.wait(lock, [this]() { return m_terminate || !m_queue.empty(); });
+
+            // upon termination, the batches left are finalized first:
+            if (m_queue.empty())
+                return;
+
+            Batch batch(std::move(m_queue.front()));
+            m_queue.pop_front();
+            ++m_busyWorkers;
+
+            lock.unlock();
+            Finalize(batch);
+            m_batchDoneCallback();
+            lock.lock();
+
+            if (--m_busyWorkers == 0 && m_queue.empty())
+                m_idleCondition.notify_all();
+        }
+    }
+
+    /// <summary>
+    /// Finalizes the objects in a batch, in order.
+    /// </summary>
+    /// <param name="batch">The batch of objects.</param>
+    void FinalizerPool::Finalize(Batch &batch)
+    {
+        std::chrono::microseconds latency(0);
+        std::chrono::microseconds peakLatency(0);
+        std::chrono::microseconds totalLatency(0);
+
+        for (auto &object : batch.objects)
+        {
+            try
+            {
+                (*object.freeMemCallback)(object.memAddr, object.destroy);
+            }
+            catch (core::IAppException &ex)
+            {
+                core::Logger::Write(ex, core::Logger::PRIO_CRITICAL);
+            }
+            catch (std::exception &ex)
+            {
+                std::ostringstream oss;
+                oss << "Generic failure when finalizing object collected by the garbage collector: " << ex.what();
+                core::Logger::Write(oss.str(), core::Logger::PRIO_CRITICAL);
+            }
+            catch (...)
+            {
+                core::Logger::Write("Unknown failure when finalizing object collected by the garbage collector",
+                                    core::Logger::PRIO_CRITICAL);
+            }
+
+            m_backlog.fetch_sub(1, std::memory_order_relaxed);
+
+            latency = std::chrono::duration_cast<std::chrono::microseconds> (
+                std::chrono::steady_clock::now() - batch.openTime
+            );
+
+            totalLatency += latency;
+            if (latency > peakLatency)
+                peakLatency = latency;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_finalizedCount += batch.objects.size();
+        m_lastLatency = latency;
+        m_totalLatency += totalLatency;
+        if (peakLatency > m_peakLatency)
+            m_peakLatency = peakLatency;
+    }
+
+    /// <summary>
+    /// Gets statistics about the operation of the finalizer threads.
+    /// </summary>
+    /// <returns>A snapshot of the statistics.</returns>
+    FinalizerPool::Statistics FinalizerPool::GetStatistics()
+    {
+        Statistics stats;
+        stats.backlog = m_backlog.load(std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        stats.peakBacklog = m_peakBacklog;
+        stats.finalizedCount = m_finalizedCount;
+        stats.lastLatency = m_lastLatency;
+        stats.peakLatency = m_peakLatency;
+        stats.totalLatency = m_totalLatency;
+        return stats;
+    }
+
+}// end of namespace memory
+}// end of namespace _3fd
@@ -0,0 +1,143 @@
+#ifndef GC_FINALIZERPOOL_H // header guard
+#define GC_FINALIZERPOOL_H
+
+#include <3fd/core/gc_common.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace _3fd
+{
+namespace memory
+{
+    /// <summary>
+    /// Finalizes the objects collected by the GC, which is invoking their destructors
+    /// and freeing their memory, with a pool of threads, so the GC thread does not
+    /// have to wait for slow destructors.
+    /// </summary>
+    /// <remarks>
+    /// The GC thread adds the objects it collects to an open batch, which it submits at
+    /// points where no collection is under way. A batch is finalized by a single thread,
+    /// in the order its objects were added, so objects found unreachable together, as
+    /// those in a cycle, are finalized just like they would be by the GC thread. Batches
+    /// might be finalized in parallel, which is fine, because an object collected on its
+    /// own is not held by any other, and the GC does not collect an object while it is
+    /// held by another one yet to be finalized.
+    /// </remarks>
+    class FinalizerPool
+    {
+    public:
+
+        /// <summary>
+        /// Holds statistics about the operation of the finalizer threads.
+        /// </summary>
+        struct Statistics
+        {
+            /// <summary>
+            /// How many objects have been submitted, but not finalized
+            /// yet, and the largest amount of them so far.
+            /// </summary>
+            size_t backlog;
+            size_t peakBacklog;
+
+            /// <summary>
+            /// How many objects have been finalized so far.
+            /// </summary>
+            uint64_t finalizedCount;
+
+            /// <summary>
+            /// How long it took from the collection of an object until it was finalized,
+            /// for the last object, for the one that took the longest, and for all together.
+            /// </summary>
+            std::chrono::microseconds lastLatency;
+            std::chrono::microseconds peakLatency;
+            std::chrono::microseconds totalLatency;
+        };
+
+    private:
+
+        /// <summary>
+        /// An object to finalize.
+        /// </summary>
+        struct Finalization
+        {
+            void *memAddr;
+            FreeMemProc freeMemCallback;
+            bool destroy;
+        };
+
+        /// <summary>
+        /// Objects to finalize in order, by a single thread.
+        /// </summary>
+        struct Batch
+        {
+            std::vector<Finalization> objects;
+
+            /// <summary>
+            /// When the first object was added to the batch.
+            /// </summary>
+            std::chrono::steady_clock::time_point openTime;
+        };
+
+        std::vector<std::thread> m_workers;
+
+        std::function<void()> m_threadStartCallback;
+        std::function<void()> m_batchDoneCallback;
+
+        std::mutex m_mutex;
+        std::condition_variable m_workCondition;
+        std::condition_variable m_idleCondition;
+        std::deque<Batch> m_queue;
+        uint32_t m_busyWorkers;
+        bool m_terminate;
+
+        // The batch of objects yet to submit, only accessed by the GC thread:
+        Batch m_openBatch;
+
+        // Statistics:
+        std::atomic<size_t> m_backlog;
+        size_t m_peakBacklog;
+        uint64_t m_finalizedCount;
+        std::chrono::microseconds m_lastLatency;
+        std::chrono::microseconds m_peakLatency;
+        std::chrono::microseconds m_totalLatency;
+
+        void WorkerProc();
+
+        void Finalize(Batch &batch);
+
+    public:
+
+        FinalizerPool(uint32_t numThreads,
+                      const std::function<void()> &threadStartCallback,
+                      const std::function<void()> &batchDoneCallback);
+
+        FinalizerPool(const FinalizerPool &) = delete;
+
+        ~FinalizerPool();
+
+        /// <summary>
+        /// Gets how many threads finalize the objects.
+        /// </summary>
+        uint32_t GetNumThreads() const { return static_cast<uint32_t> (m_workers.size()); }
+
+        void Add(void *memAddr, FreeMemProc freeMemCallback, bool destroy);
+
+        void Submit();
+
+        void WaitForIdle();
+
+        Statistics GetStatistics();
+    };
+
+}// end of namespace memory
+}// end of namespace _3fd
+
+#endif // end of header guard
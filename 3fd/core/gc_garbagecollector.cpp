@@ -2,6 +2,7 @@
 #include "gc.h"
 #include "gc_common.h"
 #include "gc_messages.h"
+#include "gc_heap.h"
 #include "exceptions.h"
 #include "callstacktracer.h"
 #include "configuration.h"
@@ -11,6 +12,7 @@
 #include <algorithm>
 #include <array>
 #include <condition_variable>
+#include <cstdint>
 #include <iomanip>
 #include <sstream>
 
@@ -25,28 +27,64 @@ namespace memory
     using core::AppException;
 
     /// <summary>
-    /// Allocates memory (aligned in 2 bytes) and registers it with the GC.
+    /// Allocates memory from the GC heap, but does not register it with the GC.
     /// </summary>
     /// <param name="size">The size of the memory block to allocated.</param>
+    /// <param name="alignment">The alignment of the memory block, which must be a power of 2.</param>
+    /// <returns>The address of the allocated memory.</returns>
+    void *AllocMemoryFromGCHeap(size_t size, size_t alignment)
+    {
+        if (alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment > GCHeap::maxAlignment)
+        {
+            std::ostringstream oss;
+            oss << "Requested alignment of " << alignment << " bytes is not a power of 2 up to " << GCHeap::maxAlignment;
+            throw AppException<std::invalid_argument>("Invalid alignment for collectable memory", oss.str());
+        }
+
+        void *ptr = GCHeap::GetInstance().Allocate(size, alignment);
+
+        if (ptr == nullptr)
+            throw AppException<std::runtime_error>("Failed to allocated collectable memory");
+
+        return ptr;
+    }
+
+    /// <summary>
+    /// Gets the size of the memory block for an array allocated by the GC.
+    /// </summary>
+    /// <param name="count">How many elements the array has.</param>
+    /// <param name="elementSize">The size of an element.</param>
+    /// <param name="elementsOffset">The offset of the elements, as given by <see cref="GetArrayElementsOffset"/>.</param>
+    /// <returns>The size of the memory block, including the headers.</returns>
+    size_t GetArrayBlockSize(size_t count, size_t elementSize, size_t elementsOffset)
+    {
+        if (count > (SIZE_MAX - elementsOffset) / elementSize)
+        {
+            std::ostringstream oss;
+            oss << "An array of " << count << " elements of " << elementSize << " bytes exceeds the addressable memory";
+            throw AppException<std::length_error>("Invalid length for collectable array", oss.str());
+        }
+
+        return elementsOffset + count * elementSize;
+    }
+
+    /// <summary>
+    /// Allocates memory from the GC heap and registers it with the GC.
+    /// </summary>
+    /// <param name="size">The size of the memory block to allocated.</param>
+    /// <param name="alignment">The alignment of the memory block, which must be a power of 2.</param>
     /// <param name="sptrObjAddr">The address of the smart pointer that will refer to the same memory.</param>
     /// <param name="freeMemCallback">The callback that must be used to free the allocated memory.</param>
     /// <returns>The address of the allocated memory.</returns>
     void *AllocMemoryAndRegisterWithGC(size_t size, 
+                                        size_t alignment,
                                         void *sptrObjAddr, 
                                         FreeMemProc freeMemCallback)
     {
-#    ifdef _WIN32
-        void *ptr = _aligned_malloc(size, 2);
-#    else
-        void *ptr = aligned_alloc(2, size);
-#    endif
-        if (ptr != nullptr)
-        {
-            GarbageCollector::GetInstance()
-                .RegisterNewObject(sptrObjAddr, ptr, size, freeMemCallback);
-        }
-        else
-            throw AppException<std::runtime_error>("Failed to allocated collectable memory");
+        void *ptr = AllocMemoryFromGCHeap(size, alignment);
+
+        GarbageCollector::GetInstance()
+            .RegisterNewObject(sptrObjAddr, ptr, size, freeMemCallback);
 
         return ptr;
     }
@@ -55,6 +93,99 @@ namespace memory
 
     std::mutex GarbageCollector::singleInstanceCreationMutex;
 
+    uint32_t GarbageCollector::generationsCount(0);
+
+    /// <summary>
+    /// Holds the messages a thread accumulates
+    /// before publishing them to the GC at once.
+    /// </summary>
+    struct GarbageCollector::ThreadMessagesBuffer
+    {
+        std::unique_ptr<Message[]> messages;
+        uint32_t capacity;
+        uint32_t count;
+
+        /// <summary>
+        /// When the oldest message in the buffer was added.
+        /// </summary>
+        std::chrono::steady_clock::time_point firstMsgTime;
+
+        /// <summary>
+        /// The generation of the GC instance which the messages were accumulated for.
+        /// Messages from another generation are never published, because the
+        /// sptr objects they refer to are unknown to the current GC.
+        /// </summary>
+        uint32_t generation;
+
+        /// <summary>
+        /// Whether messages from this thread go straight to the ring.
+        /// That is the case for the GC thread itself, so the collection
+        /// of objects released by destructors is not postponed, and for
+        /// the finalizer threads, because the messages from a destructor
+        /// must be published before the memory of the object is freed,
+        /// otherwise they could come after those from a new object at
+        /// the same place.
+        /// </summary>
+        bool bypass;
+
+        /// <summary>
+        /// Whether the buffer is in the registry swept by the GC thread.
+        /// </summary>
+        bool registered;
+
+        /// <summary>
+        /// Guards the messages against the GC thread, which publishes
+        /// them when the thread that owns the buffer goes idle.
+        /// </summary>
+        std::mutex mutex;
+
+        ThreadMessagesBuffer() :
+            capacity(0),
+            count(0),
+            generation(0),
+            bypass(false),
+            registered(false)
+        {}
+
+        ThreadMessagesBuffer(const ThreadMessagesBuffer &) = delete;
+
+        /// <summary>
+        /// Publishes the messages left in the buffer upon thread exit.
+        /// </summary>
+        ~ThreadMessagesBuffer()
+        {
+            try
+            {
+                if (registered)
+                {
+                    std::lock_guard<std::mutex> lock(threadMsgBuffersMutex);
+                    threadMsgBuffers.erase(
+                        std::find(threadMsgBuffers.begin(), threadMsgBuffers.end(), this)
+                    );
+                }
+
+                if (count == 0)
+                    return;
+
+                std::lock_guard<std::mutex> lock(singleInstanceCreationMutex);
+
+                if (uniqueObjectPtr != nullptr && uniqueObjectPtr->m_generation == generation)
+                    uniqueObjectPtr->PublishMessages(messages.get(), count, false);
+            }
+            catch (std::system_error &)
+            {/* DO NOTHING: SWALLOW EXCEPTION
+                This cannot throw an exception because it is invoked by a destructor.
+                If an exception is thrown, memory leaks are expected. */
+            }
+        }
+    };
+
+    thread_local GarbageCollector::ThreadMessagesBuffer GarbageCollector::threadMsgBuffer;
+
+    std::mutex GarbageCollector::threadMsgBuffersMutex;
+
+    std::vector<GarbageCollector::ThreadMessagesBuffer *> GarbageCollector::threadMsgBuffers;
+
     /// <summary>
     /// Creates the unique instance of the <see cref="GarbageCollector" /> class.
     /// </summary>
@@ -113,6 +244,7 @@ namespace memory
                 
             if(uniqueObjectPtr != nullptr)
             {
+                uniqueObjectPtr->PublishAllThreadMessages();
                 delete uniqueObjectPtr;
                 uniqueObjectPtr = nullptr;
             }
@@ -124,19 +256,110 @@ namespace memory
         }
     }
 
+    /// <summary>
+    /// Gets from configuration the base 2 logarithm of the messages ring capacity.
+    /// </summary>
+    /// <returns>The validated setting.</returns>
+    static uint32_t GetMessagesRingCapacityLog2()
+    {
+        auto capacityLog2 = AppConfig::GetSettings().framework.gc.msgRing.capacityLog2;
+
+        if (capacityLog2 < 4 || capacityLog2 > 24)
+        {
+            std::ostringstream oss;
+            oss << "msgRingCapacityLog2 = " << capacityLog2 << " (must be in range [4, 24])";
+            throw AppException<std::invalid_argument>("Invalid setting for garbage collector", oss.str());
+        }
+
+        return capacityLog2;
+    }
+
     /// <summary>
     /// Initializes a new instance of the <see cref="GarbageCollector"/> class.
     /// </summary>
     GarbageCollector::GarbageCollector() 
     try : 
         m_error(nullptr), 
+        m_stopped(false),
         m_memoryDigraph(), 
-        m_messagesQueue(), 
-        m_terminationEvent()
+        m_messagesRing(GetMessagesRingCapacityLog2()), 
+        m_wakeUpEvent(),
+        m_terminate(false),
+        m_ringFullPolicy(RingFullPolicy::Overflow),
+        m_overflowedCount(0),
+        m_blockedProducersCount(0),
+        m_wakeUpPending(false),
+        m_wakeUpThreshold(AppConfig::GetSettings().framework.gc.msgRing.wakeUpThreshold),
+        m_backpressureThreshold(AppConfig::GetSettings().framework.gc.msgRing.backpressureThreshold),
+        m_cycleCollectionThreshold(AppConfig::GetSettings().framework.gc.cycleCollection.threshold),
+        m_cycleCollectionInterval(AppConfig::GetSettings().framework.gc.cycleCollection.intervalMillisecs),
+        m_lastCycleCollectionTime(std::chrono::steady_clock::now()),
+        m_parallelMarkingMinCandidates(AppConfig::GetSettings().framework.gc.parallelMarking.minCandidates),
+        m_selfEmittedCount(0),
+        m_peakMessagesBacklog(0),
+        m_demandWakeUpsCount(0),
+        m_timedWakeUpsCount(0),
+        m_producerWaitsCount(0),
+        m_gcThreadStats(),
+        m_statsSnapshot(),
+        m_statsLogInterval(AppConfig::GetSettings().framework.gc.statsLogIntervalSecs),
+        m_lastStatsLogTime(std::chrono::steady_clock::now()),
+        m_generation(++generationsCount),
+        m_msgBatchSize(AppConfig::GetSettings().framework.gc.msgBatching.size),
+        m_msgBatchFlushTimeout(AppConfig::GetSettings().framework.gc.msgBatching.flushTimeoutMillisecs)
     {
         CALL_STACK_TRACE;
 
-        //_ASSERTE(m_messagesQueue.is_lock_free()); // Queue must be implemented lock-free
+        // A batch of messages must fit in the ring:
+        if (m_msgBatchSize > m_messagesRing.Capacity())
+            m_msgBatchSize = static_cast<uint32_t> (m_messagesRing.Capacity());
+
+        auto &policy = AppConfig::GetSettings().framework.gc.msgRing.fullPolicy;
+
+        if (policy == "spin")
+            m_ringFullPolicy = RingFullPolicy::Spin;
+        else if (policy == "block")
+            m_ringFullPolicy = RingFullPolicy::Block;
+        else if (policy == "overflow")
+            m_ringFullPolicy = RingFullPolicy::Overflow;
+        else
+        {
+            throw AppException<std::invalid_argument>("Invalid setting for garbage collector",
+                "msgRingFullPolicy = " + policy + " (must be 'spin', 'block' or 'overflow')");
+        }
+
+        auto numShards = AppConfig::GetSettings().framework.gc.numShards;
+
+        if (numShards < 1 || numShards > 64)
+        {
+            std::ostringstream oss;
+            oss << "shards = " << numShards << " (must be in range [1, 64])";
+            throw AppException<std::invalid_argument>("Invalid setting for garbage collector", oss.str());
+        }
+
+        if (numShards > 1)
+            m_shards.reset(new DigraphShards(numShards));
+
+        auto numMarkingThreads = AppConfig::GetSettings().framework.gc.parallelMarking.numThreads;
+        if (numMarkingThreads > 0)
+            m_parallelMarker.reset(new ParallelMarker(numMarkingThreads));
+
+        auto numFinalizerThreads = AppConfig::GetSettings().framework.gc.numFinalizerThreads;
+        if (numFinalizerThreads > 0)
+        {
+            m_finalizers.reset(new FinalizerPool(
+                numFinalizerThreads,
+                []() { threadMsgBuffer.bypass = true; },
+                // the messages from destructors might be all the GC is waiting for:
+                [this]()
+                {
+                    if (GetMessagesBacklog() > 0)
+                        WakeUpGCThread();
+                }
+            ));
+
+            m_memoryDigraph.SetFinalizerPool(m_finalizers.get());
+        }
 
         // Create the GC dedicated thread
         std::thread temp(&GarbageCollector::GCThreadProc, this);
@@ -171,7 +394,8 @@ namespace memory
         try
         {
             // Signalizes termination for the message loop
-            m_terminationEvent.Signalize();
+            m_terminate.store(true, std::memory_order_release);
+            m_wakeUpEvent.Signalize();
 
             if( m_thread.joinable() )
                 m_thread.join();
@@ -206,28 +430,79 @@ namespace memory
 
         try
         {
+            // Messages emitted by this thread (from destructors of collected objects) are not batched:
+            threadMsgBuffer.bypass = true;
+
             bool terminate(false);
 
+            // When messages are batched, wake up often enough to publish those left by idle threads:
+            unsigned long sleepTimeout = AppConfig::GetSettings().framework.gc.msgLoopSleepTimeoutMilisecs;
+            if (m_msgBatchSize > 0 && m_msgBatchFlushTimeout.count() > 0)
+                sleepTimeout = std::min<unsigned long>(sleepTimeout, static_cast<unsigned long> (m_msgBatchFlushTimeout.count()));
+
             // The message loop:
             do
             {
-                // Wait for either the termination event or a timeout
-                terminate = m_terminationEvent.WaitFor(
-                    AppConfig::GetSettings().framework.gc.msgLoopSleepTimeoutMilisecs
-                );
-
-                // Consume the messages in the queue:
-                IMessage *message = m_messagesQueue.Remove();
-                while(message != nullptr)
+                // Wait for either a wake-up call or a timeout
+                bool wokenUp = m_wakeUpEvent.WaitFor(sleepTimeout);
+
+                // from now on, producers that find a large backlog must wake this thread up again:
+                m_wakeUpPending.store(false, std::memory_order_relaxed);
+
+                terminate = m_terminate.load(std::memory_order_acquire);
+
+                if (wokenUp)
+                    m_demandWakeUpsCount.fetch_add(1, std::memory_order_relaxed);
+                else
+                    m_timedWakeUpsCount.fetch_add(1, std::memory_order_relaxed);
+
+                auto backlog = GetMessagesBacklog();
+                if (backlog > m_peakMessagesBacklog.load(std::memory_order_relaxed))
+                    m_peakMessagesBacklog.store(backlog, std::memory_order_relaxed);
+
+                auto startTime = std::chrono::steady_clock::now();
+
+                if (m_msgBatchSize > 0)
+                    PublishIdleThreadMessages();
+
+                ConsumeMessages();
+
+                /* Upon termination, the destructors invoked by the finalizer
+                threads might still emit messages, so wait until there are none: */
+                if (terminate && m_finalizers)
                 {
-                    message->Execute(m_memoryDigraph);
-                    delete message;
-                    message = m_messagesQueue.Remove();
+                    while (true)
+                    {
+                        m_finalizers->WaitForIdle();
+
+                        if (GetMessagesBacklog() == 0)
+                            break;
+
+                        ConsumeMessages();
+                    }
                 }
 
-                // If there is still work to do, optimize the master table
-                if(terminate == false)
-                    m_memoryDigraph.ShrinkVertexPool();
+                /* Shrink the pool of vertices only when idle, because otherwise it would
+                just grow back right away. It is not even scanned unless usage has dropped: */
+                if(terminate == false && wokenUp == false)
+                    m_memoryDigraph.ShrinkVertexPool(false);
+
+                auto endTime = std::chrono::steady_clock::now();
+                auto iterationTime = std::chrono::duration_cast<std::chrono::microseconds> (endTime - startTime);
+
+                ++m_gcThreadStats.loopIterationsCount;
+                m_gcThreadStats.lastLoopIterationTime = iterationTime;
+                m_gcThreadStats.totalLoopIterationTime += iterationTime;
+                if (iterationTime > m_gcThreadStats.peakLoopIterationTime)
+                    m_gcThreadStats.peakLoopIterationTime = iterationTime;
+
+                PublishStatistics();
+
+                if (m_statsLogInterval.count() > 0 && endTime - m_lastStatsLogTime >= m_statsLogInterval)
+                {
+                    m_lastStatsLogTime = endTime;
+                    LogStatistics(GetStatistics());
+                }
             }
             while(terminate == false);
         }
@@ -253,41 +528,933 @@ namespace memory
             core::Logger::Write(oss.str(), core::Logger::PRIO_CRITICAL);
             m_error = std::current_exception();
         }
+
+        // threads waiting on fences must not wait forever:
+        m_stopped.store(true, std::memory_order_release);
+    }
+
+    /// <summary>
+    /// Consumes the messages in the ring, and then those in the side list, if it has overflowed.
+    /// Executed by the GC dedicated thread.
+    /// </summary>
+    void GarbageCollector::ConsumeMessages()
+    {
+        Message message;
+        std::vector<Message> overflowedMessages;
+
+        uint32_t count(0);
+
+        while (true)
+        {
+            while (m_messagesRing.Remove(message))
+            {
+                if (message.type != MessageType::Fence)
+                    Execute(message);
+                else
+                {
+                    ExecuteBatch();
+                    HandleFence(message);
+                }
+
+                ++m_gcThreadStats.messagesProcessedCount[static_cast<size_t> (message.type)];
+
+                if ((++count & 255) == 0)
+                {
+                    // release waiting threads as soon as there is room:
+                    if (m_blockedProducersCount.load(std::memory_order_relaxed) > 0)
+                        NotifyBlockedProducers();
+
+                    // and keep the finalizer threads busy:
+                    if (m_finalizers)
+                        m_finalizers->Submit();
+                }
+
+                // keep the list of candidates for collection short under a steady flow of messages:
+                if ((count & 4095) == 0)
+                {
+                    ExecuteBatch();
+                    CollectCycles();
+                    PublishStatistics();
+                }
+            }
+
+            if (!m_messagesRing.IsOverflowing())
+            {
+                /* Evaluate the candidates left by the messages executed so far. The
+                destructors of collected objects might emit messages, so drain again: */
+                if (ExecuteBatch() || CollectCycles())
+                    continue;
+
+                break;
+            }
+
+            /* The messages in the side list come after all those in the ring,
+            so wait for the cells already reserved to be written and consumed: */
+            if (!m_messagesRing.IsDrained())
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            /* Take the side list and reopen the ring. Messages are not executed
+            while holding the lock, because the execution of destructors might
+            emit messages from this thread, that would then overflow: */
+            {
+                std::lock_guard<std::mutex> lock(m_overflowMutex);
+                overflowedMessages.swap(m_overflowList);
+                m_overflowedCount.store(0, std::memory_order_relaxed);
+                m_messagesRing.ClearOverflowing();
+            }
+
+            for (auto &overflowed : overflowedMessages)
+            {
+                if (overflowed.type != MessageType::Fence)
+                    Execute(overflowed);
+                else
+                {
+                    ExecuteBatch();
+                    HandleFence(overflowed);
+                }
+
+                ++m_gcThreadStats.messagesProcessedCount[static_cast<size_t> (overflowed.type)];
+            }
+
+            overflowedMessages.clear();
+        }
+
+        if (m_finalizers)
+            m_finalizers->Submit();
+
+        NotifyBlockedProducers();
+    }
+
+    /// <summary>
+    /// Executes a message, either right away, or in a batch when the work is split among shards.
+    /// Executed by the GC dedicated thread.
+    /// </summary>
+    /// <param name="message">The message to execute.</param>
+    void GarbageCollector::Execute(const Message &message)
+    {
+        if (!m_shards)
+        {
+            ExecuteMessage(message, m_memoryDigraph);
+            return;
+        }
+
+        m_shards->Enqueue(message, m_memoryDigraph);
+
+        if (m_shards->IsBatchFull())
+            m_shards->ExecuteBatch(m_memoryDigraph);
+    }
+
+    /// <summary>
+    /// Executes the batch of messages accumulated for the shards, if any.
+    /// Executed by the GC dedicated thread.
+    /// </summary>
+    /// <returns>Whether there were messages to execute.</returns>
+    bool GarbageCollector::ExecuteBatch()
+    {
+        if (!m_shards || m_shards->IsBatchEmpty())
+            return false;
+
+        m_shards->ExecuteBatch(m_memoryDigraph);
+        return true;
+    }
+
+    /// <summary>
+    /// Collects the candidates for collection that turn out to be unreachable,
+    /// which is where unreachable cycles are found, but only when due: either
+    /// deferral is off, or there are enough candidates, or the interval has
+    /// elapsed, or the GC is terminating, or the collection is forced.
+    /// Executed by the GC dedicated thread.
+    /// </summary>
+    /// <param name="forced">Whether to collect regardless of deferral.</param>
+    /// <returns>Whether any memory block has been collected.</returns>
+    bool GarbageCollector::CollectCycles(bool forced)
+    {
+        if (m_memoryDigraph.GetCandidatesCount() == 0)
+            return false;
+
+        auto now = std::chrono::steady_clock::now();
+
+        if (m_cycleCollectionThreshold > 0
+            && m_memoryDigraph.GetCandidatesCount() < m_cycleCollectionThreshold
+            && now - m_lastCycleCollectionTime < m_cycleCollectionInterval
+            && !forced
+            && !m_terminate.load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+
+        m_lastCycleCollectionTime = now;
+
+        auto visitsCountBefore = m_memoryDigraph.GetVisitsCount();
+
+        /* Many candidates might be released at once by a large structure being
+        dropped, when collecting the whole graph takes less than their analysis: */
+        bool collected;
+        if (m_parallelMarker && m_memoryDigraph.GetCandidatesCount() >= m_parallelMarkingMinCandidates)
+            collected = m_memoryDigraph.CollectAllUnreachable(*m_parallelMarker);
+        else
+            collected = m_memoryDigraph.CollectUnreachableCandidates();
+
+        ++m_gcThreadStats.collectionsCount;
+        m_gcThreadStats.lastCollectionVisitsCount = m_memoryDigraph.GetVisitsCount() - visitsCountBefore;
+
+        return collected;
+    }
+
+    /// <summary>
+    /// Makes the statistics kept by the GC thread available to the other threads.
+    /// Executed by the GC dedicated thread.
+    /// </summary>
+    void GarbageCollector::PublishStatistics()
+    {
+        auto &stats = m_gcThreadStats;
+        stats.verticesCount = m_memoryDigraph.GetVerticesCount();
+        stats.sptrObjectsCount = m_shards ? m_shards->GetPointersCount() : m_memoryDigraph.GetPointersCount();
+        stats.edgeSetsCount = m_memoryDigraph.GetEdgeSetsCount();
+        stats.managedBytes = m_memoryDigraph.GetManagedBytes();
+        stats.freedBytes = m_memoryDigraph.GetFreedBytes();
+        stats.vertexPoolReleasedBytes = m_memoryDigraph.GetVertexPoolReleasedBytes();
+        stats.visitsCount = m_memoryDigraph.GetVisitsCount();
+
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_statsSnapshot = stats;
+    }
+
+    /// <summary>
+    /// Writes statistics about the operation of the GC to the log.
+    /// </summary>
+    /// <param name="stats">The statistics to write.</param>
+    void GarbageCollector::LogStatistics(const Statistics &stats)
+    {
+        static const std::array<const char *, messageTypesCount> messageTypeNames = {
+            "NewObject",
+            "ReferenceUpdate",
+            "ReferenceMove",
+            "ReferenceRelease",
+            "AbortedObject",
+            "SptrRegistration",
+            "SptrCopyRegistration",
+            "SptrMoveRegistration",
+            "SptrNewObjectRegistration",
+            "SptrUnregistration",
+            "WeakReferenceRegistration",
+            "SptrWeakLockRegistration",
+            "EdgeSetRegistration",
+            "EdgesAddition",
+            "EdgesRemoval",
+            "EdgeSetSwap",
+            "EdgeSetUnregistration",
+            "Fence"
+        };
+
+        std::ostringstream oss;
+        oss << "Garbage collector statistics: messages backlog = " << stats.messagesBacklog
+            << " (peak " << stats.peakMessagesBacklog
+            << "), wake-ups = " << stats.demandWakeUpsCount << " on demand + " << stats.timedWakeUpsCount << " timed"
+            << ", producer waits = " << stats.producerWaitsCount
+            << ", messages processed = {";
+
+        for (size_t idx = 0; idx < messageTypesCount; ++idx)
+        {
+            oss << (idx > 0 ? ", " : " ") << messageTypeNames[idx] << ": " << stats.messagesProcessedCount[idx];
+        }
+
+        oss << " }, vertices = " << stats.verticesCount
+            << ", sptr objects = " << stats.sptrObjectsCount
+            << ", gc_vector objects = " << stats.edgeSetsCount
+            << ", managed bytes = " << stats.managedBytes
+            << ", freed bytes = " << stats.freedBytes
+            << ", vertex pool released bytes = " << stats.vertexPoolReleasedBytes
+            << ", collections = " << stats.collectionsCount
+            << ", visits = " << stats.visitsCount << " (last collection " << stats.lastCollectionVisitsCount
+            << "), loop iterations = " << stats.loopIterationsCount
+            << ", loop time (us) = " << stats.lastLoopIterationTime.count() << " last, "
+            << stats.peakLoopIterationTime.count() << " peak, "
+            << stats.totalLoopIterationTime.count() << " total"
+            << ", finalization backlog = " << stats.finalizationBacklog
+            << " (peak " << stats.peakFinalizationBacklog
+            << "), finalized objects = " << stats.finalizedObjectsCount
+            << ", finalization latency (us) = " << stats.lastFinalizationLatency.count() << " last, "
+            << stats.peakFinalizationLatency.count() << " peak, "
+            << stats.totalFinalizationLatency.count() << " total";
+
+        core::Logger::Write(oss.str(), core::Logger::PRIO_INFORMATION);
+    }
+
+    /// <summary>
+    /// Releases the threads waiting for room in the ring or for a smaller backlog.
+    /// </summary>
+    void GarbageCollector::NotifyBlockedProducers()
+    {
+        // the lock guarantees a thread about to wait does not miss the notification:
+        std::lock_guard<std::mutex> lock(m_ringSpaceMutex);
+
+        if (m_blockedProducersCount.load(std::memory_order_relaxed) > 0)
+            m_ringSpaceCondition.notify_all();
+    }
+
+    /// <summary>
+    /// Wakes up the GC thread, unless a wake-up call is already pending.
+    /// </summary>
+    void GarbageCollector::WakeUpGCThread()
+    {
+        if (!m_wakeUpPending.load(std::memory_order_relaxed)
+            && !m_wakeUpPending.exchange(true, std::memory_order_acq_rel))
+        {
+            m_wakeUpEvent.Signalize();
+        }
+    }
+
+    /// <summary>
+    /// Gets an estimate of how many messages are waiting to be processed.
+    /// </summary>
+    size_t GarbageCollector::GetMessagesBacklog() const
+    {
+        return m_messagesRing.GetDepth() + m_overflowedCount.load(std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    /// Publishes messages to the GC thread, adding them to the ring at once.
+    /// What happens when the ring is full depends on the configured policy.
+    /// Once the messages are published, the GC thread is woken up if the backlog
+    /// is large enough, and the calling thread might have to wait for it.
+    /// </summary>
+    /// <param name="messages">The messages to publish.</param>
+    /// <param name="count">How many messages to publish.</param>
+    /// <param name="mustNotWait">
+    /// Whether the messages must overflow into the side list rather than wait for room
+    /// in the ring. That is the case for the GC thread, which would otherwise deadlock.
+    /// </param>
+    void GarbageCollector::PublishMessages(const Message *messages, size_t count, bool mustNotWait)
+    {
+        while (true)
+        {
+            auto result = m_messagesRing.Add(messages, count);
+
+            if (result == MessagesRing::AddResult::Okay)
+                break;
+
+            if (result == MessagesRing::AddResult::Full
+                && !mustNotWait
+                && m_ringFullPolicy != RingFullPolicy::Overflow)
+            {
+                // the GC thread is supposed to make room as soon as possible:
+                WakeUpGCThread();
+
+                if (m_ringFullPolicy == RingFullPolicy::Spin)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(m_ringSpaceMutex);
+
+                // retry now, because the GC thread notifies only while holding the lock:
+                result = m_messagesRing.Add(messages, count);
+
+                if (result == MessagesRing::AddResult::Okay)
+                    break;
+
+                if (result == MessagesRing::AddResult::Full)
+                {
+                    // the timeout is a safeguard in case the GC thread has stopped
+                    m_producerWaitsCount.fetch_add(1, std::memory_order_relaxed);
+                    ++m_blockedProducersCount;
+                    m_ringSpaceCondition.wait_for(lock, std::chrono::milliseconds(
+                        AppConfig::GetSettings().framework.gc.msgLoopSleepTimeoutMilisecs
+                    ));
+                    --m_blockedProducersCount;
+                    continue;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(m_overflowMutex);
+
+            // if the GC thread has just taken the side list, the ring is open again:
+            if (result == MessagesRing::AddResult::Overflowing && !m_messagesRing.IsOverflowing())
+                continue;
+
+            m_messagesRing.SetOverflowing();
+            m_overflowList.insert(m_overflowList.end(), messages, messages + count);
+            m_overflowedCount.fetch_add(count, std::memory_order_relaxed);
+            break;
+        }
+
+        if (mustNotWait)
+            return;
+
+        auto backlog = GetMessagesBacklog();
+
+        if (m_wakeUpThreshold != 0 && backlog >= m_wakeUpThreshold)
+            WakeUpGCThread();
+
+        if (m_backpressureThreshold != 0 && backlog >= m_backpressureThreshold)
+            ApplyBackpressure();
+    }
+
+    /// <summary>
+    /// Makes the calling thread wait for the GC thread to
+    /// bring the backlog of messages below the threshold.
+    /// </summary>
+    void GarbageCollector::ApplyBackpressure()
+    {
+        WakeUpGCThread();
+
+        m_producerWaitsCount.fetch_add(1, std::memory_order_relaxed);
+
+        std::unique_lock<std::mutex> lock(m_ringSpaceMutex);
+        ++m_blockedProducersCount;
+
+        // the timeout is a safeguard in case the GC thread has stopped
+        m_ringSpaceCondition.wait_for(lock,
+            std::chrono::milliseconds(AppConfig::GetSettings().framework.gc.msgLoopSleepTimeoutMilisecs),
+            [this]() { return GetMessagesBacklog() < m_backpressureThreshold; }
+        );
+
+        --m_blockedProducersCount;
+    }
+
+    /// <summary>
+    /// Sends a message to the GC thread. When batching is enabled, the message is
+    /// accumulated in the buffer of the calling thread, which is published to the
+    /// ring once it is full or too old. Should the thread go idle meanwhile, the
+    /// GC thread publishes the buffer once it is too old.
+    /// </summary>
+    /// <param name="message">The message to send.</param>
+    void GarbageCollector::SendMessage(const Message &message)
+    {
+        auto &buffer = threadMsgBuffer;
+
+        if (buffer.bypass)
+            m_selfEmittedCount.fetch_add(1, std::memory_order_relaxed);
+
+        if (m_msgBatchSize == 0 || buffer.bypass)
+        {
+            PublishMessages(&message, 1, buffer.bypass);
+            return;
+        }
+
+        if (!buffer.registered)
+        {
+            std::lock_guard<std::mutex> lock(threadMsgBuffersMutex);
+            threadMsgBuffers.push_back(&buffer);
+            buffer.registered = true;
+        }
+
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+
+        if (buffer.generation != m_generation)
+        {
+            buffer.count = 0; // left behind by a previous GC instance
+            buffer.generation = m_generation;
+
+            if (buffer.capacity != m_msgBatchSize)
+            {
+                buffer.messages.reset(new Message[m_msgBatchSize]);
+                buffer.capacity = m_msgBatchSize;
+            }
+        }
+
+        if (buffer.count == 0)
+            buffer.firstMsgTime = std::chrono::steady_clock::now();
+
+        buffer.messages[buffer.count++] = message;
+
+        // to keep it cheap, the age of the buffer is only checked every few messages:
+        if (buffer.count == buffer.capacity
+            || ((buffer.count & 15) == 0
+                && std::chrono::steady_clock::now() - buffer.firstMsgTime >= m_msgBatchFlushTimeout))
+        {
+            PublishMessages(buffer.messages.get(), buffer.count, false);
+            buffer.count = 0;
+        }
+    }
+
+    /// <summary>
+    /// Publishes to the GC the messages the calling thread has accumulated so far.
+    /// When batching is enabled, a thread must call this before handing
+    /// <see cref="sptr"/> objects over to another thread, because messages
+    /// from different threads are only ordered upon publication.
+    /// </summary>
+    void GarbageCollector::PublishThreadMessages()
+    {
+        auto &buffer = threadMsgBuffer;
+
+        if (buffer.bypass)
+            return; // nothing is ever batched
+
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+
+        if (buffer.count == 0)
+            return;
+
+        if (buffer.generation == m_generation)
+            PublishMessages(buffer.messages.get(), buffer.count, false);
+
+        buffer.count = 0;
+    }
+
+    /// <summary>
+    /// Publishes the messages batched by threads that have not sent any
+    /// for longer than the flush timeout, so the objects they release are
+    /// not held until those threads send more messages or exit.
+    /// Executed by the GC dedicated thread.
+    /// </summary>
+    void GarbageCollector::PublishIdleThreadMessages()
+    {
+        /* Nothing here waits for a lock, because the threads holding them might
+        be waiting for this one to make room in the ring. A buffer in use is left
+        to its own thread, which publishes it once due, and so is the whole
+        registry if busy, because it will be swept again on the next wake-up: */
+        std::unique_lock<std::mutex> registryLock(threadMsgBuffersMutex, std::try_to_lock);
+
+        if (!registryLock.owns_lock())
+            return;
+
+        auto now = std::chrono::steady_clock::now();
+
+        for (auto buffer : threadMsgBuffers)
+        {
+            std::unique_lock<std::mutex> lock(buffer->mutex, std::try_to_lock);
+
+            if (!lock.owns_lock()
+                || buffer->count == 0
+                || buffer->generation != m_generation
+                || now - buffer->firstMsgTime < m_msgBatchFlushTimeout)
+            {
+                continue;
+            }
+
+            PublishMessages(buffer->messages.get(), buffer->count, true);
+            buffer->count = 0;
+        }
+    }
+
+    /// <summary>
+    /// Publishes the messages batched by all threads, upon shutdown.
+    /// The messages overflow rather than wait for room in the ring,
+    /// because the GC thread might be waiting for the registry.
+    /// </summary>
+    void GarbageCollector::PublishAllThreadMessages()
+    {
+        std::lock_guard<std::mutex> registryLock(threadMsgBuffersMutex);
+
+        for (auto buffer : threadMsgBuffers)
+        {
+            std::lock_guard<std::mutex> lock(buffer->mutex);
+
+            if (buffer->count > 0 && buffer->generation == m_generation)
+                PublishMessages(buffer->messages.get(), buffer->count, true);
+
+            buffer->count = 0;
+        }
+    }
+
+    /// <summary>
+    /// A request for notification once the GC has caught up
+    /// with the messages published before the request.
+    /// </summary>
+    struct GarbageCollector::FenceRequest
+    {
+        std::promise<void> done;
+
+        /// <summary>
+        /// Whether to force the collection of cycles, and
+        /// to release the unused memory of the GC, as well.
+        /// </summary>
+        bool collect;
+
+        /// <summary>
+        /// Whether the fence has already been posted again by the GC thread,
+        /// and how many messages that thread had emitted by then.
+        /// </summary>
+        bool reposted;
+        uint64_t selfEmittedCountMark;
+
+        /// <summary>
+        /// Where to take a snapshot of the graph once the fence is handled, if requested.
+        /// </summary>
+        HeapSnapshot *snapshot;
+    };
+
+    /// <summary>
+    /// Handles a fence found among the messages.
+    /// Executed by the GC dedicated thread.
+    /// </summary>
+    /// <param name="message">The message of the fence.</param>
+    void GarbageCollector::HandleFence(const Message &message)
+    {
+        auto request = static_cast<FenceRequest *> (message.otherAddr);
+
+        if (request->collect)
+            CollectCycles(true);
+
+        // the objects collected so far must have been finalized, too:
+        if (m_finalizers)
+            m_finalizers->WaitForIdle();
+
+        /* The messages emitted by this thread while executing the ones before the fence,
+        such as those from destructors of collected objects, come after the fence, and so
+        do those from the finalizer threads. So it is posted again, until it comes back
+        with nothing else emitted in the meantime: */
+        auto selfEmittedCount = m_selfEmittedCount.load(std::memory_order_relaxed);
+        if (request->reposted && request->selfEmittedCountMark == selfEmittedCount)
+        {
+            if (request->collect)
+                m_memoryDigraph.ShrinkVertexPool(true);
+
+            PublishStatistics();
+
+            if (request->snapshot != nullptr)
+            {
+                try
+                {
+                    m_memoryDigraph.TakeSnapshot(*request->snapshot, m_shards.get());
+                }
+                catch (...)
+                {
+                    request->done.set_exception(std::current_exception());
+                    delete request;
+                    return;
+                }
+            }
+
+            request->done.set_value();
+            delete request;
+            return;
+        }
+
+        request->reposted = true;
+        request->selfEmittedCountMark = selfEmittedCount;
+        PublishMessages(&message, 1, true);
+    }
+
+    /// <summary>
+    /// Posts a fence in the messages to the GC.
+    /// </summary>
+    /// <param name="collect">Whether to force collection once the GC gets to the fence.</param>
+    /// <param name="snapshot">Where to take a snapshot of the graph once the GC gets to the fence, if not null.</param>
+    /// <returns>A future that becomes ready once the fence has been handled.</returns>
+    std::future<void> GarbageCollector::PostFence(bool collect, HeapSnapshot *snapshot)
+    {
+        if (threadMsgBuffer.bypass)
+        {
+            throw AppException<std::logic_error>(
+                "The garbage collector cannot be waited for from its own threads");
+        }
+
+        std::unique_ptr<FenceRequest> request(new FenceRequest());
+        request->collect = collect;
+        request->reposted = false;
+        request->selfEmittedCountMark = 0;
+        request->snapshot = snapshot;
+
+        auto future = request->done.get_future();
+
+        SendMessage(Message{ MessageType::Fence, nullptr, request.get(), 0, nullptr });
+        request.release(); // from now on owned by the GC thread
+
+        PublishThreadMessages();
+        WakeUpGCThread();
+
+        return future;
+    }
+
+    /// <summary>
+    /// Waits for a fence to be handled by the GC.
+    /// </summary>
+    /// <param name="fence">The future of the fence.</param>
+    /// <param name="timeout">How long to wait, or <c>nullptr</c> to wait indefinitely.</param>
+    /// <returns>Whether the fence has been handled before the timeout.</returns>
+    bool GarbageCollector::WaitForFence(std::future<void> &fence, const std::chrono::milliseconds *timeout)
+    {
+        auto deadline = (timeout != nullptr)
+            ? std::chrono::steady_clock::now() + *timeout
+            : std::chrono::steady_clock::time_point::max();
+
+        // check from time to time whether the GC thread is still there to handle the fence:
+        const std::chrono::milliseconds checkInterval(100);
+
+        while (true)
+        {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline)
+                return fence.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+
+            auto waitTime = std::min<std::chrono::steady_clock::duration>(deadline - now, checkInterval);
+            if (fence.wait_for(waitTime) == std::future_status::ready)
+                return true;
+
+            if (m_stopped.load(std::memory_order_acquire))
+            {
+                if (fence.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+                    return true;
+
+                throw AppException<std::runtime_error>("Garbage collector thread has stopped");
+            }
+        }
+    }
+
+    /// <summary>
+    /// Blocks until the GC has executed all messages published before the call, and
+    /// also those emitted meanwhile by destructors of the objects collected. Messages
+    /// batched by the calling thread are published first. Cycles whose collection
+    /// is deferred might remain, see <see cref="Collect"/>.
+    /// </summary>
+    void GarbageCollector::Flush()
+    {
+        CALL_STACK_TRACE;
+        auto fence = PostFence(false);
+        WaitForFence(fence, nullptr);
+    }
+
+    /// <summary>
+    /// Blocks until the GC has executed all messages published before the call,
+    /// like <see cref="Flush()"/>, but for no longer than the given timeout.
+    /// </summary>
+    /// <param name="timeout">How long to wait at most.</param>
+    /// <returns>Whether the GC has caught up before the timeout.</returns>
+    bool GarbageCollector::Flush(std::chrono::milliseconds timeout)
+    {
+        CALL_STACK_TRACE;
+        auto fence = PostFence(false);
+        return WaitForFence(fence, &timeout);
+    }
+
+    /// <summary>
+    /// Does the same as <see cref="Flush()"/>, but also forces the collection of
+    /// unreachable cycles, regardless of deferral, and releases the unused memory
+    /// of the GC. Once this returns, everything dropped before the call is freed.
+    /// </summary>
+    void GarbageCollector::Collect()
+    {
+        CALL_STACK_TRACE;
+        auto fence = PostFence(true);
+        WaitForFence(fence, nullptr);
+    }
+
+    /// <summary>
+    /// Does the same as <see cref="Collect()"/>, but for no longer than the given timeout.
+    /// </summary>
+    /// <param name="timeout">How long to wait at most.</param>
+    /// <returns>Whether the collection has finished before the timeout.</returns>
+    bool GarbageCollector::Collect(std::chrono::milliseconds timeout)
+    {
+        CALL_STACK_TRACE;
+        auto fence = PostFence(true);
+        return WaitForFence(fence, &timeout);
+    }
+
+    /// <summary>
+    /// Exports a snapshot of the graph of memory blocks managed by the GC to a file. It
+    /// includes everything published before the call, as seen after <see cref="Flush()"/>.
+    /// The GC thread only copies the graph, and the file is written by the calling thread,
+    /// so producers hardly notice, but the snapshot takes memory proportional to the graph.
+    /// </summary>
+    /// <param name="filePath">The path of the file, which is overwritten.</param>
+    void GarbageCollector::ExportHeapSnapshot(const std::string &filePath)
+    {
+        CALL_STACK_TRACE;
+
+        HeapSnapshot snapshot;
+        auto fence = PostFence(false, &snapshot);
+        WaitForFence(fence, nullptr);
+        fence.get();
+
+        snapshot.Save(filePath);
+    }
+
+    /// <summary>
+    /// Gets statistics about the operation of the GC.
+    /// </summary>
+    /// <returns>A snapshot of the statistics.</returns>
+    GarbageCollector::Statistics GarbageCollector::GetStatistics() const
+    {
+        Statistics stats;
+        {
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            stats = m_statsSnapshot;
+        }
+
+        stats.messagesBacklog = GetMessagesBacklog();
+        stats.peakMessagesBacklog = m_peakMessagesBacklog.load(std::memory_order_relaxed);
+        stats.demandWakeUpsCount = m_demandWakeUpsCount.load(std::memory_order_relaxed);
+        stats.timedWakeUpsCount = m_timedWakeUpsCount.load(std::memory_order_relaxed);
+        stats.producerWaitsCount = m_producerWaitsCount.load(std::memory_order_relaxed);
+
+        if (m_finalizers)
+        {
+            auto finalizerStats = m_finalizers->GetStatistics();
+            stats.finalizationBacklog = finalizerStats.backlog;
+            stats.peakFinalizationBacklog = finalizerStats.peakBacklog;
+            stats.finalizedObjectsCount = finalizerStats.finalizedCount;
+            stats.lastFinalizationLatency = finalizerStats.lastLatency;
+            stats.peakFinalizationLatency = finalizerStats.peakLatency;
+            stats.totalFinalizationLatency = finalizerStats.totalLatency;
+        }
+
+        return stats;
     }
 
     void GarbageCollector::UpdateReference(void *leftSptrObjAddr, void *rightSptrObjAddr)
     {
-        m_messagesQueue.Add(dbg_new ReferenceUpdateMsg(leftSptrObjAddr, rightSptrObjAddr));
+        SendMessage(Message{ MessageType::ReferenceUpdate, leftSptrObjAddr, rightSptrObjAddr, 0, nullptr });
+    }
+
+    void GarbageCollector::MoveReference(void *leftSptrObjAddr, void *rightSptrObjAddr)
+    {
+        SendMessage(Message{ MessageType::ReferenceMove, leftSptrObjAddr, rightSptrObjAddr, 0, nullptr });
     }
 
     void GarbageCollector::ReleaseReference(void *sptrObjAddr)
     {
-        m_messagesQueue.Add(dbg_new ReferenceReleaseMsg(sptrObjAddr));
+        SendMessage(Message{ MessageType::ReferenceRelease, sptrObjAddr, nullptr, 0, nullptr });
     }
 
     void GarbageCollector::RegisterNewObject(void *sptrObjAddr, void *pointedAddr, size_t blockSize, FreeMemProc freeMemCallback)
     {
-        m_messagesQueue.Add(dbg_new NewObjectMsg(sptrObjAddr, pointedAddr, blockSize, freeMemCallback));
+        SendMessage(Message{ MessageType::NewObject, sptrObjAddr, pointedAddr, blockSize, freeMemCallback });
     }
 
     void GarbageCollector::UnregisterAbortedObject(void *sptrObjAddr)
     {
-        m_messagesQueue.Add(dbg_new AbortedObjectMsg(sptrObjAddr));
+        SendMessage(Message{ MessageType::AbortedObject, sptrObjAddr, nullptr, 0, nullptr });
     }
 
     void GarbageCollector::RegisterSptr(void *sptrObjAddr, void *pointedAddr)
     {
-        m_messagesQueue.Add(dbg_new SptrRegistrationMsg(sptrObjAddr, pointedAddr));
+        SendMessage(Message{ MessageType::SptrRegistration, sptrObjAddr, pointedAddr, 0, nullptr });
     }
 
     void GarbageCollector::RegisterSptrCopy(void *leftSptrObjAddr, void *rightSptrObjAddr)
     {
-        m_messagesQueue.Add(dbg_new SptrCopyRegistrationMsg(leftSptrObjAddr, rightSptrObjAddr));
+        SendMessage(Message{ MessageType::SptrCopyRegistration, leftSptrObjAddr, rightSptrObjAddr, 0, nullptr });
+    }
+
+    void GarbageCollector::RegisterSptrMove(void *leftSptrObjAddr, void *rightSptrObjAddr)
+    {
+        SendMessage(Message{ MessageType::SptrMoveRegistration, leftSptrObjAddr, rightSptrObjAddr, 0, nullptr });
+    }
+
+    void GarbageCollector::RegisterSptrWithNewObject(void *sptrObjAddr, void *pointedAddr, size_t blockSize, FreeMemProc freeMemCallback)
+    {
+        SendMessage(Message{ MessageType::SptrNewObjectRegistration, sptrObjAddr, pointedAddr, blockSize, freeMemCallback });
     }
 
     void GarbageCollector::UnregisterSptr(void *sptrObjAddr)
     {
-        m_messagesQueue.Add(dbg_new SptrUnregistrationMsg(sptrObjAddr));
+        SendMessage(Message{ MessageType::SptrUnregistration, sptrObjAddr, nullptr, 0, nullptr });
+    }
+
+    /// <summary>
+    /// Acquires the block shared by the weak references to the object
+    /// referenced by a <see cref="sptr"/> object held by the calling thread.
+    /// </summary>
+    /// <param name="pointedAddr">The address pointed by the <see cref="sptr"/> object.</param>
+    /// <returns>The block, with a reference added for the caller.</returns>
+    WeakRefBlock *GarbageCollector::AcquireWeakReference(void *pointedAddr)
+    {
+        // the pointed address might be inside the memory block, as for arrays:
+        auto memBlockAddr = GCHeap::GetInstance().GetBlockStart(pointedAddr);
+
+        if (memBlockAddr == nullptr)
+        {
+            throw AppException<std::logic_error>(
+                "Cannot weakly reference an object not managed by the GC, such as one in an arena");
+        }
+
+        bool isNew;
+        auto block = m_memoryDigraph.AcquireWeakReference(memBlockAddr, isNew);
+
+        if (isNew)
+            SendMessage(Message{ MessageType::WeakReferenceRegistration, nullptr, memBlockAddr, 0, nullptr });
+
+        return block;
+    }
+
+    void GarbageCollector::RegisterSptrOnWeakLock(void *sptrObjAddr, void *memBlockAddr)
+    {
+        SendMessage(Message{ MessageType::SptrWeakLockRegistration, sptrObjAddr, memBlockAddr, 0, nullptr });
+    }
+
+    /// <summary>
+    /// Sends a message that adds or removes the edges from a <see cref="gc_vector"/> object
+    /// to several objects at once. Unless there is a single one, the addresses go in an array,
+    /// which the GC deletes once it executes the message.
+    /// </summary>
+    /// <param name="type">The type of message.</param>
+    /// <param name="containerAddr">The address of the container.</param>
+    /// <param name="pointedAddrs">The addresses of the objects.</param>
+    /// <param name="count">How many objects there are.</param>
+    void GarbageCollector::SendEdgesMessage(MessageType type, void *containerAddr, void *const *pointedAddrs, size_t count)
+    {
+        if (count == 0)
+            return;
+
+        if (count == 1)
+        {
+            SendMessage(Message{ type, containerAddr, pointedAddrs[0], 1, nullptr });
+            return;
+        }
+
+        std::unique_ptr<void *[]> addrs(new void *[count]);
+        std::copy(pointedAddrs, pointedAddrs + count, addrs.get());
+
+        SendMessage(Message{ type, containerAddr, addrs.get(), count, nullptr });
+        addrs.release();
+    }
+
+    void GarbageCollector::RegisterEdgeSet(void *containerAddr)
+    {
+        SendMessage(Message{ MessageType::EdgeSetRegistration, containerAddr, nullptr, 0, nullptr });
+    }
+
+    /// <summary>
+    /// Adds edges from a <see cref="gc_vector"/> object to objects held
+    /// by the calling thread, in a single message.
+    /// </summary>
+    /// <param name="containerAddr">The address of the container.</param>
+    /// <param name="pointedAddrs">The addresses of the objects, which must be managed by the GC.</param>
+    /// <param name="count">How many objects there are.</param>
+    void GarbageCollector::AddEdges(void *containerAddr, void *const *pointedAddrs, size_t count)
+    {
+        auto &heap = GCHeap::GetInstance();
+
+        for (size_t idx = 0; idx < count; ++idx)
+        {
+            // the address might be inside the memory block, as for arrays:
+            if (heap.GetBlockStart(pointedAddrs[idx]) == nullptr)
+            {
+                throw AppException<std::logic_error>(
+                    "Cannot hold in a gc_vector an object not managed by the GC, such as one in an arena");
+            }
+        }
+
+        SendEdgesMessage(MessageType::EdgesAddition, containerAddr, pointedAddrs, count);
+    }
+
+    /// <summary>
+    /// Removes edges from a <see cref="gc_vector"/> object, in a single message.
+    /// </summary>
+    /// <param name="containerAddr">The address of the container.</param>
+    /// <param name="pointedAddrs">The addresses of the objects, as previously added.</param>
+    /// <param name="count">How many objects there are.</param>
+    void GarbageCollector::RemoveEdges(void *containerAddr, void *const *pointedAddrs, size_t count)
+    {
+        SendEdgesMessage(MessageType::EdgesRemoval, containerAddr, pointedAddrs, count);
+    }
+
+    void GarbageCollector::SwapEdgeSets(void *leftContainerAddr, void *rightContainerAddr)
+    {
+        SendMessage(Message{ MessageType::EdgeSetSwap, leftContainerAddr, rightContainerAddr, 0, nullptr });
+    }
+
+    void GarbageCollector::UnregisterEdgeSet(void *containerAddr)
+    {
+        SendMessage(Message{ MessageType::EdgeSetUnregistration, containerAddr, nullptr, 0, nullptr });
     }
 
 }// end of namespace memory
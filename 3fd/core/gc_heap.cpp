@@ -0,0 +1,503 @@
+#include "pch.h"
+#include "gc_heap.h"
+#include "gc_common.h"
+#include "preprocessing.h"
+
+#include <cstdint>
+#include <cstdlib>
+
+namespace _3fd
+{
+namespace memory
+{
+    /// <summary>
+    /// The header in the beginning of a slab or span.
+    /// Right after it, comes the array of tags, and then the blocks.
+    /// </summary>
+    struct GCHeap::SpanHeader
+    {
+        SpanHeader *prev;
+        SpanHeader *next;
+
+        char *firstBlock;
+        void **tags;
+        void *freeList;
+        size_t spanSize;
+
+        // for a large span, this is 'numSizeClasses':
+        uint32_t sizeClass;
+
+        // a large span holds a single block, which can be as large as the memory:
+        size_t blockSize;
+        uint32_t numBlocks;
+        uint32_t usedCount;
+
+        // blocks from this position on have never been used:
+        uint32_t unusedIndex;
+    };
+
+    static size_t AlignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    /// <summary>
+    /// Frees memory allocated from the GC heap.
+    /// </summary>
+    /// <param name="addr">The address of the memory block.</param>
+    void FreeMemoryFromGCHeap(void *addr)
+    {
+        GCHeap::GetInstance().Free(addr);
+    }
+
+    /// <summary>
+    /// Gets the unique instance of <see cref="GCHeap"/>.
+    /// </summary>
+    /// <returns>The heap for objects managed by the GC.</returns>
+    /// <remarks>
+    /// The heap is never destroyed, because objects might still be freed
+    /// after the GC is shut down, during finalization of static objects.
+    /// </remarks>
+    GCHeap &GCHeap::GetInstance()
+    {
+        static GCHeap *uniqueInstance = new GCHeap();
+        return *uniqueInstance;
+    }
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="GCHeap"/> class.
+    /// </summary>
+    GCHeap::GCHeap()
+    {
+        /* The size classes grow in steps of 16 bytes up to 128 bytes,
+        and from then on there are 4 classes per power of 2: */
+        uint32_t blockSize(0);
+        for (uint32_t idx = 0; idx < numSizeClasses; ++idx)
+        {
+            blockSize += (blockSize < 128) ? 16 : (1U << Log2Floor(blockSize)) / 4;
+
+            auto &sizeClass = m_sizeClasses[idx];
+            sizeClass.partialSlabs = nullptr;
+            sizeClass.blockSize = blockSize;
+            sizeClass.emptySlabsCount = 0;
+
+            /* The blocks of a slab are aligned to the greatest power of 2 dividing their size,
+            so every block of the size class is, and over-aligned objects can be placed there: */
+            sizeClass.blockAlignment = blockSize & (~blockSize + 1);
+
+            const auto headerSize = AlignUp(sizeof(SpanHeader), sizeof(void *));
+
+            auto numBlocks = static_cast<uint32_t> ((unitSize - headerSize) / (blockSize + sizeof(void *)));
+            while (AlignUp(headerSize + numBlocks * sizeof(void *), sizeClass.blockAlignment) + numBlocks * blockSize > unitSize)
+                --numBlocks;
+
+            sizeClass.blocksPerSlab = numBlocks;
+        }
+
+        _ASSERTE(m_sizeClasses.back().blockSize == maxSmallObjectSize);
+
+        uint8_t sizeClass(0);
+        for (size_t idx = 0; idx < m_sizeClassBySize.size(); ++idx)
+        {
+            while (m_sizeClasses[sizeClass].blockSize < idx * blockAlignment)
+                ++sizeClass;
+
+            m_sizeClassBySize[idx] = sizeClass;
+        }
+    }
+
+    /// <summary>
+    /// Computes the base 2 logarithm of a number, rounded down.
+    /// </summary>
+    uint32_t GCHeap::Log2Floor(uint32_t value)
+    {
+        uint32_t result(0);
+        while (value >>= 1)
+            ++result;
+
+        return result;
+    }
+
+    /// <summary>
+    /// Creates a new slab or span, and maps its units.
+    /// </summary>
+    /// <param name="spanSize">The size of the span, which must be a multiple of the unit.</param>
+    /// <param name="sizeClass">The size class of the slab, or 'numSizeClasses' for a large span.</param>
+    /// <param name="blockSize">The size of each block.</param>
+    /// <param name="numBlocks">How many blocks the span holds.</param>
+    /// <param name="alignment">The alignment of the first block, which cannot be stricter than the unit.</param>
+    /// <returns>The header of the new span, or <c>nullptr</c> if the memory could not be allocated.</returns>
+    GCHeap::SpanHeader *GCHeap::CreateSpan(size_t spanSize, uint32_t sizeClass, size_t blockSize, uint32_t numBlocks, size_t alignment)
+    {
+#    ifdef _WIN32
+        void *base = _aligned_malloc(spanSize, unitSize);
+#    else
+        void *base = aligned_alloc(unitSize, spanSize);
+#    endif
+        if (base == nullptr)
+            return nullptr;
+
+        auto span = new (base) SpanHeader;
+        span->prev = span->next = nullptr;
+        span->tags = reinterpret_cast<void **> (
+            static_cast<char *> (base) + AlignUp(sizeof(SpanHeader), sizeof(void *))
+        );
+        span->firstBlock = static_cast<char *> (base)
+            + AlignUp(reinterpret_cast<char *> (span->tags + numBlocks) - static_cast<char *> (base), alignment);
+        span->freeList = nullptr;
+        span->spanSize = spanSize;
+        span->sizeClass = sizeClass;
+        span->blockSize = blockSize;
+        span->numBlocks = numBlocks;
+        span->usedCount = 0;
+        span->unusedIndex = 0;
+
+        for (uint32_t idx = 0; idx < numBlocks; ++idx)
+            span->tags[idx] = nullptr;
+
+        if (!m_spansByUnit.Map(base, spanSize, span))
+        {
+#       ifdef _WIN32
+            _aligned_free(base);
+#       else
+            free(base);
+#       endif
+            return nullptr;
+        }
+
+        return span;
+    }
+
+    /// <summary>
+    /// Unmaps the units of a slab or span and returns its memory to the system.
+    /// </summary>
+    /// <param name="span">The header of the span.</param>
+    void GCHeap::DestroySpan(SpanHeader *span)
+    {
+        std::lock_guard<std::mutex> lock(m_tagsIterationMutex);
+
+        m_spansByUnit.Unmap(span, span->spanSize);
+
+#    ifdef _WIN32
+        _aligned_free(span);
+#    else
+        free(span);
+#    endif
+    }
+
+    /// <summary>
+    /// Gets the slab or span that contains a given address.
+    /// </summary>
+    /// <param name="addr">The address.</param>
+    /// <returns>The header of the span, or <c>nullptr</c> if the address is not in the heap.</returns>
+    GCHeap::SpanHeader *GCHeap::GetSpan(const void *addr)
+    {
+        return static_cast<SpanHeader *> (m_spansByUnit.Lookup(addr));
+    }
+
+    /// <summary>
+    /// Gets the tag of the block in a span which contains a given address.
+    /// </summary>
+    /// <param name="span">The header of the span.</param>
+    /// <param name="addr">The address.</param>
+    /// <param name="exactly">Whether the address must be the start of the block.</param>
+    /// <returns>
+    /// The position of the tag in the span header, or <c>nullptr</c> if no block contains the address.
+    /// </returns>
+    void **GCHeap::GetTagSlot(SpanHeader *span, const void *addr, bool exactly)
+    {
+        /* Only the fields that never change after the span is created can be read
+        here, because blocks might be concurrently allocated by other threads: */
+        auto pos = static_cast<const char *> (addr);
+        if (pos < span->firstBlock)
+            return nullptr;
+
+        auto offset = static_cast<size_t> (pos - span->firstBlock);
+        auto index = offset / span->blockSize;
+
+        if (index >= span->numBlocks || (exactly && offset % span->blockSize != 0))
+            return nullptr;
+
+        return span->tags + index;
+    }
+
+    /// <summary>
+    /// Allocates a block of a given size class.
+    /// </summary>
+    /// <param name="sizeClass">The size class.</param>
+    /// <returns>The allocated block, or <c>nullptr</c> if the memory could not be allocated.</returns>
+    void *GCHeap::AllocateSmall(uint32_t sizeClass)
+    {
+        auto &sc = m_sizeClasses[sizeClass];
+
+        std::lock_guard<std::mutex> lock(sc.mutex);
+
+        auto slab = sc.partialSlabs;
+        if (slab == nullptr)
+        {
+            slab = CreateSpan(unitSize, sizeClass, sc.blockSize, sc.blocksPerSlab, sc.blockAlignment);
+            if (slab == nullptr)
+                return nullptr;
+
+            sc.partialSlabs = slab;
+            ++sc.emptySlabsCount;
+        }
+
+        if (slab->usedCount == 0)
+            --sc.emptySlabsCount;
+
+        void *block;
+        if (slab->freeList != nullptr)
+        {
+            block = slab->freeList;
+            slab->freeList = *static_cast<void **> (block);
+        }
+        else
+            block = slab->firstBlock + static_cast<size_t> (slab->unusedIndex++) * slab->blockSize;
+
+        // once full, the slab leaves the list:
+        if (++slab->usedCount == slab->numBlocks)
+        {
+            sc.partialSlabs = slab->next;
+            if (slab->next != nullptr)
+                slab->next->prev = nullptr;
+
+            slab->next = nullptr;
+        }
+
+        return block;
+    }
+
+    /// <summary>
+    /// Returns a block to its slab.
+    /// </summary>
+    /// <param name="slab">The header of the slab.</param>
+    /// <param name="addr">The address of the block.</param>
+    void GCHeap::FreeSmall(SpanHeader *slab, void *addr)
+    {
+        auto &sc = m_sizeClasses[slab->sizeClass];
+
+        std::lock_guard<std::mutex> lock(sc.mutex);
+
+        *static_cast<void **> (addr) = slab->freeList;
+        slab->freeList = addr;
+
+        // a full slab has vacant blocks again, so it returns to the list:
+        if (slab->usedCount-- == slab->numBlocks)
+        {
+            slab->prev = nullptr;
+            slab->next = sc.partialSlabs;
+            if (sc.partialSlabs != nullptr)
+                sc.partialSlabs->prev = slab;
+
+            sc.partialSlabs = slab;
+        }
+
+        if (slab->usedCount > 0)
+            return;
+
+        // keep one empty slab for the size class, but no more than that:
+        if (sc.emptySlabsCount == 0)
+        {
+            ++sc.emptySlabsCount;
+            return;
+        }
+
+        if (slab->prev != nullptr)
+            slab->prev->next = slab->next;
+        else
+            sc.partialSlabs = slab->next;
+
+        if (slab->next != nullptr)
+            slab->next->prev = slab->prev;
+
+        DestroySpan(slab);
+    }
+
+    /// <summary>
+    /// Allocates a block of memory, aligned in 16 bytes at least.
+    /// </summary>
+    /// <param name="size">The size of the block.</param>
+    /// <param name="alignment">
+    /// The alignment of the block, which must be a power of 2 no stricter than <see cref="maxAlignment"/>.
+    /// </param>
+    /// <returns>The allocated block, or <c>nullptr</c> if the memory could not be allocated.</returns>
+    void *GCHeap::Allocate(size_t size, size_t alignment)
+    {
+        _ASSERTE(alignment > 0 && (alignment & (alignment - 1)) == 0 && alignment <= maxAlignment);
+
+        if (alignment <= blockAlignment)
+        {
+            if (size <= maxSmallObjectSize)
+                return AllocateSmall(m_sizeClassBySize[(size + blockAlignment - 1) / blockAlignment]);
+        }
+        else
+        {
+            // a block of some size class with such alignment is taken, unless too large:
+            auto alignedSize = AlignUp(size, alignment);
+            if (alignedSize <= maxSmallObjectSize)
+            {
+                auto sizeClass = m_sizeClassBySize[alignedSize / blockAlignment];
+                while (sizeClass < numSizeClasses && m_sizeClasses[sizeClass].blockAlignment < alignment)
+                    ++sizeClass;
+
+                if (sizeClass < numSizeClasses)
+                    return AllocateSmall(sizeClass);
+            }
+        }
+
+        // large objects take a span of their own:
+        if (alignment < blockAlignment)
+            alignment = blockAlignment;
+
+        auto dataOffset = AlignUp(AlignUp(sizeof(SpanHeader), sizeof(void *)) + sizeof(void *), alignment);
+        if (size > SIZE_MAX - dataOffset - unitSize)
+            return nullptr;
+
+        auto span = CreateSpan(AlignUp(dataOffset + size, unitSize),
+                               static_cast<uint32_t> (numSizeClasses),
+                               size,
+                               1,
+                               alignment);
+        if (span == nullptr)
+            return nullptr;
+
+        span->usedCount = span->unusedIndex = 1;
+        return span->firstBlock;
+    }
+
+    /// <summary>
+    /// Frees a block of memory allocated from this heap.
+    /// </summary>
+    /// <param name="addr">The address of the block.</param>
+    void GCHeap::Free(void *addr)
+    {
+        auto span = GetSpan(addr);
+        _ASSERTE(span != nullptr); // the address must have been allocated from this heap
+
+#    ifndef NDEBUG
+        auto tagSlot = GetTagSlot(span, addr, true);
+        _ASSERTE(tagSlot != nullptr && *tagSlot == nullptr); // block must be untagged before freed
+#    endif
+
+        if (span->sizeClass == numSizeClasses)
+            DestroySpan(span);
+        else
+            FreeSmall(span, addr);
+    }
+
+    /// <summary>
+    /// Gets the tag of a block.
+    /// </summary>
+    /// <param name="blockAddr">The address of the block.</param>
+    /// <returns>The tag, or <c>nullptr</c> if none was set or the address does not start a block.</returns>
+    void *GCHeap::GetTag(const void *blockAddr)
+    {
+        auto span = GetSpan(blockAddr);
+        if (span == nullptr)
+            return nullptr;
+
+        auto tagSlot = GetTagSlot(span, blockAddr, true);
+        return (tagSlot != nullptr) ? *tagSlot : nullptr;
+    }
+
+    /// <summary>
+    /// Sets the tag of a block.
+    /// </summary>
+    /// <param name="blockAddr">The address of the block.</param>
+    /// <param name="tag">The tag to set.</param>
+    void GCHeap::SetTag(const void *blockAddr, void *tag)
+    {
+        auto span = GetSpan(blockAddr);
+        _ASSERTE(span != nullptr); // the address must have been allocated from this heap
+
+        auto tagSlot = GetTagSlot(span, blockAddr, true);
+        _ASSERTE(tagSlot != nullptr); // the address must be the start of a block
+
+        *tagSlot = tag;
+    }
+
+    /// <summary>
+    /// Gets the tag of the block which contains a given address.
+    /// </summary>
+    /// <param name="addr">The address for which a container will be searched.</param>
+    /// <returns>
+    /// The tag of the block containing the given address, or <c>nullptr</c>
+    /// if none was set or the address is not inside a block of this heap.
+    /// </returns>
+    void *GCHeap::GetContainerTag(const void *addr)
+    {
+        auto span = GetSpan(addr);
+        if (span == nullptr)
+            return nullptr;
+
+        auto tagSlot = GetTagSlot(span, addr, false);
+        return (tagSlot != nullptr) ? *tagSlot : nullptr;
+    }
+
+    /// <summary>
+    /// Gets the start of the block which contains a given address.
+    /// Unlike the tags, this can be used by any thread.
+    /// </summary>
+    /// <param name="addr">The address for which a container will be searched.</param>
+    /// <returns>
+    /// The address of the block containing the given address, or
+    /// <c>nullptr</c> if the address is not inside a block of this heap.
+    /// </returns>
+    void *GCHeap::GetBlockStart(const void *addr)
+    {
+        auto span = GetSpan(addr);
+        if (span == nullptr)
+            return nullptr;
+
+        auto tagSlot = GetTagSlot(span, addr, false);
+        if (tagSlot == nullptr)
+            return nullptr;
+
+        return span->firstBlock + (tagSlot - span->tags) * span->blockSize;
+    }
+
+    /// <summary>
+    /// Iterates over each tag set in the heap.
+    /// </summary>
+    /// <param name="callback">The callback to invoke for each tag.</param>
+    void GCHeap::ForEachTag(const std::function<void(void *)> &callback)
+    {
+        std::lock_guard<std::mutex> lock(m_tagsIterationMutex);
+
+        m_spansByUnit.ForEach([&callback](const void *unitAddr, void *value)
+        {
+            auto span = static_cast<SpanHeader *> (value);
+
+            // a large span is mapped by several units, but must be visited once:
+            if (unitAddr != span)
+                return;
+
+            for (uint32_t idx = 0; idx < span->numBlocks; ++idx)
+            {
+                if (span->tags[idx] != nullptr)
+                    callback(span->tags[idx]);
+            }
+        });
+    }
+
+    /// <summary>
+    /// Clears all tags set in the heap.
+    /// </summary>
+    void GCHeap::ClearTags()
+    {
+        std::lock_guard<std::mutex> lock(m_tagsIterationMutex);
+
+        m_spansByUnit.ForEach([](const void *unitAddr, void *value)
+        {
+            auto span = static_cast<SpanHeader *> (value);
+            if (unitAddr != span)
+                return;
+
+            for (uint32_t idx = 0; idx < span->numBlocks; ++idx)
+                span->tags[idx] = nullptr;
+        });
+    }
+
+}// end of namespace memory
+}// end of namespace _3fd
@@ -0,0 +1,135 @@
+#ifndef GC_HEAP_H // header guard
+#define GC_HEAP_H
+
+#include "gc_pagemap.h"
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+
+namespace _3fd
+{
+namespace memory
+{
+    /// <summary>
+    /// The heap that provides the memory for the objects managed by the GC.
+    /// Small objects come from slabs, which are regions of fixed size holding blocks
+    /// of a single size class, whereas a large object takes a span of its own.
+    /// </summary>
+    /// <remarks>
+    /// Slabs and spans are aligned to their unit of size and start with a header,
+    /// so the block containing an address is found by masking the address and some
+    /// arithmetic, without searching. The header also keeps a tag for each block,
+    /// which the GC sets to the vertex representing the block in the memory graph.
+    /// Blocks can be allocated by any thread, but tags must only be accessed by the
+    /// GC thread. Blocks are freed by the GC thread, or else by the finalizer threads,
+    /// once the GC thread has cleared their tags.
+    /// </remarks>
+    class GCHeap
+    {
+    public:
+
+        /// <summary>
+        /// The size of the unit slabs and spans are made of, which is also their alignment.
+        /// </summary>
+        static const size_t unitSize = pageMapPageSize;
+
+        /// <summary>
+        /// Objects larger than this are not allocated from slabs.
+        /// </summary>
+        static const size_t maxSmallObjectSize = 8192;
+
+        /// <summary>
+        /// The alignment of every block allocated from the heap, unless a stricter one is requested.
+        /// </summary>
+        static const size_t blockAlignment = 16;
+
+        /// <summary>
+        /// The strictest alignment a block can be requested with.
+        /// </summary>
+        static const size_t maxAlignment = unitSize;
+
+    private:
+
+        struct SpanHeader;
+
+        /// <summary>
+        /// Keeps the slabs of a size class that have vacant blocks.
+        /// </summary>
+        struct SizeClass
+        {
+            std::mutex mutex;
+            SpanHeader *partialSlabs;
+            uint32_t blockSize;
+            uint32_t blockAlignment;
+            uint32_t blocksPerSlab;
+            uint32_t emptySlabsCount;
+        };
+
+        static const size_t numSizeClasses = 32;
+
+        std::array<SizeClass, numSizeClasses> m_sizeClasses;
+
+        std::array<uint8_t, maxSmallObjectSize / blockAlignment + 1> m_sizeClassBySize;
+
+        /// <summary>
+        /// Maps each unit of memory in use by the heap to the header of its slab or span.
+        /// Defining _3FD_GC_HASHED_PAGEMAP replaces the radix tree by a hash table.
+        /// </summary>
+#   ifdef _3FD_GC_HASHED_PAGEMAP
+        HashedPageMap m_spansByUnit;
+#   else
+        RadixPageMap m_spansByUnit;
+#   endif
+
+        /// <summary>
+        /// Keeps slabs and spans from being destroyed while their tags are iterated,
+        /// because blocks might be freed by other threads meanwhile.
+        /// </summary>
+        std::mutex m_tagsIterationMutex;
+
+        GCHeap();
+
+        static uint32_t Log2Floor(uint32_t value);
+
+        SpanHeader *CreateSpan(size_t spanSize, uint32_t sizeClass, size_t blockSize, uint32_t numBlocks, size_t alignment);
+
+        void DestroySpan(SpanHeader *span);
+
+        SpanHeader *GetSpan(const void *addr);
+
+        void *AllocateSmall(uint32_t sizeClass);
+
+        void FreeSmall(SpanHeader *slab, void *addr);
+
+        static void **GetTagSlot(SpanHeader *span, const void *addr, bool exactly);
+
+    public:
+
+        static GCHeap &GetInstance();
+
+        GCHeap(const GCHeap &) = delete;
+
+        void *Allocate(size_t size, size_t alignment = blockAlignment);
+
+        void Free(void *addr);
+
+        void *GetTag(const void *blockAddr);
+
+        void SetTag(const void *blockAddr, void *tag);
+
+        void *GetContainerTag(const void *addr);
+
+        void *GetBlockStart(const void *addr);
+
+        void ForEachTag(const std::function<void(void *)> &callback);
+
+        void ClearTags();
+    };
+
+}// end of namespace memory
+}// end of namespace _3fd
+
+#endif // end of header guard
@@ -0,0 +1,172 @@
+#include "pch.h"
+#include "gc_heapsnapshot.h"
+#include "exceptions.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace _3fd
+{
+namespace memory
+{
+    static const char snapshotMagic[8] = { '3', 'F', 'D', 'H', 'E', 'A', 'P', '\0' };
+
+    static const uint32_t snapshotVersion = 1;
+
+    template <typename ValType>
+    static void WriteValue(std::ostream &output, ValType value)
+    {
+        output.write(reinterpret_cast<const char *> (&value), sizeof value);
+    }
+
+    template <typename ValType>
+    static ValType ReadValue(std::istream &input)
+    {
+        ValType value{};
+        input.read(reinterpret_cast<char *> (&value), sizeof value);
+        return value;
+    }
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="HeapSnapshot"/> class.
+    /// </summary>
+    HeapSnapshot::HeapSnapshot() :
+        m_timeTaken(0)
+    {}
+
+    /// <summary>
+    /// Discards the contents of this snapshot, so it can be taken again.
+    /// </summary>
+    /// <param name="verticesCount">How many vertices are expected, for which room is reserved.</param>
+    void HeapSnapshot::Clear(size_t verticesCount)
+    {
+        m_timeTaken = std::chrono::duration_cast<std::chrono::microseconds> (
+            std::chrono::system_clock::now().time_since_epoch()
+        );
+
+        m_vertices.clear();
+        m_edges.clear();
+        m_roots.clear();
+        m_vertices.reserve(verticesCount);
+        m_edges.reserve(verticesCount);
+    }
+
+    /// <summary>
+    /// Saves this snapshot to a file.
+    /// </summary>
+    /// <param name="filePath">The path of the file, which is overwritten.</param>
+    void HeapSnapshot::Save(const std::string &filePath) const
+    {
+        std::ofstream ofs(filePath, std::ios::binary | std::ios::trunc);
+        if (!ofs.is_open())
+            throw core::AppException<std::runtime_error>("Could not open file to save snapshot of GC heap", filePath);
+
+        ofs.write(snapshotMagic, sizeof snapshotMagic);
+        WriteValue<uint32_t>(ofs, snapshotVersion);
+        WriteValue<uint32_t>(ofs, 0);
+        WriteValue<uint64_t>(ofs, m_timeTaken.count());
+        WriteValue<uint64_t>(ofs, m_vertices.size());
+        WriteValue<uint64_t>(ofs, m_edges.size());
+        WriteValue<uint64_t>(ofs, m_roots.size());
+
+        for (auto &vertex : m_vertices)
+        {
+            WriteValue(ofs, vertex.address);
+            WriteValue(ofs, vertex.typeTag);
+            WriteValue(ofs, vertex.blockSize);
+        }
+
+        for (auto &edge : m_edges)
+        {
+            WriteValue(ofs, edge.from);
+            WriteValue(ofs, edge.to);
+        }
+
+        for (auto &root : m_roots)
+        {
+            WriteValue(ofs, root.sptrAddress);
+            WriteValue(ofs, root.to);
+        }
+
+        ofs.flush();
+        if (ofs.fail())
+            throw core::AppException<std::runtime_error>("Failed to write snapshot of GC heap to file", filePath);
+    }
+
+    /// <summary>
+    /// Loads a snapshot from a file.
+    /// </summary>
+    /// <param name="filePath">The path of the file.</param>
+    /// <returns>The snapshot loaded.</returns>
+    HeapSnapshot HeapSnapshot::Load(const std::string &filePath)
+    {
+        std::ifstream ifs(filePath, std::ios::binary);
+        if (!ifs.is_open())
+            throw core::AppException<std::runtime_error>("Could not open file of GC heap snapshot", filePath);
+
+        char magic[sizeof snapshotMagic];
+        ifs.read(magic, sizeof magic);
+        auto version = ReadValue<uint32_t>(ifs);
+        ReadValue<uint32_t>(ifs);
+
+        if (ifs.fail() || memcmp(magic, snapshotMagic, sizeof magic) != 0 || version != snapshotVersion)
+            throw core::AppException<std::runtime_error>("File is not a GC heap snapshot of a supported version", filePath);
+
+        HeapSnapshot snapshot;
+        snapshot.m_timeTaken = std::chrono::microseconds(ReadValue<uint64_t>(ifs));
+        auto verticesCount = ReadValue<uint64_t>(ifs);
+        auto edgesCount = ReadValue<uint64_t>(ifs);
+        auto rootsCount = ReadValue<uint64_t>(ifs);
+
+        // the counts are not trusted for reserving room, in case the file is corrupt:
+        for (uint64_t idx = 0; idx < verticesCount; ++idx)
+        {
+            VertexRecord vertex;
+            vertex.address = ReadValue<uint64_t>(ifs);
+            vertex.typeTag = ReadValue<uint64_t>(ifs);
+            vertex.blockSize = ReadValue<uint32_t>(ifs);
+
+            if (ifs.fail())
+                break;
+
+            snapshot.m_vertices.push_back(vertex);
+        }
+
+        for (uint64_t idx = 0; idx < edgesCount && !ifs.fail(); ++idx)
+        {
+            EdgeRecord edge;
+            edge.from = ReadValue<uint32_t>(ifs);
+            edge.to = ReadValue<uint32_t>(ifs);
+
+            if (ifs.fail())
+                break;
+
+            if (edge.from >= snapshot.m_vertices.size() || edge.to >= snapshot.m_vertices.size())
+                throw core::AppException<std::runtime_error>("GC heap snapshot has edge out of range", filePath);
+
+            snapshot.m_edges.push_back(edge);
+        }
+
+        for (uint64_t idx = 0; idx < rootsCount && !ifs.fail(); ++idx)
+        {
+            RootRecord root;
+            root.sptrAddress = ReadValue<uint64_t>(ifs);
+            root.to = ReadValue<uint32_t>(ifs);
+
+            if (ifs.fail())
+                break;
+
+            if (root.to >= snapshot.m_vertices.size())
+                throw core::AppException<std::runtime_error>("GC heap snapshot has root out of range", filePath);
+
+            snapshot.m_roots.push_back(root);
+        }
+
+        if (ifs.fail())
+            throw core::AppException<std::runtime_error>("GC heap snapshot file is truncated", filePath);
+
+        return snapshot;
+    }
+
+}// end of namespace memory
+}// end of namespace _3fd
@@ -0,0 +1,127 @@
+#ifndef GC_HEAPSNAPSHOT_H // header guard
+#define GC_HEAPSNAPSHOT_H
+
+#include <3fd/core/gc_common.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace _3fd
+{
+namespace memory
+{
+    /// <summary>
+    /// A snapshot of the graph of memory blocks managed by the GC, with the
+    /// vertices, the edges between them, and the roots holding them, which
+    /// can be saved to a compact binary file for offline analysis.
+    /// </summary>
+    /// <remarks>
+    /// The file has a header, followed by the arrays of vertices, edges and roots. Values
+    /// are written in the byte order of the machine taking the snapshot, with fixed sizes:
+    ///
+    ///   header: magic "3FDHEAP\0", version (u32), reserved (u32), time taken in microseconds
+    ///           since the epoch (u64), count of vertices (u64), edges (u64) and roots (u64)
+    ///   vertex: address (u64), type tag (u64), block size (u32)
+    ///   edge:   index of the vertex holding the pointer (u32), index of the vertex pointed (u32)
+    ///   root:   address of the pointer (u64), index of the vertex pointed (u32)
+    ///
+    /// The type tag is the address of the callback that frees the memory block, which is
+    /// specific to the type of the object in it, so blocks of the same type share the tag.
+    /// </remarks>
+    class HeapSnapshot
+    {
+    public:
+
+        /// <summary>
+        /// A memory block managed by the GC.
+        /// </summary>
+        struct VertexRecord
+        {
+            uint64_t address;
+            uint64_t typeTag;
+            uint32_t blockSize;
+        };
+
+        /// <summary>
+        /// A pointer inside a memory block managed by the GC, to another one.
+        /// </summary>
+        struct EdgeRecord
+        {
+            uint32_t from;
+            uint32_t to;
+        };
+
+        /// <summary>
+        /// A pointer outside the memory managed by the GC, to a memory block that is.
+        /// </summary>
+        struct RootRecord
+        {
+            uint64_t sptrAddress;
+            uint32_t to;
+        };
+
+    private:
+
+        std::chrono::microseconds m_timeTaken;
+
+        std::vector<VertexRecord> m_vertices;
+        std::vector<EdgeRecord> m_edges;
+        std::vector<RootRecord> m_roots;
+
+    public:
+
+        HeapSnapshot();
+
+        HeapSnapshot(const HeapSnapshot &) = delete;
+
+        HeapSnapshot(HeapSnapshot &&) = default;
+
+        void Clear(size_t verticesCount);
+
+        /// <summary>
+        /// Adds a vertex, whose index is the amount of vertices added before it.
+        /// </summary>
+        void AddVertex(const void *memAddr, size_t blockSize, FreeMemProc freeMemCallback)
+        {
+            m_vertices.push_back(VertexRecord{
+                reinterpret_cast<uintptr_t> (memAddr),
+                reinterpret_cast<uintptr_t> (freeMemCallback),
+                static_cast<uint32_t> (blockSize)
+            });
+        }
+
+        /// <summary>
+        /// Adds an edge between the vertices with the given indexes.
+        /// </summary>
+        void AddEdge(uint32_t from, uint32_t to) { m_edges.push_back(EdgeRecord{ from, to }); }
+
+        /// <summary>
+        /// Adds a root holding the vertex with the given index.
+        /// </summary>
+        void AddRoot(const void *sptrObjAddr, uint32_t to)
+        {
+            m_roots.push_back(RootRecord{ reinterpret_cast<uintptr_t> (sptrObjAddr), to });
+        }
+
+        /// <summary>
+        /// Gets when the snapshot was taken, in microseconds since the epoch.
+        /// </summary>
+        std::chrono::microseconds GetTimeTaken() const { return m_timeTaken; }
+
+        const std::vector<VertexRecord> &GetVertices() const { return m_vertices; }
+
+        const std::vector<EdgeRecord> &GetEdges() const { return m_edges; }
+
+        const std::vector<RootRecord> &GetRoots() const { return m_roots; }
+
+        void Save(const std::string &filePath) const;
+
+        static HeapSnapshot Load(const std::string &filePath);
+    };
+
+}// end of namespace memory
+}// end of namespace _3fd
+
+#endif // end of header guard
@@ -1,18 +1,38 @@
 #include "pch.h"
 #include "gc_memorydigraph.h"
+#include "gc_digraphshards.h"
 
 #include <cassert>
+#include <memory>
 
 namespace _3fd
 {
 namespace memory
 {
     /// <summary>
-    /// Shrinks the pool of <see cref="Vertex"/> objects.
+    /// Sets the pool of threads that finalize the objects collected. Until then,
+    /// or when set to <c>nullptr</c>, that is done by the calling thread.
     /// </summary>
-    void MemoryDigraph::ShrinkVertexPool()
+    /// <param name="finalizers">The pool of finalizer threads.</param>
+    /// <remarks>
+    /// An object is only collected once the objects holding safe pointers to it
+    /// have released them, which is done by their destructors. With the finalizer
+    /// threads, that happens some time after the collection, so until then, an edge
+    /// from a vertex already collected holds the receiving vertex just like a root.
+    /// </remarks>
+    void MemoryDigraph::SetFinalizerPool(FinalizerPool *finalizers)
+    {
+        m_finalizers = finalizers;
+        m_reachabilityAnalyzer.SetCollectedHolds(finalizers != nullptr);
+    }
+
+    /// <summary>
+    /// Shrinks the pool of <see cref="Vertex"/> objects, if due.
+    /// </summary>
+    /// <param name="forced">Whether to shrink the pool regardless of usage and time.</param>
+    void MemoryDigraph::ShrinkVertexPool(bool forced)
     {
-        m_vertices.ShrinkPool();
+        m_vertices.ShrinkPool(forced);
     }
 
     /// <summary>
@@ -22,12 +42,15 @@ namespace memory
     /// <param name="sptrObjHashTableElem">
     /// A hashtable element which represents the pointer.
     /// </param>
-    /// <param name="pointedAddr">The referred memory address.</param>
+    /// <param name="pointedAddr">
+    /// The referred memory address, which might be inside the memory block,
+    /// as for an object taken from a <see cref="gc_vector"/>.
+    /// </param>
     void MemoryDigraph::MakeReference(
         AddressesHashTable::Element &sptrObjHashTableElem,
         void *pointedAddr)
     {
-        auto pointedMemBlock = m_vertices.GetVertex(pointedAddr);
+        auto pointedMemBlock = m_vertices.GetContainerVertex(pointedAddr);
 
         /* By the time the connection is to be set, the vertex representing
         the pointed memory block must already exist in the graph. If not present,
@@ -65,37 +88,294 @@ namespace memory
     }
 
     /// <summary>
-    /// Determines whether this vertex is reachable by any root vertex
-    /// using depth-first search algorithm.
+    /// Starts a new pass of reachability analysis, taking care
+    /// of resetting the epochs before they are exhausted.
+    /// </summary>
+    /// <param name="maxSearches">The maximum amount of searches in the pass.</param>
+    void MemoryDigraph::StartReachabilityPass(size_t maxSearches)
+    {
+        /* Vertices out of the store have had their resources released,
+        so the search never looks at their epochs, and only those in the
+        store need to be reset: */
+        if (!m_reachabilityAnalyzer.HasEpochsFor(maxSearches))
+        {
+            m_vertices.ForEach([](Vertex *memBlock) { memBlock->SetEpoch(0); });
+            m_reachabilityAnalyzer.ResetEpochs();
+        }
+
+        m_reachabilityAnalyzer.StartPass();
+    }
+
+    /// <summary>
+    /// Releases the resources of a memory block that has become
+    /// unreachable, and removes the vertex from the graph.
+    /// </summary>
+    /// <param name="memBlock">The vertex representing the memory block.</param>
+    /// <param name="allowDtion">Whether the destructor of the object is to be invoked.</param>
+    void MemoryDigraph::CollectVertex(Vertex *memBlock, bool allowDtion)
+    {
+        if (memBlock->HasWeakReferences())
+            m_weakRefs.Discard(memBlock);
+
+        // First remove the vertex from the ordered set of vertices...
+        m_vertices.RemoveVertex(memBlock);
+
+        /* When the piece of memory represented by this vertex is
+        released, the data member in the vertex object that holds
+        its memory address is set to zero. Because the store finds
+        the vertices by such address, that should not be altered
+        before anything that looks up the vertex in the store, like
+        the removal performed in the line above. */
+        if (m_finalizers != nullptr)
+            memBlock->HandOverReprObjResources(*m_finalizers, allowDtion);
+        else
+            memBlock->ReleaseReprObjResources(allowDtion);
+
+        /* if isolated in the graph and not referred by the
+        list of candidates, it can be safely returned to the
+        object pool... */
+        if (!memBlock->HasAnyEdges() && !memBlock->IsCandidate())
+            delete memBlock;
+    }
+
+    /// <summary>
+    /// Expires the weak references to a memory block that has become unreachable
+    /// on its own, which is when it has no incoming edges left.
     /// </summary>
+    /// <param name="memBlock">The vertex representing the memory block.</param>
     /// <returns>
-    /// <c>true</c> if there is a path through with a root vertex
-    /// can reach this vertex, otherwise, <c>false</c>.
+    /// Whether the memory block can be collected, which is not the case when a weak
+    /// reference is locked, because the lock is about to give the block an edge.
     /// </returns>
-    bool IsReachable(Vertex *memBlock)
+    bool MemoryDigraph::ExpireWeakReferences(Vertex *memBlock)
     {
-        if (memBlock->HasRootEdges())
-            return true;
+        return !memBlock->HasWeakReferences() || m_weakRefs.TryExpire(&memBlock, 1);
+    }
 
-        // mark this vertex before going deeper
-        memBlock->Mark(true);
+    /// <summary>
+    /// Evaluates the reachability of the candidates gathered since the last
+    /// time, in a single pass of analysis, and collects those unreachable.
+    /// </summary>
+    /// <returns>
+    /// Whether any memory block has been collected.
+    /// </returns>
+    /// <remarks>
+    /// Only the candidates themselves are collected. The remaining of an unreachable
+    /// subgraph is collected by the messages the destructors emit when releasing
+    /// their pointers, which in turn produce more candidates.
+    /// </remarks>
+    bool MemoryDigraph::CollectUnreachableCandidates()
+    {
+        if (m_candidates.empty())
+            return false;
+
+        StartReachabilityPass(m_candidates.size());
+
+        bool collected(false);
+        for (auto memBlock : m_candidates)
+        {
+            memBlock->SetCandidate(false);
 
-        // iterate over the vertices of receiving edges:
-        bool rootFound(false);
-        memBlock->ForEachRegularReceivingVertex(
-            [&rootFound](Vertex *recvEdgeVtx)
+            if (!memBlock->AreReprObjResourcesReleased())
             {
-                return rootFound =
-                    !recvEdgeVtx->IsMarked() // prevent infinite recursion
-                    && !recvEdgeVtx->AreReprObjResourcesReleased() // already collected, skip
-                    && IsReachable(recvEdgeVtx); // recursive search
+                if (!m_reachabilityAnalyzer.IsReachable(memBlock))
+                {
+                    CollectVertex(memBlock, true);
+                    collected = true;
+                }
             }
-        );
+            // released meanwhile, so it only had to stay for the sake of this list:
+            else if (!memBlock->HasAnyEdges())
+                delete memBlock;
+        }
+
+        m_candidates.clear();
+        return collected;
+    }
 
-        // unmark this vertex before leaving
-        memBlock->Mark(false);
+    /// <summary>
+    /// Takes a snapshot of the graph, which must have no changes pending.
+    /// This only copies the vertices and edges, so it takes little time.
+    /// </summary>
+    /// <param name="snapshot">Where to take the snapshot.</param>
+    /// <param name="shards">
+    /// The shards holding the pointers, when the work is split among them, otherwise, <c>nullptr</c>.
+    /// </param>
+    void MemoryDigraph::TakeSnapshot(HeapSnapshot &snapshot, const DigraphShards *shards)
+    {
+        snapshot.Clear(m_vertices.GetVerticesCount());
 
-        return rootFound;
+        // Index the vertices by their epochs, just like in the collection of the whole graph:
+        std::vector<Vertex *> vertices;
+        vertices.reserve(m_vertices.GetVerticesCount());
+        m_vertices.ForEach([&vertices, &snapshot](Vertex *memBlock)
+        {
+            memBlock->SetEpoch(static_cast<uint32_t> (vertices.size()));
+            vertices.push_back(memBlock);
+
+            snapshot.AddVertex(memBlock->GetMemoryAddress().Get(),
+                               memBlock->GetBlockSize(),
+                               memBlock->GetFreeMemCallback());
+        });
+
+        for (uint32_t idx = 0; idx < vertices.size(); ++idx)
+        {
+            // edges from collected vertices are left out, because they are gone from the store:
+            vertices[idx]->ForEachRegularReceivingVertex([&snapshot, idx](Vertex *recvEdgeVtx)
+            {
+                if (!recvEdgeVtx->AreReprObjResourcesReleased())
+                    snapshot.AddEdge(recvEdgeVtx->GetEpoch(), idx);
+
+                return true;
+            });
+        }
+
+        // the vertices only count the edges from roots, so these are found among the pointers:
+        auto addRoot = [&snapshot](const AddressesHashTable::Element &element)
+        {
+            if (element.IsRoot() && element.GetPointedMemBlock() != nullptr)
+                snapshot.AddRoot(element.GetSptrObjectAddr(), element.GetPointedMemBlock()->GetEpoch());
+        };
+
+        if (shards != nullptr)
+            shards->ForEachPointer(addRoot);
+        else
+            m_sptrObjects.ForEach(addRoot);
+
+        // the containers outside the managed memory are roots as well:
+        m_edgeSets.ForEach([&snapshot](void *containerAddr, const EdgeSets::EdgeSet &set)
+        {
+            if (set.origin == nullptr)
+            {
+                for (auto handle : set.targets)
+                    snapshot.AddRoot(containerAddr, Vertex::FromHandle(handle)->GetEpoch());
+            }
+        });
+
+        for (auto memBlock : vertices)
+            memBlock->SetEpoch(0);
+
+        m_reachabilityAnalyzer.ResetEpochs();
+    }
+
+    /// <summary>
+    /// Collects every memory block in the graph that is unreachable, which settles
+    /// all candidates at once. The vertices reachable from the roots are marked by
+    /// several threads, whereas this thread sweeps the unmarked ones.
+    /// </summary>
+    /// <param name="marker">The marker that spreads the work across threads.</param>
+    /// <returns>
+    /// Whether any memory block has been collected.
+    /// </returns>
+    bool MemoryDigraph::CollectAllUnreachable(ParallelMarker &marker)
+    {
+        /* Index the vertices, temporarily using their epochs for that, which is
+        fine because the results of reachability analysis are discarded anyway: */
+        std::vector<Vertex *> vertices;
+        m_vertices.ForEach([&vertices](Vertex *memBlock)
+        {
+            memBlock->SetEpoch(static_cast<uint32_t> (vertices.size()));
+            vertices.push_back(memBlock);
+        });
+
+        /* The graph only keeps the incoming edges, so turn them into outgoing edges.
+        Edges from released vertices are left out, hence some rows are not full: */
+        ParallelMarker::OutgoingEdges edges;
+        edges.first.resize(vertices.size());
+        edges.last.resize(vertices.size());
+
+        uint32_t offset(0);
+        for (size_t idx = 0; idx < vertices.size(); ++idx)
+        {
+            edges.first[idx] = edges.last[idx] = offset;
+            offset += vertices[idx]->GetOutgoingEdgeCount();
+        }
+
+        edges.targets.resize(offset);
+
+        std::vector<uint32_t> roots;
+        for (uint32_t idx = 0; idx < vertices.size(); ++idx)
+        {
+            if (vertices[idx]->IsHeldByRoot())
+            {
+                roots.push_back(idx);
+                continue; // marked anyway, so the incoming edges do not matter
+            }
+
+            bool heldByCollected(false);
+            vertices[idx]->ForEachRegularReceivingVertex([&edges, &heldByCollected, idx](Vertex *recvEdgeVtx)
+            {
+                if (!recvEdgeVtx->AreReprObjResourcesReleased())
+                    edges.targets[edges.last[recvEdgeVtx->GetEpoch()]++] = idx;
+                else
+                    heldByCollected = true;
+
+                return true;
+            });
+
+            // the finalizer threads have yet to release the edges from collected vertices:
+            if (heldByCollected && m_finalizers != nullptr)
+                roots.push_back(idx);
+        }
+
+        /* Before the unmarked vertices are swept, their weak references must expire.
+        Any found locked becomes a root, and the marking is repeated until none is: */
+        std::vector<Vertex *> weaklyReferenced;
+        while (true)
+        {
+            marker.Mark(edges, roots);
+
+            weaklyReferenced.clear();
+            for (uint32_t idx = 0; idx < vertices.size(); ++idx)
+            {
+                if (vertices[idx]->HasWeakReferences() && !marker.IsMarked(idx))
+                    weaklyReferenced.push_back(vertices[idx]);
+            }
+
+            if (weaklyReferenced.empty()
+                || m_weakRefs.TryExpire(weaklyReferenced.data(), weaklyReferenced.size()))
+            {
+                break;
+            }
+
+            for (uint32_t idx = 0; idx < vertices.size(); ++idx)
+            {
+                if (vertices[idx]->IsLockedByWeakReference() && !marker.IsMarked(idx))
+                    roots.push_back(idx);
+            }
+        }
+
+        // Sweep:
+        bool collected(false);
+        for (uint32_t idx = 0; idx < vertices.size(); ++idx)
+        {
+            auto memBlock = vertices[idx];
+
+            if (marker.IsMarked(idx))
+            {
+                memBlock->SetEpoch(0);
+                ++m_markedCount;
+            }
+            else
+            {
+                CollectVertex(memBlock, true);
+                collected = true;
+            }
+        }
+
+        m_reachabilityAnalyzer.ResetEpochs();
+
+        // All candidates are settled:
+        for (auto memBlock : m_candidates)
+        {
+            memBlock->SetCandidate(false);
+
+            if (memBlock->AreReprObjResourcesReleased() && !memBlock->HasAnyEdges())
+                delete memBlock;
+        }
+
+        m_candidates.clear();
+        return collected;
     }
 
     /// <summary>
@@ -133,8 +413,12 @@ namespace memory
 
             /* if no longer starts or receives any edge, then
             this vertex became isolated in the graph and can
-            be safely returned to the object pool... */
-            if (!originatorVtx->HasAnyEdges())
+            be safely returned to the object pool, unless the
+            list of candidates still refers to it, or the edge
+            was a loop, which is then taken care of below... */
+            if (originatorVtx != receivingVtx
+                && !originatorVtx->HasAnyEdges()
+                && !originatorVtx->IsCandidate())
             {
                 /* ... but the represented object resources have
                 to be released before this vertex disappears */
@@ -145,36 +429,122 @@ namespace memory
 
         if (!receivingVtx->AreReprObjResourcesReleased())
         {
-            /* If the memory block has just now became unreachable,
-            release its resources and remove it from the graph: */
-            if (!IsReachable(receivingVtx))
+            /* With no incoming edges left, the memory block has
+            just now become unreachable, and there is nothing to
+            analyse, so release its resources right away: */
+            if (!receivingVtx->HasIncomingEdges())
+            {
+                if (ExpireWeakReferences(receivingVtx))
+                    CollectVertex(receivingVtx, allowDtion);
+            }
+            /* An object whose construction failed cannot wait for the
+            analysis of candidates, because its destructor must not be
+            invoked, so evaluate its reachability right away: */
+            else if (!allowDtion)
+            {
+                StartReachabilityPass(1);
+
+                if (!m_reachabilityAnalyzer.IsReachable(receivingVtx))
+                    CollectVertex(receivingVtx, false);
+            }
+            /* Otherwise, postpone the analysis, so the reachability results
+            can be shared with the other candidates in the same batch: */
+            else if (!receivingVtx->IsCandidate())
             {
-                // First remove the vertex from the ordered set of vertices...
-                m_vertices.RemoveVertex(receivingVtx);
-
-                /* When the piece of memory represented by this vertex is
-                released, the data member in the vertex object that holds
-                its memory address is set to zero. Because the ordered set
-                of vertices organizes the elements by such address, that
-                should not be altered before anything that performs a search
-                in the set, like the removal performed in the line above. */
-                receivingVtx->ReleaseReprObjResources(allowDtion);
-
-                /* if isolated in the graph, it can be
-                safely returned to the object pool... */
-                if (!receivingVtx->HasAnyEdges())
-                    delete receivingVtx;
+                receivingVtx->SetCandidate(true);
+                m_candidates.push_back(receivingVtx);
             }
         }
         /* otherwise, if the memory block was already unreachable, just
         check if the corresponding vertex is isolated in the graph, hence
         able to be safely returned to the object pool: */
-        else if (!receivingVtx->HasAnyEdges())
+        else if (!receivingVtx->HasAnyEdges() && !receivingVtx->IsCandidate())
         {
             delete receivingVtx;
         }
     }
 
+    /// <summary>
+    /// Settles the changes made to a vertex by the shards of the graph, which
+    /// is what <see cref="UnmakeReference"/> does after an edge is removed.
+    /// </summary>
+    /// <param name="memBlock">The vertex, which must have pending changes.</param>
+    void MemoryDigraph::SettleChanges(Vertex *memBlock)
+    {
+        auto changes = memBlock->TakePendingChanges();
+        _ASSERTE(changes != 0);
+
+        // the memory block was already unreachable, so the vertex might now be isolated:
+        if (memBlock->AreReprObjResourcesReleased())
+        {
+            if (!memBlock->HasAnyEdges() && !memBlock->IsCandidate())
+                delete memBlock;
+
+            return;
+        }
+
+        bool allowDtion = (changes & Vertex::AbortedObject) == 0;
+
+        if (!memBlock->HasIncomingEdges())
+        {
+            if (ExpireWeakReferences(memBlock))
+                CollectVertex(memBlock, allowDtion);
+        }
+        else if (!allowDtion)
+        {
+            StartReachabilityPass(1);
+
+            if (!m_reachabilityAnalyzer.IsReachable(memBlock))
+                CollectVertex(memBlock, false);
+        }
+        else if ((changes & Vertex::LostIncomingEdge) != 0 && !memBlock->IsCandidate())
+        {
+            memBlock->SetCandidate(true);
+            m_candidates.push_back(memBlock);
+        }
+    }
+
+    /// <summary>
+    /// Moves the reference from a pointer to another, so the
+    /// latter points what the former pointed, which then points nothing.
+    /// </summary>
+    /// <param name="toSptrObjHashTableElem">
+    /// A hashtable element which represents the pointer taking over the reference.
+    /// It must not be referencing anything.
+    /// </param>
+    /// <param name="fromSptrObjHashTableElem">
+    /// A hashtable element which represents the pointer giving up the reference.
+    /// </param>
+    void MemoryDigraph::TransferReference(AddressesHashTable::Element &toSptrObjHashTableElem,
+                                          AddressesHashTable::Element &fromSptrObjHashTableElem)
+    {
+        _ASSERTE(toSptrObjHashTableElem.GetPointedMemBlock() == nullptr);
+
+        auto pointedMemBlock = fromSptrObjHashTableElem.GetPointedMemBlock();
+        if (pointedMemBlock == nullptr)
+            return;
+
+        if (toSptrObjHashTableElem.IsRoot() && fromSptrObjHashTableElem.IsRoot())
+        {
+            /* the edges from roots are identified by the pointer address, so replace the
+            edge, but never let the pointed memory block be left without it meanwhile: */
+            pointedMemBlock->ReceiveEdgeFrom(toSptrObjHashTableElem.GetSptrObjectAddr());
+            pointedMemBlock->RemoveEdgeFrom(fromSptrObjHashTableElem.GetSptrObjectAddr());
+        }
+        else if (toSptrObjHashTableElem.GetContainerMemBlock() != fromSptrObjHashTableElem.GetContainerMemBlock())
+        {
+            /* the edge now starts somewhere else, which might change the reachability of
+            the pointed memory block, hence it is evaluated as if it were two operations: */
+            MakeReference(toSptrObjHashTableElem, pointedMemBlock);
+            UnmakeReference(fromSptrObjHashTableElem, true);
+            return;
+        }
+        // else, both pointers are inside the same memory block, which keeps its edge
+
+        toSptrObjHashTableElem.SetPointedMemBlock(pointedMemBlock);
+        fromSptrObjHashTableElem.SetPointedMemBlock(nullptr);
+    }
+
     /// <summary>
     /// Adds a new vertex to the graph.
     /// </summary>
@@ -227,6 +597,23 @@ namespace memory
             MakeReference(leftSptrObjHTabElem, receivingVtx);
     }
 
+    /// <summary>
+    /// Adds a new pointer (constructed by moving from another) to the graph.
+    /// </summary>
+    /// <param name="leftPointerAddr">The address of the pointer object to add.</param>
+    /// <param name="rightPointerAddr">The address of the pointer object moved from.</param>
+    void MemoryDigraph::AddPointerOnMove(void *leftPointerAddr, void *rightPointerAddr)
+    {
+        auto containerMemBlock = m_vertices.GetContainerVertex(leftPointerAddr); // null if root
+
+        // insertion first, because it can relocate the elements in the hash table:
+        auto &leftSptrObjHTabElem = m_sptrObjects.Insert(leftPointerAddr, nullptr, containerMemBlock);
+
+        auto &rightSptrObjHTabElem = m_sptrObjects.Lookup(rightPointerAddr);
+
+        TransferReference(leftSptrObjHTabElem, rightSptrObjHTabElem);
+    }
+
     /// <summary>
     /// Resets a given pointer to the memory address
     /// of a newly created object (never assigned before).
@@ -275,6 +662,21 @@ namespace memory
             MakeReference(leftSptrObjHashTabElem, newlyPointedMemBlock);
     }
 
+    /// <summary>
+    /// Resets a given pointer to the memory address referenced by
+    /// another pointer, which is moved from, hence left pointing nothing.
+    /// </summary>
+    /// <param name="pointerAddr">The address of the pointer object.</param>
+    /// <param name="otherPointerAddr">The address of the other pointer object.</param>
+    void MemoryDigraph::ResetPointerOnMove(void *pointerAddr, void *otherPointerAddr)
+    {
+        auto &leftSptrObjHashTabElem = m_sptrObjects.Lookup(pointerAddr);
+        auto &rightSptrObjHashTabElem = m_sptrObjects.Lookup(otherPointerAddr);
+
+        UnmakeReference(leftSptrObjHashTabElem, true);
+        TransferReference(leftSptrObjHashTabElem, rightSptrObjHashTabElem);
+    }
+
     /// <summary>
     /// Releases the reference a pointer holds to a memory address.
     /// </summary>
@@ -285,6 +687,32 @@ namespace memory
         UnmakeReference(sptrObjHashTableElem, true);
     }
 
+    /// <summary>
+    /// Flags a memory block as referenced by <see cref="weak_sptr"/> objects,
+    /// so its weak references are expired before it is collected.
+    /// </summary>
+    /// <param name="memAddr">The address of the memory block.</param>
+    void MemoryDigraph::AddWeakReferences(void *memAddr)
+    {
+        auto memBlock = m_vertices.GetVertex(memAddr);
+        _ASSERTE(memBlock != nullptr); // a pointer to it was around when weakly referenced
+
+        if (!memBlock->HasWeakReferences())
+            memBlock->SetWeakRefState(Vertex::WeakRefState::Referenced);
+    }
+
+    /// <summary>
+    /// Undoes a lock of the weak references to a memory block, once the
+    /// <see cref="sptr"/> object produced by the lock is in the graph.
+    /// </summary>
+    /// <param name="memAddr">The address of the memory block.</param>
+    void MemoryDigraph::UnlockWeakReference(void *memAddr)
+    {
+        auto memBlock = m_vertices.GetVertex(memAddr);
+        _ASSERTE(memBlock != nullptr); // the lock prevents it from being collected
+        m_weakRefs.Unlock(memBlock);
+    }
+
     /// <summary>
     /// Removes a given pointer from the graph.
     /// </summary>
@@ -296,5 +724,120 @@ namespace memory
         m_sptrObjects.Remove(sptrObjHashTableElem);
     }
 
+    /// <summary>
+    /// Updates the set of edges of a container of safe pointers as requested by
+    /// a message, but leaves the changes to the edges for the caller to apply.
+    /// </summary>
+    /// <param name="message">
+    /// The message, which takes ownership of the array of addresses it might carry.
+    /// </param>
+    /// <param name="changes">Where to append the changes to the edges.</param>
+    void MemoryDigraph::UpdateEdgeSet(const Message &message, std::vector<EdgeSets::EdgeChange> &changes)
+    {
+        switch (message.type)
+        {
+        case MessageType::EdgeSetRegistration:
+            m_edgeSets.Insert(message.sptrObjAddr, m_vertices.GetContainerVertex(message.sptrObjAddr)); // null if root
+            break;
+
+        case MessageType::EdgesAddition:
+        case MessageType::EdgesRemoval:
+        {
+            // a single address comes in the message, otherwise, an array of them:
+            std::unique_ptr<void *[]> addrsArray(
+                message.blockSize > 1 ? static_cast<void **> (message.otherAddr) : nullptr
+            );
+
+            auto addrs = (message.blockSize > 1) ? addrsArray.get() : &message.otherAddr;
+
+            m_edgeTargets.clear();
+
+            if (message.type == MessageType::EdgesAddition)
+            {
+                for (size_t idx = 0; idx < message.blockSize; ++idx)
+                {
+                    // the objects are held by the sender, so their vertices must be in the graph:
+                    auto memBlock = m_vertices.GetContainerVertex(addrs[idx]);
+                    _ASSERTE(memBlock != nullptr);
+                    m_edgeTargets.push_back(memBlock->GetHandle());
+                }
+
+                m_edgeSets.AddEdges(message.sptrObjAddr, m_edgeTargets, changes);
+                break;
+            }
+
+            /* An object removed might have been collected along with the container, whose
+            owner empties it when destroyed, so no vertex is found, or the one of an object
+            allocated at the same address since. The set resolves that: */
+            for (size_t idx = 0; idx < message.blockSize; ++idx)
+            {
+                auto memBlock = m_vertices.GetContainerVertex(addrs[idx]);
+                m_edgeTargets.push_back(memBlock != nullptr ? memBlock->GetHandle() : VertexTable::invalidHandle);
+            }
+
+            m_edgeSets.RemoveEdges(message.sptrObjAddr, m_edgeTargets, changes);
+
+            break;
+        }
+        case MessageType::EdgeSetSwap:
+            m_edgeSets.Swap(message.sptrObjAddr, message.otherAddr, changes);
+            break;
+
+        case MessageType::EdgeSetUnregistration:
+            m_edgeSets.Remove(message.sptrObjAddr, changes);
+            break;
+
+        default:
+            _ASSERTE(false); // not a message for the edge sets
+            break;
+        }
+    }
+
+    /// <summary>
+    /// Executes a message for the set of edges of a container of safe pointers.
+    /// The changes to the edges are applied first, and then settled just like
+    /// the shards do, so a batch of removals is evaluated at once.
+    /// </summary>
+    /// <param name="message">The message to execute.</param>
+    void MemoryDigraph::ExecuteEdgeSetMessage(const Message &message)
+    {
+        m_edgeChanges.clear();
+        UpdateEdgeSet(message, m_edgeChanges);
+
+        m_changedVertices.clear();
+        for (auto &change : m_edgeChanges)
+        {
+            if (change.added)
+            {
+                if (change.origin == nullptr)
+                    change.target->ReceiveEdgeFrom(change.containerAddr);
+                else
+                {
+                    change.origin->IncrementOutgoingEdgeCount();
+                    change.target->ReceiveEdgeFrom(change.origin);
+                }
+
+                continue;
+            }
+
+            if (change.origin == nullptr)
+                change.target->RemoveEdgeFrom(change.containerAddr);
+            else
+            {
+                change.origin->DecrementOutgoingEdgeCount();
+                change.target->RemoveEdgeFrom(change.origin);
+
+                if (change.origin->AddPendingChanges(Vertex::LostOutgoingEdge))
+                    m_changedVertices.push_back(change.origin);
+            }
+
+            if (change.target->AddPendingChanges(Vertex::LostIncomingEdge))
+                m_changedVertices.push_back(change.target);
+        }
+
+        for (auto memBlock : m_changedVertices)
+            SettleChanges(memBlock);
+    }
+
 }// end of namespace memory
 }// end of namespace _3fd
@@ -16,11 +16,21 @@
 
 #include <3fd/core/gc_vertexstore.h>
 #include <3fd/core/gc_addresseshashtable.h>
+#include <3fd/core/gc_edgesets.h>
+#include <3fd/core/gc_messages.h>
+#include <3fd/core/gc_reachabilityanalyzer.h>
+#include <3fd/core/gc_weakreferences.h>
+#include <3fd/core/gc_parallelmarker.h>
+#include <3fd/core/gc_heapsnapshot.h>
+
+#include <vector>
 
 namespace _3fd
 {
 namespace memory
 {
+    class DigraphShards;
+
     /// <summary>
     /// Directed graph representing the connections made by safe pointers
     /// between pieces of memory managed by the GC.
@@ -38,21 +48,126 @@ namespace memory
         /// </remarks>
         AddressesHashTable m_sptrObjects;
 
+        /// <summary>
+        /// The edges reported by the containers of safe pointers.
+        /// </summary>
+        EdgeSets m_edgeSets;
+
+        // Reused by every message to the edge sets, to spare allocations:
+        std::vector<uint32_t> m_edgeTargets;
+        std::vector<EdgeSets::EdgeChange> m_edgeChanges;
+        std::vector<Vertex *> m_changedVertices;
+
         VertexStore m_vertices;
 
+        WeakReferences m_weakRefs;
+
+        ReachabilityAnalyzer m_reachabilityAnalyzer;
+
+        /// <summary>
+        /// The threads that finalize the objects collected, if not done by the GC thread.
+        /// </summary>
+        FinalizerPool *m_finalizers;
+
+        /// <summary>
+        /// Vertices that lost an incoming edge and await reachability analysis,
+        /// so a burst of releases over the same subgraph is evaluated in one pass.
+        /// </summary>
+        std::vector<Vertex *> m_candidates;
+
+        /// <summary>
+        /// How many vertices have been marked by collections of the whole graph.
+        /// </summary>
+        uint64_t m_markedCount;
+
+        void StartReachabilityPass(size_t maxSearches);
+
+        void CollectVertex(Vertex *memBlock, bool allowDtion);
+
+        bool ExpireWeakReferences(Vertex *memBlock);
+
         void MakeReference(AddressesHashTable::Element &sptrObjHashTableElem, Vertex *pointedMemBlock);
 
         void MakeReference(AddressesHashTable::Element &sptrObjHashTableElem, void *pointedAddr);
 
         void UnmakeReference(AddressesHashTable::Element &sptrObjHashTableElem, bool allowDestruction);
 
+        void TransferReference(AddressesHashTable::Element &toSptrObjHashTableElem,
+                               AddressesHashTable::Element &fromSptrObjHashTableElem);
+
     public:
 
-		MemoryDigraph() {}
+		MemoryDigraph() :
+            m_reachabilityAnalyzer(&m_weakRefs),
+            m_finalizers(nullptr),
+            m_markedCount(0)
+        {}
 
 		MemoryDigraph(const MemoryDigraph &) = delete;
 
-        void ShrinkVertexPool();
+        void SetFinalizerPool(FinalizerPool *finalizers);
+
+        void ShrinkVertexPool(bool forced);
+
+        /// <summary>
+        /// Gets the total size of the memory of the pool of vertices handed back to the system so far.
+        /// </summary>
+        uint64_t GetVertexPoolReleasedBytes() const { return m_vertices.GetPoolReleasedBytes(); }
+
+        bool CollectUnreachableCandidates();
+
+        bool CollectAllUnreachable(ParallelMarker &marker);
+
+        void TakeSnapshot(HeapSnapshot &snapshot, const DigraphShards *shards);
+
+        /// <summary>
+        /// Gets how many vertices await reachability analysis.
+        /// </summary>
+        size_t GetCandidatesCount() const { return m_candidates.size(); }
+
+        /// <summary>
+        /// Gets how many vertices are in the graph, which is how many memory blocks are managed.
+        /// </summary>
+        size_t GetVerticesCount() const { return m_vertices.GetVerticesCount(); }
+
+        /// <summary>
+        /// Gets how many pointers are in the graph.
+        /// </summary>
+        size_t GetPointersCount() const { return m_sptrObjects.GetElementsCount(); }
+
+        /// <summary>
+        /// Gets how many containers of safe pointers are in the graph.
+        /// </summary>
+        size_t GetEdgeSetsCount() const { return m_edgeSets.GetCount(); }
+
+        /// <summary>
+        /// Gets the total size of the memory blocks managed.
+        /// </summary>
+        uint64_t GetManagedBytes() const { return m_vertices.GetManagedBytes(); }
+
+        /// <summary>
+        /// Gets the total size of the memory blocks collected so far.
+        /// </summary>
+        uint64_t GetFreedBytes() const { return m_vertices.GetFreedBytes(); }
+
+        /// <summary>
+        /// Gets how many vertices have been visited so far by the analysis of
+        /// reachability, including those marked by collections of the whole graph.
+        /// </summary>
+        uint64_t GetVisitsCount() const { return m_reachabilityAnalyzer.GetVisitsCount() + m_markedCount; }
+
+        /// <summary>
+        /// Gets the vertex representing a given memory address.
+        /// </summary>
+        Vertex *GetVertex(void *memAddr) const { return m_vertices.GetVertex(memAddr); }
+
+        /// <summary>
+        /// Gets the vertex representing the memory block which contains a given address,
+        /// or <c>nullptr</c> when none does.
+        /// </summary>
+        Vertex *GetContainerVertex(void *addr) const { return m_vertices.GetContainerVertex(addr); }
+
+        void SettleChanges(Vertex *memBlock);
 
         void AddRegularVertex(void *memAddr, size_t blockSize, FreeMemProc freeMemCallback);
 
@@ -60,13 +175,37 @@ namespace memory
 
         void AddPointerOnCopy(void *leftPointerAddr, void *rightPointerAddr);
 
+        void AddPointerOnMove(void *leftPointerAddr, void *rightPointerAddr);
+
         void ResetPointer(void *pointerAddr, void *newPointedAddr, bool allowDtion);
 
         void ResetPointer(void *pointerAddr, void *otherPointerAddr);
 
+        void ResetPointerOnMove(void *pointerAddr, void *otherPointerAddr);
+
         void ReleasePointer(void *pointerAddr);
 
         void RemovePointer(void *pointerAddr);
+
+        void UpdateEdgeSet(const Message &message, std::vector<EdgeSets::EdgeChange> &changes);
+
+        void ExecuteEdgeSetMessage(const Message &message);
+
+        /// <summary>
+        /// Acquires the block shared by the weak references to a memory block.
+        /// Unlike the remaining of the graph, this can be invoked by any thread.
+        /// </summary>
+        /// <param name="memBlockAddr">The address of the memory block.</param>
+        /// <param name="isNew">Set to whether the block has just been created.</param>
+        /// <returns>The block, with a reference added for the caller.</returns>
+        WeakRefBlock *AcquireWeakReference(void *memBlockAddr, bool &isNew)
+        {
+            return m_weakRefs.Acquire(memBlockAddr, isNew);
+        }
+
+        void AddWeakReferences(void *memAddr);
+
+        void UnlockWeakReference(void *memAddr);
     };
 
 }// end of namespace memory
@@ -1,95 +1,115 @@
 #include "pch.h"
 #include "gc_messages.h"
+#include "gc_memorydigraph.h"
+#include "preprocessing.h"
 
 namespace _3fd
 {
 namespace memory
 {
     /// <summary>
-    /// Executes in the memory graph the action corresponding
-    /// to the message <see cref="NewObjectMsg"/>.
+    /// Executes in the memory graph the action corresponding to a given message.
     /// </summary>
+    /// <param name="message">The message to execute.</param>
     /// <param name="graph">A reference to the memory graph.</param>
-    void NewObjectMsg::Execute(MemoryDigraph &graph)
+    void ExecuteMessage(const Message &message, MemoryDigraph &graph)
     {
-        graph.AddRegularVertex(m_pointedAddr, m_blockSize, m_freeMemCallback);
-        graph.ResetPointer(m_sptrObjectAddr, m_pointedAddr, true);
-    }
+        switch (message.type)
+        {
+        case MessageType::NewObject:
+            graph.AddRegularVertex(message.otherAddr, message.blockSize, message.freeMemCallback);
+            graph.ResetPointer(message.sptrObjAddr, message.otherAddr, true);
+            break;
 
-    /// <summary>
-    /// Executes in the memory graph the action corresponding
-    /// to the message <see cref="ReferenceUpdateMsg"/>.
-    /// </summary>
-    /// <param name="graph">A reference to the memory graph.</param>
-    void ReferenceUpdateMsg::Execute(MemoryDigraph &graph)
-    {
-        /* due to an assignment betweeen pointesr, resets the pointer
-        in the left to make it reference the same object referenced
-        by the pointer in the right */
-        graph.ResetPointer(m_leftSptrObjAddr, m_rightSptrObjAddr);
-    }
+        case MessageType::ReferenceUpdate:
+            /* due to an assignment betweeen pointesr, resets the pointer
+            in the left to make it reference the same object referenced
+            by the pointer in the right */
+            graph.ResetPointer(message.sptrObjAddr, message.otherAddr);
+            break;
 
-    /// <summary>
-    /// Executes in the memory graph the action corresponding
-    /// to the message <see cref="ReferenceReleaseMsg"/>.
-    /// </summary>
-    /// <param name="graph">A reference to the memory graph.</param>
-    void ReferenceReleaseMsg::Execute(MemoryDigraph &graph)
-    {
-        /* release the reference made by a pointer, but do not
-        unregister it, because it still hasn't gone out of scope */
-        graph.ReleasePointer(m_sptrObjAddr);
-    }
+        case MessageType::ReferenceMove:
+            /* due to a move assignment between pointers, the pointer in
+            the left takes over the reference made by the pointer in the
+            right, which is left pointing nothing */
+            graph.ResetPointerOnMove(message.sptrObjAddr, message.otherAddr);
+            break;
 
-    /// <summary>
-    /// Executes in the memory graph the action corresponding
-    /// to the message <see cref="AbortedObjectMsg"/>.
-    /// </summary>
-    /// <param name="graph">A reference to the memory graph.</param>
-    void AbortedObjectMsg::Execute(MemoryDigraph &graph)
-    {
-        /* due to an object whose ctor failed with a thrown exception,
-        make the pointer stop referencing the memory allocated for the
-        object, but do not allow the dtor to be invoked, because in C++
-        that does not happen to "semi-constructed" objects */
-        graph.ResetPointer(m_sptrObjAddr, nullptr, false);
-    }
+        case MessageType::ReferenceRelease:
+            /* release the reference made by a pointer, but do not
+            unregister it, because it still hasn't gone out of scope */
+            graph.ReleasePointer(message.sptrObjAddr);
+            break;
 
-    /// <summary>
-    /// Executes in the memory graph the action corresponding
-    /// to the message <see cref="SptrRegistrationMsg"/>.
-    /// </summary>
-    /// <param name="graph">A reference to the memory graph.</param>
-    void SptrRegistrationMsg::Execute(MemoryDigraph &graph)
-    {
-        /* adds a new pointer to the graph, already making it
-        refence a given memory address */
-        graph.AddPointer(m_sptrObjAddr, m_pointedAddr);
-    }
+        case MessageType::AbortedObject:
+            /* due to an object whose ctor failed with a thrown exception,
+            make the pointer stop referencing the memory allocated for the
+            object, but do not allow the dtor to be invoked, because in C++
+            that does not happen to "semi-constructed" objects */
+            graph.ResetPointer(message.sptrObjAddr, nullptr, false);
+            break;
 
-    /// <summary>
-    /// Executes in the memory graph the action corresponding
-    /// to the message <see cref="SptrCopyRegistrationMsg"/>.
-    /// </summary>
-    /// <param name="graph">A reference to the memory graph.</param>
-    void SptrCopyRegistrationMsg::Execute(MemoryDigraph &graph)
-    {
-        /* adds a new pointer to the graph, which has been constructed
-        as a copy of another pointer, so make the first reference the
-        object already referenced by the second */
-        graph.AddPointerOnCopy(m_leftSptrObjAddr, m_rightSptrObjAddr);
-    }
+        case MessageType::SptrRegistration:
+            /* adds a new pointer to the graph, already making it
+            refence a given memory address */
+            graph.AddPointer(message.sptrObjAddr, message.otherAddr);
+            break;
 
-    /// <summary>
-    /// Executes in the memory graph the action corresponding
-    /// to the message <see cref="SptrUnregistrationMsg"/>.
-    /// </summary>
-    /// <param name="graph">A reference to the memory graph.</param>
-    void SptrUnregistrationMsg::Execute(MemoryDigraph &graph)
-    {
-        /* a pointer has gone out of scope, so remove it from the
-        graph and undo the reference it makes to the pointed object */
-        graph.RemovePointer(m_sptrObjAddr);
+        case MessageType::SptrCopyRegistration:
+            /* adds a new pointer to the graph, which has been constructed
+            as a copy of another pointer, so make the first reference the
+            object already referenced by the second */
+            graph.AddPointerOnCopy(message.sptrObjAddr, message.otherAddr);
+            break;
+
+        case MessageType::SptrMoveRegistration:
+            /* adds a new pointer to the graph, which has been constructed
+            by moving from another pointer, so the first takes over the
+            reference made by the second, without a new edge if possible */
+            graph.AddPointerOnMove(message.sptrObjAddr, message.otherAddr);
+            break;
+
+        case MessageType::SptrNewObjectRegistration:
+            /* adds a new pointer to the graph, already making it
+            reference a new object, which is added first */
+            graph.AddRegularVertex(message.otherAddr, message.blockSize, message.freeMemCallback);
+            graph.AddPointer(message.sptrObjAddr, message.otherAddr);
+            break;
+
+        case MessageType::SptrUnregistration:
+            /* a pointer has gone out of scope, so remove it from the
+            graph and undo the reference it makes to the pointed object */
+            graph.RemovePointer(message.sptrObjAddr);
+            break;
+
+        case MessageType::WeakReferenceRegistration:
+            /* a memory block has got weak references, which
+            must then expire before it can be collected */
+            graph.AddWeakReferences(message.otherAddr);
+            break;
+
+        case MessageType::SptrWeakLockRegistration:
+            /* adds a new pointer to the graph, which has been produced by
+            a lock of weak references, so only after it references the
+            memory block, the memory block can be unlocked */
+            graph.AddPointer(message.sptrObjAddr, message.otherAddr);
+            graph.UnlockWeakReference(message.otherAddr);
+            break;
+
+        case MessageType::EdgeSetRegistration:
+        case MessageType::EdgesAddition:
+        case MessageType::EdgesRemoval:
+        case MessageType::EdgeSetSwap:
+        case MessageType::EdgeSetUnregistration:
+            /* a container of safe pointers reports the objects it holds
+            as a set of edges, changed in batches instead of one by one */
+            graph.ExecuteEdgeSetMessage(message);
+            break;
+
+        default:
+            _ASSERTE(false); // unknown type of message
+            break;
+        }
     }
 
 }// end of namespace memory
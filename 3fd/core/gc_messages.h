@@ -1,191 +1,180 @@
 #ifndef GC_MESSAGES_H // header guard
 #define GC_MESSAGES_H
 
-#include <3fd/core/gc.h>
+#include <3fd/core/gc_common.h>
+
+#include <cstdint>
+#include <cstddef>
 
 namespace _3fd
 {
 namespace memory
 {
-    /// <summary>
-    /// Message used to inform that the memory address of
-    /// a new object is to be managed by the GC, which
-    /// means it will handle both the release of memory
-    /// and object destruction.
-    /// </summary>
-    class NewObjectMsg : public IMessage
-    {
-    private:
-
-        void *m_sptrObjectAddr,
-             *m_pointedAddr;
-
-        size_t m_blockSize;
-
-        FreeMemProc    m_freeMemCallback;
-
-    public:
-
-        NewObjectMsg(void *sptrObjaddr,
-                        void *pointedAddr,
-                        size_t blockSize,
-                        FreeMemProc freeMemCallback) noexcept :
-            m_sptrObjectAddr(sptrObjaddr),
-            m_pointedAddr(pointedAddr),
-            m_blockSize(blockSize),
-            m_freeMemCallback(freeMemCallback)
-        {}
-
-        virtual void Execute(MemoryDigraph &graph) override;
-    };
+    class MemoryDigraph;
 
     /// <summary>
-    /// Message used to inform that a <see cref="sptr"/> object
-    /// is now referencing a different but already existent object.
-    /// This message is emitted when a pointer is being assigned
-    /// the object from another pointer.
+    /// Enumerates the operations the GC can be requested to perform.
     /// </summary>
-    class ReferenceUpdateMsg : public IMessage
+    enum class MessageType : uint8_t
     {
-    private:
-
-        void *m_leftSptrObjAddr,
-             *m_rightSptrObjAddr;
-
-    public:
+        /// <summary>
+        /// Informs that the memory address of a new object is to be managed
+        /// by the GC, which means it will handle both the release of memory
+        /// and object destruction.
+        /// </summary>
+        NewObject,
 
         /// <summary>
-        /// Initializes a new instance of the <see cref="ReferenceUpdateMsg"/> class.
+        /// Informs that a <see cref="sptr"/> object is now referencing a
+        /// different but already existent object. This is emitted when a
+        /// pointer is being assigned the object from another pointer.
         /// </summary>
-        /// <param name="leftSptrObjAddr">
-        /// The address of the <see cref="sptr"/> object in
-        /// the left side of the assignment operation.
-        /// </param>
-        /// <param name="rightSptrObjAddr">
-        /// The address of the <see cref="sptr"/> object in
-        /// the right side of the assignment operation.
-        /// </param>
-        ReferenceUpdateMsg(void *leftSptrObjAddr, void *rightSptrObjAddr) noexcept :
-            m_leftSptrObjAddr(leftSptrObjAddr),
-            m_rightSptrObjAddr(rightSptrObjAddr)
-        {}
+        ReferenceUpdate,
 
-        virtual void Execute(MemoryDigraph &graph) override;
-    };
+        /// <summary>
+        /// Informs that a <see cref="sptr"/> object has taken over the
+        /// reference of another one, which is now pointing nothing. This
+        /// is emitted when a pointer is being move-assigned.
+        /// </summary>
+        ReferenceMove,
 
-    /// <summary>
-    /// Message used to inform that a <see cref="sptr"/> object
-    /// has been reset and is currently pointing nothing.
-    /// </summary>
-    class ReferenceReleaseMsg : public IMessage
-    {
-    private:
+        /// <summary>
+        /// Informs that a <see cref="sptr"/> object has been
+        /// reset and is currently pointing nothing.
+        /// </summary>
+        ReferenceRelease,
 
-        void *m_sptrObjAddr;
+        /// <summary>
+        /// Informs that the construction of an object has failed, and so
+        /// its memory must be unregistered as well as the referer
+        /// <see cref="sptr"/> object must be updated.
+        /// </summary>
+        AbortedObject,
 
-    public:
+        /// <summary>
+        /// Informs that a new <see cref="sptr"/> object
+        /// was created, and so must registered by the GC.
+        /// </summary>
+        SptrRegistration,
 
         /// <summary>
-        /// Initializes a new instance of the <see cref="ReferenceReleaseMsg"/> class.
+        /// Informs that a new <see cref="sptr"/> object was
+        /// created as a copy, and so must registered by the GC.
         /// </summary>
-        /// <param name="sptrObjAddr">
-        /// The memory address of the <see cref="sptr"/> object being reset to nothing.
-        /// </param>
-        ReferenceReleaseMsg(void *sptrObjAddr)
-            : m_sptrObjAddr(sptrObjAddr) {}
+        SptrCopyRegistration,
 
-        virtual void Execute(MemoryDigraph &graph) override;
-    };
+        /// <summary>
+        /// Informs that a new <see cref="sptr"/> object was created by moving
+        /// from another one, which is now pointing nothing, and so must be
+        /// registered by the GC in place of the other.
+        /// </summary>
+        SptrMoveRegistration,
 
-    /// <summary>
-    /// Message used to inform that the construction of an object
-    /// has failed, and so its memory must be unregistered as well
-    /// as the referer <see cref="sptr"/> object must be updated.
-    /// </summary>
-    class AbortedObjectMsg : public IMessage
-    {
-    private:
+        /// <summary>
+        /// Informs that a new <see cref="sptr"/> object was created along
+        /// with the object it references, whose memory address is to be
+        /// managed by the GC. This is the same as <see cref="SptrRegistration"/>
+        /// followed by <see cref="NewObject"/>, but in a single message.
+        /// </summary>
+        SptrNewObjectRegistration,
 
-        void *m_sptrObjAddr;
+        /// <summary>
+        /// Informs that a <see cref="sptr"/> object was
+        /// destroyed, and so must be unregistered by the GC.
+        /// </summary>
+        SptrUnregistration,
 
-    public:
+        /// <summary>
+        /// Informs that a memory block is now referenced by <see cref="weak_sptr"/>
+        /// objects, whose weak references must expire before it is collected.
+        /// </summary>
+        WeakReferenceRegistration,
 
         /// <summary>
-        /// Initializes a new instance of the <see cref="AbortedObjectMsg"/> class.
+        /// Informs that a new <see cref="sptr"/> object was created by locking
+        /// a <see cref="weak_sptr"/> object, so it must be registered by the GC
+        /// referencing the memory block, which is then unlocked.
         /// </summary>
-        /// <param name="sptrObjAddr">
-        /// The memory address of the <see cref="sptr"/> object
-        /// whose referred object experienced failure during construction.
-        /// </param>
-        AbortedObjectMsg(void *sptrObjAddr) noexcept :
-            m_sptrObjAddr(sptrObjAddr)
-        {}
+        SptrWeakLockRegistration,
 
-        virtual void Execute(MemoryDigraph &graph) override;
-    };
+        /// <summary>
+        /// Informs that a new <see cref="gc_vector"/> object was created, so the
+        /// GC must register the set of edges it reports, starting from the memory
+        /// block that contains it. In this message and the next ones, the address
+        /// of the container takes the place of the <see cref="sptr"/> object.
+        /// </summary>
+        EdgeSetRegistration,
 
-    /// <summary>
-    /// Message used to inform that a new <see cref="sptr"/> object
-    /// was created, and so must registered by the GC.
-    /// </summary>
-    class SptrRegistrationMsg : public IMessage
-    {
-    private:
+        /// <summary>
+        /// Informs that objects were added to a <see cref="gc_vector"/> object,
+        /// which gains an edge to each one. With a single object, the other
+        /// address is its own, otherwise, it is an array of their addresses,
+        /// allocated by the sender and deleted once the message is executed.
+        /// </summary>
+        EdgesAddition,
 
-        void *m_sptrObjAddr,
-             *m_pointedAddr;
+        /// <summary>
+        /// Informs that objects were removed from a <see cref="gc_vector"/> object,
+        /// which loses an edge to each one. The addresses of the objects come just
+        /// like in <see cref="EdgesAddition"/>.
+        /// </summary>
+        EdgesRemoval,
 
-    public:
+        /// <summary>
+        /// Informs that two <see cref="gc_vector"/> objects have
+        /// exchanged their contents, hence their sets of edges.
+        /// </summary>
+        EdgeSetSwap,
 
-        SptrRegistrationMsg(void *sptrObjAddr, void *pointedAddr) noexcept :
-            m_sptrObjAddr(sptrObjAddr),
-            m_pointedAddr(pointedAddr)
-        {}
+        /// <summary>
+        /// Informs that a <see cref="gc_vector"/> object was destroyed, so
+        /// the GC must remove its set of edges, whatever is left in it.
+        /// </summary>
+        EdgeSetUnregistration,
 
-        virtual void Execute(MemoryDigraph &graph) override;
+        /// <summary>
+        /// Requests a notification for when all messages published before this
+        /// one have been executed. Instead of going to <see cref="ExecuteMessage"/>,
+        /// this is handled by the GC itself.
+        /// </summary>
+        Fence
     };
 
     /// <summary>
-    /// Message used to inform that a new <see cref="sptr"/> object
-    /// was created as a cpy, and so must registered by the GC.
+    /// How many types of message there are.
     /// </summary>
-    class SptrCopyRegistrationMsg : public IMessage
-    {
-    private:
-
-        void *m_leftSptrObjAddr,
-             *m_rightSptrObjAddr;
-
-    public:
-
-        SptrCopyRegistrationMsg(void *leftSptrObjAddr, void *rightSptrObjAddr) noexcept :
-            m_leftSptrObjAddr(leftSptrObjAddr),
-            m_rightSptrObjAddr(rightSptrObjAddr)
-        {}
-
-        virtual void Execute(MemoryDigraph &graph) override;
-    };
+    static const size_t messageTypesCount = static_cast<size_t> (MessageType::Fence) + 1;
 
     /// <summary>
-    /// Message used to inform that a <see cref="sptr"/> object
-    /// was destroyed, and so must be unregistered by the GC.
+    /// A message for the GC, as a record of fixed size made of the
+    /// operation code plus its operands. Records are copied by value
+    /// into the GC messages ring, hence no allocation is ever needed.
     /// </summary>
-    class SptrUnregistrationMsg : public IMessage
+    struct Message
     {
-    private:
+        MessageType type;
 
-        void *m_sptrObjAddr;
+        /// <summary>
+        /// The address of the <see cref="sptr"/> object the operation applies to.
+        /// In case of assignment, copy or move, this is the one in the left side.
+        /// </summary>
+        void *sptrObjAddr;
 
-    public:
+        /// <summary>
+        /// Either the pointed memory address, or the address of
+        /// the <see cref="sptr"/> object in the right side of an
+        /// assignment, copy or move, depending on the operation.
+        /// </summary>
+        void *otherAddr;
 
-        SptrUnregistrationMsg(void *sptrObjAddr) noexcept :
-            m_sptrObjAddr(sptrObjAddr)
-        {}
+        size_t blockSize;
 
-        virtual void Execute(MemoryDigraph &graph) override;
+        FreeMemProc freeMemCallback;
     };
 
+    void ExecuteMessage(const Message &message, MemoryDigraph &graph);
+
 }// end of memory
 }// end of namespace _3fd
 
-#endif // end of header guard
\ No newline at end of file
+#endif // end of header guard
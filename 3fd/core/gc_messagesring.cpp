@@ -0,0 +1,97 @@
+#include "pch.h"
+#include "gc_messagesring.h"
+#include "preprocessing.h"
+
+namespace _3fd
+{
+namespace memory
+{
+    /// <summary>
+    /// Initializes a new instance of the <see cref="MessagesRing"/> class.
+    /// </summary>
+    /// <param name="capacityLog2">The base 2 logarithm of the ring capacity.</param>
+    MessagesRing::MessagesRing(uint32_t capacityLog2) :
+        m_cells(new Cell[static_cast<size_t> (1) << capacityLog2]),
+        m_mask((static_cast<size_t> (1) << capacityLog2) - 1),
+        m_enqueuePos(0),
+        m_dequeuePos(0)
+    {
+        _ASSERTE(capacityLog2 < sizeof(size_t) * 8 - 1);
+
+        for (size_t idx = 0; idx <= m_mask; ++idx)
+            m_cells[idx].sequence.store(idx, std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    /// Adds a batch of messages to the ring, in consecutive cells.
+    /// </summary>
+    /// <param name="messages">The messages to add.</param>
+    /// <param name="count">How many messages to add. Cannot exceed the ring capacity.</param>
+    /// <returns>
+    /// Whether the messages were added. If not, that is because either there is not
+    /// enough vacant cells, or the ring has overflowed and still holds messages that
+    /// must be consumed before those in the side list.
+    /// </returns>
+    MessagesRing::AddResult MessagesRing::Add(const Message *messages, size_t count) noexcept
+    {
+        _ASSERTE(count > 0 && count <= Capacity());
+
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            if ((pos & overflowFlag) != 0)
+                return AddResult::Overflowing;
+
+            /* The consumer releases cells in order, so if the last cell of
+            the span is vacant, then all cells preceding it are vacant too: */
+            size_t last = pos + count - 1;
+            size_t seq = m_cells[last & m_mask].sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t> (seq) - static_cast<intptr_t> (last);
+
+            if (diff == 0)
+            {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+                return AddResult::Full;
+            else
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+
+        for (size_t idx = 0; idx < count; ++idx)
+        {
+            auto &cell = m_cells[(pos + idx) & m_mask];
+            cell.message = messages[idx];
+            cell.sequence.store(pos + idx + 1, std::memory_order_release);
+        }
+
+        return AddResult::Okay;
+    }
+
+    /// <summary>
+    /// Removes the next message from the ring.
+    /// Must only be invoked by the consumer.
+    /// </summary>
+    /// <param name="message">Receives the removed message.</param>
+    /// <returns>
+    /// <c>true</c> if a message was removed, otherwise, <c>false</c>,
+    /// meaning the ring is empty or the next message is still being written.
+    /// </returns>
+    bool MessagesRing::Remove(Message &message) noexcept
+    {
+        auto pos = m_dequeuePos.load(std::memory_order_relaxed);
+        auto &cell = m_cells[pos & m_mask];
+
+        if (cell.sequence.load(std::memory_order_acquire) != pos + 1)
+            return false;
+
+        message = cell.message;
+        cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+        m_dequeuePos.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+}// end of namespace memory
+}// end of namespace _3fd
@@ -0,0 +1,116 @@
+#ifndef GC_MESSAGESRING_H // header guard
+#define GC_MESSAGESRING_H
+
+#include <3fd/core/gc_messages.h>
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+namespace _3fd
+{
+namespace memory
+{
+    /// <summary>
+    /// A bounded ring buffer of GC messages, which supports multiple producers
+    /// and a single consumer without locks. Each cell has its own sequence number
+    /// that tells whether it is vacant or holds a message ready for consumption.
+    /// A producer reserves consecutive cells for a whole batch of messages at once.
+    /// </summary>
+    /// <remarks>
+    /// The highest bit of the enqueue position is a flag that signals the ring
+    /// has overflowed into a side list. While it is set, reservations fail, so
+    /// the order of messages is preserved when the ring is full. Because the flag
+    /// and the position share the same atomic word, a producer cannot reserve
+    /// cells once the flag has been observed by another thread.
+    /// </remarks>
+    class MessagesRing
+    {
+    private:
+
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            Message message;
+        };
+
+        static const size_t overflowFlag = static_cast<size_t> (1) << (sizeof(size_t) * 8 - 1);
+
+        std::unique_ptr<Cell[]> m_cells;
+        const size_t m_mask;
+
+        // Producers and the consumer write to separate cache lines:
+        alignas(64) std::atomic<size_t> m_enqueuePos;
+        alignas(64) std::atomic<size_t> m_dequeuePos;
+
+    public:
+
+        /// <summary>
+        /// Enumerates the possible outcomes of adding messages to the ring.
+        /// </summary>
+        enum class AddResult { Okay, Full, Overflowing };
+
+        MessagesRing(uint32_t capacityLog2);
+
+        MessagesRing(const MessagesRing &) = delete;
+
+        /// <summary>
+        /// Gets how many messages the ring can hold.
+        /// </summary>
+        size_t Capacity() const { return m_mask + 1; }
+
+        AddResult Add(const Message *messages, size_t count) noexcept;
+
+        bool Remove(Message &message) noexcept;
+
+        /// <summary>
+        /// Determines whether all messages reserved so far have been consumed.
+        /// Must only be invoked by the consumer.
+        /// </summary>
+        bool IsDrained() const noexcept
+        {
+            return m_dequeuePos.load(std::memory_order_relaxed)
+                == (m_enqueuePos.load(std::memory_order_acquire) & ~overflowFlag);
+        }
+
+        /// <summary>
+        /// Gets how many messages are in the ring, including those still
+        /// being written. This is only an estimate when producers and the
+        /// consumer are active at the same time.
+        /// </summary>
+        size_t GetDepth() const noexcept
+        {
+            auto enqueuePos = m_enqueuePos.load(std::memory_order_relaxed) & ~overflowFlag;
+            auto dequeuePos = m_dequeuePos.load(std::memory_order_relaxed);
+            return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+        }
+
+        /// <summary>
+        /// Determines whether the ring has overflowed into a side list.
+        /// </summary>
+        bool IsOverflowing() const noexcept
+        {
+            return (m_enqueuePos.load(std::memory_order_acquire) & overflowFlag) != 0;
+        }
+
+        /// <summary>
+        /// Flags the ring as overflowed, so no more reservations succeed.
+        /// </summary>
+        void SetOverflowing() noexcept
+        {
+            m_enqueuePos.fetch_or(overflowFlag, std::memory_order_acq_rel);
+        }
+
+        /// <summary>
+        /// Clears the overflow flag, so reservations can succeed again.
+        /// </summary>
+        void ClearOverflowing() noexcept
+        {
+            m_enqueuePos.fetch_and(~overflowFlag, std::memory_order_acq_rel);
+        }
+    };
+
+}// end of namespace memory
+}// end of namespace _3fd
+
+#endif // end of header guard
@@ -0,0 +1,241 @@
+#include "pch.h"
+#include "gc_pagemap.h"
+
+#include <new>
+
+namespace _3fd
+{
+namespace memory
+{
+    /// <summary>
+    /// Initializes a new instance of the <see cref="RadixPageMap"/> class.
+    /// </summary>
+    RadixPageMap::RadixPageMap()
+    {
+        for (auto &entry : m_root)
+            entry.store(nullptr, std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="RadixPageMap"/> class.
+    /// </summary>
+    RadixPageMap::~RadixPageMap()
+    {
+        for (auto &entry : m_root)
+        {
+            auto midNode = entry.load(std::memory_order_relaxed);
+            if (midNode == nullptr)
+                continue;
+
+            for (auto &leaf : midNode->leaves)
+                delete leaf.load(std::memory_order_relaxed);
+
+            delete midNode;
+        }
+    }
+
+    /// <summary>
+    /// Gets the leaf of the tree where the value for a page is kept.
+    /// </summary>
+    /// <param name="key">The page number.</param>
+    /// <param name="create">Whether the missing nodes in the path must be created.</param>
+    /// <returns>The leaf, or <c>nullptr</c> if it does not exist or could not be created.</returns>
+    /// <remarks>The caller must hold the lock for changes.</remarks>
+    RadixPageMap::Leaf *RadixPageMap::GetLeaf(uintptr_t key, bool create)
+    {
+        if ((key >> keyBits) != 0)
+            return nullptr;
+
+        auto &rootEntry = m_root[key >> (leafBits + midBits)];
+        auto midNode = rootEntry.load(std::memory_order_relaxed);
+
+        if (midNode == nullptr)
+        {
+            if (!create)
+                return nullptr;
+
+            midNode = new (std::nothrow) MidNode;
+            if (midNode == nullptr)
+                return nullptr;
+
+            for (auto &entry : midNode->leaves)
+                entry.store(nullptr, std::memory_order_relaxed);
+
+            rootEntry.store(midNode, std::memory_order_release);
+        }
+
+        auto &midEntry = midNode->leaves[(key >> leafBits) & ((1U << midBits) - 1)];
+        auto leaf = midEntry.load(std::memory_order_relaxed);
+
+        if (leaf == nullptr)
+        {
+            if (!create)
+                return nullptr;
+
+            leaf = new (std::nothrow) Leaf;
+            if (leaf == nullptr)
+                return nullptr;
+
+            for (auto &entry : leaf->values)
+                entry.store(nullptr, std::memory_order_relaxed);
+
+            midEntry.store(leaf, std::memory_order_release);
+        }
+
+        return leaf;
+    }
+
+    /// <summary>
+    /// Maps the pages in a range of addresses to a value.
+    /// </summary>
+    /// <param name="addr">The start of the range, which must be aligned to the page.</param>
+    /// <param name="size">The size of the range, which must be a multiple of the page.</param>
+    /// <param name="value">The value to map.</param>
+    /// <returns>
+    /// <c>true</c> if the pages were mapped, otherwise, <c>false</c>,
+    /// when the memory for the tree nodes could not be allocated.
+    /// </returns>
+    bool RadixPageMap::Map(const void *addr, size_t size, void *value)
+    {
+        auto firstKey = reinterpret_cast<uintptr_t> (addr) >> pageBits;
+        auto endKey = firstKey + size / pageMapPageSize;
+
+        std::lock_guard<std::mutex> lock(m_changesMutex);
+
+        for (auto key = firstKey; key < endKey; ++key)
+        {
+            auto leaf = GetLeaf(key, true);
+            if (leaf == nullptr)
+            {
+                // undo the pages already mapped:
+                for (auto undoKey = firstKey; undoKey < key; ++undoKey)
+                    GetLeaf(undoKey, false)->values[undoKey & ((1U << leafBits) - 1)].store(nullptr, std::memory_order_release);
+
+                return false;
+            }
+
+            leaf->values[key & ((1U << leafBits) - 1)].store(value, std::memory_order_release);
+        }
+
+        return true;
+    }
+
+    /// <summary>
+    /// Removes the values mapped to the pages in a range of addresses.
+    /// </summary>
+    /// <param name="addr">The start of the range, which must be aligned to the page.</param>
+    /// <param name="size">The size of the range, which must be a multiple of the page.</param>
+    void RadixPageMap::Unmap(const void *addr, size_t size)
+    {
+        auto firstKey = reinterpret_cast<uintptr_t> (addr) >> pageBits;
+        auto endKey = firstKey + size / pageMapPageSize;
+
+        std::lock_guard<std::mutex> lock(m_changesMutex);
+
+        for (auto key = firstKey; key < endKey; ++key)
+        {
+            auto leaf = GetLeaf(key, false);
+            if (leaf != nullptr)
+                leaf->values[key & ((1U << leafBits) - 1)].store(nullptr, std::memory_order_release);
+        }
+    }
+
+    /// <summary>
+    /// Iterates over the mapped pages, in ascending order of address.
+    /// </summary>
+    /// <param name="callback">
+    /// The callback to invoke with the address of each page and its value.
+    /// Pages mapped or unmapped while the iteration is in progress might be missed.
+    /// </param>
+    void RadixPageMap::ForEach(const std::function<void(const void *, void *)> &callback) const
+    {
+        for (uintptr_t rootIdx = 0; rootIdx < (1U << rootBits); ++rootIdx)
+        {
+            auto midNode = m_root[rootIdx].load(std::memory_order_acquire);
+            if (midNode == nullptr)
+                continue;
+
+            for (uintptr_t midIdx = 0; midIdx < (1U << midBits); ++midIdx)
+            {
+                auto leaf = midNode->leaves[midIdx].load(std::memory_order_acquire);
+                if (leaf == nullptr)
+                    continue;
+
+                for (uintptr_t leafIdx = 0; leafIdx < (1U << leafBits); ++leafIdx)
+                {
+                    auto value = leaf->values[leafIdx].load(std::memory_order_acquire);
+                    if (value == nullptr)
+                        continue;
+
+                    auto key = (((rootIdx << midBits) | midIdx) << leafBits) | leafIdx;
+                    callback(reinterpret_cast<const void *> (key << pageBits), value);
+                }
+            }
+        }
+    }
+
+    /// <summary>
+    /// Maps the pages in a range of addresses to a value.
+    /// </summary>
+    /// <param name="addr">The start of the range, which must be aligned to the page.</param>
+    /// <param name="size">The size of the range, which must be a multiple of the page.</param>
+    /// <param name="value">The value to map.</param>
+    /// <returns>Always <c>true</c>, because failure to allocate memory throws.</returns>
+    bool HashedPageMap::Map(const void *addr, size_t size, void *value)
+    {
+        auto firstKey = reinterpret_cast<uintptr_t> (addr) / pageMapPageSize;
+        auto endKey = firstKey + size / pageMapPageSize;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (auto key = firstKey; key < endKey; ++key)
+            m_valuesByPage[key] = value;
+
+        return true;
+    }
+
+    /// <summary>
+    /// Removes the values mapped to the pages in a range of addresses.
+    /// </summary>
+    /// <param name="addr">The start of the range, which must be aligned to the page.</param>
+    /// <param name="size">The size of the range, which must be a multiple of the page.</param>
+    void HashedPageMap::Unmap(const void *addr, size_t size)
+    {
+        auto firstKey = reinterpret_cast<uintptr_t> (addr) / pageMapPageSize;
+        auto endKey = firstKey + size / pageMapPageSize;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (auto key = firstKey; key < endKey; ++key)
+            m_valuesByPage.erase(key);
+    }
+
+    /// <summary>
+    /// Gets the value mapped to the page containing a given address.
+    /// </summary>
+    /// <param name="addr">The address.</param>
+    /// <returns>The value mapped to the page, or <c>nullptr</c> if there is none.</returns>
+    void *HashedPageMap::Lookup(const void *addr) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto iter = m_valuesByPage.find(reinterpret_cast<uintptr_t> (addr) / pageMapPageSize);
+        return (m_valuesByPage.end() != iter) ? iter->second : nullptr;
+    }
+
+    /// <summary>
+    /// Iterates over the mapped pages, in no particular order.
+    /// </summary>
+    /// <param name="callback">
+    /// The callback to invoke with the address of each page and its value.
+    /// The map must not be changed while the iteration is in progress.
+    /// </param>
+    void HashedPageMap::ForEach(const std::function<void(const void *, void *)> &callback) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (auto &entry : m_valuesByPage)
+            callback(reinterpret_cast<const void *> (entry.first * pageMapPageSize), entry.second);
+    }
+
+}// end of namespace memory
+}// end of namespace _3fd
@@ -0,0 +1,125 @@
+#ifndef GC_PAGEMAP_H // header guard
+#define GC_PAGEMAP_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+namespace _3fd
+{
+namespace memory
+{
+    /// <summary>
+    /// The size of the pages mapped by <see cref="RadixPageMap"/> and <see cref="HashedPageMap"/>.
+    /// </summary>
+    static const size_t pageMapPageSize = static_cast<size_t> (1) << 16;
+
+    /// <summary>
+    /// Maps the pages of the address space to values, using a radix tree
+    /// of three levels indexed by the bits of the page number.
+    /// </summary>
+    /// <remarks>
+    /// Nodes of the tree are created on demand, and only released along with the map.
+    /// Changes to the map must be serialized, but lookups are lock-free and can happen
+    /// concurrently with them. A lookup costs three dependent loads, regardless of how
+    /// many pages are mapped.
+    /// </remarks>
+    class RadixPageMap
+    {
+    private:
+
+        static const uint32_t pageBits = 16;
+
+        // on 64-bit platforms, user space does not go beyond 48 bits of address:
+        static const uint32_t keyBits = (sizeof(void *) == 8 ? 48 : 32) - pageBits;
+
+        static const uint32_t leafBits = (keyBits + 2) / 3;
+        static const uint32_t midBits = (keyBits - leafBits + 1) / 2;
+        static const uint32_t rootBits = keyBits - leafBits - midBits;
+
+        struct Leaf
+        {
+            std::atomic<void *> values[1U << leafBits];
+        };
+
+        struct MidNode
+        {
+            std::atomic<Leaf *> leaves[1U << midBits];
+        };
+
+        std::atomic<MidNode *> m_root[1U << rootBits];
+
+        std::mutex m_changesMutex;
+
+        Leaf *GetLeaf(uintptr_t key, bool create);
+
+    public:
+
+        RadixPageMap();
+
+        RadixPageMap(const RadixPageMap &) = delete;
+
+        ~RadixPageMap();
+
+        bool Map(const void *addr, size_t size, void *value);
+
+        void Unmap(const void *addr, size_t size);
+
+        /// <summary>
+        /// Gets the value mapped to the page containing a given address.
+        /// </summary>
+        /// <param name="addr">The address.</param>
+        /// <returns>The value mapped to the page, or <c>nullptr</c> if there is none.</returns>
+        void *Lookup(const void *addr) const
+        {
+            auto key = reinterpret_cast<uintptr_t> (addr) >> pageBits;
+            if ((key >> keyBits) != 0)
+                return nullptr;
+
+            auto midNode = m_root[key >> (leafBits + midBits)].load(std::memory_order_acquire);
+            if (midNode == nullptr)
+                return nullptr;
+
+            auto leaf = midNode->leaves[(key >> leafBits) & ((1U << midBits) - 1)].load(std::memory_order_acquire);
+            if (leaf == nullptr)
+                return nullptr;
+
+            return leaf->values[key & ((1U << leafBits) - 1)].load(std::memory_order_acquire);
+        }
+
+        void ForEach(const std::function<void(const void *, void *)> &callback) const;
+    };
+
+    /// <summary>
+    /// Maps the pages of the address space to values, using a hash table protected by a lock.
+    /// This has the same interface of <see cref="RadixPageMap"/>, so they can be compared.
+    /// </summary>
+    class HashedPageMap
+    {
+    private:
+
+        std::unordered_map<uintptr_t, void *> m_valuesByPage;
+        mutable std::mutex m_mutex;
+
+    public:
+
+        HashedPageMap() = default;
+
+        HashedPageMap(const HashedPageMap &) = delete;
+
+        bool Map(const void *addr, size_t size, void *value);
+
+        void Unmap(const void *addr, size_t size);
+
+        void *Lookup(const void *addr) const;
+
+        void ForEach(const std::function<void(const void *, void *)> &callback) const;
+    };
+
+}// end of namespace memory
+}// end of namespace _3fd
+
+#endif // end of header guard
@@ -0,0 +1,246 @@
+#include "pch.h"
+#include "gc_parallelmarker.h"
+
+#include <algorithm>
+
+namespace _3fd
+{
+namespace memory
+{
+    // A private stack only shares work when it holds at least this many vertices:
+    static const size_t minStackSizeToShare(64);
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="ParallelMarker"/> class.
+    /// </summary>
+    /// <param name="numThreads">
+    /// How many threads take part in the marking, including the one that requests it.
+    /// </param>
+    ParallelMarker::ParallelMarker(uint32_t numThreads) :
+        m_jobNumber(0),
+        m_busyWorkers(0),
+        m_terminate(false),
+        m_edges(nullptr),
+        m_marksCapacity(0),
+        m_pendingCount(0)
+    {
+        numThreads = std::max(numThreads, 1U);
+
+        for (uint32_t idx = 0; idx < numThreads; ++idx)
+            m_queues.emplace_back(new WorkQueue());
+
+        // the thread requesting the marking has the queue zero:
+        for (uint32_t id = 1; id < numThreads; ++id)
+            m_workers.emplace_back(&ParallelMarker::WorkerProc, this, id);
+    }
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="ParallelMarker"/> class.
+    /// </summary>
+    ParallelMarker::~ParallelMarker()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_jobMutex);
+            m_terminate = true;
+        }
+
+        m_jobStartCondition.notify_all();
+
+        for (auto &worker : m_workers)
+            worker.join();
+    }
+
+    /// <summary>
+    /// Marks the vertices reachable from the given roots, making use of all threads.
+    /// </summary>
+    /// <param name="edges">The outgoing edges of all vertices in the graph.</param>
+    /// <param name="roots">The indexes of the root vertices.</param>
+    void ParallelMarker::Mark(const OutgoingEdges &edges, const std::vector<uint32_t> &roots)
+    {
+        auto numVertices = edges.first.size();
+
+        if (numVertices > m_marksCapacity)
+        {
+            m_marks.reset(new std::atomic<uint8_t>[numVertices]);
+            m_marksCapacity = numVertices;
+        }
+
+        for (size_t idx = 0; idx < numVertices; ++idx)
+            m_marks[idx].store(0, std::memory_order_relaxed);
+
+        m_edges = &edges;
+
+        // Distribute the roots across the threads:
+        size_t pendingCount(0);
+        for (auto root : roots)
+        {
+            if (m_marks[root].load(std::memory_order_relaxed) != 0)
+                continue;
+
+            m_marks[root].store(1, std::memory_order_relaxed);
+            m_queues[pendingCount++ % m_queues.size()]->stack.push_back(root);
+        }
+
+        if (pendingCount == 0)
+            return;
+
+        /* Roots in the private stacks of the workers must
+        be shared, because only the owner takes from there: */
+        for (size_t id = 1; id < m_queues.size(); ++id)
+        {
+            auto &queue = *m_queues[id];
+            queue.shared.insert(queue.shared.end(), queue.stack.begin(), queue.stack.end());
+            queue.sharedSize.store(queue.shared.size(), std::memory_order_relaxed);
+            queue.stack.clear();
+        }
+
+        m_pendingCount.store(pendingCount, std::memory_order_relaxed);
+
+        if (!m_workers.empty())
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_jobMutex);
+                m_busyWorkers = static_cast<uint32_t> (m_workers.size());
+                ++m_jobNumber;
+            }
+
+            m_jobStartCondition.notify_all();
+        }
+
+        DoMarking(0);
+
+        std::unique_lock<std::mutex> lock(m_jobMutex);
+        m_jobEndCondition.wait(lock, [this]() { return m_busyWorkers == 0; });
+    }
+
+    /// <summary>
+    /// Executed by each thread of the pool, which
+    /// waits for a marking job and takes part in it.
+    /// </summary>
+    /// <param name="id">The identifier of the thread.</param>
+    void ParallelMarker::WorkerProc(uint32_t id)
+    {
+        uint64_t lastJobNumber(0);
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_jobMutex);
+                m_jobStartCondition.wait(lock, [this, lastJobNumber]()
+                {
+                    return m_terminate || m_jobNumber != lastJobNumber;
+                });
+
+                if (m_terminate)
+                    return;
+
+                lastJobNumber = m_jobNumber;
+            }
+
+            DoMarking(id);
+
+            std::lock_guard<std::mutex> lock(m_jobMutex);
+            if (--m_busyWorkers == 0)
+                m_jobEndCondition.notify_one();
+        }
+    }
+
+    /// <summary>
+    /// Visits vertices marking their successors, until there is nothing left to visit.
+    /// </summary>
+    /// <param name="id">The identifier of the thread.</param>
+    void ParallelMarker::DoMarking(uint32_t id)
+    {
+        auto &queue = *m_queues[id];
+        auto &stack = queue.stack;
+        auto &edges = *m_edges;
+
+        while (true)
+        {
+            if (stack.empty() && !TakeWork(id))
+            {
+                if (m_pendingCount.load(std::memory_order_acquire) == 0)
+                    break;
+
+                std::this_thread::yield();
+                continue;
+            }
+
+            auto index = stack.back();
+            stack.pop_back();
+
+            size_t foundCount(0);
+            for (auto pos = edges.first[index]; pos < edges.last[index]; ++pos)
+            {
+                auto target = edges.targets[pos];
+
+                if (m_marks[target].load(std::memory_order_relaxed) == 0
+                    && m_marks[target].exchange(1, std::memory_order_relaxed) == 0)
+                {
+                    stack.push_back(target);
+                    ++foundCount;
+                }
+            }
+
+            // this vertex was visited, while the ones found are yet to visit:
+            if (foundCount == 0)
+                m_pendingCount.fetch_sub(1, std::memory_order_acq_rel);
+            else if (foundCount > 1)
+                m_pendingCount.fetch_add(foundCount - 1, std::memory_order_relaxed);
+
+            if (stack.size() >= minStackSizeToShare
+                && queue.sharedSize.load(std::memory_order_relaxed) == 0)
+            {
+                ShareWork(queue);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Moves the older half of the private stack of a thread to its shared queue.
+    /// </summary>
+    /// <param name="queue">The work of the thread.</param>
+    void ParallelMarker::ShareWork(WorkQueue &queue)
+    {
+        auto half = queue.stack.begin() + queue.stack.size() / 2;
+
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.shared.insert(queue.shared.end(), queue.stack.begin(), half);
+        queue.sharedSize.store(queue.shared.size(), std::memory_order_relaxed);
+        queue.stack.erase(queue.stack.begin(), half);
+    }
+
+    /// <summary>
+    /// Fills the empty private stack of a thread with work taken from its own shared
+    /// queue, or else with half the work in the shared queue of another thread.
+    /// </summary>
+    /// <param name="id">The identifier of the thread.</param>
+    /// <returns>Whether any work was found.</returns>
+    bool ParallelMarker::TakeWork(uint32_t id)
+    {
+        auto &stack = m_queues[id]->stack;
+
+        for (size_t count = 0; count < m_queues.size(); ++count)
+        {
+            auto &queue = *m_queues[(id + count) % m_queues.size()];
+
+            if (queue.sharedSize.load(std::memory_order_relaxed) == 0)
+                continue;
+
+            std::lock_guard<std::mutex> lock(queue.mutex);
+
+            auto takeCount = (count == 0) ? queue.shared.size() : (queue.shared.size() + 1) / 2;
+            if (takeCount == 0)
+                continue;
+
+            stack.insert(stack.end(), queue.shared.begin(), queue.shared.begin() + takeCount);
+            queue.shared.erase(queue.shared.begin(), queue.shared.begin() + takeCount);
+            queue.sharedSize.store(queue.shared.size(), std::memory_order_relaxed);
+            return true;
+        }
+
+        return false;
+    }
+
+}// end of namespace memory
+}// end of namespace _3fd
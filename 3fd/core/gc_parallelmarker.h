@@ -0,0 +1,113 @@
+#ifndef GC_PARALLELMARKER_H // header guard
+#define GC_PARALLELMARKER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace _3fd
+{
+namespace memory
+{
+    /// <summary>
+    /// Marks the vertices reachable from a set of roots in a graph, with the work
+    /// spread across a pool of threads. The thread requesting the marking takes
+    /// part in it, so the pool has one thread less than the requested parallelism.
+    /// </summary>
+    /// <remarks>
+    /// Each thread keeps the vertices it has yet to visit in a private stack. When the
+    /// stack grows, the older half of it moves to a shared queue, from where the thread
+    /// itself or any idle thread can take it. Marks are atomic, so a vertex is visited
+    /// by the one thread that sets its mark. A count of vertices marked but not yet
+    /// visited tells when the marking is complete.
+    /// </remarks>
+    class ParallelMarker
+    {
+    public:
+
+        /// <summary>
+        /// The outgoing edges of the vertices in a graph, in compressed rows:
+        /// the vertex of index 'i' has edges to the vertices whose indexes are
+        /// in 'targets', from position 'first[i]' up to 'last[i]' (exclusive).
+        /// </summary>
+        struct OutgoingEdges
+        {
+            std::vector<uint32_t> first;
+            std::vector<uint32_t> last;
+            std::vector<uint32_t> targets;
+        };
+
+    private:
+
+        /// <summary>
+        /// The work of a thread: the private stack of vertices to visit, and
+        /// the queue of vertices to visit shared with the other threads.
+        /// </summary>
+        struct WorkQueue
+        {
+            std::vector<uint32_t> stack;
+
+            std::mutex mutex;
+            std::deque<uint32_t> shared;
+            std::atomic<size_t> sharedSize;
+
+            WorkQueue() : sharedSize(0) {}
+        };
+
+        std::vector<std::unique_ptr<WorkQueue>> m_queues;
+        std::vector<std::thread> m_workers;
+
+        std::mutex m_jobMutex;
+        std::condition_variable m_jobStartCondition;
+        std::condition_variable m_jobEndCondition;
+        uint64_t m_jobNumber;
+        uint32_t m_busyWorkers;
+        bool m_terminate;
+
+        const OutgoingEdges *m_edges;
+        std::unique_ptr<std::atomic<uint8_t>[]> m_marks;
+        size_t m_marksCapacity;
+        std::atomic<size_t> m_pendingCount;
+
+        void WorkerProc(uint32_t id);
+
+        void DoMarking(uint32_t id);
+
+        bool TakeWork(uint32_t id);
+
+        void ShareWork(WorkQueue &queue);
+
+    public:
+
+        ParallelMarker(uint32_t numThreads);
+
+        ParallelMarker(const ParallelMarker &) = delete;
+
+        ~ParallelMarker();
+
+        /// <summary>
+        /// Gets how many threads take part in the marking.
+        /// </summary>
+        uint32_t GetNumThreads() const { return static_cast<uint32_t> (m_queues.size()); }
+
+        void Mark(const OutgoingEdges &edges, const std::vector<uint32_t> &roots);
+
+        /// <summary>
+        /// Determines whether a vertex has been marked by the last marking.
+        /// </summary>
+        /// <param name="index">The index of the vertex.</param>
+        bool IsMarked(uint32_t index) const
+        {
+            return m_marks[index].load(std::memory_order_relaxed) != 0;
+        }
+    };
+
+}// end of namespace memory
+}// end of namespace _3fd
+
+#endif // end of header guard
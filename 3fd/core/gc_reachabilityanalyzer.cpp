@@ -0,0 +1,207 @@
+#include "pch.h"
+#include "gc_reachabilityanalyzer.h"
+
+namespace _3fd
+{
+namespace memory
+{
+    /// <summary>
+    /// Initializes a new instance of the <see cref="ReachabilityAnalyzer"/> class.
+    /// </summary>
+    /// <param name="weakRefs">
+    /// The weak references to expire before a vertex is deemed unreachable, if any.
+    /// </param>
+    ReachabilityAnalyzer::ReachabilityAnalyzer(WeakReferences *weakRefs)
+        : m_epoch(0), m_passEpoch(1), m_visitsCount(0), m_weakRefs(weakRefs), m_collectedHolds(false) {}
+
+    /// <summary>
+    /// Restarts the counting of epochs, which must only be done
+    /// after the epochs of all vertices in the graph were reset.
+    /// </summary>
+    void ReachabilityAnalyzer::ResetEpochs()
+    {
+        m_epoch = 0;
+        m_passEpoch = 1;
+    }
+
+    /// <summary>
+    /// Starts a new pass of analysis, so results
+    /// memoized by searches in previous passes expire.
+    /// </summary>
+    void ReachabilityAnalyzer::StartPass()
+    {
+        _ASSERTE(HasEpochsFor(1));
+        m_passEpoch = m_epoch + 1;
+    }
+
+    /// <summary>
+    /// Determines whether a vertex is reachable by any root vertex
+    /// using depth-first search algorithm.
+    /// </summary>
+    /// <param name="memBlock">The vertex to start the search from.</param>
+    /// <returns>
+    /// <c>true</c> if there is a path through with a root vertex
+    /// can reach this vertex, otherwise, <c>false</c>.
+    /// </returns>
+    bool ReachabilityAnalyzer::IsReachable(Vertex *memBlock)
+    {
+        if (memBlock->IsHeldByRoot())
+            return true;
+
+        if (IsMemoized(memBlock) && memBlock->GetReachability() != Vertex::Reachability::Unknown)
+            return memBlock->GetReachability() == Vertex::Reachability::Reachable;
+
+        /* An unreachable outcome only stands once the weak references to the
+        vertices visited have expired. When one of them is locked, it becomes a
+        root, so searching again has a different outcome, or expires the rest: */
+        bool rootFound;
+        while (true)
+        {
+            rootFound = Search(memBlock);
+
+            if (rootFound || ExpireWeakReferences())
+                break;
+
+            if (memBlock->IsHeldByRoot())
+                return true;
+        }
+
+        if (rootFound)
+        {
+            /* every vertex in the path that leads back from
+            the root to the start is reachable as well: */
+            auto index = m_visited.size() - 1;
+            while (true)
+            {
+                m_visited[index].vertex->SetReachability(Vertex::Reachability::Reachable);
+
+                if (index == 0)
+                    break;
+
+                index = m_visited[index].fromIndex;
+            }
+        }
+        else
+        {
+            // when the search is exhausted, every vertex visited is unreachable:
+            for (auto &entry : m_visited)
+                entry.vertex->SetReachability(Vertex::Reachability::Unreachable);
+        }
+
+        return rootFound;
+    }
+
+    /// <summary>
+    /// Expires the weak references to the vertices visited by the last search.
+    /// </summary>
+    /// <returns>Whether they have all expired, which fails when any is locked.</returns>
+    bool ReachabilityAnalyzer::ExpireWeakReferences()
+    {
+        if (m_weakRefs == nullptr)
+            return true;
+
+        m_weaklyReferenced.clear();
+        for (auto &entry : m_visited)
+        {
+            if (entry.vertex->HasWeakReferences())
+                m_weaklyReferenced.push_back(entry.vertex);
+        }
+
+        return m_weaklyReferenced.empty()
+            || m_weakRefs->TryExpire(m_weaklyReferenced.data(), m_weaklyReferenced.size());
+    }
+
+    /// <summary>
+    /// Searches backwards from a vertex for a root vertex, leaving in the list of
+    /// visited vertices either the path from the root, or all vertices visited.
+    /// </summary>
+    /// <param name="memBlock">The vertex to start the search from.</param>
+    /// <returns>Whether a root vertex has been found.</returns>
+    bool ReachabilityAnalyzer::Search(Vertex *memBlock)
+    {
+        _ASSERTE(HasEpochsFor(1));
+        const auto epoch = ++m_epoch;
+
+        m_stack.clear();
+        m_visited.clear();
+
+        memBlock->SetEpoch(epoch);
+        memBlock->SetReachability(Vertex::Reachability::Unknown);
+        m_stack.push_back(StackEntry{ memBlock, 0 });
+
+        bool rootFound(false);
+        while (!rootFound && !m_stack.empty())
+        {
+            const auto thisIndex = m_visited.size();
+            m_visited.push_back(m_stack.back());
+            m_stack.pop_back();
+
+            // iterate over the vertices of receiving edges:
+            m_visited.back().vertex->ForEachRegularReceivingVertex(
+                [this, epoch, thisIndex, &rootFound](Vertex *recvEdgeVtx)
+                {
+                    if (recvEdgeVtx->AreReprObjResourcesReleased())
+                    {
+                        if (!m_collectedHolds) // already collected, skip
+                            return true;
+
+                        // the destructor is yet to release the edge:
+                        rootFound = true;
+                        return false;
+                    }
+
+                    if (IsMemoized(recvEdgeVtx))
+                    {
+                        if (recvEdgeVtx->GetEpoch() == epoch) // already visited, skip
+                            return true;
+
+                        switch (recvEdgeVtx->GetReachability())
+                        {
+                        case Vertex::Reachability::Reachable:
+                            rootFound = true;
+                            return false;
+                        case Vertex::Reachability::Unreachable:
+                            return true;
+                        default:
+                            break;
+                        }
+                    }
+
+                    if (recvEdgeVtx->IsHeldByRoot())
+                    {
+                        rootFound = true;
+                        return false;
+                    }
+
+                    recvEdgeVtx->SetEpoch(epoch);
+                    recvEdgeVtx->SetReachability(Vertex::Reachability::Unknown);
+                    m_stack.push_back(StackEntry{ recvEdgeVtx, thisIndex });
+                    return true;
+                }
+            );
+        }
+
+        m_visitsCount += m_visited.size();
+        return rootFound;
+    }
+
+    /// <summary>
+    /// Determines whether this vertex is reachable by any root vertex,
+    /// in an analysis of its own, hence without memoized results.
+    /// </summary>
+    /// <returns>
+    /// <c>true</c> if there is a path through with a root vertex
+    /// can reach this vertex, otherwise, <c>false</c>.
+    /// </returns>
+    bool IsReachable(Vertex *memBlock)
+    {
+        /* For a standalone analysis, there is no way to reset the epochs of
+        the vertices in the graph, but the epochs would only be exhausted
+        after billions of invocations. The GC has an analyzer of its own. */
+        thread_local ReachabilityAnalyzer analyzer;
+        analyzer.StartPass();
+        return analyzer.IsReachable(memBlock);
+    }
+
+}// end of namespace memory
+}// end of namespace _3fd
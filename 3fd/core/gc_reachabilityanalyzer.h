@@ -0,0 +1,106 @@
+#ifndef GC_REACHABILITYANALYZER_H // header guard
+#define GC_REACHABILITYANALYZER_H
+
+#include <3fd/core/gc_vertex.h>
+#include <3fd/core/gc_weakreferences.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace _3fd
+{
+namespace memory
+{
+    /// <summary>
+    /// Performs reachability analysis in the graph of memory pieces, searching
+    /// backwards from a vertex (through its incoming edges) for a root vertex.
+    /// </summary>
+    /// <remarks>
+    /// The search is iterative, with an explicit stack, so its depth is not limited
+    /// by the call stack. Instead of marking vertices and unmarking them afterwards,
+    /// each search has its own epoch, and a vertex counts as visited when it holds
+    /// the epoch of the current search. The analysis is organized in passes: along a
+    /// pass, the outcome of a search is memoized in the vertices it has proven to be
+    /// reachable (the path to the root) or unreachable (all visited, when exhausted),
+    /// so later searches in the same pass stop as soon as they hit a vertex already
+    /// known. A pass must not span changes in the graph edges.
+    /// </remarks>
+    class ReachabilityAnalyzer
+    {
+    private:
+
+        uint32_t m_epoch;
+        uint32_t m_passEpoch;
+
+        /// <summary>
+        /// A vertex to visit, along with the position in the
+        /// list of visited vertices of the one that led to it.
+        /// </summary>
+        struct StackEntry
+        {
+            Vertex *vertex;
+            size_t fromIndex;
+        };
+
+        std::vector<StackEntry> m_stack;
+        std::vector<StackEntry> m_visited;
+
+        /// <summary>
+        /// How many vertices have been visited by all searches so far.
+        /// </summary>
+        uint64_t m_visitsCount;
+
+        WeakReferences *m_weakRefs;
+        std::vector<Vertex *> m_weaklyReferenced;
+
+        /// <summary>
+        /// Whether an edge from a vertex already collected holds the receiving vertex
+        /// like a root, which is the case when the objects collected are finalized by
+        /// other threads, because the edge stays until the destructor releases it.
+        /// </summary>
+        bool m_collectedHolds;
+
+        bool IsMemoized(Vertex *vtx) const { return vtx->GetEpoch() >= m_passEpoch; }
+
+        bool Search(Vertex *memBlock);
+
+        bool ExpireWeakReferences();
+
+    public:
+
+        ReachabilityAnalyzer(WeakReferences *weakRefs = nullptr);
+
+        ReachabilityAnalyzer(const ReachabilityAnalyzer &) = delete;
+
+        /// <summary>
+        /// Determines whether there are enough epochs left for a given amount of searches.
+        /// When not, the epochs of all vertices in the graph must be reset to zero, and
+        /// afterwards <see cref="ResetEpochs"/> invoked, before a new pass starts.
+        /// </summary>
+        /// <param name="maxSearches">The maximum amount of searches to perform.</param>
+        bool HasEpochsFor(size_t maxSearches) const
+        {
+            return maxSearches < static_cast<size_t> (UINT32_MAX - m_epoch);
+        }
+
+        /// <summary>
+        /// Sets whether an edge from a vertex already collected holds the receiving vertex.
+        /// </summary>
+        void SetCollectedHolds(bool collectedHolds) { m_collectedHolds = collectedHolds; }
+
+        void ResetEpochs();
+
+        void StartPass();
+
+        bool IsReachable(Vertex *memBlock);
+
+        /// <summary>
+        /// Gets how many vertices have been visited by all searches so far.
+        /// </summary>
+        uint64_t GetVisitsCount() const { return m_visitsCount; }
+    };
+
+}// end of namespace memory
+}// end of namespace _3fd
+
+#endif // end of header guard
@@ -0,0 +1,417 @@
+#ifndef GC_VECTOR_H // header guard
+#define GC_VECTOR_H
+
+#include <3fd/core/sptr.h>
+#include <3fd/core/preprocessing.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace _3fd
+{
+namespace memory
+{
+    //////////////////////////////////////////
+    //  gc_vector Class Template for sptr
+    //////////////////////////////////////////
+
+    /// <summary>
+    /// A sequence of safe pointers that the GC sees as a single container, instead of a
+    /// <see cref="sptr"/> object per element. The container is registered once, and the objects
+    /// it holds are edges from the memory block that contains it, or from a root when it is not
+    /// in memory managed by the GC. Growing or reordering the sequence sends no messages to the
+    /// GC, whereas inserting, erasing or swapping any amount of elements sends a single one.
+    /// </summary>
+    /// <remarks>
+    /// The objects must be managed by the GC, rather than by an arena. They are handed out either
+    /// as new safe pointers, or as raw pointers, which are only valid while the container holds
+    /// the object. The element type is that of the safe pointers, so this takes the place of
+    /// <c>std::vector&lt;sptr&lt;Type&gt;&gt;</c> as <c>gc_vector&lt;sptr&lt;Type&gt;&gt;</c>.
+    /// </remarks>
+    template <typename Type>
+    class gc_vector<sptr<Type>>
+    {
+    private:
+
+        typedef typename std::vector<Type *>::const_iterator ConstIterator;
+
+        std::vector<Type *> m_elements;
+
+        /// <summary>
+        /// Gets the address of an object as expected by the GC.
+        /// </summary>
+        static void *ToAddress(Type *ptr)
+        {
+            return const_cast<void *> (static_cast<const void *> (ptr));
+        }
+
+        /// <summary>
+        /// Gets the addresses of the objects in a range of elements, leaving out the null ones.
+        /// </summary>
+        static std::vector<void *> GetAddresses(ConstIterator first, ConstIterator last)
+        {
+            std::vector<void *> addrs;
+            addrs.reserve(last - first);
+
+            for (; first != last; ++first)
+            {
+                if (*first != nullptr)
+                    addrs.push_back(ToAddress(*first));
+            }
+
+            return addrs;
+        }
+
+        /// <summary>
+        /// Makes room for more elements, so they are inserted without fail
+        /// once the GC has been told about them.
+        /// </summary>
+        /// <param name="count">How many elements are about to be inserted.</param>
+        void MakeRoomFor(size_t count)
+        {
+            auto size = m_elements.size();
+
+            if (size + count > m_elements.capacity())
+                m_elements.reserve(std::max(size + count, 2 * m_elements.capacity()));
+        }
+
+        /// <summary>
+        /// Inserts a range of objects, which must not come from this instance.
+        /// </summary>
+        void InsertPointers(size_t pos, ConstIterator first, ConstIterator last)
+        {
+            _ASSERTE(pos <= m_elements.size());
+
+            auto addrs = GetAddresses(first, last);
+            MakeRoomFor(last - first);
+
+            GarbageCollector::GetInstance()
+                .AddEdges(this, addrs.data(), addrs.size());
+
+            m_elements.insert(m_elements.begin() + pos, first, last);
+        }
+
+        /// <summary>
+        /// Empties a container in an arena abandoned because of escaped references,
+        /// once the arena has told the GC that the container no longer exists.
+        /// </summary>
+        static void Abandon(void *containerAddr)
+        {
+            static_cast<gc_vector *> (containerAddr)->m_elements.clear();
+        }
+
+    public:
+
+        /// <summary>
+        /// Default parameterless constructor.
+        /// Just registers the container with the GC.
+        /// </summary>
+        gc_vector()
+        {
+            gc_arena::RegisterEdgeSet(this, &Abandon);
+        }
+
+        /// <summary>
+        /// Copy constructor.
+        /// Tells the GC there is a new container holding the same objects, in a single message.
+        /// </summary>
+        /// <param name="ob">The object to be copied.</param>
+        gc_vector(const gc_vector &ob) :
+            m_elements(ob.m_elements)
+        {
+            auto addrs = GetAddresses(m_elements.begin(), m_elements.end());
+            gc_arena::RegisterEdgeSet(this, &Abandon);
+
+            try
+            {
+                GarbageCollector::GetInstance().AddEdges(this, addrs.data(), addrs.size());
+            }
+            catch (...)
+            {
+                // this instance does not get destroyed when its constructor throws:
+                gc_arena::UnregisterEdgeSet(this);
+                throw;
+            }
+        }
+
+        /// <summary>
+        /// Move constructor.
+        /// Tells the GC this container takes over the objects of the other, which is left empty.
+        /// This is not <c>noexcept</c>, because telling the GC can fail, as any message can.
+        /// </summary>
+        /// <param name="ob">The object to be moved.</param>
+        gc_vector(gc_vector &&ob)
+        {
+            gc_arena::RegisterEdgeSet(this, &Abandon);
+
+            try
+            {
+                Swap(ob);
+            }
+            catch (...)
+            {
+                // this instance does not get destroyed when its constructor throws:
+                gc_arena::UnregisterEdgeSet(this);
+                throw;
+            }
+        }
+
+        /// <summary>
+        /// Destructor.
+        /// Tells the GC that the container and all the references it holds no longer exist.
+        /// </summary>
+        ~gc_vector()
+        {
+            gc_arena::UnregisterEdgeSet(this);
+        }
+
+        gc_vector &operator =(const gc_vector &ob)
+        {
+            if (&ob != this)
+            {
+                gc_vector copy(ob);
+                Swap(copy);
+            }
+
+            return *this;
+        }
+
+        gc_vector &operator =(gc_vector &&ob)
+        {
+            if (&ob != this)
+            {
+                Swap(ob);
+                ob.Clear();
+            }
+
+            return *this;
+        }
+
+        /// <summary>
+        /// Gets how many elements there are.
+        /// </summary>
+        size_t GetCount() const { return m_elements.size(); }
+
+        /// <summary>
+        /// Determines whether there are no elements.
+        /// </summary>
+        bool IsEmpty() const { return m_elements.empty(); }
+
+        /// <summary>
+        /// Gets how many elements fit before the storage must grow.
+        /// </summary>
+        size_t GetCapacity() const { return m_elements.capacity(); }
+
+        /// <summary>
+        /// Makes the storage fit at least a given amount of elements.
+        /// </summary>
+        /// <param name="capacity">How many elements the storage should fit.</param>
+        void Reserve(size_t capacity)
+        {
+            m_elements.reserve(capacity);
+        }
+
+        /// <summary>
+        /// Gets a safe pointer to the object in a position.
+        /// </summary>
+        /// <param name="idx">The position.</param>
+        /// <returns>A new safe pointer to the object, which might be a null one.</returns>
+        sptr<Type> operator [](size_t idx) const
+        {
+            _ASSERTE(idx < m_elements.size());
+            return sptr<Type>(HeldObjectTag(), m_elements[idx]);
+        }
+
+        /// <summary>
+        /// Gets the object in a position, without a safe pointer, hence
+        /// only valid for as long as the container holds the object.
+        /// </summary>
+        /// <param name="idx">The position.</param>
+        /// <returns>A raw pointer to the object, which might be null.</returns>
+        Type *GetPointer(size_t idx) const
+        {
+            _ASSERTE(idx < m_elements.size());
+            return m_elements[idx];
+        }
+
+        /// <summary>
+        /// Replaces the object in a position.
+        /// </summary>
+        /// <param name="idx">The position.</param>
+        /// <param name="ob">A safe pointer to the new object.</param>
+        void Set(size_t idx, const sptr<Type> &ob)
+        {
+            _ASSERTE(idx < m_elements.size());
+
+            auto &element = m_elements[idx];
+            Type *ptr = ob.operator->();
+
+            if (ptr == element)
+                return;
+
+            auto &gc = GarbageCollector::GetInstance();
+
+            // the new edge goes first, so a repeated object is never left without it:
+            if (ptr != nullptr)
+            {
+                void *addr = ToAddress(ptr);
+                gc.AddEdges(this, &addr, 1);
+            }
+
+            if (element != nullptr)
+            {
+                void *addr = ToAddress(element);
+                gc.RemoveEdges(this, &addr, 1);
+            }
+
+            element = ptr;
+        }
+
+        /// <summary>
+        /// Inserts an object in a position.
+        /// </summary>
+        /// <param name="pos">The position, which can be the end.</param>
+        /// <param name="ob">A safe pointer to the object.</param>
+        void Insert(size_t pos, const sptr<Type> &ob)
+        {
+            _ASSERTE(pos <= m_elements.size());
+
+            Type *ptr = ob.operator->();
+            MakeRoomFor(1);
+
+            if (ptr != nullptr)
+            {
+                void *addr = ToAddress(ptr);
+                GarbageCollector::GetInstance().AddEdges(this, &addr, 1);
+            }
+
+            m_elements.insert(m_elements.begin() + pos, ptr);
+        }
+
+        /// <summary>
+        /// Inserts in a position the objects referenced by a range
+        /// of safe pointers, which the GC is told in a single message.
+        /// </summary>
+        /// <param name="pos">The position, which can be the end.</param>
+        /// <param name="first">An iterator to the first safe pointer.</param>
+        /// <param name="last">An iterator past the last safe pointer.</param>
+        template <typename InputIterator>
+        void Insert(size_t pos, InputIterator first, InputIterator last)
+        {
+            std::vector<Type *> ptrs;
+            for (; first != last; ++first)
+                ptrs.push_back((*first).operator->());
+
+            InsertPointers(pos, ptrs.begin(), ptrs.end());
+        }
+
+        /// <summary>
+        /// Inserts in a position all the objects of a container,
+        /// which the GC is told in a single message.
+        /// </summary>
+        /// <param name="pos">The position, which can be the end.</param>
+        /// <param name="ob">The container whose objects will be inserted.</param>
+        void Insert(size_t pos, const gc_vector &ob)
+        {
+            if (&ob != this)
+            {
+                InsertPointers(pos, ob.m_elements.begin(), ob.m_elements.end());
+                return;
+            }
+
+            std::vector<Type *> ptrs(m_elements);
+            InsertPointers(pos, ptrs.begin(), ptrs.end());
+        }
+
+        /// <summary>
+        /// Appends an object.
+        /// </summary>
+        /// <param name="ob">A safe pointer to the object.</param>
+        void PushBack(const sptr<Type> &ob)
+        {
+            Insert(m_elements.size(), ob);
+        }
+
+        /// <summary>
+        /// Removes a range of elements, which the GC is told in a single message.
+        /// </summary>
+        /// <param name="first">The position of the first element.</param>
+        /// <param name="last">The position past the last element.</param>
+        void Erase(size_t first, size_t last)
+        {
+            _ASSERTE(first <= last && last <= m_elements.size());
+
+            if (first == last)
+                return;
+
+            auto addrs = GetAddresses(m_elements.begin() + first, m_elements.begin() + last);
+
+            GarbageCollector::GetInstance()
+                .RemoveEdges(this, addrs.data(), addrs.size());
+
+            m_elements.erase(m_elements.begin() + first, m_elements.begin() + last);
+        }
+
+        /// <summary>
+        /// Removes the element in a position.
+        /// </summary>
+        /// <param name="pos">The position.</param>
+        void Erase(size_t pos)
+        {
+            Erase(pos, pos + 1);
+        }
+
+        /// <summary>
+        /// Removes the last element.
+        /// </summary>
+        void PopBack()
+        {
+            _ASSERTE(!m_elements.empty());
+            Erase(m_elements.size() - 1);
+        }
+
+        /// <summary>
+        /// Removes all elements, which the GC is told in a single message.
+        /// </summary>
+        void Clear()
+        {
+            Erase(0, m_elements.size());
+        }
+
+        /// <summary>
+        /// Exchanges the elements of two positions, which the GC is not told at all.
+        /// </summary>
+        void SwapElements(size_t idx1, size_t idx2)
+        {
+            _ASSERTE(idx1 < m_elements.size() && idx2 < m_elements.size());
+            std::swap(m_elements[idx1], m_elements[idx2]);
+        }
+
+        /// <summary>
+        /// Sorts the elements, which the GC is not told at all.
+        /// </summary>
+        /// <param name="compare">Compares the raw pointers to the objects of two elements.</param>
+        template <typename Compare>
+        void Sort(Compare compare)
+        {
+            std::sort(m_elements.begin(), m_elements.end(), compare);
+        }
+
+        /// <summary>
+        /// Exchanges the elements with another container, which the GC is told in a single message.
+        /// </summary>
+        /// <param name="ob">The other container.</param>
+        void Swap(gc_vector &ob)
+        {
+            if (&ob == this)
+                return;
+
+            GarbageCollector::GetInstance().SwapEdgeSets(this, &ob);
+            m_elements.swap(ob.m_elements);
+        }
+    };
+
+}// end of namespace memory
+}// end of namespace _3fd
+
+#endif // end of header guard
@@ -5,38 +5,38 @@ namespace _3fd
 {
 namespace memory
 {
-    utils::DynamicMemPool * Vertex::dynMemPool(nullptr);
+    VertexTable * Vertex::table(nullptr);
 
     /// <summary>
-    /// Sets the object pool that provides all the <see cref="Vertex"/> instances.
+    /// Sets the table that provides all the <see cref="Vertex"/> instances.
     /// </summary>
-    /// <param name="ob">The object pool to use.</param>
-    void Vertex::SetMemoryPool(utils::DynamicMemPool &ob)
+    /// <param name="ob">The table to use.</param>
+    void Vertex::SetTable(VertexTable &ob)
     {
-        dynMemPool = &ob;
+        table = &ob;
     }
 
     /// <summary>
     /// Implements the operator new, to construct a new <see cref="Vertex"/>
-    /// instance from resources in the object pool.
+    /// instance from resources in the table.
     /// </summary>
     /// <param name="">Currently not used.</param>
     /// <returns>
-    /// A new <see cref="Vertex"/> instance retrieved from the object pool.
+    /// A new <see cref="Vertex"/> instance retrieved from the table.
     /// </returns>
     void * Vertex::operator new(size_t)
     {
-        return dynMemPool->GetFreeBlock();
+        return table->Allocate();
     }
 
     /// <summary>
     /// Implements the operator delete, to destroy a <see cref="Vertex"/>
-    /// instance returning itself to the object pool.
+    /// instance returning itself to the table.
     /// </summary>
     /// <param name="ptr">The address of the object to delete.</param>
     void Vertex::operator delete(void *ptr)
     {
-        dynMemPool->ReturnBlock(ptr);
+        table->Free(ptr);
     }
 
     /// <summary>
@@ -49,9 +49,15 @@ namespace memory
     /// </param>
     Vertex::Vertex(void *memAddr, size_t blockSize, FreeMemProc freeMemCallback) :
         MemAddrContainer(memAddr),
-        m_freeMemCallback(freeMemCallback),
+        m_handle(table->GetHandle(this)),
         m_blockSize(blockSize), 
-        m_outEdgeCount(0)
+        m_outEdgeCount(0),
+        m_epoch(0),
+        m_reachability(Reachability::Unknown),
+        m_isCandidate(false),
+        m_pendingChanges(0),
+        m_weakRefState(WeakRefState::None),
+        m_freeMemCallbackIndex(table->GetFreeMemCallbackIndex(freeMemCallback))
     {
         _ASSERTE(!GetMemoryAddress().GetBit0()); // regular vertices must have bit 0 unset
     }
@@ -107,38 +113,32 @@ namespace memory
     }
 
     /// <summary>
-    /// Marks or unmarks this vertex.
+    /// Frees the resources allocated to
+    /// the object represented by this vertex.
     /// </summary>
-    /// <param name="on">
-    /// if set to <c>true</c>, marks the instance, otherwise, unmark it.
+    /// <param name="destroy">
+    /// If set to <c>true</c>, invokes the object destructor.
     /// </param>
-    void Vertex::Mark(bool on)
-    {
-        /* In order to save memory, use the vacant bits
-        in the held memory address for marking */
-        GetMemoryAddress().SetBit0(on);
-    }
-
-    /// <summary>
-    /// Determines whether this vertex is marked.
-    /// </summary>
-    /// <returns><c>true</c> whether marked, otherwise, <c>false</c>.</returns>
-    bool Vertex::IsMarked() const
+    void Vertex::ReleaseReprObjResources(bool destroy)
     {
-        return GetMemoryAddress().GetBit0();
+        _ASSERTE(GetMemoryAddress().Get() != nullptr); // resource already freed
+        (*GetFreeMemCallback())(GetMemoryAddress().Get(), destroy);
+        SetMemoryAddress(nullptr);
     }
 
     /// <summary>
-    /// Frees the resources allocated to
-    /// the object represented by this vertex.
+    /// Hands the resources allocated to the object represented by this vertex
+    /// over to the finalizer threads, which free them. As far as this vertex is
+    /// concerned, the resources are released.
     /// </summary>
+    /// <param name="finalizers">The pool of finalizer threads.</param>
     /// <param name="destroy">
-    /// If set to <c>true</c>, invokes the object destructor.
+    /// If set to <c>true</c>, the object destructor is to be invoked.
     /// </param>
-    void Vertex::ReleaseReprObjResources(bool destroy)
+    void Vertex::HandOverReprObjResources(FinalizerPool &finalizers, bool destroy)
     {
         _ASSERTE(GetMemoryAddress().Get() != nullptr); // resource already freed
-        (*m_freeMemCallback)(GetMemoryAddress().Get(), destroy);
+        finalizers.Add(GetMemoryAddress().Get(), GetFreeMemCallback(), destroy);
         SetMemoryAddress(nullptr);
     }
 
@@ -4,7 +4,8 @@
 #include <3fd/core/gc_common.h>
 #include <3fd/core/gc_memaddress.h>
 #include <3fd/core/gc_arrayofedges.h>
-#include <3fd/utils/memory.h>
+#include <3fd/core/gc_vertextable.h>
+#include <3fd/core/gc_finalizerpool.h>
 
 #include <cstdint>
 #include <cstdlib>
@@ -48,18 +49,55 @@ namespace memory
     /// </summary>
     class Vertex : public MemAddrContainer
     {
+    public:
+
+        /// <summary>
+        /// Enumerates the outcomes of reachability analysis
+        /// that can be memoized in a vertex.
+        /// </summary>
+        enum class Reachability : uint8_t { Unknown, Reachable, Unreachable };
+
+        /// <summary>
+        /// Enumerates the changes made to a vertex by the shards of the
+        /// graph, which await to be settled after a batch of messages.
+        /// </summary>
+        enum PendingChange : uint8_t
+        {
+            LostIncomingEdge = 1,
+            LostOutgoingEdge = 2,
+            AbortedObject = 4
+        };
+
+        /// <summary>
+        /// Enumerates whether a vertex is referenced by <see cref="weak_sptr"/>
+        /// objects, and whether any of them is locked, which holds the vertex
+        /// just like a root, until the GC gets the message for the lock.
+        /// </summary>
+        enum class WeakRefState : uint8_t { None, Referenced, Locked };
+
     private:
 
         ArrayOfEdges m_incomingEdges;
-        FreeMemProc  m_freeMemCallback;
+        uint32_t     m_handle;
         uint32_t     m_blockSize;
         uint32_t     m_outEdgeCount;
+        uint32_t     m_epoch;
+        Reachability m_reachability;
+        bool         m_isCandidate;
+        uint8_t      m_pendingChanges;
+        WeakRefState m_weakRefState;
+        uint16_t     m_freeMemCallbackIndex;
 
-        static utils::DynamicMemPool *dynMemPool;
+        static VertexTable *table;
 
     public:
 
-        static void SetMemoryPool(utils::DynamicMemPool &ob);
+        static void SetTable(VertexTable &ob);
+
+        /// <summary>
+        /// Gets the vertex identified by a handle in the table.
+        /// </summary>
+        static Vertex *FromHandle(uint32_t handle) { return table->Get(handle); }
 
         void *operator new(size_t);
 
@@ -77,6 +115,28 @@ namespace memory
 
         void DecrementOutgoingEdgeCount();
 
+        /// <summary>
+        /// Gets the count of outgoing edges.
+        /// </summary>
+        uint32_t GetOutgoingEdgeCount() const { return m_outEdgeCount; }
+
+        /// <summary>
+        /// Gets the handle of this vertex in the table, which is <see cref="VertexTable::invalidHandle"/>
+        /// when the vertex has not been allocated from it.
+        /// </summary>
+        uint32_t GetHandle() const { return m_handle; }
+
+        /// <summary>
+        /// Gets the size of the represented memory block.
+        /// </summary>
+        uint32_t GetBlockSize() const { return m_blockSize; }
+
+        /// <summary>
+        /// Gets the callback that frees the represented memory block,
+        /// which is specific to the type of the object in it.
+        /// </summary>
+        FreeMemProc GetFreeMemCallback() const { return table->GetFreeMemCallback(m_freeMemCallbackIndex); }
+
         /// <summary>
         /// Adds an incoming edge from a root vertex.
         /// </summary>
@@ -102,8 +162,7 @@ namespace memory
         void RemoveEdgeFrom(Vertex *vtxRegular) { m_incomingEdges.RemoveEdge(vtxRegular); }
 
         /// <summary>
-        /// Iterates over each receiving edge from regular vertices in this array.
-        /// This can only be used when this array has no edges with root vertices.
+        /// Iterates over each receiving edge from regular vertices.
         /// </summary>
         /// <param name="callback">
         /// The callback to invoke for each vertex with an edge in this array.
@@ -113,7 +172,7 @@ namespace memory
         {
             m_incomingEdges.ForEachRegular(callback);
         }
-            
+
         /// <summary>
         /// Determines whether this vertex has any edge
         /// coming from a root vertex.
@@ -123,15 +182,92 @@ namespace memory
         /// one root vertex, otherwise, <c>false</c>.
         /// </returns>
         bool HasRootEdges() const { return m_incomingEdges.HasRootEdges(); }
+
+        /// <summary>
+        /// Determines whether this vertex is held by a root, which is either
+        /// an edge from a root vertex, or a locked weak reference.
+        /// </summary>
+        bool IsHeldByRoot() const { return HasRootEdges() || m_weakRefState == WeakRefState::Locked; }
             
+        /// <summary>
+        /// Determines whether this vertex receives any edge.
+        /// </summary>
+        bool HasIncomingEdges() const { return m_incomingEdges.Size() > 0; }
+
         bool HasAnyEdges() const;
 
-        void Mark(bool on);
+        /// <summary>
+        /// Gets the epoch of the last reachability search that visited this vertex.
+        /// </summary>
+        uint32_t GetEpoch() const { return m_epoch; }
+
+        /// <summary>
+        /// Sets the epoch of the reachability search visiting this vertex.
+        /// </summary>
+        void SetEpoch(uint32_t epoch) { m_epoch = epoch; }
+
+        /// <summary>
+        /// Gets the reachability memoized by the search of the current epoch.
+        /// </summary>
+        Reachability GetReachability() const { return m_reachability; }
+
+        /// <summary>
+        /// Memoizes the reachability determined by the search of the current epoch.
+        /// </summary>
+        void SetReachability(Reachability reachability) { m_reachability = reachability; }
 
-        bool IsMarked() const;
+        /// <summary>
+        /// Determines whether this vertex awaits reachability analysis in the list of candidates.
+        /// While it does, it cannot be returned to the object pool.
+        /// </summary>
+        bool IsCandidate() const { return m_isCandidate; }
+
+        /// <summary>
+        /// Sets whether this vertex awaits reachability analysis in the list of candidates.
+        /// </summary>
+        void SetCandidate(bool on) { m_isCandidate = on; }
+
+        /// <summary>
+        /// Records changes that await to be settled.
+        /// </summary>
+        /// <param name="changes">The changes, as a combination of <see cref="PendingChange"/> flags.</param>
+        /// <returns>Whether no change was pending before.</returns>
+        bool AddPendingChanges(uint8_t changes)
+        {
+            bool wasSettled = (m_pendingChanges == 0);
+            m_pendingChanges |= changes;
+            return wasSettled;
+        }
+
+        /// <summary>
+        /// Gets the changes that await to be settled, which are then cleared.
+        /// </summary>
+        uint8_t TakePendingChanges()
+        {
+            auto changes = m_pendingChanges;
+            m_pendingChanges = 0;
+            return changes;
+        }
+
+        /// <summary>
+        /// Determines whether this vertex is referenced by <see cref="weak_sptr"/> objects.
+        /// </summary>
+        bool HasWeakReferences() const { return m_weakRefState != WeakRefState::None; }
+
+        /// <summary>
+        /// Determines whether a weak reference to this vertex has been found locked.
+        /// </summary>
+        bool IsLockedByWeakReference() const { return m_weakRefState == WeakRefState::Locked; }
+
+        /// <summary>
+        /// Sets whether this vertex is referenced by <see cref="weak_sptr"/> objects.
+        /// </summary>
+        void SetWeakRefState(WeakRefState state) { m_weakRefState = state; }
 
         void ReleaseReprObjResources(bool destroy);
 
+        void HandOverReprObjResources(FinalizerPool &finalizers, bool destroy);
+
         bool AreReprObjResourcesReleased() const;
     };
 
@@ -1,32 +1,90 @@
 #include "pch.h"
 #include "gc_vertexstore.h"
 #include "configuration.h"
+#include "exceptions.h"
+
+#include <sstream>
 
 namespace _3fd
 {
 namespace memory
 {
     using core::AppConfig;
+    using core::AppException;
+
+    /// <summary>
+    /// Gets from configuration the high-water mark for shrinking the pool of vertices.
+    /// </summary>
+    /// <returns>The validated setting.</returns>
+    static float GetPoolHighWaterMark()
+    {
+        auto highWaterMark = AppConfig::GetSettings().framework.gc.memBlocksMemPool.highWaterMark;
+
+        if (!(highWaterMark > 0.0F && highWaterMark <= 1.0F))
+        {
+            std::ostringstream oss;
+            oss << "memoryBlocksPoolHighWaterMark = " << highWaterMark << " (must be in range (0, 1])";
+            throw AppException<std::invalid_argument>("Invalid setting for garbage collector", oss.str());
+        }
+
+        return highWaterMark;
+    }
 
     /// <summary>
     /// Initializes a new instance of the <see cref="VertexStore"/> class.
     /// </summary>
     VertexStore::VertexStore() :
-        m_memBlocksPool(
-            AppConfig::GetSettings().framework.gc.memBlocksMemPool.initialSize,
-            sizeof(Vertex),
-            AppConfig::GetSettings().framework.gc.memBlocksMemPool.growingFactor
-        )
+        m_vertexTable(
+            static_cast<uint32_t> (AppConfig::GetSettings().framework.gc.memBlocksMemPool.initialSize
+                                   * AppConfig::GetSettings().framework.gc.memBlocksMemPool.growingFactor),
+            sizeof(Vertex)
+        ),
+        m_heap(GCHeap::GetInstance()),
+        m_verticesCount(0),
+        m_managedBytes(0),
+        m_freedBytes(0),
+        m_poolShrinkInterval(AppConfig::GetSettings().framework.gc.memBlocksMemPool.shrinkIntervalMillisecs),
+        m_poolLowWaterMark(AppConfig::GetSettings().framework.gc.memBlocksMemPool.lowWaterMark),
+        m_poolHighWaterMark(GetPoolHighWaterMark()),
+        m_lastPoolShrinkTime(std::chrono::steady_clock::now()),
+        m_poolReleasedBytes(0)
     {
-        Vertex::SetMemoryPool(m_memBlocksPool);
+        Vertex::SetTable(m_vertexTable);
     }
 
     /// <summary>
-    /// Shrinks the pool of <see cref="Vertex"/> objects.
+    /// Finalizes an instance of the <see cref="VertexStore"/> class.
     /// </summary>
-    void VertexStore::ShrinkPool()
+    VertexStore::~VertexStore()
     {
-        m_memBlocksPool.Shrink();
+        // the vertices are gone with the table, but the heap outlives this store:
+        m_heap.ClearTags();
+    }
+
+    /// <summary>
+    /// Shrinks the table of <see cref="Vertex"/> objects, handing idle memory back to the
+    /// system. Unless forced, that is only done once the vertices in use have dropped below
+    /// the low-water mark, as a fraction of the peak since the last time, which is a cheap
+    /// check, and when enough time has elapsed since then. The table then keeps room for
+    /// the vertices in use to fill it up to the high-water mark, so it does not have to grow
+    /// right back, whereas a forced shrink keeps no room at all.
+    /// </summary>
+    /// <param name="forced">Whether to shrink the pool regardless of usage and time.</param>
+    void VertexStore::ShrinkPool(bool forced)
+    {
+        auto now = std::chrono::steady_clock::now();
+        auto inUse = static_cast<float> (m_vertexTable.GetNumUsedBlocks());
+
+        if (!forced
+            && (inUse > m_poolLowWaterMark * m_vertexTable.GetPeakNumUsedBlocks()
+                || now - m_lastPoolShrinkTime < m_poolShrinkInterval))
+        {
+            return;
+        }
+
+        auto minNumBlocks = forced ? 0 : static_cast<size_t> (inUse / m_poolHighWaterMark);
+        m_poolReleasedBytes += m_vertexTable.Shrink(minNumBlocks);
+        m_lastPoolShrinkTime = now;
     }
 
     /// <summary>
@@ -36,13 +94,7 @@ namespace memory
     /// <returns>The vertex representing the given memory address.</returns>
     Vertex * VertexStore::GetVertex(void *memAddr) const
     {
-        MemAddrContainer key(memAddr);
-        auto iter = m_vertices.find(&key);
-
-        if (m_vertices.end() != iter)
-            return static_cast<Vertex *> (*iter);
-        else
-            return nullptr;
+        return static_cast<Vertex *> (m_heap.GetTag(memAddr));
     }
 
     /// <summary>
@@ -55,29 +107,7 @@ namespace memory
     /// </returns>
     Vertex * VertexStore::GetContainerVertex(void *addr) const
     {
-        if (!m_vertices.empty())
-        {
-            MemAddrContainer key(addr);
-            auto iter = m_vertices.lower_bound(&key);
-
-            if (m_vertices.end() != iter)
-            {
-                auto memBlock = static_cast<Vertex *> (*iter);
-                if (memBlock->Contains(addr))
-                    return memBlock;
-
-                if (m_vertices.begin() != iter)
-                    --iter;
-            }
-            else
-                --iter;
-
-            auto memBlock = static_cast<Vertex *> (*iter);
-            if (memBlock->Contains(addr))
-                return memBlock;
-        }
-
-        return nullptr;
+        return static_cast<Vertex *> (m_heap.GetContainerTag(addr));
     }
 
     /// <summary>
@@ -88,9 +118,12 @@ namespace memory
     /// <param name="freeMemCallback">The callback that frees the memory block.</param>
     void VertexStore::AddVertex(void *memAddr, size_t blockSize, FreeMemProc freeMemCallback)
     {
-        auto memBlock = new Vertex(memAddr, blockSize, freeMemCallback);
-        auto insertSucceded = m_vertices.insert(memBlock).second;
-        _ASSERTE(insertSucceded); // insertion should always succeed because a vertex cannot be added twice
+        // a vertex cannot be added twice:
+        _ASSERTE(m_heap.GetTag(memAddr) == nullptr);
+        m_heap.SetTag(memAddr, new Vertex(memAddr, blockSize, freeMemCallback));
+
+        ++m_verticesCount;
+        m_managedBytes += blockSize;
     }
 
     /// <summary>
@@ -101,9 +134,25 @@ namespace memory
     /// </param>
     void VertexStore::RemoveVertex(Vertex *memBlock)
     {
-        auto iter = m_vertices.find(memBlock);
-        _ASSERTE(m_vertices.end() != iter); // cannot handle removal of unexistent vertex
-        m_vertices.erase(iter);
+        // cannot handle removal of unexistent vertex
+        _ASSERTE(m_heap.GetTag(memBlock->GetMemoryAddress().Get()) == memBlock);
+        m_heap.SetTag(memBlock->GetMemoryAddress().Get(), nullptr);
+
+        --m_verticesCount;
+        m_managedBytes -= memBlock->GetBlockSize();
+        m_freedBytes += memBlock->GetBlockSize();
+    }
+
+    /// <summary>
+    /// Iterates over each vertex in the store.
+    /// </summary>
+    /// <param name="callback">The callback to invoke for each vertex.</param>
+    void VertexStore::ForEach(const std::function<void(Vertex *)> &callback) const
+    {
+        m_heap.ForEachTag([&callback](void *tag)
+        {
+            callback(static_cast<Vertex *> (tag));
+        });
     }
 
 }// end of namespace memory
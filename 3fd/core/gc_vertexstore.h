@@ -3,34 +3,45 @@
 
 #include <3fd/core/gc_common.h>
 #include <3fd/core/gc_vertex.h>
-#include <3fd/utils/memory.h>
-#include <btree/stx/btree_set.h>
+#include <3fd/core/gc_heap.h>
+#include <3fd/core/gc_vertextable.h>
+
+#include <chrono>
+#include <functional>
 
 namespace _3fd
 {
 namespace memory
 {
     /// <summary>
-    /// Represents a store of vertices allocated from a pool.
-    /// The vertices represent memory blocks.
+    /// Represents a store of vertices allocated from a table.
+    /// The vertices represent memory blocks from the GC heap.
     /// </summary>
+    /// <remarks>
+    /// Each vertex is kept as the tag of the block it represents in the GC heap,
+    /// so retrieving the vertex that represents or contains an address takes
+    /// constant time, unlike a search in a sorted set.
+    /// </remarks>
     class VertexStore
     {
     private:
 
-        utils::DynamicMemPool m_memBlocksPool;
+        VertexTable m_vertexTable;
 
-        // Compared to a binary tree, a B+Tree can render better cache efficiency
-        typedef stx::btree_set<MemAddrContainer *, LessOperOnVertexRepAddr> SetOfMemBlocks;
+        GCHeap &m_heap;
 
-        /// <summary>
-        /// A sorted set of garbage collected pieces of memory,
-        /// ordered by the memory addresses of those pieces.
-        /// </summary>
-        /// <remarks>
-        /// Although a hash table could be faster, it is not sorted, hence cannot be used.
-        /// </remarks>
-        SetOfMemBlocks m_vertices;
+        size_t m_verticesCount;
+
+        uint64_t m_managedBytes;
+
+        uint64_t m_freedBytes;
+
+        // Shrinking of the pool, when the vertices in use drop well below the peak:
+        std::chrono::milliseconds m_poolShrinkInterval;
+        float m_poolLowWaterMark;
+        float m_poolHighWaterMark;
+        std::chrono::steady_clock::time_point m_lastPoolShrinkTime;
+        uint64_t m_poolReleasedBytes;
 
     public:
 
@@ -38,7 +49,9 @@ namespace memory
 
 		VertexStore(const VertexStore &) = delete;
 
-        void ShrinkPool();
+        ~VertexStore();
+
+        void ShrinkPool(bool forced);
 
         void AddVertex(void *memAddr, size_t blockSize, FreeMemProc freeMemCallback);
 
@@ -47,6 +60,28 @@ namespace memory
         Vertex *GetVertex(void *memAddr) const;
 
         Vertex *GetContainerVertex(void *addr) const;
+
+        void ForEach(const std::function<void(Vertex *)> &callback) const;
+
+        /// <summary>
+        /// Gets how many vertices are in the store.
+        /// </summary>
+        size_t GetVerticesCount() const { return m_verticesCount; }
+
+        /// <summary>
+        /// Gets the total size of the memory blocks represented by the vertices in the store.
+        /// </summary>
+        uint64_t GetManagedBytes() const { return m_managedBytes; }
+
+        /// <summary>
+        /// Gets the total size of the memory blocks whose vertices have been removed so far.
+        /// </summary>
+        uint64_t GetFreedBytes() const { return m_freedBytes; }
+
+        /// <summary>
+        /// Gets the total size of the memory of the pool handed back to the system so far.
+        /// </summary>
+        uint64_t GetPoolReleasedBytes() const { return m_poolReleasedBytes; }
     };
 
 }// end of namespace memory
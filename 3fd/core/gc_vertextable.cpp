@@ -0,0 +1,249 @@
+#include "pch.h"
+#include "gc_vertextable.h"
+#include "exceptions.h"
+
+#include <limits>
+#include <sstream>
+
+namespace _3fd
+{
+namespace memory
+{
+    using core::AppException;
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="VertexTable"/> class.
+    /// </summary>
+    /// <param name="chunkSize">
+    /// How many vertices a chunk of the table should fit, which is rounded up to a power
+    /// of 2, and kept within the limits of <see cref="utils::MemoryPool"/>.
+    /// </param>
+    /// <param name="vertexSize">The size of a vertex.</param>
+    VertexTable::VertexTable(uint32_t chunkSize, uint16_t vertexSize) :
+        m_vertexSize(vertexSize),
+        m_chunkSizeInBits(4),
+        m_numBlocks(0),
+        m_numUsedBlocks(0),
+        m_peakNumUsedBlocks(0),
+        m_freeMemCallbacks(1, nullptr),
+        m_lastFreeMemCallback(nullptr),
+        m_lastFreeMemCallbackIndex(0)
+    {
+        _ASSERTE(vertexSize > 0);
+
+        while (m_chunkSizeInBits < 15 && (1U << m_chunkSizeInBits) < chunkSize)
+            ++m_chunkSizeInBits;
+
+        m_freeMemCallbackIndexes[nullptr] = 0;
+    }
+
+    /// <summary>
+    /// Finds the chunk containing a vertex.
+    /// </summary>
+    /// <param name="addr">The address of the vertex.</param>
+    /// <returns>
+    /// The index of the chunk containing the vertex, if any,
+    /// otherwise, <see cref="invalidHandle"/>.
+    /// </returns>
+    uint32_t VertexTable::FindChunk(const void *addr) const
+    {
+        auto iter = m_chunksByAddress.upper_bound(static_cast<const char *> (addr));
+
+        if (iter == m_chunksByAddress.begin())
+            return invalidHandle;
+
+        --iter;
+        if (m_chunks[iter->second]->Contains(const_cast<void *> (addr)))
+            return iter->second;
+
+        return invalidHandle;
+    }
+
+    /// <summary>
+    /// Creates a chunk, reusing the lowest index of those that have been released.
+    /// </summary>
+    /// <returns>The index of the new chunk.</returns>
+    uint32_t VertexTable::CreateChunk()
+    {
+        uint32_t idx;
+
+        if (!m_releasedChunks.empty())
+            idx = *m_releasedChunks.begin();
+        else
+        {
+            // the last chunk is never used, so no vertex gets the invalid handle:
+            const uint32_t maxNumChunks = (invalidHandle >> m_chunkSizeInBits);
+
+            if (m_chunks.size() == maxNumChunks)
+            {
+                std::ostringstream oss;
+                oss << "The table cannot have more than " << maxNumChunks * GetChunkSize() << " vertices";
+                throw AppException<std::length_error>("Failed to allocate vertex for GC", oss.str());
+            }
+
+            idx = static_cast<uint32_t> (m_chunks.size());
+            m_chunks.emplace_back();
+            m_chunkBases.push_back(nullptr);
+        }
+
+        std::unique_ptr<utils::MemoryPool> chunk(
+            new utils::MemoryPool(static_cast<uint16_t> (GetChunkSize()), m_vertexSize)
+        );
+
+        auto base = static_cast<char *> (chunk->GetBaseAddress());
+        m_chunksByAddress[base] = idx;
+        m_availableChunks.insert(idx);
+        m_releasedChunks.erase(idx);
+        m_chunkBases[idx] = base;
+        m_chunks[idx] = std::move(chunk);
+        m_numBlocks += GetChunkSize();
+        return idx;
+    }
+
+    /// <summary>
+    /// Allocates the memory for a vertex, from the lowest chunk with room.
+    /// </summary>
+    /// <returns>The address of the memory.</returns>
+    void *VertexTable::Allocate()
+    {
+        auto idx = m_availableChunks.empty() ? CreateChunk() : *m_availableChunks.begin();
+
+        auto &chunk = *m_chunks[idx];
+        auto addr = chunk.GetFreeBlock();
+        _ASSERTE(addr != nullptr); // chunks without room must have left the set
+
+        if (chunk.IsEmpty())
+            m_availableChunks.erase(idx);
+
+        if (++m_numUsedBlocks > m_peakNumUsedBlocks)
+            m_peakNumUsedBlocks = m_numUsedBlocks;
+
+        return addr;
+    }
+
+    /// <summary>
+    /// Frees the memory of a vertex.
+    /// </summary>
+    /// <param name="addr">The address of the vertex.</param>
+    void VertexTable::Free(void *addr)
+    {
+        auto idx = FindChunk(addr);
+        _ASSERTE(idx != invalidHandle); // cannot free a vertex which does not belong to the table
+
+        auto &chunk = *m_chunks[idx];
+
+        // if the chunk had no room, now it has:
+        if (chunk.IsEmpty())
+            m_availableChunks.insert(idx);
+
+        chunk.ReturnBlock(addr);
+        --m_numUsedBlocks;
+    }
+
+    /// <summary>
+    /// Gets the handle of a vertex.
+    /// </summary>
+    /// <param name="addr">The address of the vertex.</param>
+    /// <returns>
+    /// The handle of the vertex, if its memory has been provided
+    /// by this table, otherwise, <see cref="invalidHandle"/>.
+    /// </returns>
+    uint32_t VertexTable::GetHandle(const void *addr) const
+    {
+        auto idx = FindChunk(addr);
+
+        if (idx == invalidHandle)
+            return invalidHandle;
+
+        auto position = static_cast<uint32_t> (
+            (static_cast<const char *> (addr) - m_chunkBases[idx]) / m_vertexSize
+        );
+
+        return (idx << m_chunkSizeInBits) | position;
+    }
+
+    /// <summary>
+    /// Shrinks the table, destroying the chunks with no vertex in use, and handing back to
+    /// the system the pages of the remaining ones that have no vertex in use either.
+    /// </summary>
+    /// <param name="minNumBlocks">
+    /// How many vertices the table must still fit, so that empty chunks are kept, the
+    /// lowest ones, as room for growth instead of being created again right away.
+    /// </param>
+    /// <returns>The size of the memory handed back to the system.</returns>
+    size_t VertexTable::Shrink(size_t minNumBlocks)
+    {
+        size_t releasedSize(0);
+
+        const auto chunkSize = GetChunkSize();
+        auto numSpareChunks = (m_numBlocks > minNumBlocks) ? (m_numBlocks - minNumBlocks) / chunkSize : 0;
+
+        // go from the highest chunk down, because vertices are taken from the lowest:
+        auto iter = m_availableChunks.end();
+        while (iter != m_availableChunks.begin())
+        {
+            --iter;
+            auto idx = *iter;
+            auto &chunk = m_chunks[idx];
+
+            /* Discarding the pages of a chunk about to be destroyed makes sure the
+            memory is gone, even if the allocator keeps it for later use: */
+            releasedSize += chunk->ReleaseIdlePages();
+
+            if (chunk->IsFull() && numSpareChunks > 0)
+            {
+                --numSpareChunks;
+                iter = m_availableChunks.erase(iter);
+                m_numBlocks -= chunk->GetNumBlocks();
+                m_chunksByAddress.erase(m_chunkBases[idx]);
+                m_chunkBases[idx] = nullptr;
+                chunk.reset();
+                m_releasedChunks.insert(idx);
+            }
+        }
+
+        // the released chunks at the end of the table are no longer needed to keep the handles:
+        while (!m_chunks.empty() && !m_chunks.back())
+        {
+            m_releasedChunks.erase(static_cast<uint32_t> (m_chunks.size() - 1));
+            m_chunks.pop_back();
+            m_chunkBases.pop_back();
+        }
+
+        m_peakNumUsedBlocks = m_numUsedBlocks;
+        return releasedSize;
+    }
+
+    /// <summary>
+    /// Gets the index of a callback that frees memory blocks, which is registered
+    /// in the table the first time. The index of no callback is zero.
+    /// </summary>
+    /// <param name="freeMemCallback">The callback that frees memory blocks of some type.</param>
+    /// <returns>The index of the callback in this table.</returns>
+    uint16_t VertexTable::GetFreeMemCallbackIndex(FreeMemProc freeMemCallback)
+    {
+        if (freeMemCallback == m_lastFreeMemCallback)
+            return m_lastFreeMemCallbackIndex;
+
+        auto iter = m_freeMemCallbackIndexes.find(freeMemCallback);
+
+        if (iter == m_freeMemCallbackIndexes.end())
+        {
+            if (m_freeMemCallbacks.size() > std::numeric_limits<uint16_t>::max())
+            {
+                throw AppException<std::length_error>(
+                    "Failed to register type of object for GC: there are too many types");
+            }
+
+            auto index = static_cast<uint16_t> (m_freeMemCallbacks.size());
+            m_freeMemCallbacks.push_back(freeMemCallback);
+            iter = m_freeMemCallbackIndexes.emplace(freeMemCallback, index).first;
+        }
+
+        m_lastFreeMemCallback = freeMemCallback;
+        m_lastFreeMemCallbackIndex = iter->second;
+        return iter->second;
+    }
+
+}// end of namespace memory
+}// end of namespace _3fd
@@ -0,0 +1,143 @@
+#ifndef GC_VERTEXTABLE_H // header guard
+#define GC_VERTEXTABLE_H
+
+#include <3fd/core/gc_common.h>
+#include <3fd/utils/memory.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace _3fd
+{
+namespace memory
+{
+    class Vertex;
+
+    /// <summary>
+    /// A dense table providing the memory for all the <see cref="Vertex"/> objects, where each
+    /// one is identified by a 32-bit handle, which takes half the room of a pointer in the edges.
+    /// The callbacks that free the memory blocks are kept here as well, one per type of object,
+    /// so the vertices only need a 16-bit index to them.
+    /// </summary>
+    /// <remarks>
+    /// The table is made of chunks of a fixed amount of vertices, which is a power of 2, so the
+    /// handle is the index of the chunk followed by the position in the chunk, and finding the
+    /// vertex takes a shift and a mask. Vertices are taken from the lowest chunk with room, which
+    /// keeps those in use packed, so that shrinking the table releases the chunks at the end.
+    /// This was designed for SINGLE-THREAD access, which is the GC thread.
+    /// </remarks>
+    class VertexTable
+    {
+    public:
+
+        /// <summary>
+        /// The handle of no vertex, such as one not provided by a table.
+        /// </summary>
+        static constexpr uint32_t invalidHandle = UINT32_MAX;
+
+    private:
+
+        const uint16_t m_vertexSize;
+        uint32_t m_chunkSizeInBits;
+
+        std::vector<std::unique_ptr<utils::MemoryPool>> m_chunks;
+
+        /// <summary>
+        /// The base addresses of the chunks, kept apart for fast retrieval of vertices.
+        /// A chunk that has been released has a null address, until it is created again.
+        /// </summary>
+        std::vector<char *> m_chunkBases;
+
+        /// <summary>
+        /// Maps the base address of each chunk to its index, to find the chunk of a vertex.
+        /// </summary>
+        std::map<const char *, uint32_t> m_chunksByAddress;
+
+        /// <summary>
+        /// The indexes of the chunks with available room, the lowest taken first.
+        /// </summary>
+        std::set<uint32_t> m_availableChunks;
+
+        /// <summary>
+        /// The indexes of the chunks that have been released.
+        /// </summary>
+        std::set<uint32_t> m_releasedChunks;
+
+        size_t m_numBlocks;
+        size_t m_numUsedBlocks;
+        size_t m_peakNumUsedBlocks;
+
+        std::vector<FreeMemProc> m_freeMemCallbacks;
+        std::unordered_map<FreeMemProc, uint16_t> m_freeMemCallbackIndexes;
+
+        // The last callback looked up, because objects of the same type tend to come in a row:
+        FreeMemProc m_lastFreeMemCallback;
+        uint16_t m_lastFreeMemCallbackIndex;
+
+        uint32_t FindChunk(const void *addr) const;
+
+        uint32_t CreateChunk();
+
+    public:
+
+        VertexTable(uint32_t chunkSize, uint16_t vertexSize);
+
+        VertexTable(const VertexTable &) = delete;
+
+        void *Allocate();
+
+        void Free(void *addr);
+
+        uint32_t GetHandle(const void *addr) const;
+
+        size_t Shrink(size_t minNumBlocks = 0);
+
+        /// <summary>
+        /// Gets the vertex identified by a handle.
+        /// </summary>
+        /// <param name="handle">The handle of the vertex.</param>
+        /// <returns>The vertex.</returns>
+        Vertex *Get(uint32_t handle) const
+        {
+            auto chunkBase = m_chunkBases[handle >> m_chunkSizeInBits];
+            auto offset = (handle & ((1U << m_chunkSizeInBits) - 1)) * static_cast<size_t> (m_vertexSize);
+            return reinterpret_cast<Vertex *> (chunkBase + offset);
+        }
+
+        uint16_t GetFreeMemCallbackIndex(FreeMemProc freeMemCallback);
+
+        /// <summary>
+        /// Gets the callback that frees memory blocks with a given index, as
+        /// returned by <see cref="GetFreeMemCallbackIndex"/>.
+        /// </summary>
+        FreeMemProc GetFreeMemCallback(uint16_t index) const { return m_freeMemCallbacks[index]; }
+
+        /// <summary>
+        /// Gets how many vertices fit in a chunk.
+        /// </summary>
+        uint32_t GetChunkSize() const { return 1U << m_chunkSizeInBits; }
+
+        /// <summary>
+        /// Gets how many vertices fit in the table, whether in use or not.
+        /// </summary>
+        size_t GetNumBlocks() const { return m_numBlocks; }
+
+        /// <summary>
+        /// Gets how many vertices are in use.
+        /// </summary>
+        size_t GetNumUsedBlocks() const { return m_numUsedBlocks; }
+
+        /// <summary>
+        /// Gets the largest amount of vertices in use since the table was last shrunk.
+        /// </summary>
+        size_t GetPeakNumUsedBlocks() const { return m_peakNumUsedBlocks; }
+    };
+
+}// end of namespace memory
+}// end of namespace _3fd
+
+#endif // end of header guard
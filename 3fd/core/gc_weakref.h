@@ -0,0 +1,171 @@
+#ifndef GC_WEAKREF_H // header guard
+#define GC_WEAKREF_H
+
+#include <3fd/core/preprocessing.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace _3fd
+{
+namespace memory
+{
+    /// <summary>
+    /// The block shared by all <see cref="weak_sptr"/> objects referencing the same
+    /// garbage collected object. The GC expires it before collecting the object, but
+    /// not while a weak pointer is locked, which is until the GC gets the message
+    /// registering the <see cref="sptr"/> object that came out of the lock.
+    /// </summary>
+    class WeakRefBlock
+    {
+    private:
+
+        /// <summary>
+        /// Set in the state once the block has expired. The remaining
+        /// bits count the locks the GC is yet to be informed about.
+        /// </summary>
+        static const uint32_t expiredFlag = 0x80000000;
+
+        /// <summary>
+        /// Set in the state while the GC decides whether to expire the block
+        /// along with others, which lock attempts must wait for.
+        /// </summary>
+        static const uint32_t expiringFlag = 0x40000000;
+
+        std::atomic<uint32_t> m_state;
+        std::atomic<uint32_t> m_refCount;
+
+        void *m_memBlockAddr;
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the <see cref="WeakRefBlock"/> class,
+        /// with a reference for the GC and another for the requester.
+        /// </summary>
+        /// <param name="memBlockAddr">The address of the memory block of the object.</param>
+        explicit WeakRefBlock(void *memBlockAddr) :
+            m_state(0),
+            m_refCount(2),
+            m_memBlockAddr(memBlockAddr)
+        {}
+
+        WeakRefBlock(const WeakRefBlock &) = delete;
+
+        /// <summary>
+        /// Gets the address of the memory block of the object.
+        /// </summary>
+        void *GetMemBlockAddress() const { return m_memBlockAddr; }
+
+        /// <summary>
+        /// Adds a reference to this block.
+        /// </summary>
+        void AddRef()
+        {
+            m_refCount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /// <summary>
+        /// Removes a reference to this block, which is deleted along with the last one.
+        /// </summary>
+        void Release()
+        {
+            if (m_refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                delete this;
+        }
+
+        /// <summary>
+        /// Determines whether this block has expired, hence cannot be locked anymore.
+        /// </summary>
+        bool IsExpired() const
+        {
+            return (m_state.load(std::memory_order_acquire) & expiredFlag) != 0;
+        }
+
+        /// <summary>
+        /// Locks this block, so the GC does not collect the object,
+        /// unless the block has already expired. Should the GC be
+        /// deciding on it, this waits for the decision, which takes
+        /// no longer than going through the blocks of a collection.
+        /// </summary>
+        /// <returns>Whether the block has been locked.</returns>
+        bool TryLock()
+        {
+            auto state = m_state.load(std::memory_order_relaxed);
+            do
+            {
+                if ((state & expiredFlag) != 0)
+                    return false;
+
+                if ((state & expiringFlag) != 0)
+                {
+                    std::this_thread::yield();
+                    state = m_state.load(std::memory_order_relaxed);
+                    continue;
+                }
+
+                if (m_state.compare_exchange_weak(state, state + 1,
+                                                  std::memory_order_acquire,
+                                                  std::memory_order_relaxed))
+                {
+                    return true;
+                }
+            }
+            while (true);
+        }
+
+        /// <summary>
+        /// Undoes a lock, once the GC has been informed about it.
+        /// </summary>
+        /// <returns>How many locks remain.</returns>
+        uint32_t Unlock()
+        {
+            return m_state.fetch_sub(1, std::memory_order_release) - 1;
+        }
+
+        /// <summary>
+        /// Expires this block, unless it is locked.
+        /// </summary>
+        /// <returns>Whether the block has been expired.</returns>
+        bool TryExpire()
+        {
+            uint32_t unlocked(0);
+            return m_state.compare_exchange_strong(unlocked, expiredFlag, std::memory_order_acq_rel);
+        }
+
+        /// <summary>
+        /// Prepares to expire this block along with others, unless it is locked.
+        /// Until <see cref="EndExpire"/> or <see cref="CancelExpire"/>, the block
+        /// can neither be locked, nor is it expired.
+        /// </summary>
+        /// <returns>Whether the block is ready to expire.</returns>
+        bool TryBeginExpire()
+        {
+            uint32_t unlocked(0);
+            return m_state.compare_exchange_strong(unlocked, expiringFlag, std::memory_order_acq_rel);
+        }
+
+        /// <summary>
+        /// Expires this block, once prepared by <see cref="TryBeginExpire"/>.
+        /// </summary>
+        void EndExpire()
+        {
+            _ASSERTE(m_state.load(std::memory_order_relaxed) == expiringFlag);
+            m_state.store(expiredFlag, std::memory_order_release);
+        }
+
+        /// <summary>
+        /// Undoes the preparation made by <see cref="TryBeginExpire"/>.
+        /// </summary>
+        void CancelExpire()
+        {
+            _ASSERTE(m_state.load(std::memory_order_relaxed) == expiringFlag);
+            m_state.store(0, std::memory_order_release);
+        }
+    };
+
+}// end of namespace memory
+}// end of namespace _3fd
+
+#endif // end of header guard
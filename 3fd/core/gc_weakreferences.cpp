@@ -0,0 +1,133 @@
+#include "pch.h"
+#include "gc_weakreferences.h"
+
+namespace _3fd
+{
+namespace memory
+{
+    /// <summary>
+    /// Finalizes an instance of the <see cref="WeakReferences"/> class.
+    /// The blocks left are expired, because their objects are no longer managed.
+    /// </summary>
+    WeakReferences::~WeakReferences()
+    {
+        for (auto &entry : m_blocks)
+        {
+            entry.second->TryExpire();
+            entry.second->Release();
+        }
+    }
+
+    /// <summary>
+    /// Gets the block of weak references to a memory block.
+    /// </summary>
+    /// <param name="memBlockAddr">The address of the memory block.</param>
+    /// <returns>The block of weak references, which must exist.</returns>
+    WeakRefBlock *WeakReferences::GetBlock(void *memBlockAddr)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto iter = m_blocks.find(memBlockAddr);
+        _ASSERTE(iter != m_blocks.end());
+        return iter->second;
+    }
+
+    /// <summary>
+    /// Acquires the block of weak references to a memory block, which is created
+    /// if not yet present. This can be invoked by any thread, as long as it holds
+    /// a <see cref="sptr"/> object referencing the memory block.
+    /// </summary>
+    /// <param name="memBlockAddr">The address of the memory block.</param>
+    /// <param name="isNew">
+    /// Set to whether the block has just been created, in which case
+    /// the GC must be informed that the memory block has weak references.
+    /// </param>
+    /// <returns>The block, with a reference added for the caller.</returns>
+    WeakRefBlock *WeakReferences::Acquire(void *memBlockAddr, bool &isNew)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto &block = m_blocks[memBlockAddr];
+        isNew = (block == nullptr);
+
+        if (isNew)
+            block = new WeakRefBlock(memBlockAddr);
+        else
+            block->AddRef();
+
+        return block;
+    }
+
+    /// <summary>
+    /// Undoes a lock of the weak references to a memory block,
+    /// once the <see cref="sptr"/> object it produced is in the graph.
+    /// </summary>
+    /// <param name="memBlock">The vertex representing the memory block.</param>
+    void WeakReferences::Unlock(Vertex *memBlock)
+    {
+        auto block = GetBlock(memBlock->GetMemoryAddress().Get());
+
+        if (block->Unlock() == 0 && memBlock->IsLockedByWeakReference())
+            memBlock->SetWeakRefState(Vertex::WeakRefState::Referenced);
+    }
+
+    /// <summary>
+    /// Expires the weak references to the given vertices altogether, or none at all.
+    /// </summary>
+    /// <param name="vertices">The vertices, which must have weak references.</param>
+    /// <param name="count">How many vertices there are.</param>
+    /// <returns>
+    /// Whether they have all expired. If not, the one locked is flagged as such.
+    /// </returns>
+    bool WeakReferences::TryExpire(Vertex *const *vertices, size_t count)
+    {
+        m_expiringBlocks.clear();
+
+        for (size_t idx = 0; idx < count; ++idx)
+        {
+            auto block = GetBlock(vertices[idx]->GetMemoryAddress().Get());
+
+            // the vertex might have been found unreachable before, but not collected yet:
+            if (block->IsExpired())
+                continue;
+
+            if (!block->TryBeginExpire())
+            {
+                for (auto expiring : m_expiringBlocks)
+                    expiring->CancelExpire();
+
+                vertices[idx]->SetWeakRefState(Vertex::WeakRefState::Locked);
+                return false;
+            }
+
+            m_expiringBlocks.push_back(block);
+        }
+
+        // none is locked, nor can be anymore, so they really expire:
+        for (auto expiring : m_expiringBlocks)
+            expiring->EndExpire();
+
+        return true;
+    }
+
+    /// <summary>
+    /// Discards the weak references to a memory block about to be collected.
+    /// </summary>
+    /// <param name="memBlock">The vertex representing the memory block.</param>
+    void WeakReferences::Discard(Vertex *memBlock)
+    {
+        WeakRefBlock *block;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto iter = m_blocks.find(memBlock->GetMemoryAddress().Get());
+            _ASSERTE(iter != m_blocks.end());
+            block = iter->second;
+            m_blocks.erase(iter);
+        }
+
+        _ASSERTE(block->IsExpired());
+        block->Release();
+        memBlock->SetWeakRefState(Vertex::WeakRefState::None);
+    }
+
+}// end of namespace memory
+}// end of namespace _3fd
@@ -0,0 +1,59 @@
+#ifndef GC_WEAKREFERENCES_H // header guard
+#define GC_WEAKREFERENCES_H
+
+#include <3fd/core/gc_vertex.h>
+#include <3fd/core/gc_weakref.h>
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace _3fd
+{
+namespace memory
+{
+    /// <summary>
+    /// Keeps the <see cref="WeakRefBlock"/> of each memory block referenced by
+    /// <see cref="weak_sptr"/> objects, so they all share the same block. Blocks
+    /// are acquired by any thread, but the remaining is done by the GC thread.
+    /// </summary>
+    /// <remarks>
+    /// A memory block must not be collected before its weak references expire. That
+    /// is done for all vertices found unreachable at once, but fails when any of them
+    /// is locked, in which case none expires and the locked vertex is flagged, so the
+    /// GC treats it as a root until it gets the message for the lock. The blocks are
+    /// only expired once all of them are known to be unlocked, and lock attempts wait
+    /// for that decision, so a failed lock always means the object is really gone.
+    /// </remarks>
+    class WeakReferences
+    {
+    private:
+
+        std::mutex m_mutex;
+        std::unordered_map<void *, WeakRefBlock *> m_blocks;
+
+        std::vector<WeakRefBlock *> m_expiringBlocks;
+
+        WeakRefBlock *GetBlock(void *memBlockAddr);
+
+    public:
+
+        WeakReferences() = default;
+
+        WeakReferences(const WeakReferences &) = delete;
+
+        ~WeakReferences();
+
+        WeakRefBlock *Acquire(void *memBlockAddr, bool &isNew);
+
+        void Unlock(Vertex *memBlock);
+
+        bool TryExpire(Vertex *const *vertices, size_t count);
+
+        void Discard(Vertex *memBlock);
+    };
+
+}// end of namespace memory
+}// end of namespace _3fd
+
+#endif // end of header guard
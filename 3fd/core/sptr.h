@@ -2,8 +2,16 @@
 #define SPTR_H
 
 #include <3fd/core/gc.h>
+#include <3fd/core/gc_arena.h>
 #include <3fd/core/gc_common.h>
+#include <3fd/core/gc_weakref.h>
+#include <3fd/core/preprocessing.h>
+#include <algorithm>
 #include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 // A macro through which the client code constructs garbage collected objects and assigns them to a safe pointer
 #define has(CTOR_CALL)    createAndAcquireGCObject<decltype(CTOR_CALL)>([&] (void *gcRegMem) { new (gcRegMem) CTOR_CALL; })
@@ -12,6 +20,55 @@ namespace _3fd
 {
 namespace memory
 {
+    template <typename Type> class sptr;
+
+    template <typename Type> class weak_sptr;
+
+    template <typename Type> class gc_vector;
+
+    template <typename ObjectType, typename... Args>
+    sptr<ObjectType> make_sptr(Args &&...args);
+
+    template <typename ObjectType, typename... Args>
+    sptr<ObjectType> make_aligned_sptr(size_t alignment, Args &&...args);
+
+    template <typename ObjectType>
+    sptr<ObjectType[]> make_sptr_array(size_t count, size_t alignment = alignof(ObjectType));
+
+    /// <summary>
+    /// Tag to select the constructors that create a new garbage collected object.
+    /// </summary>
+    struct NewObjectTag
+    {
+        /// <summary>
+        /// The alignment requested for the object, which is
+        /// made no looser than that of its type.
+        /// </summary>
+        size_t alignment;
+    };
+
+    /// <summary>
+    /// Tag to select the constructors that create a new garbage collected array.
+    /// </summary>
+    struct NewArrayTag
+    {
+        /// <summary>
+        /// The alignment requested for the elements, which is
+        /// made no looser than that of their type.
+        /// </summary>
+        size_t alignment;
+    };
+
+    /// <summary>
+    /// Tag to select the constructors that take the object of a locked <see cref="weak_sptr"/>.
+    /// </summary>
+    struct WeakLockTag {};
+
+    /// <summary>
+    /// Tag to select the constructors that take an object held by a <see cref="gc_vector"/>.
+    /// </summary>
+    struct HeldObjectTag {};
+
     /////////////////////////////////
     //  sptr_base Class Template
     /////////////////////////////////
@@ -28,11 +85,45 @@ namespace memory
         // Make all the sptr_base classes mutually trustable:
         template <typename OtherType> friend class sptr_base;
 
+        template <typename OtherType> friend class weak_sptr;
+
         /// <summary>
         /// The memory address referenced by this instance.
         /// </summary>
         Type *m_pointedAddress;
 
+        /// <summary>
+        /// Creates an object in the innermost arena of the calling thread, and makes this safe
+        /// pointer reference it, rather than sending messages to the GC.
+        /// </summary>
+        /// <param name="size">The size of the memory for the object.</param>
+        /// <param name="alignment">The alignment of the memory for the object.</param>
+        /// <param name="destroy">The callback that destroys the object.</param>
+        /// <param name="construct">Constructs the object in the given memory.</param>
+        /// <param name="offset">Where the object is in the memory, which is past the header of an array.</param>
+        /// <param name="isRegistered">
+        /// Whether this safe pointer is already registered, and so might reference something else.
+        /// </param>
+        template <typename ObjectType, typename Construct>
+        void CreateInArena(size_t size,
+                           size_t alignment,
+                           gc_arena::DestroyProc destroy,
+                           const Construct &construct,
+                           size_t offset,
+                           bool isRegistered)
+        {
+            void *memAddr = gc_arena::CreateObject<ObjectType>(size, alignment, destroy, construct);
+
+            if (isRegistered)
+                gc_arena::AcquireNewObject(this, m_pointedAddress);
+            else
+                gc_arena::RegisterSptrWithNewObject(this);
+
+            m_pointedAddress = static_cast<Type *> (
+                reinterpret_cast<ObjectType *> (static_cast<char *> (memAddr) + offset)
+            );
+        }
+
     protected:
 
         /// <summary>
@@ -51,8 +142,11 @@ namespace memory
         sptr_base() : 
             m_pointedAddress(nullptr)
         {
-            GarbageCollector::GetInstance()
-                .RegisterSptr(this, nullptr);
+            if (gc_arena::IsActive())
+                gc_arena::RegisterSptr(this);
+            else
+                GarbageCollector::GetInstance()
+                    .RegisterSptr(this, nullptr);
         }
 
         /// <summary>
@@ -63,8 +157,11 @@ namespace memory
         sptr_base(const sptr_base &ob) :
             m_pointedAddress(ob.m_pointedAddress)
         {
-            GarbageCollector::GetInstance()
-                .RegisterSptrCopy(this, const_cast<sptr_base *> (&ob));
+            if (gc_arena::IsActive())
+                gc_arena::RegisterSptrCopy(this, const_cast<sptr_base *> (&ob), ob.m_pointedAddress);
+            else
+                GarbageCollector::GetInstance()
+                    .RegisterSptrCopy(this, const_cast<sptr_base *> (&ob));
         }
 
         /// <summary>
@@ -75,9 +172,224 @@ namespace memory
         template <typename ObjectType> 
         sptr_base(const sptr_base<ObjectType> &ob) :
             m_pointedAddress(static_cast<Type *> (ob.m_pointedAddress)) // Fires a compile-time error when 'ObjectType' is not a derived/same/convertible type
+        {
+            if (gc_arena::IsActive())
+                gc_arena::RegisterSptrCopy(this, const_cast<sptr_base<ObjectType> *> (&ob), ob.m_pointedAddress);
+            else
+                GarbageCollector::GetInstance()
+                    .RegisterSptrCopy(this, const_cast<sptr_base<ObjectType> *> (&ob));
+        }
+
+        /// <summary>
+        /// Move constructor.
+        /// Tells the GC this safe pointer takes over the reference of the other,
+        /// which is left pointing nothing. Just like <see cref="gc_vector"/>, the
+        /// moves are not <c>noexcept</c>, since the message to the GC can fail.
+        /// </summary>
+        /// <param name="ob">The object to be moved.</param>
+        sptr_base(sptr_base &&ob) :
+            m_pointedAddress(ob.m_pointedAddress)
+        {
+            if (gc_arena::IsActive())
+                gc_arena::RegisterSptrMove(this, &ob, ob.m_pointedAddress);
+            else
+                GarbageCollector::GetInstance()
+                    .RegisterSptrMove(this, &ob);
+
+            ob.m_pointedAddress = nullptr;
+        }
+
+        /// <summary>
+        /// Move constructor.
+        /// Tells the GC this safe pointer takes over the reference of the other,
+        /// which is left pointing nothing.
+        /// </summary>
+        /// <param name="ob">The object to be moved.</param>
+        template <typename ObjectType> 
+        sptr_base(sptr_base<ObjectType> &&ob) :
+            m_pointedAddress(static_cast<Type *> (ob.m_pointedAddress)) // Fires a compile-time error when 'ObjectType' is not a derived/same/convertible type
+        {
+            if (gc_arena::IsActive())
+                gc_arena::RegisterSptrMove(this, &ob, ob.m_pointedAddress);
+            else
+                GarbageCollector::GetInstance()
+                    .RegisterSptrMove(this, &ob);
+
+            ob.m_pointedAddress = nullptr;
+        }
+
+        /// <summary>
+        /// Constructor that takes the object of a locked <see cref="weak_sptr"/>.
+        /// The object is unlocked by the GC once this safe pointer is registered.
+        /// </summary>
+        /// <param name="pointedAddr">The address of the object.</param>
+        /// <param name="memBlockAddr">The address of the memory block of the object.</param>
+        sptr_base(WeakLockTag, Type *pointedAddr, void *memBlockAddr) :
+            m_pointedAddress(pointedAddr)
+        {
+            GarbageCollector::GetInstance()
+                .RegisterSptrOnWeakLock(this, memBlockAddr);
+        }
+
+        /// <summary>
+        /// Constructor that takes an object held by a <see cref="gc_vector"/>,
+        /// which keeps it from being collected until this safe pointer is registered.
+        /// </summary>
+        /// <param name="pointedAddr">The address of the object.</param>
+        sptr_base(HeldObjectTag, Type *pointedAddr) :
+            m_pointedAddress(pointedAddr)
         {
             GarbageCollector::GetInstance()
-                .RegisterSptrCopy(this, const_cast<sptr_base<ObjectType> *> (&ob));
+                .RegisterSptr(this, pointedAddr);
+        }
+
+        /// <summary>
+        /// Constructor that creates a new garbage collected object in place, and
+        /// registers both with the GC at once, so a single message is sent.
+        /// </summary>
+        /// <param name="args">The arguments for the constructor of the object.</param>
+        template <typename... Args>
+        explicit sptr_base(NewObjectTag tag, Args &&...args) :
+            m_pointedAddress(nullptr)
+        {
+            const size_t alignment = std::max(tag.alignment, alignof(Type));
+
+            if (gc_arena::IsActive())
+            {
+                CreateInArena<Type>(sizeof (Type), alignment, &DestroyArenaObject<Type>,
+                                    [&](void *mem) { new (mem) Type(std::forward<Args>(args)...); },
+                                    0, false);
+                return;
+            }
+
+            const bool isCtorNoexcept = std::is_nothrow_constructible<Type, Args...>::value;
+            void *gcRegMem = AllocMemoryFromGCHeap(sizeof (Type), alignment);
+
+            if (std::is_trivially_destructible<Type>::value)
+            {
+                /* Such object cannot contain safe pointers, so nothing else
+                is sent to the GC during its construction, which can be done
+                before the registration. A failure then needs no message. */
+                if (isCtorNoexcept)
+                    new (gcRegMem) Type(std::forward<Args>(args)...);
+                else
+                {
+                    try
+                    {
+                        new (gcRegMem) Type(std::forward<Args>(args)...);
+                    }
+                    catch (...)
+                    {
+                        FreeMemoryFromGCHeap(gcRegMem);
+                        throw;
+                    }
+                }
+
+                GarbageCollector::GetInstance()
+                    .RegisterSptrWithNewObject(this, gcRegMem, sizeof (Type), &FreeMemAddr<Type>);
+            }
+            else
+            {
+                // safe pointers inside the object will look for its memory, so register it first:
+                GarbageCollector::GetInstance()
+                    .RegisterSptrWithNewObject(this, gcRegMem, sizeof (Type), &FreeMemAddr<Type>);
+
+                if (isCtorNoexcept)
+                    new (gcRegMem) Type(std::forward<Args>(args)...);
+                else
+                {
+                    try
+                    {
+                        new (gcRegMem) Type(std::forward<Args>(args)...);
+                    }
+                    catch (...)
+                    {
+                        // this instance does not get destroyed when its constructor throws:
+                        auto &gc = GarbageCollector::GetInstance();
+                        gc.UnregisterAbortedObject(this);
+                        gc.UnregisterSptr(this);
+                        throw;
+                    }
+                }
+            }
+
+            m_pointedAddress = static_cast<Type *> (gcRegMem);
+        }
+
+        /// <summary>
+        /// Constructor that creates a new garbage collected array of default constructed
+        /// objects, registered with the GC as a single memory block.
+        /// </summary>
+        /// <param name="count">How many objects to create.</param>
+        sptr_base(NewArrayTag tag, size_t count) :
+            m_pointedAddress(nullptr)
+        {
+            const bool isCtorNoexcept = std::is_nothrow_default_constructible<Type>::value;
+            const size_t alignment = std::max({ tag.alignment, alignof(Type), alignof(GCArrayHeader) });
+            const size_t elementsOffset = GetArrayElementsOffset(alignment);
+            const size_t blockSize = GetArrayBlockSize(count, sizeof (Type), elementsOffset);
+
+            if (gc_arena::IsActive())
+            {
+                CreateInArena<Type>(blockSize, alignment, &DestroyArenaArray<Type>,
+                                    [count, elementsOffset](void *mem)
+                                    {
+                                        auto elements = static_cast<Type *> (InitArrayHeaders(mem, count, elementsOffset));
+                                        std::uninitialized_value_construct_n(elements, count);
+                                    },
+                                    elementsOffset, false);
+                return;
+            }
+
+            void *gcRegMem = AllocMemoryFromGCHeap(blockSize, alignment);
+            auto elements = static_cast<Type *> (InitArrayHeaders(gcRegMem, count, elementsOffset));
+
+            if (std::is_trivially_destructible<Type>::value)
+            {
+                // just like for a single object, no message is sent before it is constructed:
+                if (isCtorNoexcept)
+                    std::uninitialized_value_construct_n(elements, count);
+                else
+                {
+                    try
+                    {
+                        std::uninitialized_value_construct_n(elements, count);
+                    }
+                    catch (...)
+                    {
+                        FreeMemoryFromGCHeap(gcRegMem);
+                        throw;
+                    }
+                }
+
+                GarbageCollector::GetInstance()
+                    .RegisterSptrWithNewObject(this, gcRegMem, blockSize, &FreeArrayMemAddr<Type>);
+            }
+            else
+            {
+                GarbageCollector::GetInstance()
+                    .RegisterSptrWithNewObject(this, gcRegMem, blockSize, &FreeArrayMemAddr<Type>);
+
+                if (isCtorNoexcept)
+                    std::uninitialized_value_construct_n(elements, count);
+                else
+                {
+                    try
+                    {
+                        // the objects constructed so far are destroyed before this throws:
+                        std::uninitialized_value_construct_n(elements, count);
+                    }
+                    catch (...)
+                    {
+                        auto &gc = GarbageCollector::GetInstance();
+                        gc.UnregisterAbortedObject(this);
+                        gc.UnregisterSptr(this);
+                        throw;
+                    }
+                }
+            }
+
+            m_pointedAddress = elements;
         }
 
         /// <summary>
@@ -86,8 +398,11 @@ namespace memory
         /// </summary>
         ~sptr_base()
         {
-            GarbageCollector::GetInstance()
-                .UnregisterSptr(this);
+            if (gc_arena::IsActive())
+                gc_arena::UnregisterSptr(this, m_pointedAddress);
+            else
+                GarbageCollector::GetInstance()
+                    .UnregisterSptr(this);
         }
 
         /// <summary>
@@ -100,14 +415,50 @@ namespace memory
             if (static_cast<const void *> (&ob) != static_cast<const void *> (this)
                 && static_cast<const void *> (m_pointedAddress) != static_cast<const void *> (ob.m_pointedAddress))
             {
-                GarbageCollector::GetInstance()
-                    .UpdateReference(this, const_cast<sptr_base<ObjectType> *> (&ob));
+                if (gc_arena::IsActive())
+                {
+                    gc_arena::UpdateReference(this, m_pointedAddress,
+                                              const_cast<sptr_base<ObjectType> *> (&ob), ob.m_pointedAddress);
+                }
+                else
+                    GarbageCollector::GetInstance()
+                        .UpdateReference(this, const_cast<sptr_base<ObjectType> *> (&ob));
 
                 // Fires a compile-time error when 'ObjectType' is not a derived/same/convertible type
                 m_pointedAddress = static_cast<Type *> (ob.m_pointedAddress);
             }
         }
 
+        /// <summary>
+        /// Moves an object to the current instance, which is left pointing nothing.
+        /// </summary>
+        /// <param name="ob">The object to move.</param>
+        template <typename ObjectType> 
+        void MoveAssign(sptr_base<ObjectType> &ob)
+        {
+            if (static_cast<const void *> (&ob) == static_cast<const void *> (this))
+                return;
+
+            // when both reference the same object, the assignment amounts to releasing the other:
+            if (static_cast<const void *> (m_pointedAddress) == static_cast<const void *> (ob.m_pointedAddress))
+            {
+                if (ob.m_pointedAddress != nullptr)
+                    ob.Reset();
+
+                return;
+            }
+
+            if (gc_arena::IsActive())
+                gc_arena::MoveReference(this, m_pointedAddress, &ob, ob.m_pointedAddress);
+            else
+                GarbageCollector::GetInstance()
+                    .MoveReference(this, &ob);
+
+            // Fires a compile-time error when 'ObjectType' is not a derived/same/convertible type
+            m_pointedAddress = static_cast<Type *> (ob.m_pointedAddress);
+            ob.m_pointedAddress = nullptr;
+        }
+
     public:
 
         /// <summary>
@@ -117,11 +468,18 @@ namespace memory
         template <typename ObjectType> 
         void createAndAcquireGCObject(const std::function<void (void *)> &invokeObjectCtor)
         {
+            if (gc_arena::IsActive())
+            {
+                CreateInArena<ObjectType>(sizeof (ObjectType), alignof(ObjectType),
+                                          &DestroyArenaObject<ObjectType>, invokeObjectCtor, 0, true);
+                return;
+            }
+
             /* The object memory must first be registered with the GC. That is because the referred object
             might contain a member which is a safe pointer. If that is the case, the registration of this
             'child' safe pointer must be able to know it belongs to the memory region of the current instance,
             which is possible only if its memory was allocated before hand. */
-            void *gcRegMem = AllocMemoryAndRegisterWithGC(sizeof (ObjectType), this, &FreeMemAddr<ObjectType>);
+            void *gcRegMem = AllocMemoryAndRegisterWithGC(sizeof (ObjectType), alignof(ObjectType), this, &FreeMemAddr<ObjectType>);
 
             try
             {
@@ -196,11 +554,18 @@ namespace memory
         /// </summary>
         void Reset()
         {
-            GarbageCollector::GetInstance().ReleaseReference(this);
+            if (gc_arena::IsActive())
+                gc_arena::ReleaseReference(this, m_pointedAddress);
+            else
+                GarbageCollector::GetInstance().ReleaseReference(this);
+
             m_pointedAddress = nullptr;
         }
     };
 
+    // an arena abandoned with escaped references makes the safe pointers inside it null in place:
+    static_assert(sizeof(sptr_base<char>) == sizeof(void *), "A safe pointer must be laid out as the address it references");
+
 
     ///////////////////////////////////
     //  const_sptr Class Template
@@ -216,28 +581,62 @@ namespace memory
 
         const_sptr() : sptr_base<Type>() {}
 
+        const_sptr(const const_sptr &ob) : sptr_base<Type>(ob) {}
+
         const_sptr(const sptr_base<Type> &ob) : sptr_base<Type>(ob) {}
 
         template <typename ObjectType> 
         const_sptr(const sptr_base<ObjectType> &ob) : sptr_base<Type>(ob) {}
 
+        const_sptr(const_sptr &&ob) : sptr_base<Type>(std::move(ob)) {}
+
+        const_sptr(sptr_base<Type> &&ob) : sptr_base<Type>(std::move(ob)) {}
+
+        template <typename ObjectType> 
+        const_sptr(sptr_base<ObjectType> &&ob) : sptr_base<Type>(std::move(ob)) {}
+
+        const_sptr &operator =(const const_sptr &ob)
+        {
+            this->Assign(ob);
+            return *this;
+        }
+
         const_sptr &operator =(const sptr_base<Type> &ob)
         {
-            Assign(ob);
+            this->Assign(ob);
             return *this;
         }
 
         template <typename ObjectType> 
         const_sptr &operator =(const sptr_base<ObjectType> &ob)
         {
-            Assign(ob);
+            this->Assign(ob);
+            return *this;
+        }
+
+        const_sptr &operator =(const_sptr &&ob)
+        {
+            this->MoveAssign(ob);
+            return *this;
+        }
+
+        const_sptr &operator =(sptr_base<Type> &&ob)
+        {
+            this->MoveAssign(ob);
+            return *this;
+        }
+
+        template <typename ObjectType> 
+        const_sptr &operator =(sptr_base<ObjectType> &&ob)
+        {
+            this->MoveAssign(ob);
             return *this;
         }
 
         template <typename ObjectType> 
         operator const_sptr<ObjectType>() const
         {
-            return const_sptr<ObjectType>(*this);
+            return const_sptr<ObjectType>(static_cast<const sptr_base<Type> &> (*this));
         }
 
         const Type &operator *() const
@@ -262,6 +661,28 @@ namespace memory
     template <typename Type> 
     class sptr : public sptr_base<Type>
     {
+    private:
+
+        template <typename ObjectType, typename... Args>
+        friend sptr<ObjectType> make_sptr(Args &&...args);
+
+        template <typename ObjectType, typename... Args>
+        friend sptr<ObjectType> make_aligned_sptr(size_t alignment, Args &&...args);
+
+        template <typename... Args>
+        sptr(NewObjectTag tag, Args &&...args) :
+            sptr_base<Type>(tag, std::forward<Args>(args)...) {}
+
+        friend class weak_sptr<Type>;
+
+        sptr(WeakLockTag tag, Type *pointedAddr, void *memBlockAddr) :
+            sptr_base<Type>(tag, pointedAddr, memBlockAddr) {}
+
+        friend class gc_vector<sptr<Type>>;
+
+        sptr(HeldObjectTag tag, Type *pointedAddr) :
+            sptr_base<Type>(tag, pointedAddr) {}
+
     public:
 
         sptr() : sptr_base<Type>() {}
@@ -271,6 +692,11 @@ namespace memory
         template <typename ObjectType> 
         sptr(const sptr<ObjectType> &ob) : sptr_base<Type>(ob) {}
 
+        sptr(sptr &&ob) : sptr_base<Type>(std::move(ob)) {}
+
+        template <typename ObjectType> 
+        sptr(sptr<ObjectType> &&ob) : sptr_base<Type>(std::move(ob)) {}
+
         sptr &operator =(const sptr &ob)
         {
             this->Assign(ob);
@@ -284,6 +710,19 @@ namespace memory
             return *this;
         }
 
+        sptr &operator =(sptr &&ob)
+        {
+            this->MoveAssign(ob);
+            return *this;
+        }
+
+        template <typename ObjectType> 
+        sptr &operator =(sptr<ObjectType> &&ob)
+        {
+            this->MoveAssign(ob);
+            return *this;
+        }
+
         template <typename ObjectType> 
         operator sptr<ObjectType>() const
         {
@@ -293,7 +732,7 @@ namespace memory
         template <typename ObjectType> 
         operator const_sptr<ObjectType>() const
         {
-            return const_sptr<ObjectType>(*this);
+            return const_sptr<ObjectType>(static_cast<const sptr_base<Type> &> (*this));
         }
 
         Type &operator *() const
@@ -307,6 +746,258 @@ namespace memory
         }
     };
 
+
+    ///////////////////////////////////////
+    //  sptr Class Template for Arrays
+    ///////////////////////////////////////
+
+    /// <summary>
+    /// A class for safe pointers (make use of the GC) to arrays.
+    /// The whole array is a single memory block for the GC, and the safe
+    /// pointers inside its elements are the edges starting from that block.
+    /// </summary>
+    template <typename Type> 
+    class sptr<Type[]> : public sptr_base<Type>
+    {
+    private:
+
+        template <typename ObjectType>
+        friend sptr<ObjectType[]> make_sptr_array(size_t count, size_t alignment);
+
+        sptr(NewArrayTag tag, size_t count) :
+            sptr_base<Type>(tag, count) {}
+
+    public:
+
+        sptr() : sptr_base<Type>() {}
+
+        sptr(const sptr &ob) : sptr_base<Type>(ob) {}
+
+        sptr(sptr &&ob) : sptr_base<Type>(std::move(ob)) {}
+
+        sptr &operator =(const sptr &ob)
+        {
+            this->Assign(ob);
+            return *this;
+        }
+
+        sptr &operator =(sptr &&ob)
+        {
+            this->MoveAssign(ob);
+            return *this;
+        }
+
+        /// <summary>
+        /// Gets how many objects are in the array.
+        /// </summary>
+        /// <returns>The amount of objects, or zero if this is a null pointer.</returns>
+        size_t GetCount() const
+        {
+            auto elements = this->GetPointedAddress();
+            if (elements == nullptr)
+                return 0;
+
+            return (reinterpret_cast<const GCArrayHeader *> (elements) - 1)->count;
+        }
+
+        Type &operator [](size_t idx) const
+        {
+            _ASSERTE(idx < GetCount());
+            return this->GetPointedAddress()[idx];
+        }
+    };
+
+    ///////////////////////////////////
+    //  weak_sptr Class Template
+    ///////////////////////////////////
+
+    /// <summary>
+    /// A class for weak references to garbage collected objects, which do not keep
+    /// them from being collected, such as those in caches. It must be locked to get
+    /// a <see cref="sptr"/> to the object, which is a null pointer once collected.
+    /// </summary>
+    /// <remarks>
+    /// Unlike <see cref="sptr"/>, this is unknown to the GC, and does not take part
+    /// in the graph. Instead, all weak pointers to an object share a block, which the
+    /// GC expires before collecting the object. Locking costs about as much as copying
+    /// a <see cref="sptr"/>, because it only adds an atomic operation in that block.
+    /// Like for <see cref="sptr"/>, the thread messages must be published before
+    /// handing weak pointers over to another thread.
+    /// </remarks>
+    template <typename Type>
+    class weak_sptr
+    {
+    private:
+
+        template <typename OtherType> friend class weak_sptr;
+
+        Type *m_pointedAddress;
+        WeakRefBlock *m_block;
+
+    public:
+
+        /// <summary>
+        /// Default parameterless constructor, for a weak pointer to nothing.
+        /// </summary>
+        weak_sptr() :
+            m_pointedAddress(nullptr),
+            m_block(nullptr)
+        {}
+
+        /// <summary>
+        /// Constructor that weakly references the object of a safe pointer.
+        /// </summary>
+        /// <param name="ob">The safe pointer.</param>
+        template <typename ObjectType>
+        weak_sptr(const sptr_base<ObjectType> &ob) :
+            m_pointedAddress(static_cast<Type *> (ob.m_pointedAddress)), // Fires a compile-time error when 'ObjectType' is not a derived/same/convertible type
+            m_block(nullptr)
+        {
+            if (m_pointedAddress != nullptr)
+            {
+                m_block = GarbageCollector::GetInstance()
+                    .AcquireWeakReference(m_pointedAddress);
+            }
+        }
+
+        /// <summary>
+        /// Copy constructor.
+        /// </summary>
+        /// <param name="ob">The object to be copied.</param>
+        weak_sptr(const weak_sptr &ob) :
+            m_pointedAddress(ob.m_pointedAddress),
+            m_block(ob.m_block)
+        {
+            if (m_block != nullptr)
+                m_block->AddRef();
+        }
+
+        /// <summary>
+        /// Copy constructor.
+        /// </summary>
+        /// <param name="ob">The object to be copied.</param>
+        template <typename ObjectType>
+        weak_sptr(const weak_sptr<ObjectType> &ob) :
+            m_pointedAddress(static_cast<Type *> (ob.m_pointedAddress)), // Fires a compile-time error when 'ObjectType' is not a derived/same/convertible type
+            m_block(ob.m_block)
+        {
+            if (m_block != nullptr)
+                m_block->AddRef();
+        }
+
+        /// <summary>
+        /// Move constructor.
+        /// </summary>
+        /// <param name="ob">The object to be moved, which is left pointing nothing.</param>
+        weak_sptr(weak_sptr &&ob) noexcept :
+            m_pointedAddress(ob.m_pointedAddress),
+            m_block(ob.m_block)
+        {
+            ob.m_pointedAddress = nullptr;
+            ob.m_block = nullptr;
+        }
+
+        /// <summary>
+        /// Destructor.
+        /// </summary>
+        ~weak_sptr()
+        {
+            if (m_block != nullptr)
+                m_block->Release();
+        }
+
+        /// <summary>
+        /// Assignment operator overload.
+        /// </summary>
+        /// <param name="ob">The object to assign.</param>
+        weak_sptr &operator =(weak_sptr ob) noexcept
+        {
+            std::swap(m_pointedAddress, ob.m_pointedAddress);
+            std::swap(m_block, ob.m_block);
+            return *this;
+        }
+
+        /// <summary>
+        /// Gets a safe pointer to the referenced object.
+        /// </summary>
+        /// <returns>
+        /// A safe pointer to the object, or a null pointer when
+        /// it has been collected, or this references nothing.
+        /// </returns>
+        sptr<Type> Lock() const
+        {
+            if (m_block == nullptr || !m_block->TryLock())
+                return sptr<Type>();
+
+            return sptr<Type>(WeakLockTag(), m_pointedAddress, m_block->GetMemBlockAddress());
+        }
+
+        /// <summary>
+        /// Whether the referenced object has been collected, or
+        /// is about to, hence this cannot be locked anymore.
+        /// </summary>
+        /// <returns>'true' if expired or a null pointer, otherwise, 'false'</returns>
+        bool IsExpired() const
+        {
+            return m_block == nullptr || m_block->IsExpired();
+        }
+
+        /// <summary>
+        /// Resets this to reference nothing.
+        /// </summary>
+        void Reset()
+        {
+            if (m_block != nullptr)
+                m_block->Release();
+
+            m_pointedAddress = nullptr;
+            m_block = nullptr;
+        }
+    };
+
+    /// <summary>
+    /// Creates a new garbage collected object, constructed in place.
+    /// This is faster than the <see cref="has" /> macro, because it sends a single
+    /// message to the GC, and it is templated all the way down to the constructor.
+    /// </summary>
+    /// <param name="args">The arguments for the constructor of the object.</param>
+    /// <returns>A safe pointer to the new object.</returns>
+    template <typename ObjectType, typename... Args>
+    sptr<ObjectType> make_sptr(Args &&...args)
+    {
+        return sptr<ObjectType>(NewObjectTag{ alignof(ObjectType) }, std::forward<Args>(args)...);
+    }
+
+    /// <summary>
+    /// Creates a new garbage collected object, constructed in place, in memory with a stricter
+    /// alignment than that of its type, such as that of a cache line, so the object shares it
+    /// with nothing else and no false sharing between threads happens.
+    /// </summary>
+    /// <param name="alignment">The alignment of the object, which must be a power of 2.</param>
+    /// <param name="args">The arguments for the constructor of the object.</param>
+    /// <returns>A safe pointer to the new object.</returns>
+    template <typename ObjectType, typename... Args>
+    sptr<ObjectType> make_aligned_sptr(size_t alignment, Args &&...args)
+    {
+        return sptr<ObjectType>(NewObjectTag{ alignment }, std::forward<Args>(args)...);
+    }
+
+    /// <summary>
+    /// Creates a new garbage collected array of default constructed objects.
+    /// The GC manages the array as a single memory block, rather than one per object.
+    /// </summary>
+    /// <param name="count">How many objects to create.</param>
+    /// <param name="alignment">
+    /// The alignment of the first object, which must be a power of 2. A stricter one than
+    /// that of the type, such as that of vector registers, allows aligned loads of the array.
+    /// </param>
+    /// <returns>A safe pointer to the new array.</returns>
+    template <typename ObjectType>
+    sptr<ObjectType[]> make_sptr_array(size_t count, size_t alignment)
+    {
+        return sptr<ObjectType[]>(NewArrayTag{ alignment }, count);
+    }
+
 }// end of namespace memory
 }// end of namespace _3fd
 
@@ -18,7 +18,6 @@ namespace _3fd
 {
 namespace utils
 {
-    /// <summary>
     /// <summary>
     /// Initializes a new instance of the <see cref="DynamicMemPool"/> class.
     /// </summary>
@@ -28,7 +27,10 @@ namespace utils
     DynamicMemPool::DynamicMemPool(uint16_t initialSize, uint16_t blockSize, float growingFactor) :
         m_initialSize(initialSize),
         m_blockSize(blockSize),
-        m_growingFactor(growingFactor)
+        m_growingFactor(growingFactor),
+        m_numBlocks(0),
+        m_numUsedBlocks(0),
+        m_peakNumUsedBlocks(0)
     {
         _ASSERTE(initialSize * blockSize > 0); // The object pool cannot start zero-sized
         _ASSERTE(growingFactor > 0); // The increasing factor must be a positive number
@@ -40,19 +42,20 @@ namespace utils
     /// <returns></returns>
     void * DynamicMemPool::GetFreeBlock()
     {
-        // are there memory pools with available memory?
+        // are there memory pools with available memory? take from the lowest:
         if (!m_availableMemPools.empty())
         {
-            auto memPool = m_availableMemPools.front();
+            auto memPool = *m_availableMemPools.begin();
             auto addr = memPool->GetFreeBlock();
+            _ASSERTE(addr != nullptr); // pools without available memory must have left the set
 
-            if (addr != nullptr)
-                return addr;
-            else
-            {
-                m_availableMemPools.pop();
-                return GetFreeBlock(); // tail recursion
-            }
+            if (memPool->IsEmpty())
+                m_availableMemPools.erase(m_availableMemPools.begin());
+
+            if (++m_numUsedBlocks > m_peakNumUsedBlocks)
+                m_peakNumUsedBlocks = m_numUsedBlocks;
+
+            return addr;
         }
 
         // there is no memory available in the existent pools, so create a new one:
@@ -77,7 +80,13 @@ namespace utils
             std::make_pair(addr, std::move(memPool))
         ).first->second;
 
-        m_availableMemPools.push(&movedMemPool); // make the new memory pool available
+        if (!movedMemPool.IsEmpty())
+            m_availableMemPools.insert(&movedMemPool); // make the new memory pool available
+
+        m_numBlocks += initNumBlocks;
+
+        if (++m_numUsedBlocks > m_peakNumUsedBlocks)
+            m_peakNumUsedBlocks = m_numUsedBlocks;
 
         return addr;
     }
@@ -97,51 +106,44 @@ namespace utils
 
         _ASSERTE(memPool.Contains(object)); // Cannot return a memory block which does not belong to the pool
 
-        // If the corresponding memory pool was empty:
+        // If the corresponding memory pool was empty, it becomes available:
         if (memPool.IsEmpty())
-        {
-            m_availableMemPools.push(&memPool); // mark the pool as 'available' (not empty / with available memory)
-
-            // The empty memory pool might have already been in the queue (front element):
-            if (m_availableMemPools.front() == &memPool)
-                m_availableMemPools.pop();
-        }
+            m_availableMemPools.insert(&memPool);
 
         memPool.ReturnBlock(object); // returns the memory to the pool
+        --m_numUsedBlocks;
     }
 
     /// <summary>
-    /// Shrinks the set of memory pools releasing the resources of the pools which are full.
+    /// Shrinks the set of memory pools releasing the resources of the pools which are full,
+    /// and hands back to the system the pages of the remaining that have no block in use.
     /// </summary>
-    void DynamicMemPool::Shrink()
+    /// <returns>The size of the memory handed back to the system.</returns>
+    size_t DynamicMemPool::Shrink()
     {
-        std::vector<MemoryPool *> toBeDeleted;
+        size_t releasedSize(0);
 
-        toBeDeleted.reserve(m_availableMemPools.size());
-
-        // Scan the queue and hold the pointers to the pool objects that are full:
-        for (auto count = m_availableMemPools.size(); count > 0; --count)
+        auto iter = m_availableMemPools.begin();
+        while (iter != m_availableMemPools.end())
         {
-            auto memPool = m_availableMemPools.front();
+            auto memPool = *iter;
+
+            /* Discarding the pages of a pool about to be destroyed makes sure the
+            memory is gone, even if the allocator keeps it for later use: */
+            releasedSize += memPool->ReleaseIdlePages();
 
             if (memPool->IsFull())
             {
-                m_availableMemPools.pop();
-                toBeDeleted.push_back(memPool);
+                iter = m_availableMemPools.erase(iter);
+                m_numBlocks -= memPool->GetNumBlocks();
+                m_memPools.erase(memPool->GetBaseAddress());
             }
             else
-            {
-                m_availableMemPools.pop();
-                m_availableMemPools.push(memPool);
-            }
+                ++iter;
         }
 
-        // Delete the pool objects that were found full:
-        for (auto memPool : toBeDeleted)
-        {
-            auto iter = m_memPools.find(memPool->GetBaseAddress());
-            m_memPools.erase(iter);
-        }
+        m_peakNumUsedBlocks = m_numUsedBlocks;
+        return releasedSize;
     }
 
 } // end of namespace utils
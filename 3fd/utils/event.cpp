@@ -76,8 +76,14 @@ namespace utils
     {
         std::unique_lock<std::mutex> lock(m_mutex);
 
-        return m_flag ||
-            m_condition.wait_for(lock, 
+        // the event might have been set before the wait started:
+        if (m_flag)
+        {
+            m_flag = false;
+            return true;
+        }
+
+        return m_condition.wait_for(lock, 
                 std::chrono::milliseconds(millisecs), 
                 [this]()
                 {
@@ -13,6 +13,7 @@
 #include <map>
 #include <memory>
 #include <queue>
+#include <set>
 #include <stack>
 #include <vector>
 
@@ -198,6 +199,11 @@ namespace utils
     /// that <see cref="DynamicMemPool"> will use several instances of this class when it needs more memory.
     /// The pool was designed for single-thread access.
     /// </summary>
+    /// <remarks>
+    /// The memory is made of whole pages, which are only backed by the system once touched.
+    /// Available blocks are given lowest address first, so those in use are packed at the
+    /// start, and the pages at the end remain idle, which can be handed back to the system.
+    /// </remarks>
     class MemoryPool
     {
     private:
@@ -212,8 +218,18 @@ namespace utils
         /// Keeps available memory addresses stored as distance in number of blocks
         /// from the base address. Because the offset is a 16 bit unsigned integer,
         /// this imposes a practical limit of aproximately 64k blocks to the pool.
+        /// This is a heap with the lowest offset at the top.
         /// </summary>
-        std::stack<uint16_t> m_availAddrsAsBlockIndex;
+        std::vector<uint16_t> m_availAddrsAsBlockIndex;
+
+        /// <summary>
+        /// Which pages have been handed back to the system and not touched since,
+        /// so they are neither discarded nor counted again.
+        /// </summary>
+        std::vector<bool> m_discardedPages;
+        size_t m_numDiscardedPages;
+
+        void ReuseDiscardedPages(void *addr) noexcept;
 
     public:
 
@@ -238,6 +254,10 @@ namespace utils
         void *GetFreeBlock() noexcept;
 
         void ReturnBlock(void *addr);
+
+        size_t GetNumUsedBlocks() const noexcept;
+
+        size_t ReleaseIdlePages();
     };
 
     /// <summary>
@@ -259,7 +279,27 @@ namespace utils
         typedef std::map<void *, MemoryPool> MapOfMemoryPools;
 #endif
         MapOfMemoryPools m_memPools;
-        std::queue<MemoryPool *> m_availableMemPools;
+
+        /// <summary>
+        /// Sorts the memory pools by address, so blocks are taken from the lowest first.
+        /// </summary>
+        struct LessOperOnMemPoolAddr
+        {
+            bool operator()(const MemoryPool *left, const MemoryPool *right) const
+            {
+                return left->GetBaseAddress() < right->GetBaseAddress();
+            }
+        };
+
+        /// <summary>
+        /// The memory pools with available memory. Taking blocks from the lowest
+        /// address packs the ones in use, so the pools at the end are drained.
+        /// </summary>
+        std::set<MemoryPool *, LessOperOnMemPoolAddr> m_availableMemPools;
+
+        size_t m_numBlocks;
+        size_t m_numUsedBlocks;
+        size_t m_peakNumUsedBlocks;
 
     public:
 
@@ -273,7 +313,22 @@ namespace utils
 
         void ReturnBlock(void *object);
 
-        void Shrink();
+        size_t Shrink();
+
+        /// <summary>
+        /// Gets how many blocks the pool has, whether in use or not.
+        /// </summary>
+        size_t GetNumBlocks() const noexcept { return m_numBlocks; }
+
+        /// <summary>
+        /// Gets how many blocks are in use.
+        /// </summary>
+        size_t GetNumUsedBlocks() const noexcept { return m_numUsedBlocks; }
+
+        /// <summary>
+        /// Gets the largest amount of blocks in use since the pool was last shrunk.
+        /// </summary>
+        size_t GetPeakNumUsedBlocks() const noexcept { return m_peakNumUsedBlocks; }
     };
 
 }// end of namespace utils
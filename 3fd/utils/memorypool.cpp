@@ -7,43 +7,75 @@
 #include "memory.h"
 #include <3fd/core/exceptions.h>
 
+#include <algorithm>
 #include <cassert>
-#include <cstring>
+#include <functional>
 #include <sstream>
 
+#ifndef _WIN32
+#   include <sys/mman.h>
+#   include <unistd.h>
+#endif
+
 namespace _3fd
 {
 namespace utils
 {
     /// <summary>
-    /// Perform allocation of aligned memory for an array, initialized to zero.
+    /// Gets the size of a page of memory in the system.
+    /// </summary>
+    static size_t GetPageSize()
+    {
+        static const size_t pageSize = []()
+        {
+#    ifdef _WIN32
+            SYSTEM_INFO sysInfo;
+            GetSystemInfo(&sysInfo);
+            return static_cast<size_t> (sysInfo.dwPageSize);
+#    else
+            return static_cast<size_t> (sysconf(_SC_PAGESIZE));
+#    endif
+        }();
+
+        return pageSize;
+    }
+
+    /// <summary>
+    /// Perform allocation of whole pages of memory, which are left untouched,
+    /// so the system only backs them with physical memory once in use.
     /// </summary>
-    /// <param name="alignment">The alignment.</param>
-    /// <param name="numBlocks">How many blocks to allocate.</param>
-    /// <param name="blockSize">The amount of bytes to allocate per block.</param>
+    /// <param name="nBytes">How many bytes to allocate, a multiple of the page size.</param>
     /// <returns>
     /// A pointer to the allocated memory.
     /// </returns>
-    /// <remarks>
-    /// The product 'blockSize * numBlocks' has to be a multiple of the alignment.
-    /// </remarks>
-    static void *aligned_calloc(size_t alignment, size_t numBlocks, size_t blockSize)
+    static void *AllocatePages(size_t nBytes)
     {
-        auto nBytes = numBlocks * blockSize;
 #    ifdef _WIN32
-        auto ptr = _aligned_malloc(nBytes, alignment);
+        auto ptr = _aligned_malloc(nBytes, GetPageSize());
 #    else
-        auto ptr = aligned_alloc(alignment, nBytes);
+        auto ptr = aligned_alloc(GetPageSize(), nBytes);
 #    endif
         if (ptr != nullptr)
-        {
-            memset(ptr, 0x0, nBytes);
             return ptr;
-        }
         else
             throw core::AppException<std::runtime_error>("Failed to allocate memory for memory pool");
     }
 
+    /// <summary>
+    /// Hands pages of memory back to the system, while keeping them allocated.
+    /// Their content is lost, and they are backed by physical memory again once touched.
+    /// </summary>
+    /// <param name="addr">The address of the first page.</param>
+    /// <param name="nBytes">How many bytes, a multiple of the page size.</param>
+    static void DiscardPages(void *addr, size_t nBytes)
+    {
+#    ifdef _WIN32
+        VirtualAlloc(addr, nBytes, MEM_RESET, PAGE_READWRITE);
+#    else
+        madvise(addr, nBytes, MADV_DONTNEED);
+#    endif
+    }
+
     /// <summary>
     /// Memories the pool.
     /// </summary>
@@ -56,12 +88,14 @@ namespace utils
         , m_end(nullptr)
         , m_blockSize(blockSize)
         , m_availAddrsAsBlockIndex()
+        , m_numDiscardedPages(0)
     {
         _ASSERTE(numBlocks * blockSize > 0); // Cannot handle a null value as the amount of memory
 
-        /* Allocation aligned in 4 bytes guarantees the addresses will always have
+        /* Allocation aligned in pages guarantees the addresses will always have
            the 2 least significant bit unused. This is explored in the GC implementation. */
-        m_baseAddr = aligned_calloc(4, numBlocks, blockSize);
+        auto pageSize = GetPageSize();
+        m_baseAddr = AllocatePages((numBlocks * blockSize + pageSize - 1) / pageSize * pageSize);
         m_end = reinterpret_cast<void *> (reinterpret_cast<size_t> (m_baseAddr) + numBlocks * blockSize);
         m_nextAddr = m_baseAddr;
     }
@@ -86,8 +120,11 @@ namespace utils
         , m_end(ob.m_end)
         , m_blockSize(ob.m_blockSize)
         , m_availAddrsAsBlockIndex(std::move(ob.m_availAddrsAsBlockIndex))
+        , m_discardedPages(std::move(ob.m_discardedPages))
+        , m_numDiscardedPages(ob.m_numDiscardedPages)
     {
         ob.m_baseAddr = ob.m_nextAddr = ob.m_end = nullptr;
+        ob.m_numDiscardedPages = 0;
     }
 
     /// <summary>
@@ -162,22 +199,48 @@ namespace utils
     /// <returns></returns>
     void * MemoryPool::GetFreeBlock() noexcept
     {
+        void *addr;
+
         if (!m_availAddrsAsBlockIndex.empty())
         {
-            auto addr = reinterpret_cast<void *> (
-                reinterpret_cast<uintptr_t> (m_baseAddr) + m_availAddrsAsBlockIndex.top() * m_blockSize
+            addr = reinterpret_cast<void *> (
+                reinterpret_cast<uintptr_t> (m_baseAddr) + m_availAddrsAsBlockIndex.front() * m_blockSize
             );
-            m_availAddrsAsBlockIndex.pop();
-            return addr;
+            std::pop_heap(m_availAddrsAsBlockIndex.begin(), m_availAddrsAsBlockIndex.end(), std::greater<uint16_t>());
+            m_availAddrsAsBlockIndex.pop_back();
         }
         else if (m_nextAddr < m_end)
         {
-            auto addr = m_nextAddr;
+            addr = m_nextAddr;
             m_nextAddr = reinterpret_cast<void *> (reinterpret_cast<uintptr_t> (m_nextAddr) + m_blockSize);
-            return addr;
         }
         else
             return nullptr;
+
+        if (m_numDiscardedPages > 0)
+            ReuseDiscardedPages(addr);
+
+        return addr;
+    }
+
+    /// <summary>
+    /// Takes note that the pages of a block taken from the pool are no longer discarded,
+    /// because the system backs them with physical memory again once touched.
+    /// </summary>
+    /// <param name="addr">The address of the block.</param>
+    void MemoryPool::ReuseDiscardedPages(void *addr) noexcept
+    {
+        const auto pageSize = GetPageSize();
+        const auto offset = reinterpret_cast<uintptr_t> (addr) - reinterpret_cast<uintptr_t> (m_baseAddr);
+
+        for (auto page = offset / pageSize; page <= (offset + m_blockSize - 1) / pageSize; ++page)
+        {
+            if (m_discardedPages[page])
+            {
+                m_discardedPages[page] = false;
+                --m_numDiscardedPages;
+            }
+        }
     }
 
     /// <summary>
@@ -187,9 +250,83 @@ namespace utils
     void MemoryPool::ReturnBlock(void *addr)
     {
         _ASSERTE(Contains(addr)); // Cannot return a memory block which does not belong to the memory pool
-        m_availAddrsAsBlockIndex.push(static_cast<uint16_t> (
+        m_availAddrsAsBlockIndex.push_back(static_cast<uint16_t> (
             (reinterpret_cast<uintptr_t> (addr) - reinterpret_cast<uintptr_t> (m_baseAddr)) / m_blockSize
         ));
+        std::push_heap(m_availAddrsAsBlockIndex.begin(), m_availAddrsAsBlockIndex.end(), std::greater<uint16_t>());
+    }
+
+    /// <summary>
+    /// Gets the number of memory blocks in use.
+    /// </summary>
+    /// <returns>How many memory blocks have been taken from the pool, but not returned.</returns>
+    size_t MemoryPool::GetNumUsedBlocks() const noexcept
+    {
+        return (reinterpret_cast<uintptr_t> (m_nextAddr) - reinterpret_cast<uintptr_t> (m_baseAddr)) / m_blockSize
+            - m_availAddrsAsBlockIndex.size();
+    }
+
+    /// <summary>
+    /// Hands the pages with no block in use back to the system. Pages that were never
+    /// touched, or that have already been handed back and not touched since, are left
+    /// alone, because there is no physical memory behind them to release.
+    /// </summary>
+    /// <returns>The size of the pages newly handed back.</returns>
+    size_t MemoryPool::ReleaseIdlePages()
+    {
+        const auto numBlocks = GetNumBlocks();
+        const auto numTouchedBlocks =
+            (reinterpret_cast<uintptr_t> (m_nextAddr) - reinterpret_cast<uintptr_t> (m_baseAddr)) / m_blockSize;
+
+        // the blocks never taken from the pool are idle as well as the available ones:
+        std::vector<bool> isIdle(numBlocks, false);
+        std::fill(isIdle.begin() + numTouchedBlocks, isIdle.end(), true);
+
+        for (auto index : m_availAddrsAsBlockIndex)
+            isIdle[index] = true;
+
+        const auto pageSize = GetPageSize();
+        const auto numPages = (numBlocks * m_blockSize + pageSize - 1) / pageSize;
+        const auto numTouchedPages = (numTouchedBlocks * m_blockSize + pageSize - 1) / pageSize;
+        const auto noRun = numPages;
+
+        m_discardedPages.resize(numPages, false);
+
+        // discard the runs of touched pages that only overlap idle blocks, and were not discarded yet:
+        size_t releasedSize(0);
+        size_t runStart(noRun);
+        for (size_t page = 0; page <= numTouchedPages; ++page)
+        {
+            bool mustDiscard(false);
+
+            if (page < numTouchedPages && !m_discardedPages[page])
+            {
+                auto firstBlock = page * pageSize / m_blockSize;
+                auto lastBlock = std::min(((page + 1) * pageSize - 1) / m_blockSize, numBlocks - 1);
+
+                mustDiscard = std::all_of(isIdle.begin() + firstBlock,
+                                          isIdle.begin() + lastBlock + 1,
+                                          [](bool idle) { return idle; });
+            }
+
+            if (mustDiscard)
+            {
+                if (runStart == noRun)
+                    runStart = page;
+
+                m_discardedPages[page] = true;
+                ++m_numDiscardedPages;
+            }
+            else if (runStart != noRun)
+            {
+                auto runSize = (page - runStart) * pageSize;
+                DiscardPages(reinterpret_cast<void *> (reinterpret_cast<uintptr_t> (m_baseAddr) + runStart * pageSize), runSize);
+                releasedSize += runSize;
+                runStart = noRun;
+            }
+        }
+
+        return releasedSize;
     }
 
 } // end of namespace utils
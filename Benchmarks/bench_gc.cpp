@@ -0,0 +1,670 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#include <3fd/core/runtime.h>
+#include <3fd/core/exceptions.h>
+#include <3fd/core/sptr.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+    Benchmarks for the garbage collector, whose results are written as CSV or JSON,
+    so they can be compared across changes in the GC internals. Every benchmark yields
+    the median of several runs for:
+
+    mutator_ms  - how long the application threads took to do the work
+    ops_per_sec - how many operations per second the application threads did
+    gc_drain_ms - how long the GC took to catch up once the application threads
+                  were done, which for the release of a graph is the time from
+                  dropping the last reference to the release of all its memory
+*/
+namespace _3fd
+{
+namespace benchmarks
+{
+    using std::string;
+
+    using memory::sptr;
+    using memory::make_sptr;
+    using memory::make_sptr_array;
+
+    typedef std::chrono::steady_clock Clock;
+
+    /// <summary>
+    /// How long to wait for the GC before giving up.
+    /// </summary>
+    static const std::chrono::seconds gcTimeout(120);
+
+    /// <summary>
+    /// Gets the milliseconds elapsed between two points in time.
+    /// </summary>
+    static double GetMillisecs(Clock::time_point start, Clock::time_point end)
+    {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    /// <summary>
+    /// The options of the benchmarks, parsed from the command line.
+    /// </summary>
+    struct Options
+    {
+        string format;
+        string outputFilePath;
+        unsigned int maxThreads;
+        unsigned int repetitions;
+        size_t opsPerThread;
+        unsigned int treeDepth;
+        size_t fanOutWidth;
+        size_t ringsCount;
+        size_t ringLength;
+
+        Options() :
+            format("csv"),
+            maxThreads(std::max(std::thread::hardware_concurrency(), 1U)),
+            repetitions(3),
+#       ifdef NDEBUG
+            opsPerThread(200000),
+            treeDepth(18),
+            fanOutWidth(1 << 17),
+            ringsCount(1024),
+            ringLength(128)
+#       else
+            opsPerThread(20000),
+            treeDepth(14),
+            fanOutWidth(1 << 13),
+            ringsCount(128),
+            ringLength(64)
+#       endif
+        {}
+    };
+
+    /// <summary>
+    /// The result of a benchmark.
+    /// </summary>
+    struct Result
+    {
+        string benchmark;
+        unsigned int threads;
+        size_t operations;
+        double mutatorMillisecs;
+        double opsPerSec;
+        double gcDrainMillisecs;
+    };
+
+    /// <summary>
+    /// A single run of a benchmark.
+    /// </summary>
+    struct Measurement
+    {
+        double mutatorMillisecs;
+        double gcDrainMillisecs;
+    };
+
+    /// <summary>
+    /// The object allocated by the benchmarks of <see cref="sptr"/> operations.
+    /// Creation is not counted here, so as to not add contention between the
+    /// application threads, but destruction only happens in the GC thread.
+    /// </summary>
+    struct Payload
+    {
+        static std::atomic<int64_t> liveCount;
+
+        int64_t m_data[2];
+
+        Payload() : m_data{ 0, 0 } {}
+
+        ~Payload() { liveCount.fetch_sub(1, std::memory_order_relaxed); }
+    };
+
+    std::atomic<int64_t> Payload::liveCount(0);
+
+    /// <summary>
+    /// A vertex of the graphs built by the benchmarks, which counts its destruction as well.
+    /// </summary>
+    struct GraphNode
+    {
+        static std::atomic<int64_t> liveCount;
+
+        sptr<GraphNode> m_left;
+        sptr<GraphNode> m_right;
+
+        ~GraphNode() { liveCount.fetch_sub(1, std::memory_order_relaxed); }
+    };
+
+    std::atomic<int64_t> GraphNode::liveCount(0);
+
+    /// <summary>
+    /// Waits until a condition is met, and fails if that takes too long.
+    /// </summary>
+    /// <param name="condition">The condition to wait for.</param>
+    /// <returns>When the condition was met.</returns>
+    template <typename Condition>
+    static Clock::time_point WaitFor(Condition condition)
+    {
+        auto deadline = Clock::now() + gcTimeout;
+
+        while (!condition())
+        {
+            if (Clock::now() > deadline)
+                throw core::AppException<std::runtime_error>("Timeout waiting for the garbage collector");
+
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+
+        return Clock::now();
+    }
+
+    /// <summary>
+    /// Waits for the GC to process all messages published so far.
+    /// </summary>
+    /// <returns>When the GC caught up.</returns>
+    static Clock::time_point WaitForGcDrain()
+    {
+        if (!memory::GarbageCollector::GetInstance().Flush(gcTimeout))
+            throw core::AppException<std::runtime_error>("Timeout waiting for the garbage collector");
+
+        return Clock::now();
+    }
+
+    /// <summary>
+    /// Runs a piece of work on several threads starting at once.
+    /// </summary>
+    /// <param name="numThreads">How many threads to use.</param>
+    /// <param name="startTime">Receives when the threads were released to start.</param>
+    /// <param name="work">The work, which receives the index of the thread.</param>
+    /// <returns>When the last thread finished.</returns>
+    template <typename Work>
+    static Clock::time_point RunOnThreads(unsigned int numThreads, Clock::time_point &startTime, Work work)
+    {
+        std::atomic<bool> go(false);
+        std::atomic<unsigned int> readyCount(0);
+        std::vector<Clock::time_point> endTimes(numThreads);
+        std::vector<std::exception_ptr> errors(numThreads);
+        std::vector<std::thread> threads;
+        threads.reserve(numThreads);
+
+        for (unsigned int idx = 0; idx < numThreads; ++idx)
+        {
+            threads.emplace_back([&, idx]()
+            {
+                ++readyCount;
+                while (!go.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+
+                try
+                {
+                    work(idx);
+
+                    // messages must reach the GC before another thread uses the pointers:
+                    memory::GarbageCollector::GetInstance().PublishThreadMessages();
+                }
+                catch (...)
+                {
+                    errors[idx] = std::current_exception();
+                }
+
+                endTimes[idx] = Clock::now();
+            });
+        }
+
+        while (readyCount.load() < numThreads)
+            std::this_thread::yield();
+
+        startTime = Clock::now();
+        go.store(true, std::memory_order_release);
+
+        for (auto &thread : threads)
+            thread.join();
+
+        for (auto &error : errors)
+        {
+            if (error)
+                std::rethrow_exception(error);
+        }
+
+        return *std::max_element(endTimes.begin(), endTimes.end());
+    }
+
+    /// <summary>
+    /// The <see cref="sptr"/> objects owned by a thread in the benchmarks of operations.
+    /// </summary>
+    struct ThreadData
+    {
+        std::vector<sptr<Payload>> objects;
+        std::vector<sptr<Payload>> copies;
+    };
+
+    /// <summary>
+    /// Measures the rates of creation, copy, assignment and destruction
+    /// of <see cref="sptr"/> objects, in this order, by several threads.
+    /// </summary>
+    /// <param name="numThreads">How many threads to use.</param>
+    /// <param name="count">How many operations each thread does.</param>
+    /// <returns>A measurement for each operation.</returns>
+    static std::vector<Measurement> MeasureSptrOperations(unsigned int numThreads, size_t count)
+    {
+        std::vector<Measurement> measurements;
+        std::vector<ThreadData> threadsData(numThreads);
+
+        for (auto &data : threadsData)
+        {
+            data.objects.reserve(count);
+            data.copies.reserve(count);
+        }
+
+        Clock::time_point startTime, endTime;
+
+        // create:
+        endTime = RunOnThreads(numThreads, startTime, [&threadsData, count](unsigned int idx)
+        {
+            auto &objects = threadsData[idx].objects;
+
+            for (size_t num = 0; num < count; ++num)
+                objects.push_back(make_sptr<Payload>());
+
+            Payload::liveCount.fetch_add(count, std::memory_order_relaxed);
+        });
+
+        measurements.push_back(Measurement{ GetMillisecs(startTime, endTime), GetMillisecs(endTime, WaitForGcDrain()) });
+
+        // copy:
+        endTime = RunOnThreads(numThreads, startTime, [&threadsData, count](unsigned int idx)
+        {
+            auto &data = threadsData[idx];
+
+            for (size_t num = 0; num < count; ++num)
+                data.copies.push_back(data.objects[num]);
+        });
+
+        measurements.push_back(Measurement{ GetMillisecs(startTime, endTime), GetMillisecs(endTime, WaitForGcDrain()) });
+
+        // assign:
+        endTime = RunOnThreads(numThreads, startTime, [&threadsData, count](unsigned int idx)
+        {
+            auto &data = threadsData[idx];
+
+            for (size_t num = 0; num < count; ++num)
+                data.copies[num] = data.objects[count - num - 1];
+        });
+
+        measurements.push_back(Measurement{ GetMillisecs(startTime, endTime), GetMillisecs(endTime, WaitForGcDrain()) });
+
+        // destroy:
+        endTime = RunOnThreads(numThreads, startTime, [&threadsData](unsigned int idx)
+        {
+            auto &data = threadsData[idx];
+            data.copies.clear();
+            data.objects.clear();
+        });
+
+        auto releaseTime = WaitFor([]() { return Payload::liveCount.load(std::memory_order_relaxed) == 0; });
+        measurements.push_back(Measurement{ GetMillisecs(startTime, endTime), GetMillisecs(endTime, releaseTime) });
+
+        return measurements;
+    }
+
+    /// <summary>
+    /// Releases a graph and measures how long until all its memory is released.
+    /// </summary>
+    /// <param name="root">The only reference to the graph.</param>
+    /// <returns>The milliseconds elapsed.</returns>
+    template <typename Type>
+    static double MeasureRelease(sptr<Type> &root)
+    {
+        auto startTime = Clock::now();
+        root.Reset();
+        memory::GarbageCollector::GetInstance().PublishThreadMessages();
+
+        auto releaseTime = WaitFor([]() { return GraphNode::liveCount.load(std::memory_order_relaxed) == 0; });
+        return GetMillisecs(startTime, releaseTime);
+    }
+
+    /// <summary>
+    /// Builds a complete binary tree.
+    /// </summary>
+    /// <param name="depth">The depth of the tree.</param>
+    /// <param name="count">Receives the amount of nodes created.</param>
+    /// <returns>The root of the tree.</returns>
+    static sptr<GraphNode> BuildTree(unsigned int depth, size_t &count)
+    {
+        auto node = make_sptr<GraphNode>();
+        ++count;
+
+        if (depth > 1)
+        {
+            node->m_left = BuildTree(depth - 1, count);
+            node->m_right = BuildTree(depth - 1, count);
+        }
+
+        return node;
+    }
+
+    /// <summary>
+    /// Measures the build and release of a deep binary tree.
+    /// </summary>
+    static Measurement MeasureDeepTree(const Options &options, size_t &count)
+    {
+        count = 0;
+        auto startTime = Clock::now();
+        auto root = BuildTree(options.treeDepth, count);
+        auto endTime = Clock::now();
+
+        GraphNode::liveCount.fetch_add(count, std::memory_order_relaxed);
+        WaitForGcDrain();
+
+        return Measurement{ GetMillisecs(startTime, endTime), MeasureRelease(root) };
+    }
+
+    /// <summary>
+    /// Measures the build and release of a graph where a single array references
+    /// many nodes, all of them referencing a single node.
+    /// </summary>
+    static Measurement MeasureWideFanOut(const Options &options, size_t &count)
+    {
+        auto startTime = Clock::now();
+
+        auto hub = make_sptr_array<sptr<GraphNode>>(options.fanOutWidth);
+        auto sink = make_sptr<GraphNode>();
+
+        for (size_t idx = 0; idx < options.fanOutWidth; ++idx)
+        {
+            hub[idx] = make_sptr<GraphNode>();
+            hub[idx]->m_left = sink;
+        }
+
+        auto endTime = Clock::now();
+
+        count = options.fanOutWidth + 1;
+        GraphNode::liveCount.fetch_add(count, std::memory_order_relaxed);
+        sink.Reset();
+        WaitForGcDrain();
+
+        return Measurement{ GetMillisecs(startTime, endTime), MeasureRelease(hub) };
+    }
+
+    /// <summary>
+    /// Measures the build and release of many rings of nodes,
+    /// which are only released by the collection of cycles.
+    /// </summary>
+    static Measurement MeasureCyclicRings(const Options &options, size_t &count)
+    {
+        auto startTime = Clock::now();
+
+        auto rings = make_sptr_array<sptr<GraphNode>>(options.ringsCount);
+
+        for (size_t idx = 0; idx < options.ringsCount; ++idx)
+        {
+            auto first = make_sptr<GraphNode>();
+            auto last = first;
+
+            for (size_t length = 1; length < options.ringLength; ++length)
+            {
+                last->m_left = make_sptr<GraphNode>();
+                last = last->m_left;
+            }
+
+            last->m_left = first;
+            rings[idx] = std::move(first);
+        }
+
+        auto endTime = Clock::now();
+
+        count = options.ringsCount * options.ringLength;
+        GraphNode::liveCount.fetch_add(count, std::memory_order_relaxed);
+        WaitForGcDrain();
+
+        return Measurement{ GetMillisecs(startTime, endTime), MeasureRelease(rings) };
+    }
+
+    /// <summary>
+    /// Gets the median of a value among the measurements.
+    /// </summary>
+    static double GetMedian(std::vector<Measurement> measurements, double Measurement::*value)
+    {
+        std::sort(measurements.begin(), measurements.end(),
+            [value](const Measurement &left, const Measurement &right)
+            {
+                return left.*value < right.*value;
+            });
+
+        return measurements[measurements.size() / 2].*value;
+    }
+
+    /// <summary>
+    /// Makes the result of a benchmark out of its measurements.
+    /// </summary>
+    static Result MakeResult(const string &benchmark,
+                             unsigned int threads,
+                             size_t operations,
+                             const std::vector<Measurement> &measurements)
+    {
+        Result result;
+        result.benchmark = benchmark;
+        result.threads = threads;
+        result.operations = operations;
+        result.mutatorMillisecs = GetMedian(measurements, &Measurement::mutatorMillisecs);
+        result.opsPerSec = (result.mutatorMillisecs > 0) ? operations * 1000.0 / result.mutatorMillisecs : 0;
+        result.gcDrainMillisecs = GetMedian(measurements, &Measurement::gcDrainMillisecs);
+        return result;
+    }
+
+    /// <summary>
+    /// Runs all the benchmarks.
+    /// </summary>
+    static std::vector<Result> RunBenchmarks(const Options &options)
+    {
+        std::vector<Result> results;
+
+        std::vector<unsigned int> threadCounts;
+        for (unsigned int numThreads = 1; numThreads < options.maxThreads; numThreads *= 2)
+            threadCounts.push_back(numThreads);
+
+        threadCounts.push_back(options.maxThreads);
+
+        static const char *operations[] = { "sptr_create", "sptr_copy", "sptr_assign", "sptr_destroy" };
+
+        for (auto numThreads : threadCounts)
+        {
+            std::vector<std::vector<Measurement>> byOperation(4);
+
+            for (unsigned int rep = 0; rep < options.repetitions; ++rep)
+            {
+                auto measurements = MeasureSptrOperations(numThreads, options.opsPerThread);
+
+                for (size_t idx = 0; idx < measurements.size(); ++idx)
+                    byOperation[idx].push_back(measurements[idx]);
+            }
+
+            for (size_t idx = 0; idx < byOperation.size(); ++idx)
+            {
+                // destruction is counted for both the objects and their copies:
+                auto count = numThreads * options.opsPerThread * (idx == 3 ? 2 : 1);
+                results.push_back(MakeResult(operations[idx], numThreads, count, byOperation[idx]));
+            }
+        }
+
+        typedef Measurement (*GraphBenchmark)(const Options &, size_t &);
+
+        static const std::pair<const char *, GraphBenchmark> graphs[] =
+        {
+            { "deep_tree", &MeasureDeepTree },
+            { "wide_fanout", &MeasureWideFanOut },
+            { "cyclic_rings", &MeasureCyclicRings }
+        };
+
+        for (auto &graph : graphs)
+        {
+            size_t count(0);
+            std::vector<Measurement> measurements;
+
+            for (unsigned int rep = 0; rep < options.repetitions; ++rep)
+                measurements.push_back(graph.second(options, count));
+
+            results.push_back(MakeResult(graph.first, 1, count, measurements));
+        }
+
+        return results;
+    }
+
+    /// <summary>
+    /// Writes the results as CSV.
+    /// </summary>
+    static void WriteCsv(const std::vector<Result> &results, std::ostream &out)
+    {
+        out << "benchmark,threads,operations,mutator_ms,ops_per_sec,gc_drain_ms\n";
+
+        for (auto &result : results)
+        {
+            out << result.benchmark << ','
+                << result.threads << ','
+                << result.operations << ','
+                << result.mutatorMillisecs << ','
+                << result.opsPerSec << ','
+                << result.gcDrainMillisecs << '\n';
+        }
+    }
+
+    /// <summary>
+    /// Writes the results as JSON.
+    /// </summary>
+    static void WriteJson(const std::vector<Result> &results, const Options &options, std::ostream &out)
+    {
+        out << "{\n"
+            << "  \"context\": {\n"
+#       ifdef NDEBUG
+            << "    \"build\": \"release\",\n"
+#       else
+            << "    \"build\": \"debug\",\n"
+#       endif
+            << "    \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n"
+            << "    \"repetitions\": " << options.repetitions << "\n"
+            << "  },\n"
+            << "  \"benchmarks\": [";
+
+        for (size_t idx = 0; idx < results.size(); ++idx)
+        {
+            auto &result = results[idx];
+
+            out << (idx > 0 ? ",\n" : "\n")
+                << "    { \"benchmark\": \"" << result.benchmark << '"'
+                << ", \"threads\": " << result.threads
+                << ", \"operations\": " << result.operations
+                << ", \"mutator_ms\": " << result.mutatorMillisecs
+                << ", \"ops_per_sec\": " << result.opsPerSec
+                << ", \"gc_drain_ms\": " << result.gcDrainMillisecs << " }";
+        }
+
+        out << "\n  ]\n}\n";
+    }
+
+    /// <summary>
+    /// Parses the command line arguments.
+    /// </summary>
+    /// <returns>Whether the arguments are valid.</returns>
+    static bool ParseCommandLine(int argc, char *argv[], Options &options)
+    {
+        for (int idx = 1; idx < argc; ++idx)
+        {
+            string arg = argv[idx];
+
+            if (idx + 1 >= argc)
+                return false;
+
+            string value = argv[++idx];
+
+            if (arg == "--format" && (value == "csv" || value == "json"))
+                options.format = value;
+            else if (arg == "--output")
+                options.outputFilePath = value;
+            else if (arg == "--threads" && std::atoi(value.c_str()) > 0)
+                options.maxThreads = std::atoi(value.c_str());
+            else if (arg == "--repeat" && std::atoi(value.c_str()) > 0)
+                options.repetitions = std::atoi(value.c_str());
+            else if (arg == "--ops" && std::atoll(value.c_str()) > 0)
+                options.opsPerThread = std::atoll(value.c_str());
+            else if (arg == "--tree-depth" && std::atoi(value.c_str()) > 0)
+                options.treeDepth = std::atoi(value.c_str());
+            else if (arg == "--fanout" && std::atoll(value.c_str()) > 0)
+                options.fanOutWidth = std::atoll(value.c_str());
+            else if (arg == "--rings" && std::atoll(value.c_str()) > 0)
+                options.ringsCount = std::atoll(value.c_str());
+            else if (arg == "--ring-length" && std::atoll(value.c_str()) > 1)
+                options.ringLength = std::atoll(value.c_str());
+            else
+                return false;
+        }
+
+        return true;
+    }
+
+}// end of namespace benchmarks
+}// end of namespace _3fd
+
+int main(int argc, char *argv[])
+{
+    using namespace _3fd::benchmarks;
+
+    Options options;
+    if (!ParseCommandLine(argc, argv, options))
+    {
+        std::cerr << "Usage: " << argv[0] << " [--format csv|json] [--output <file>] [--threads <max>]"
+                     " [--repeat <n>] [--ops <per thread>] [--tree-depth <n>] [--fanout <n>]"
+                     " [--rings <n>] [--ring-length <n>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        std::vector<Result> results;
+        {
+            _3fd::core::FrameworkInstance _framework;
+            results = RunBenchmarks(options);
+        }
+
+        std::ofstream outputFile;
+        if (!options.outputFilePath.empty())
+        {
+            outputFile.open(options.outputFilePath, std::ios::out | std::ios::trunc);
+            if (!outputFile.is_open())
+            {
+                std::cerr << "Could not open output file " << options.outputFilePath << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+
+        std::ostream &out = outputFile.is_open() ? outputFile : std::cout;
+        out << std::fixed << std::setprecision(3);
+
+        if (options.format == "json")
+            WriteJson(results, options, out);
+        else
+            WriteCsv(results, out);
+
+        return EXIT_SUCCESS;
+    }
+    catch (_3fd::core::IAppException &appEx)
+    {
+        std::cerr << appEx.ToString() << std::endl;
+    }
+    catch (std::exception &stdEx)
+    {
+        std::cerr << stdEx.what() << std::endl;
+    }
+
+    return EXIT_FAILURE;
+}
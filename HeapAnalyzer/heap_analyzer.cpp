@@ -0,0 +1,591 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#include <3fd/core/exceptions.h>
+#include <3fd/core/gc_heapsnapshot.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+    Offline analysis of a snapshot of the GC heap, as exported by the garbage collector.
+    It builds the dominator tree of the graph of memory blocks, where a block dominates
+    another when every path from the roots to the latter goes through the former. The
+    retained size of a block is then the memory freed along with it once it is dropped,
+    which is the sum of the sizes of the blocks in its subtree. The results are:
+
+    summary     - totals and the blocks and types retaining the most memory
+    vertex CSV  - for each block: address, type tag, size, retained size, dominator
+    type CSV    - for each type tag: count of blocks, their sizes, and the memory they
+                  retain, without counting twice blocks of a type that dominate others
+    DOT         - the dominator tree of the blocks retaining the most memory
+*/
+namespace _3fd
+{
+namespace heap_analyzer
+{
+    using std::string;
+
+    using memory::HeapSnapshot;
+
+    /// <summary>
+    /// The options of the analysis, parsed from the command line.
+    /// </summary>
+    struct Options
+    {
+        string snapshotFilePath;
+        string verticesCsvFilePath;
+        string typesCsvFilePath;
+        string dotFilePath;
+        size_t top;
+
+        Options() : top(20) {}
+    };
+
+    /// <summary>
+    /// Marks the absence of a dominator, for the vertices unreachable from the roots.
+    /// </summary>
+    static const uint32_t noDominator = std::numeric_limits<uint32_t>::max();
+
+    /// <summary>
+    /// A graph in compressed sparse row format, where the node 0 is a virtual root
+    /// pointing to all vertices held by roots, and the vertex of index N is the node N+1.
+    /// </summary>
+    struct Graph
+    {
+        std::vector<uint32_t> first;
+        std::vector<uint32_t> targets;
+
+        /// <summary>
+        /// Builds the graph from a list of edges between nodes.
+        /// </summary>
+        Graph(size_t nodesCount, const std::vector<std::pair<uint32_t, uint32_t>> &edges)
+            : first(nodesCount + 1, 0), targets(edges.size())
+        {
+            for (auto &edge : edges)
+                ++first[edge.first + 1];
+
+            for (size_t idx = 1; idx < first.size(); ++idx)
+                first[idx] += first[idx - 1];
+
+            std::vector<uint32_t> next(first.begin(), first.end() - 1);
+            for (auto &edge : edges)
+                targets[next[edge.first]++] = edge.second;
+        }
+
+        size_t GetNodesCount() const { return first.size() - 1; }
+    };
+
+    /// <summary>
+    /// The outcome of the analysis, indexed by node.
+    /// </summary>
+    struct Analysis
+    {
+        std::vector<uint32_t> dominator;
+        std::vector<uint64_t> retainedSize;
+
+        /// <summary>
+        /// The reachable nodes in postorder of the depth-first search from the
+        /// virtual root, so a node always comes before those dominating it.
+        /// </summary>
+        std::vector<uint32_t> postorder;
+    };
+
+    /// <summary>
+    /// Builds the graph of a snapshot, with duplicate edges left out.
+    /// </summary>
+    static Graph BuildGraph(const HeapSnapshot &snapshot)
+    {
+        std::vector<std::pair<uint32_t, uint32_t>> edges;
+        edges.reserve(snapshot.GetEdges().size() + snapshot.GetRoots().size());
+
+        for (auto &root : snapshot.GetRoots())
+            edges.emplace_back(0, root.to + 1);
+
+        for (auto &edge : snapshot.GetEdges())
+            edges.emplace_back(edge.from + 1, edge.to + 1);
+
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        return Graph(snapshot.GetVertices().size() + 1, edges);
+    }
+
+    /// <summary>
+    /// Intersects the paths of two nodes up the dominator tree, as in the algorithm
+    /// by Cooper, Harvey & Kennedy, "A Simple, Fast Dominance Algorithm".
+    /// </summary>
+    static uint32_t Intersect(uint32_t node1,
+                              uint32_t node2,
+                              const std::vector<uint32_t> &dominator,
+                              const std::vector<uint32_t> &postorderNumber)
+    {
+        while (node1 != node2)
+        {
+            while (postorderNumber[node1] < postorderNumber[node2])
+                node1 = dominator[node1];
+
+            while (postorderNumber[node2] < postorderNumber[node1])
+                node2 = dominator[node2];
+        }
+
+        return node1;
+    }
+
+    /// <summary>
+    /// Computes the dominator tree of the graph, and the retained sizes.
+    /// </summary>
+    static Analysis Analyze(const HeapSnapshot &snapshot, const Graph &graph)
+    {
+        auto nodesCount = graph.GetNodesCount();
+
+        Analysis analysis;
+        analysis.postorder.reserve(nodesCount);
+
+        // Depth-first search without recursion, because chains of objects can be long:
+        std::vector<bool> visited(nodesCount, false);
+        std::vector<std::pair<uint32_t, uint32_t>> stack; // node & next edge
+        stack.emplace_back(0, graph.first[0]);
+        visited[0] = true;
+
+        while (!stack.empty())
+        {
+            auto &top = stack.back();
+            if (top.second < graph.first[top.first + 1])
+            {
+                auto target = graph.targets[top.second++];
+                if (!visited[target])
+                {
+                    visited[target] = true;
+                    stack.emplace_back(target, graph.first[target]);
+                }
+            }
+            else
+            {
+                analysis.postorder.push_back(top.first);
+                stack.pop_back();
+            }
+        }
+
+        std::vector<uint32_t> postorderNumber(nodesCount, noDominator);
+        for (uint32_t number = 0; number < analysis.postorder.size(); ++number)
+            postorderNumber[analysis.postorder[number]] = number;
+
+        // The predecessors of each reachable node:
+        std::vector<std::pair<uint32_t, uint32_t>> reversedEdges;
+        reversedEdges.reserve(graph.targets.size());
+        for (auto node : analysis.postorder)
+        {
+            for (auto idx = graph.first[node]; idx < graph.first[node + 1]; ++idx)
+                reversedEdges.emplace_back(graph.targets[idx], node);
+        }
+
+        Graph predecessors(nodesCount, reversedEdges);
+
+        // Iterate in reverse postorder until the dominators no longer change:
+        analysis.dominator.assign(nodesCount, noDominator);
+        analysis.dominator[0] = 0;
+
+        bool changed(true);
+        while (changed)
+        {
+            changed = false;
+
+            for (auto iter = analysis.postorder.rbegin() + 1; iter != analysis.postorder.rend(); ++iter)
+            {
+                auto node = *iter;
+                auto newDominator = noDominator;
+
+                for (auto idx = predecessors.first[node]; idx < predecessors.first[node + 1]; ++idx)
+                {
+                    auto pred = predecessors.targets[idx];
+                    if (analysis.dominator[pred] == noDominator)
+                        continue;
+
+                    newDominator = (newDominator == noDominator)
+                        ? pred
+                        : Intersect(pred, newDominator, analysis.dominator, postorderNumber);
+                }
+
+                if (analysis.dominator[node] != newDominator)
+                {
+                    analysis.dominator[node] = newDominator;
+                    changed = true;
+                }
+            }
+        }
+
+        // A node comes before its dominator in postorder, so the sizes add up in one pass:
+        auto &vertices = snapshot.GetVertices();
+        analysis.retainedSize.assign(nodesCount, 0);
+        for (uint32_t node = 1; node < nodesCount; ++node)
+            analysis.retainedSize[node] = vertices[node - 1].blockSize;
+
+        for (auto node : analysis.postorder)
+        {
+            if (node != 0)
+                analysis.retainedSize[analysis.dominator[node]] += analysis.retainedSize[node];
+        }
+
+        return analysis;
+    }
+
+    /// <summary>
+    /// Gets the reachable nodes retaining the most memory, largest first.
+    /// </summary>
+    static std::vector<uint32_t> GetTopNodes(const Analysis &analysis, size_t top)
+    {
+        std::vector<uint32_t> nodes;
+        for (auto node : analysis.postorder)
+        {
+            if (node != 0)
+                nodes.push_back(node);
+        }
+
+        top = std::min(top, nodes.size());
+        std::partial_sort(nodes.begin(), nodes.begin() + top, nodes.end(), [&analysis](uint32_t left, uint32_t right)
+        {
+            return analysis.retainedSize[left] > analysis.retainedSize[right];
+        });
+
+        nodes.resize(top);
+        return nodes;
+    }
+
+    /// <summary>
+    /// Statistics of the memory blocks sharing a type tag.
+    /// </summary>
+    struct TypeStats
+    {
+        uint64_t typeTag;
+        uint64_t count;
+        uint64_t size;
+        uint64_t retainedSize;
+    };
+
+    /// <summary>
+    /// Aggregates the statistics by type tag. The memory retained by a block is only
+    /// counted for its type when no other block of the same type dominates it.
+    /// </summary>
+    static std::vector<TypeStats> AggregateByType(const HeapSnapshot &snapshot, const Analysis &analysis)
+    {
+        auto &vertices = snapshot.GetVertices();
+        std::map<uint64_t, TypeStats> statsByTag;
+
+        for (auto &vertex : vertices)
+        {
+            auto &stats = statsByTag[vertex.typeTag];
+            stats.typeTag = vertex.typeTag;
+            stats.count += 1;
+            stats.size += vertex.blockSize;
+        }
+
+        // Children of each node in the dominator tree:
+        std::vector<std::pair<uint32_t, uint32_t>> treeEdges;
+        for (auto node : analysis.postorder)
+        {
+            if (node != 0)
+                treeEdges.emplace_back(analysis.dominator[node], node);
+        }
+
+        Graph tree(analysis.dominator.size(), treeEdges);
+
+        // Walk the tree, keeping track of how many blocks of each type are up the path:
+        std::map<uint64_t, uint32_t> typesUpThePath;
+        std::vector<std::pair<uint32_t, uint32_t>> stack; // node & next child
+        stack.emplace_back(0, tree.first[0]);
+
+        while (!stack.empty())
+        {
+            auto &top = stack.back();
+            if (top.second < tree.first[top.first + 1])
+            {
+                auto child = tree.targets[top.second++];
+                auto typeTag = vertices[child - 1].typeTag;
+
+                if (typesUpThePath[typeTag]++ == 0)
+                    statsByTag[typeTag].retainedSize += analysis.retainedSize[child];
+
+                stack.emplace_back(child, tree.first[child]);
+            }
+            else
+            {
+                if (top.first != 0)
+                    --typesUpThePath[vertices[top.first - 1].typeTag];
+
+                stack.pop_back();
+            }
+        }
+
+        std::vector<TypeStats> result;
+        for (auto &entry : statsByTag)
+            result.push_back(entry.second);
+
+        std::sort(result.begin(), result.end(), [](const TypeStats &left, const TypeStats &right)
+        {
+            return left.retainedSize > right.retainedSize;
+        });
+
+        return result;
+    }
+
+    /// <summary>
+    /// Opens a file for output.
+    /// </summary>
+    static void OpenOutput(const string &filePath, std::ofstream &ofs)
+    {
+        ofs.open(filePath, std::ios::out | std::ios::trunc);
+        if (!ofs.is_open())
+            throw core::AppException<std::runtime_error>("Could not open output file", filePath);
+    }
+
+    static void WriteHex(std::ostream &out, uint64_t value)
+    {
+        out << "0x" << std::hex << value << std::dec;
+    }
+
+    static void WriteDominator(std::ostream &out, uint32_t dominator)
+    {
+        if (dominator == 0)
+            out << "root";
+        else if (dominator == noDominator)
+            out << "unreachable";
+        else
+            out << dominator - 1;
+    }
+
+    /// <summary>
+    /// Writes a CSV with the analysis for each vertex.
+    /// </summary>
+    static void WriteVerticesCsv(const HeapSnapshot &snapshot, const Analysis &analysis, std::ostream &out)
+    {
+        out << "index,address,type_tag,block_size,retained_size,dominator\n";
+
+        auto &vertices = snapshot.GetVertices();
+        for (uint32_t idx = 0; idx < vertices.size(); ++idx)
+        {
+            out << idx << ',';
+            WriteHex(out, vertices[idx].address);
+            out << ',';
+            WriteHex(out, vertices[idx].typeTag);
+            out << ',' << vertices[idx].blockSize << ',' << analysis.retainedSize[idx + 1] << ',';
+            WriteDominator(out, analysis.dominator[idx + 1]);
+            out << '\n';
+        }
+    }
+
+    /// <summary>
+    /// Writes a CSV with the statistics for each type tag.
+    /// </summary>
+    static void WriteTypesCsv(const std::vector<TypeStats> &types, std::ostream &out)
+    {
+        out << "type_tag,count,size,retained_size\n";
+
+        for (auto &stats : types)
+        {
+            WriteHex(out, stats.typeTag);
+            out << ',' << stats.count << ',' << stats.size << ',' << stats.retainedSize << '\n';
+        }
+    }
+
+    /// <summary>
+    /// Writes the dominator tree of the vertices retaining the most memory in DOT format,
+    /// along with the vertices dominating them, all the way up to the roots.
+    /// </summary>
+    static void WriteDot(const HeapSnapshot &snapshot,
+                         const Analysis &analysis,
+                         const std::vector<uint32_t> &topNodes,
+                         std::ostream &out)
+    {
+        std::set<uint32_t> nodes;
+        for (auto node : topNodes)
+        {
+            while (node != 0 && nodes.insert(node).second)
+                node = analysis.dominator[node];
+        }
+
+        out << "digraph dominators {\n"
+               "    node [shape=box];\n"
+               "    root [label=\"roots\\nretained " << analysis.retainedSize[0] << "\"];\n";
+
+        auto &vertices = snapshot.GetVertices();
+        for (auto node : nodes)
+        {
+            auto &vertex = vertices[node - 1];
+            out << "    v" << node - 1 << " [label=\"";
+            WriteHex(out, vertex.address);
+            out << "\\ntype ";
+            WriteHex(out, vertex.typeTag);
+            out << "\\nsize " << vertex.blockSize
+                << "\\nretained " << analysis.retainedSize[node] << "\"];\n";
+        }
+
+        for (auto node : nodes)
+        {
+            auto dominator = analysis.dominator[node];
+            out << "    ";
+
+            if (dominator == 0)
+                out << "root";
+            else
+                out << 'v' << dominator - 1;
+
+            out << " -> v" << node - 1 << ";\n";
+        }
+
+        out << "}\n";
+    }
+
+    /// <summary>
+    /// Writes a summary of the analysis.
+    /// </summary>
+    static void WriteSummary(const HeapSnapshot &snapshot,
+                             const Analysis &analysis,
+                             const std::vector<uint32_t> &topNodes,
+                             const std::vector<TypeStats> &types,
+                             size_t top,
+                             std::ostream &out)
+    {
+        uint64_t totalSize(0);
+        for (auto &vertex : snapshot.GetVertices())
+            totalSize += vertex.blockSize;
+
+        out << "vertices: " << snapshot.GetVertices().size()
+            << ", edges: " << snapshot.GetEdges().size()
+            << ", roots: " << snapshot.GetRoots().size()
+            << "\nmanaged bytes: " << totalSize
+            << ", reachable: " << analysis.retainedSize[0]
+            << ", awaiting collection: " << totalSize - analysis.retainedSize[0]
+            << "\n\nblocks retaining the most memory (index, address, type, size, retained, dominator):\n";
+
+        auto &vertices = snapshot.GetVertices();
+        for (auto node : topNodes)
+        {
+            auto &vertex = vertices[node - 1];
+            out << "  " << node - 1 << ", ";
+            WriteHex(out, vertex.address);
+            out << ", ";
+            WriteHex(out, vertex.typeTag);
+            out << ", " << vertex.blockSize << ", " << analysis.retainedSize[node] << ", ";
+            WriteDominator(out, analysis.dominator[node]);
+            out << '\n';
+        }
+
+        out << "\ntypes retaining the most memory (type, count, size, retained):\n";
+
+        for (size_t idx = 0; idx < std::min(top, types.size()); ++idx)
+        {
+            out << "  ";
+            WriteHex(out, types[idx].typeTag);
+            out << ", " << types[idx].count << ", " << types[idx].size << ", " << types[idx].retainedSize << '\n';
+        }
+    }
+
+    /// <summary>
+    /// Parses the command line.
+    /// </summary>
+    /// <returns>Whether the command line was valid.</returns>
+    static bool ParseCommandLine(int argc, char *argv[], Options &options)
+    {
+        if (argc < 2)
+            return false;
+
+        options.snapshotFilePath = argv[1];
+
+        for (int idx = 2; idx < argc; ++idx)
+        {
+            string arg = argv[idx];
+
+            if (idx + 1 >= argc)
+                return false;
+
+            string value = argv[++idx];
+
+            if (arg == "--csv")
+                options.verticesCsvFilePath = value;
+            else if (arg == "--types")
+                options.typesCsvFilePath = value;
+            else if (arg == "--dot")
+                options.dotFilePath = value;
+            else if (arg == "--top" && std::atoll(value.c_str()) > 0)
+                options.top = std::atoll(value.c_str());
+            else
+                return false;
+        }
+
+        return true;
+    }
+
+}// end of namespace heap_analyzer
+}// end of namespace _3fd
+
+int main(int argc, char *argv[])
+{
+    using namespace _3fd::heap_analyzer;
+
+    Options options;
+    if (!ParseCommandLine(argc, argv, options))
+    {
+        std::cerr << "Usage: " << argv[0] << " <snapshot file> [--csv <file>] [--types <file>]"
+                     " [--dot <file>] [--top <n>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        auto snapshot = HeapSnapshot::Load(options.snapshotFilePath);
+        auto graph = BuildGraph(snapshot);
+        auto analysis = Analyze(snapshot, graph);
+        auto topNodes = GetTopNodes(analysis, options.top);
+        auto types = AggregateByType(snapshot, analysis);
+
+        WriteSummary(snapshot, analysis, topNodes, types, options.top, std::cout);
+
+        std::ofstream outputFile;
+
+        if (!options.verticesCsvFilePath.empty())
+        {
+            OpenOutput(options.verticesCsvFilePath, outputFile);
+            WriteVerticesCsv(snapshot, analysis, outputFile);
+            outputFile.close();
+        }
+
+        if (!options.typesCsvFilePath.empty())
+        {
+            OpenOutput(options.typesCsvFilePath, outputFile);
+            WriteTypesCsv(types, outputFile);
+            outputFile.close();
+        }
+
+        if (!options.dotFilePath.empty())
+        {
+            OpenOutput(options.dotFilePath, outputFile);
+            WriteDot(snapshot, analysis, topNodes, outputFile);
+            outputFile.close();
+        }
+
+        return EXIT_SUCCESS;
+    }
+    catch (_3fd::core::IAppException &appEx)
+    {
+        std::cerr << appEx.ToString() << std::endl;
+    }
+    catch (std::exception &stdEx)
+    {
+        std::cerr << stdEx.what() << std::endl;
+    }
+
+    return EXIT_FAILURE;
+}
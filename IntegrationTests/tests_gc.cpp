@@ -5,16 +5,22 @@
 //
 #include "pch.h"
 #include <3fd/core/runtime.h>
+#include <3fd/core/configuration.h>
 #include <3fd/core/sptr.h>
+#include <3fd/core/gc_vector.h>
+#include <3fd/core/gc_heapsnapshot.h>
 
 #include <map>
 #include <list>
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <thread>
 #include <future>
 #include <random>
 #include <iostream>
+#include <cstdio>
+#include <cstdint>
 
 namespace _3fd
 {
@@ -26,6 +32,11 @@ namespace integration_tests
     using namespace _3fd::core;
     using memory::sptr;
     using memory::const_sptr;
+    using memory::make_sptr;
+    using memory::make_aligned_sptr;
+    using memory::make_sptr_array;
+    using memory::weak_sptr;
+    using memory::gc_vector;
 
     void HandleException();
 
@@ -115,10 +126,917 @@ namespace integration_tests
         sptr<Foo> m_any;
     };
 
+    /// <summary>
+    /// Object that keeps count of how many instances are alive.
+    /// </summary>
+    struct Tracked
+    {
+        static std::atomic<int> liveCount;
+
+        sptr<Tracked> m_next;
+
+        Tracked() { ++liveCount; }
+
+        ~Tracked() { --liveCount; }
+    };
+
+    std::atomic<int> Tracked::liveCount(0);
+
+    /// <summary>
+    /// Object owned by <see cref="SlowOwner"/>, which
+    /// must not be finalized before its owner.
+    /// </summary>
+    struct Owned
+    {
+        static std::atomic<int> liveCount;
+        static std::atomic<int> outOfOrderCount;
+
+        bool m_ownerFinalized;
+
+        Owned() : m_ownerFinalized(false) { ++liveCount; }
+
+        ~Owned()
+        {
+            if (!m_ownerFinalized)
+                ++outOfOrderCount;
+
+            --liveCount;
+        }
+    };
+
+    std::atomic<int> Owned::liveCount(0);
+    std::atomic<int> Owned::outOfOrderCount(0);
+
+    /// <summary>
+    /// Object whose destructor takes a while, and makes use of the object it owns.
+    /// </summary>
+    struct SlowOwner
+    {
+        static std::chrono::milliseconds finalizationTime;
+
+        sptr<Owned> m_owned;
+
+        ~SlowOwner()
+        {
+            std::this_thread::sleep_for(finalizationTime);
+
+            if (!m_owned.Off())
+                m_owned->m_ownerFinalized = true;
+        }
+    };
+
+    std::chrono::milliseconds SlowOwner::finalizationTime(20);
+
+    /// <summary>
+    /// Object whose destructor throws something other than an exception.
+    /// </summary>
+    struct ThrowingOnDestruction
+    {
+        static std::atomic<int> destroyedCount;
+
+        ~ThrowingOnDestruction() noexcept(false)
+        {
+            ++destroyedCount;
+            throw 42;
+        }
+    };
+
+    std::atomic<int> ThrowingOnDestruction::destroyedCount(0);
+
+    /// <summary>
+    /// Waits for the GC to collect all <see cref="Tracked"/> objects.
+    /// </summary>
+    /// <returns>Whether all objects were collected before the timeout.</returns>
+    static bool WaitForTrackedObjectsCollection()
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+        while (Tracked::liveCount.load() > 0 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        return Tracked::liveCount.load() == 0;
+    }
+
+    /// <summary>
+    /// Tests the garbage collector with several threads producing messages,
+    /// some of them handing safe pointers over to the main thread.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, MultipleProducers_Test)
+    {
+        // Ensures proper initialization/finalization of the framework
+#   ifdef _3FD_PLATFORM_WINRT
+        core::FrameworkInstance _framework("IntegrationTestsApp.WinRT.UWP");
+#   else
+        core::FrameworkInstance _framework;
+#   endif
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            const int numThreads(8), chainLength(1000);
+
+            std::vector<sptr<Tracked>> heads(numThreads);
+            std::vector<std::promise<void>> promises(numThreads);
+            std::vector<std::thread> threads;
+            threads.reserve(numThreads);
+
+            // the pointers must be known by the GC before other threads use them:
+            memory::GarbageCollector::GetInstance().PublishThreadMessages();
+
+            for (int idx = 0; idx < numThreads; ++idx)
+            {
+                threads.emplace_back([&head = heads[idx], &promise = promises[idx]]()
+                {
+                    head.has(Tracked());
+
+                    sptr<Tracked> tail = head;
+                    for (int count = 1; count < chainLength; ++count)
+                    {
+                        tail->m_next.has(Tracked());
+                        tail = tail->m_next;
+                    }
+
+                    // some garbage which is never handed over:
+                    sptr<Tracked> garbage;
+                    garbage.has(Tracked());
+                    garbage->m_next.has(Tracked());
+                    garbage->m_next->m_next = garbage;
+
+                    // messages must reach the GC before another thread uses the pointer:
+                    memory::GarbageCollector::GetInstance().PublishThreadMessages();
+                    promise.set_value();
+                });
+            }
+
+            for (auto &promise : promises)
+                promise.get_future().wait();
+
+            std::vector<sptr<Tracked>> copies(heads.begin(), heads.end());
+
+            for (auto &thread : threads)
+                thread.join();
+
+            EXPECT_LE(numThreads * chainLength, Tracked::liveCount.load());
+
+            copies.clear();
+            heads.clear();
+            memory::GarbageCollector::GetInstance().PublishThreadMessages();
+
+            EXPECT_TRUE(WaitForTrackedObjectsCollection());
+
+            // the backlog of messages was large enough to wake up the GC thread:
+            auto stats = memory::GarbageCollector::GetInstance().GetStatistics();
+            EXPECT_LT(0U, stats.demandWakeUpsCount);
+            EXPECT_LT(0U, stats.peakMessagesBacklog);
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Tests that the messages batched by a thread which has gone idle
+    /// reach the garbage collector without the thread publishing them.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, IdleProducer_Test)
+    {
+        // Ensures proper initialization/finalization of the framework
+#   ifdef _3FD_PLATFORM_WINRT
+        core::FrameworkInstance _framework("IntegrationTestsApp.WinRT.UWP");
+#   else
+        core::FrameworkInstance _framework;
+#   endif
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            std::promise<void> released, checked;
+
+            // a few messages, far less than a batch, are left in the buffer of the thread:
+            std::thread producer([&released, &checked]()
+            {
+                {
+                    sptr<Tracked> object;
+                    object.has(Tracked());
+                }
+
+                released.set_value();
+                checked.get_future().wait();
+            });
+
+            released.get_future().wait();
+            EXPECT_TRUE(WaitForTrackedObjectsCollection());
+
+            checked.set_value();
+            producer.join();
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Tests the statistics the garbage collector keeps about its operation.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, Statistics_Test)
+    {
+        // Ensures proper initialization/finalization of the framework
+#   ifdef _3FD_PLATFORM_WINRT
+        core::FrameworkInstance _framework("IntegrationTestsApp.WinRT.UWP");
+#   else
+        core::FrameworkInstance _framework;
+#   endif
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            const int count(1000);
+            auto &gc = memory::GarbageCollector::GetInstance();
+
+            {
+                std::vector<sptr<Tracked>> objects(count);
+                for (auto &object : objects)
+                    object.has(Tracked());
+
+                // a cycle, which is only released by a collection:
+                objects[0]->m_next = objects[1];
+                objects[1]->m_next = objects[0];
+
+                gc.PublishThreadMessages();
+
+                // statistics are published by the GC thread once it is done with the messages:
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+                while (gc.GetStatistics().verticesCount < count && std::chrono::steady_clock::now() < deadline)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+                auto stats = gc.GetStatistics();
+                EXPECT_LE(static_cast<size_t> (count), stats.verticesCount);
+                EXPECT_LE(static_cast<size_t> (count), stats.sptrObjectsCount);
+                EXPECT_LE(count * sizeof(Tracked), stats.managedBytes);
+            }
+
+            gc.PublishThreadMessages();
+            EXPECT_TRUE(WaitForTrackedObjectsCollection());
+
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (gc.GetStatistics().freedBytes < count * sizeof(Tracked) && std::chrono::steady_clock::now() < deadline)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+            auto stats = gc.GetStatistics();
+            EXPECT_LE(count * sizeof(Tracked), stats.freedBytes);
+            EXPECT_LE(static_cast<uint64_t> (count), stats.messagesProcessedCount[static_cast<size_t> (memory::MessageType::NewObject)]);
+            EXPECT_LE(static_cast<uint64_t> (count), stats.messagesProcessedCount[static_cast<size_t> (memory::MessageType::SptrUnregistration)]);
+            EXPECT_LT(0U, stats.collectionsCount);
+            EXPECT_LT(0U, stats.visitsCount);
+            EXPECT_LT(0U, stats.loopIterationsCount);
+            EXPECT_LE(stats.lastLoopIterationTime, stats.peakLoopIterationTime);
+            EXPECT_LE(stats.peakLoopIterationTime, stats.totalLoopIterationTime);
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Tests waiting for the garbage collector to catch up with the messages.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, Flush_Test)
+    {
+        // Ensures proper initialization/finalization of the framework
+#   ifdef _3FD_PLATFORM_WINRT
+        core::FrameworkInstance _framework("IntegrationTestsApp.WinRT.UWP");
+#   else
+        core::FrameworkInstance _framework;
+#   endif
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            auto &gc = memory::GarbageCollector::GetInstance();
+
+            // a chain is released one link at a time, by the destructor of the previous one:
+            const int chainLength(1000);
+            {
+                sptr<Tracked> head;
+                head.has(Tracked());
+
+                sptr<Tracked> tail = head;
+                for (int count = 1; count < chainLength; ++count)
+                {
+                    tail->m_next.has(Tracked());
+                    tail = tail->m_next;
+                }
+            }
+
+            gc.Flush();
+            EXPECT_EQ(0, Tracked::liveCount.load());
+
+            auto stats = gc.GetStatistics();
+            EXPECT_EQ(0U, stats.messagesBacklog);
+            EXPECT_LE(static_cast<uint64_t> (chainLength), stats.messagesProcessedCount[static_cast<size_t> (memory::MessageType::NewObject)]);
+
+            {
+                sptr<Tracked> object;
+                object.has(Tracked());
+            }
+
+            EXPECT_TRUE(gc.Flush(std::chrono::seconds(10)));
+            EXPECT_EQ(0, Tracked::liveCount.load());
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Tests forcing the garbage collector to collect unreachable cycles.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, Collect_Test)
+    {
+        // Ensures proper initialization/finalization of the framework
+#   ifdef _3FD_PLATFORM_WINRT
+        core::FrameworkInstance _framework("IntegrationTestsApp.WinRT.UWP");
+#   else
+        core::FrameworkInstance _framework;
+#   endif
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            auto &gc = memory::GarbageCollector::GetInstance();
+
+            // few cycles, so their collection is deferred by the configuration:
+            for (int idx = 0; idx < 3; ++idx)
+            {
+                sptr<Tracked> first;
+                first.has(Tracked());
+                first->m_next.has(Tracked());
+                first->m_next->m_next = first;
+            }
+
+            gc.Collect();
+            EXPECT_EQ(0, Tracked::liveCount.load());
+
+            for (int idx = 0; idx < 3; ++idx)
+            {
+                sptr<Tracked> first;
+                first.has(Tracked());
+                first->m_next = first;
+            }
+
+            EXPECT_TRUE(gc.Collect(std::chrono::seconds(10)));
+            EXPECT_EQ(0, Tracked::liveCount.load());
+
+            // with nothing else going on, no more memory of the GC is released:
+            auto releasedBytes = gc.GetStatistics().vertexPoolReleasedBytes;
+            gc.Collect();
+            EXPECT_EQ(releasedBytes, gc.GetStatistics().vertexPoolReleasedBytes);
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Tests the export of a snapshot of the GC heap, and its loading back.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, HeapSnapshot_Test)
+    {
+        // Ensures proper initialization/finalization of the framework
+#   ifdef _3FD_PLATFORM_WINRT
+        core::FrameworkInstance _framework("IntegrationTestsApp.WinRT.UWP");
+#   else
+        core::FrameworkInstance _framework;
+#   endif
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            const char *filePath = "gc_heap_snapshot.bin";
+
+            // a root, then a chain that ends in a cycle:
+            sptr<Nexus> head;
+            head.has(Nexus(0));
+            head->m_next.has(Nexus(1));
+            head->m_next->m_next.has(Nexus(2));
+            head->m_next->m_next->m_next = head->m_next;
+
+            memory::GarbageCollector::GetInstance().ExportHeapSnapshot(filePath);
+
+            auto snapshot = memory::HeapSnapshot::Load(filePath);
+            std::remove(filePath);
+
+            EXPECT_LT(0, snapshot.GetTimeTaken().count());
+
+            // find the vertices of the objects:
+            std::array<const Nexus *, 3> objects = { &*head, &*head->m_next, &*head->m_next->m_next };
+            std::array<uint32_t, 3> indexes = { UINT32_MAX, UINT32_MAX, UINT32_MAX };
+
+            auto &vertices = snapshot.GetVertices();
+            for (uint32_t idx = 0; idx < vertices.size(); ++idx)
+            {
+                for (size_t objIdx = 0; objIdx < objects.size(); ++objIdx)
+                {
+                    if (vertices[idx].address == reinterpret_cast<uintptr_t> (objects[objIdx]))
+                    {
+                        indexes[objIdx] = idx;
+                        EXPECT_EQ(sizeof(Nexus), vertices[idx].blockSize);
+                    }
+                }
+            }
+
+            ASSERT_NE(UINT32_MAX, indexes[0]);
+            ASSERT_NE(UINT32_MAX, indexes[1]);
+            ASSERT_NE(UINT32_MAX, indexes[2]);
+
+            // objects of the same type share the tag:
+            EXPECT_EQ(vertices[indexes[0]].typeTag, vertices[indexes[1]].typeTag);
+            EXPECT_EQ(vertices[indexes[0]].typeTag, vertices[indexes[2]].typeTag);
+
+            auto &roots = snapshot.GetRoots();
+            EXPECT_TRUE(std::any_of(roots.begin(), roots.end(), [&head, &indexes](const memory::HeapSnapshot::RootRecord &root)
+            {
+                return root.sptrAddress == reinterpret_cast<uintptr_t> (&head) && root.to == indexes[0];
+            }));
+
+            auto hasEdge = [&snapshot, &indexes](size_t from, size_t to)
+            {
+                auto &edges = snapshot.GetEdges();
+                return std::any_of(edges.begin(), edges.end(), [&indexes, from, to](const memory::HeapSnapshot::EdgeRecord &edge)
+                {
+                    return edge.from == indexes[from] && edge.to == indexes[to];
+                });
+            };
+
+            EXPECT_TRUE(hasEdge(0, 1));
+            EXPECT_TRUE(hasEdge(1, 2));
+            EXPECT_TRUE(hasEdge(2, 1));
+            EXPECT_FALSE(hasEdge(1, 0));
+
+            head->m_next->m_next->m_next.Reset();
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Tests the finalization of the objects collected, which with finalizer threads
+    /// neither holds up the GC, nor finalizes an object before the one owning it.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, Finalizers_Test)
+    {
+        // Ensures proper initialization/finalization of the framework
+#   ifdef _3FD_PLATFORM_WINRT
+        core::FrameworkInstance _framework("IntegrationTestsApp.WinRT.UWP");
+#   else
+        core::FrameworkInstance _framework;
+#   endif
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            auto &gc = memory::GarbageCollector::GetInstance();
+
+            const int count(8);
+            for (int idx = 0; idx < count; ++idx)
+            {
+                sptr<SlowOwner> owner;
+                owner.has(SlowOwner());
+                owner->m_owned.has(Owned());
+
+            }
+
+            gc.Collect();
+            EXPECT_EQ(0, Owned::liveCount.load());
+            EXPECT_EQ(0, Owned::outOfOrderCount.load());
+
+            if (AppConfig::GetSettings().framework.gc.numFinalizerThreads < 2)
+                return;
+
+            auto stats = gc.GetStatistics();
+            EXPECT_EQ(0U, stats.finalizationBacklog);
+            EXPECT_LE(static_cast<uint64_t> (2 * count), stats.finalizedObjectsCount);
+            EXPECT_LE(SlowOwner::finalizationTime, stats.peakFinalizationLatency);
+            EXPECT_LE(stats.peakFinalizationLatency, stats.totalFinalizationLatency);
+
+            // an object whose destructor takes long does not hold up the collection of others:
+            const std::chrono::seconds longFinalizationTime(1);
+            SlowOwner::finalizationTime = longFinalizationTime;
+            {
+                sptr<SlowOwner> owner;
+                owner.has(SlowOwner());
+                owner->m_owned.has(Owned());
+            }
+
+            gc.PublishThreadMessages();
+
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (gc.GetStatistics().finalizationBacklog == 0 && std::chrono::steady_clock::now() < deadline)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+            auto startTime = std::chrono::steady_clock::now();
+            {
+                sptr<Tracked> object;
+                object.has(Tracked());
+            }
+
+            gc.PublishThreadMessages();
+            EXPECT_TRUE(WaitForTrackedObjectsCollection());
+            EXPECT_GT(longFinalizationTime, std::chrono::steady_clock::now() - startTime);
+
+            gc.Flush();
+            SlowOwner::finalizationTime = std::chrono::milliseconds(20);
+            EXPECT_EQ(0, Owned::liveCount.load());
+            EXPECT_EQ(0, Owned::outOfOrderCount.load());
+
+            // whatever a destructor throws, the finalizer threads carry on:
+            {
+                sptr<ThrowingOnDestruction> object;
+                object.has(ThrowingOnDestruction());
+            }
+
+            gc.Flush();
+            EXPECT_EQ(1, ThrowingOnDestruction::destroyedCount.load());
+
+            {
+                sptr<Tracked> object;
+                object.has(Tracked());
+            }
+
+            gc.Flush();
+            EXPECT_EQ(0, Tracked::liveCount.load());
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Tests weak references to garbage collected objects, which do not keep
+    /// them alive, and are locked meanwhile they are collected by another thread.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, WeakSptr_Test)
+    {
+        // Ensures proper initialization/finalization of the framework
+#   ifdef _3FD_PLATFORM_WINRT
+        core::FrameworkInstance _framework("IntegrationTestsApp.WinRT.UWP");
+#   else
+        core::FrameworkInstance _framework;
+#   endif
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            auto &gc = memory::GarbageCollector::GetInstance();
+
+            weak_sptr<Tracked> nothing;
+            EXPECT_TRUE(nothing.IsExpired());
+            EXPECT_TRUE(nothing.Lock().Off());
+
+            // While the object is alive, locking gets it:
+            auto object = make_sptr<Tracked>();
+            weak_sptr<Tracked> weak(object);
+            weak_sptr<Tracked> weakCopy(weak);
+
+            gc.Flush();
+            EXPECT_FALSE(weak.IsExpired());
+
+            auto locked = weakCopy.Lock();
+            EXPECT_TRUE(locked == object);
+
+            // A weak reference does not keep the object alive:
+            object.Reset();
+            locked.Reset();
+            gc.Flush();
+            EXPECT_EQ(0, Tracked::liveCount.load());
+            EXPECT_TRUE(weak.IsExpired());
+            EXPECT_TRUE(weak.Lock().Off());
+            EXPECT_TRUE(weakCopy.Lock().Off());
+
+            // Neither it does when the object is in a cycle:
+            {
+                sptr<Tracked> first;
+                first.has(Tracked());
+                first->m_next.has(Tracked());
+                first->m_next->m_next = first;
+                weak = first->m_next;
+            }
+
+            gc.Collect();
+            EXPECT_EQ(0, Tracked::liveCount.load());
+            EXPECT_TRUE(weak.Lock().Off());
+
+            // Locking by other threads while the objects are collected:
+            const int count = 100;
+            std::vector<weak_sptr<Tracked>> cache;
+            {
+                std::vector<sptr<Tracked>> objects;
+                for (int idx = 0; idx < count; ++idx)
+                {
+                    objects.push_back(make_sptr<Tracked>());
+                    objects.back()->m_next = objects.back(); // some in cycles
+                    cache.push_back(objects.back());
+                }
+
+                // the weak pointers are handed over to other threads:
+                gc.PublishThreadMessages();
+
+                std::atomic<bool> done(false);
+                std::vector<std::future<int>> readers;
+                for (int idx = 0; idx < 2; ++idx)
+                {
+                    readers.push_back(std::async(std::launch::async, [&gc, &cache, &done]()
+                    {
+                        int lockedCount(0);
+                        while (!done.load())
+                        {
+                            for (auto &entry : cache)
+                            {
+                                auto object = entry.Lock();
+                                if (!object.Off())
+                                {
+                                    EXPECT_FALSE(object->m_next.Off());
+                                    ++lockedCount;
+                                }
+                            }
+                        }
+
+                        gc.PublishThreadMessages();
+                        return lockedCount;
+                    }));
+                }
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+                objects.clear();
+                gc.Collect();
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                done.store(true);
+
+                for (auto &reader : readers)
+                    EXPECT_LT(0, reader.get());
+            }
+
+            gc.Collect();
+            EXPECT_EQ(0, Tracked::liveCount.load());
+
+            for (auto &entry : cache)
+                EXPECT_TRUE(entry.Lock().Off());
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Tests objects created in the scope of an arena, which the GC does
+    /// not manage, and are all destroyed at once when the scope ends.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, Arena_Test)
+    {
+        // Ensures proper initialization/finalization of the framework
+#   ifdef _3FD_PLATFORM_WINRT
+        core::FrameworkInstance _framework("IntegrationTestsApp.WinRT.UWP");
+#   else
+        core::FrameworkInstance _framework;
+#   endif
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            auto &gc = memory::GarbageCollector::GetInstance();
+            gc.Flush();
+            auto verticesCount = gc.GetStatistics().verticesCount;
+
+            // Objects in the arena are not vertices of the graph:
+            const int chainLength(1000);
+            const int arrayLength(10);
+            {
+                memory::gc_arena arena;
+
+                sptr<Tracked> head;
+                head.has(Tracked());
+
+                sptr<Tracked> tail = head;
+                for (int count = 1; count < chainLength; ++count)
+                {
+                    tail->m_next = make_sptr<Tracked>();
+                    tail = tail->m_next;
+                }
+
+                auto array = make_sptr_array<Tracked>(arrayLength);
+                array[0].m_next = head;
+
+                EXPECT_TRUE(memory::gc_arena::IsArenaMemory(&*head));
+                EXPECT_TRUE(memory::gc_arena::IsArenaMemory(&head->m_next));
+                EXPECT_FALSE(memory::gc_arena::IsArenaMemory(&head));
+                EXPECT_EQ(3U, arena.GetExternalRefsCount());
+                EXPECT_LE((chainLength + arrayLength) * sizeof(Tracked), arena.GetAllocatedBytes());
+                EXPECT_EQ(chainLength + arrayLength, Tracked::liveCount.load());
+
+                gc.Flush();
+                EXPECT_EQ(verticesCount, gc.GetStatistics().verticesCount);
+            }
+
+            EXPECT_EQ(0, Tracked::liveCount.load());
+
+            // An object in the arena keeps alive the object managed by the GC it references:
+            {
+                auto heapObject = make_sptr<Tracked>();
+
+                memory::gc_arena arena;
+                auto arenaObject = make_sptr<Tracked>();
+                arenaObject->m_next = heapObject;
+                heapObject.Reset();
+
+                gc.Collect();
+                EXPECT_EQ(2, Tracked::liveCount.load());
+                EXPECT_FALSE(memory::gc_arena::IsArenaMemory(&*arenaObject->m_next));
+                EXPECT_ANY_THROW(weak_sptr<Tracked> weak(arenaObject));
+            }
+
+            gc.Flush();
+            EXPECT_EQ(0, Tracked::liveCount.load());
+
+            // A reference that escapes the scope keeps the arena from being freed:
+            sptr<Nexus> escaped;
+            {
+                memory::gc_arena arena;
+                auto first = make_sptr<Nexus>(1);
+                first->m_next = make_sptr<Nexus>(2);
+                escaped = first->m_next;
+                first.Reset();
+
+                EXPECT_EQ(1U, arena.GetExternalRefsCount());
+            }
+
+            EXPECT_EQ(2, escaped->m_seqId);
+            EXPECT_TRUE(escaped->m_next.Off());
+            escaped.Reset();
+
+            // The objects managed by the GC are released by the abandoned ones referencing them:
+            weak_sptr<Nexus> heapObjectWeak;
+            {
+                auto heapObject = make_sptr<Nexus>(3);
+                heapObjectWeak = weak_sptr<Nexus>(heapObject);
+
+                memory::gc_arena arena;
+                escaped = make_sptr<Nexus>(4);
+                escaped->m_next = heapObject;
+                heapObject.Reset();
+
+                EXPECT_EQ(1U, arena.GetExternalRefsCount());
+            }
+
+            EXPECT_TRUE(escaped->m_next.Off());
+
+            gc.Collect();
+            EXPECT_TRUE(heapObjectWeak.IsExpired());
+            escaped.Reset();
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
     /// <summary>
     /// Tests the garbage collector for copy of safe pointers.
     /// </summary>
-    TEST(Framework_MemoryGC_TestCase, CopySemantics_Test)
+    TEST(Framework_MemoryGC_TestCase, CopySemantics_Test)
+    {
+        // Ensures proper initialization/finalization of the framework
+#   ifdef _3FD_PLATFORM_WINRT
+        core::FrameworkInstance _framework("IntegrationTestsApp.WinRT.UWP");
+#   else
+        core::FrameworkInstance _framework;
+#   endif
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            auto createResourceHolder = []()
+            {
+                sptr<ResourceHolder> x;
+                x.has(ResourceHolder());
+                return x;
+            };
+
+            sptr<ResourceHolder> y = createResourceHolder();
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Tests the garbage collector for move of safe pointers.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, MoveSemantics_Test)
+    {
+        // Ensures proper initialization/finalization of the framework
+#   ifdef _3FD_PLATFORM_WINRT
+        core::FrameworkInstance _framework("IntegrationTestsApp.WinRT.UWP");
+#   else
+        core::FrameworkInstance _framework;
+#   endif
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            const int count(1000);
+
+            {
+                // growth of the vector moves the pointers around:
+                std::vector<sptr<Tracked>> pointers;
+                for (int idx = 0; idx < count; ++idx)
+                {
+                    sptr<Tracked> ptr;
+                    ptr.has(Tracked());
+                    pointers.push_back(std::move(ptr));
+                    EXPECT_TRUE(ptr.Off());
+                }
+
+                // move between members of the same object, and across objects:
+                for (int idx = 1; idx < count; ++idx)
+                {
+                    auto &node = pointers[idx];
+                    node->m_next.has(Tracked());
+                    sptr<Tracked> temp(std::move(node->m_next));
+                    node->m_next = std::move(temp);
+                    pointers[idx - 1]->m_next = std::move(node->m_next);
+                }
+
+                // move assignment of pointers referencing the same object:
+                sptr<Tracked> other = pointers[0];
+                pointers[0] = std::move(other);
+                EXPECT_TRUE(other.Off());
+
+                // moving into a pointer releases what it referenced before:
+                pointers[1] = std::move(pointers[2]);
+                EXPECT_TRUE(pointers[2].Off());
+
+                memory::GarbageCollector::GetInstance().PublishThreadMessages();
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+                // everything still referenced must be alive:
+                EXPECT_LE(count, Tracked::liveCount.load());
+
+                EXPECT_FALSE(pointers[1]->m_next.Off());
+                for (int idx = 3; idx < count - 1; ++idx)
+                    EXPECT_FALSE(pointers[idx]->m_next.Off());
+            }
+
+            memory::GarbageCollector::GetInstance().PublishThreadMessages();
+            EXPECT_TRUE(WaitForTrackedObjectsCollection());
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Object without safe pointers inside, whose construction can fail.
+    /// </summary>
+    struct Point
+    {
+        int x, y;
+
+        Point(int px, int py) :
+            x(px), y(py)
+        {
+            if (px < 0 || py < 0)
+                throw AppException<std::invalid_argument>("Negative coordinate");
+        }
+    };
+
+    /// <summary>
+    /// Tests the creation of objects by <see cref="memory::make_sptr"/>.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, MakeSptr_Test)
     {
         // Ensures proper initialization/finalization of the framework
 #   ifdef _3FD_PLATFORM_WINRT
@@ -131,14 +1049,463 @@ namespace integration_tests
 
         try
         {
-            auto createResourceHolder = []()
+            const int count(1000);
+
             {
-                sptr<ResourceHolder> x;
-                x.has(ResourceHolder());
-                return x;
+                // objects with safe pointers inside:
+                auto head = make_sptr<Tracked>();
+                sptr<Tracked> tail = head;
+                for (int idx = 1; idx < count; ++idx)
+                {
+                    tail->m_next = make_sptr<Tracked>();
+                    tail = tail->m_next;
+                }
+
+                // object without safe pointers inside:
+                auto point = make_sptr<Point>(6, 9);
+                EXPECT_EQ(6, point->x);
+                EXPECT_EQ(9, point->y);
+
+                const_sptr<Point> constPoint = make_sptr<Point>(9, 6);
+                EXPECT_EQ(9, constPoint->x);
+
+                // failed construction:
+                EXPECT_THROW(make_sptr<Point>(-1, 0), AppException<std::invalid_argument>);
+                EXPECT_THROW(make_sptr<ResourceHolder>(true), AppException<std::runtime_error>);
+
+                memory::GarbageCollector::GetInstance().PublishThreadMessages();
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+                EXPECT_LE(count, Tracked::liveCount.load());
+            }
+
+            memory::GarbageCollector::GetInstance().PublishThreadMessages();
+            EXPECT_TRUE(WaitForTrackedObjectsCollection());
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Object that fails construction after a given amount of instances.
+    /// </summary>
+    struct Fragile
+    {
+        static int countdown;
+
+        sptr<Tracked> m_tracked;
+
+        Fragile()
+        {
+            if (--countdown == 0)
+                throw AppException<std::runtime_error>("Countdown has reached zero");
+
+            m_tracked = make_sptr<Tracked>();
+        }
+    };
+
+    int Fragile::countdown(0);
+
+    /// <summary>
+    /// Tests the arrays created by <see cref="memory::make_sptr_array"/>.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, SptrArray_Test)
+    {
+        // Ensures proper initialization/finalization of the framework
+#   ifdef _3FD_PLATFORM_WINRT
+        core::FrameworkInstance _framework("IntegrationTestsApp.WinRT.UWP");
+#   else
+        core::FrameworkInstance _framework;
+#   endif
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            {
+                // small and large arrays, whose elements point to objects:
+                for (size_t count : { 1, 10, 100000 })
+                {
+                    auto array = make_sptr_array<Tracked>(count);
+                    ASSERT_EQ(count, array.GetCount());
+                    EXPECT_EQ(static_cast<int> (count), Tracked::liveCount.load());
+
+                    for (size_t idx = 0; idx < count; ++idx)
+                        array[idx].m_next = make_sptr<Tracked>();
+
+                    // and one of them points to yet another:
+                    array[count / 2].m_next->m_next = make_sptr<Tracked>();
+
+                    memory::GarbageCollector::GetInstance().PublishThreadMessages();
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+                    // the objects are reachable through the elements:
+                    EXPECT_EQ(static_cast<int> (2 * count + 1), Tracked::liveCount.load());
+
+                    array.Reset();
+                    EXPECT_EQ(0U, array.GetCount());
+
+                    memory::GarbageCollector::GetInstance().PublishThreadMessages();
+                    EXPECT_TRUE(WaitForTrackedObjectsCollection());
+                }
+
+                // array of objects without safe pointers inside:
+                auto numbers = make_sptr_array<int>(1000);
+                for (size_t idx = 0; idx < numbers.GetCount(); ++idx)
+                {
+                    EXPECT_EQ(0, numbers[idx]);
+                    numbers[idx] = static_cast<int> (idx);
+                }
+
+                sptr<int[]> copy = numbers;
+                EXPECT_EQ(999, copy[999]);
+
+                // failure in the construction of an element:
+                Fragile::countdown = 50;
+                EXPECT_THROW(make_sptr_array<Fragile>(100), AppException<std::runtime_error>);
+
+                // a length whose memory block size cannot be represented, in the GC heap or in an arena:
+                const size_t hugeCount = SIZE_MAX / sizeof(Tracked) + 1;
+                EXPECT_THROW(make_sptr_array<Tracked>(hugeCount), AppException<std::length_error>);
+                {
+                    memory::gc_arena arena;
+                    EXPECT_THROW(make_sptr_array<Tracked>(hugeCount), AppException<std::length_error>);
+                    EXPECT_EQ(0U, arena.GetAllocatedBytes());
+                }
+            }
+
+            memory::GarbageCollector::GetInstance().PublishThreadMessages();
+            EXPECT_TRUE(WaitForTrackedObjectsCollection());
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Object padded to a cache line, so that threads
+    /// updating it do not falsely share memory with others.
+    /// </summary>
+    struct alignas(64) CacheLinePadded
+    {
+        std::atomic<int> m_counter;
+
+        sptr<Tracked> m_tracked;
+
+        CacheLinePadded() : m_counter(0) {}
+    };
+
+    /// <summary>
+    /// Tests the garbage collector for objects and arrays
+    /// with alignments stricter than the default one.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, AlignedObjects_Test)
+    {
+        // Ensures proper initialization/finalization of the framework
+#   ifdef _3FD_PLATFORM_WINRT
+        core::FrameworkInstance _framework("IntegrationTestsApp.WinRT.UWP");
+#   else
+        core::FrameworkInstance _framework;
+#   endif
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            auto isAligned = [](const void *addr, size_t alignment)
+            {
+                return reinterpret_cast<uintptr_t> (addr) % alignment == 0;
             };
 
-            sptr<ResourceHolder> y = createResourceHolder();
+            {
+                // the alignment of the type is honoured:
+                auto padded = make_sptr<CacheLinePadded>();
+                EXPECT_TRUE(isAligned(&*padded, 64));
+                padded->m_tracked = make_sptr<Tracked>();
+
+                sptr<CacheLinePadded> viaMacro;
+                viaMacro.has(CacheLinePadded());
+                EXPECT_TRUE(isAligned(&*viaMacro, 64));
+                viaMacro->m_tracked = padded->m_tracked;
+
+                // or a stricter one, when requested:
+                auto object = make_aligned_sptr<Tracked>(128);
+                EXPECT_TRUE(isAligned(&*object, 128));
+                object->m_next = make_sptr<Tracked>();
+
+                auto numbers = make_sptr_array<float>(1000, 64);
+                ASSERT_EQ(1000U, numbers.GetCount());
+                EXPECT_TRUE(isAligned(&numbers[0], 64));
+                EXPECT_EQ(0.0F, numbers[999]);
+
+                auto array = make_sptr_array<Tracked>(10, 256);
+                ASSERT_EQ(10U, array.GetCount());
+                EXPECT_TRUE(isAligned(&array[0], 256));
+                array[9].m_next = make_sptr<Tracked>();
+
+                // the objects are reachable through the over-aligned ones:
+                memory::GarbageCollector::GetInstance().Collect();
+                EXPECT_EQ(14, Tracked::liveCount.load());
+
+                // in an arena too:
+                memory::gc_arena arena;
+                auto arenaObject = make_aligned_sptr<Tracked>(64);
+                EXPECT_TRUE(isAligned(&*arenaObject, 64));
+                auto arenaArray = make_sptr_array<double>(7, 256);
+                EXPECT_TRUE(isAligned(&arenaArray[0], 256));
+                EXPECT_EQ(7U, arenaArray.GetCount());
+
+                EXPECT_THROW(make_aligned_sptr<Tracked>(48), AppException<std::invalid_argument>);
+            }
+
+            memory::GarbageCollector::GetInstance().Flush();
+            EXPECT_EQ(0, Tracked::liveCount.load());
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Node of a graph, which holds its adjacency list in a single container.
+    /// </summary>
+    struct GraphNode
+    {
+        static std::atomic<int> liveCount;
+
+        gc_vector<sptr<GraphNode>> m_neighbours;
+
+        GraphNode() { ++liveCount; }
+
+        ~GraphNode() { --liveCount; }
+    };
+
+    std::atomic<int> GraphNode::liveCount(0);
+
+    /// <summary>
+    /// Node of a graph, which empties its adjacency list when destroyed.
+    /// </summary>
+    struct ClearingNode
+    {
+        static std::atomic<int> liveCount;
+
+        gc_vector<sptr<ClearingNode>> m_neighbours;
+
+        ClearingNode() { ++liveCount; }
+
+        ~ClearingNode()
+        {
+            m_neighbours.Clear();
+            --liveCount;
+        }
+    };
+
+    std::atomic<int> ClearingNode::liveCount(0);
+
+    /// <summary>
+    /// Tests the container of safe pointers, which the GC sees as a set of edges.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, GcVector_Test)
+    {
+        // Ensures proper initialization/finalization of the framework
+#   ifdef _3FD_PLATFORM_WINRT
+        core::FrameworkInstance _framework("IntegrationTestsApp.WinRT.UWP");
+#   else
+        core::FrameworkInstance _framework;
+#   endif
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            auto &gc = memory::GarbageCollector::GetInstance();
+
+            auto getMessagesCount = [&gc](memory::MessageType type)
+            {
+                return gc.GetStatistics().messagesProcessedCount[static_cast<size_t> (type)];
+            };
+
+            {
+                // the objects are held by the container alone:
+                gc_vector<sptr<Tracked>> objects;
+                for (int idx = 0; idx < 1000; ++idx)
+                    objects.PushBack(make_sptr<Tracked>());
+
+                ASSERT_EQ(1000U, objects.GetCount());
+                objects[10]->m_next = objects[20];
+                EXPECT_EQ(objects.GetPointer(20), &*objects.GetPointer(10)->m_next);
+                objects[10]->m_next.Reset();
+
+                gc.Collect();
+                EXPECT_EQ(1000, Tracked::liveCount.load());
+
+                // bulk operations are a single message each, and reordering sends none:
+                std::vector<sptr<Tracked>> batch(500);
+                for (auto &object : batch)
+                    object = make_sptr<Tracked>();
+
+                gc.Flush();
+                auto additionsCount = getMessagesCount(memory::MessageType::EdgesAddition);
+                auto removalsCount = getMessagesCount(memory::MessageType::EdgesRemoval);
+
+                objects.Insert(0, batch.begin(), batch.end());
+                batch.clear();
+                objects.Erase(1000, 1500);
+                objects.Sort([](Tracked *left, Tracked *right) { return left < right; });
+                objects.SwapElements(0, 999);
+
+                gc.Collect();
+                EXPECT_EQ(1U, getMessagesCount(memory::MessageType::EdgesAddition) - additionsCount);
+                EXPECT_EQ(1U, getMessagesCount(memory::MessageType::EdgesRemoval) - removalsCount);
+                EXPECT_EQ(1000, Tracked::liveCount.load());
+
+                // copy, move and swap:
+                gc_vector<sptr<Tracked>> copy(objects);
+                objects.Clear();
+
+                gc_vector<sptr<Tracked>> other;
+                other.PushBack(make_sptr<Tracked>());
+                other.Swap(copy);
+                EXPECT_EQ(1U, copy.GetCount());
+                EXPECT_EQ(1000U, other.GetCount());
+
+                objects = std::move(other);
+                EXPECT_TRUE(other.IsEmpty());
+
+                gc.Collect();
+                EXPECT_EQ(1001, Tracked::liveCount.load());
+
+                objects.Erase(0, 999);
+                copy.Set(0, objects[0]);
+                EXPECT_EQ(objects.GetPointer(0), copy.GetPointer(0));
+
+                gc.Collect();
+                EXPECT_EQ(1, Tracked::liveCount.load());
+
+                // an object in an arena cannot be held:
+                memory::gc_arena arena;
+                auto arenaObject = make_sptr<Tracked>();
+                EXPECT_THROW(objects.PushBack(arenaObject), AppException<std::logic_error>);
+            }
+
+            gc.Flush();
+            EXPECT_EQ(0, Tracked::liveCount.load());
+
+            {
+                // a graph full of cycles, held by a container outside the managed memory:
+                const int nodesCount(1000);
+                const int degree(50);
+
+                gc_vector<sptr<GraphNode>> nodes;
+                std::vector<sptr<GraphNode>> batch(nodesCount);
+                for (auto &node : batch)
+                    node = make_sptr<GraphNode>();
+
+                nodes.Insert(0, batch.begin(), batch.end());
+                batch.clear();
+
+                for (int idx = 0; idx < nodesCount; ++idx)
+                {
+                    std::vector<sptr<GraphNode>> neighbours;
+                    for (int offset = 1; offset <= degree; ++offset)
+                        neighbours.push_back(nodes[(idx + offset) % nodesCount]);
+
+                    nodes.GetPointer(idx)->m_neighbours.Insert(0, neighbours.begin(), neighbours.end());
+                }
+
+                // the node inside a node keeps the edges from the latter:
+                nodes.GetPointer(0)->m_neighbours.Swap(nodes.GetPointer(1)->m_neighbours);
+
+                gc.Collect();
+                EXPECT_EQ(nodesCount, GraphNode::liveCount.load());
+
+                // a heap snapshot sees the container as a root:
+                const char *filePath = "gc_vector_snapshot.bin";
+                gc.ExportHeapSnapshot(filePath);
+                auto snapshot = memory::HeapSnapshot::Load(filePath);
+                std::remove(filePath);
+
+                EXPECT_EQ(static_cast<size_t> (nodesCount), snapshot.GetRoots().size());
+
+                // few nodes of the first half are reachable from the second half:
+                for (int idx = 0; idx < nodesCount / 2; ++idx)
+                    nodes.GetPointer(idx)->m_neighbours.Clear();
+
+                nodes.Erase(0, nodesCount / 2);
+
+                gc.Collect();
+                EXPECT_EQ(nodesCount / 2 + degree, GraphNode::liveCount.load());
+
+                nodes.Clear();
+                gc.Collect();
+                EXPECT_EQ(0, GraphNode::liveCount.load());
+            }
+
+            {
+                /* a cycle whose nodes empty their containers when destroyed, so the objects
+                removed have been collected already, and their memory might be reused: */
+                const int nodesCount(1000);
+                const int degree(10);
+
+                gc.Flush();
+                auto edgeSetsCount = gc.GetStatistics().edgeSetsCount;
+
+                for (int round = 0; round < 3; ++round)
+                {
+                    std::vector<sptr<ClearingNode>> nodes(nodesCount);
+                    for (auto &node : nodes)
+                        node = make_sptr<ClearingNode>();
+
+                    for (int idx = 0; idx < nodesCount; ++idx)
+                    {
+                        for (int offset = 1; offset <= degree; ++offset)
+                            nodes[idx]->m_neighbours.PushBack(nodes[(idx + offset) % nodesCount]);
+                    }
+
+                    gc.Collect();
+                    EXPECT_EQ(nodesCount, ClearingNode::liveCount.load());
+
+                    nodes.clear();
+                    gc.Collect();
+                    EXPECT_EQ(0, ClearingNode::liveCount.load());
+                }
+
+                gc.Collect();
+                EXPECT_EQ(edgeSetsCount, gc.GetStatistics().edgeSetsCount);
+            }
+
+            {
+                // a container in an arena abandoned because of an escaped reference releases what it holds:
+                gc.Flush();
+                auto edgeSetsCount = gc.GetStatistics().edgeSetsCount;
+
+                weak_sptr<GraphNode> heapNodeWeak;
+                sptr<GraphNode> escaped;
+                {
+                    auto heapNode = make_sptr<GraphNode>();
+                    heapNodeWeak = weak_sptr<GraphNode>(heapNode);
+
+                    memory::gc_arena arena;
+                    escaped = make_sptr<GraphNode>();
+                    escaped->m_neighbours.PushBack(heapNode);
+                    heapNode.Reset();
+
+                    gc.Collect();
+                    EXPECT_FALSE(heapNodeWeak.IsExpired());
+                    EXPECT_EQ(edgeSetsCount + 2, gc.GetStatistics().edgeSetsCount);
+                }
+
+                EXPECT_TRUE(escaped->m_neighbours.IsEmpty());
+
+                gc.Collect();
+                EXPECT_TRUE(heapNodeWeak.IsExpired());
+                EXPECT_EQ(edgeSetsCount, gc.GetStatistics().edgeSetsCount);
+                escaped.Reset();
+            }
         }
         catch (...)
         {
@@ -208,6 +1575,55 @@ namespace integration_tests
         }
     }
 
+    /// <summary>
+    /// Tests the GC for the collection of many small cycles released at once,
+    /// which are analysed together as candidates for collection.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, ManyRefCycles_Test)
+    {
+        // Ensures proper initialization/finalization of the framework
+#   ifdef _3FD_PLATFORM_WINRT
+        core::FrameworkInstance _framework("IntegrationTestsApp.WinRT.UWP");
+#   else
+        core::FrameworkInstance _framework;
+#   endif
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            const int numCycles = 2000;
+            const int cycleLength = 3;
+
+            std::vector<sptr<Tracked>> cycles(numCycles);
+
+            for (auto &head : cycles)
+            {
+                head.has(Tracked());
+                auto last = head;
+
+                for (int idx = 1; idx < cycleLength; ++idx)
+                {
+                    last->m_next.has(Tracked());
+                    last = last->m_next;
+                }
+
+                last->m_next = head; // closes the cycle
+            }
+
+            EXPECT_EQ(numCycles * cycleLength, Tracked::liveCount.load());
+
+            cycles.clear();
+            memory::GarbageCollector::GetInstance().PublishThreadMessages();
+
+            EXPECT_TRUE(WaitForTrackedObjectsCollection());
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
     /// <summary>
     /// Tests the GC for allocation of objects in a tree structure with cycles.
     /// </summary>
@@ -7,6 +7,7 @@
 #include <3fd/core/gc_arrayofedges.h>
 #include <3fd/core/gc_vertex.h>
 
+#include <algorithm>
 #include <vector>
 
 namespace _3fd
@@ -68,6 +69,7 @@ namespace unit_tests
     TEST(Framework_MemoryGC_TestCase, ArrayOfEdges_Test)
     {
         using memory::Vertex;
+        using memory::VertexTable;
         using memory::ArrayOfEdges;
 
         ArrayOfEdges array;
@@ -87,9 +89,9 @@ namespace unit_tests
         std::vector<Vertex *> fromVertices(n),
                                 toVertices(n);
 
-        // Memory pool for vertices:
-        utils::DynamicMemPool myPool(n, sizeof(Vertex), 1.0F);
-        Vertex::SetMemoryPool(myPool);
+        // Table of vertices:
+        VertexTable myTable(n, sizeof(Vertex));
+        Vertex::SetTable(myTable);
 
         // Generate some fake vertices:
         for (int idx = 0; idx < n; ++idx)
@@ -166,7 +168,83 @@ namespace unit_tests
         array.ForEachRegular([&count](Vertex *){ ++count; return true; });
         ASSERT_EQ(0, count);
 
-        // Return vertices to the pool:
+        // Return vertices to the table:
+        for (auto vtx : fromVertices)
+            delete vtx;
+    }
+
+    /// <summary>
+    /// Tests <see cref="memory::ArrayOfEdges"/> class with few edges, crossing
+    /// the limit of the inline storage, and with edges of both kinds at once.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, ArrayOfEdges_Mixed_Test)
+    {
+        using memory::Vertex;
+        using memory::VertexTable;
+        using memory::ArrayOfEdges;
+
+        const int n = 16;
+        std::vector<int> someVars(n, 696);
+
+        VertexTable myTable(n, sizeof(Vertex));
+        Vertex::SetTable(myTable);
+
+        std::vector<Vertex *> fromVertices(n);
+        for (int idx = 0; idx < n; ++idx)
+            fromVertices[idx] = new Vertex(this, sizeof *this, nullptr);
+
+        // the regular vertices visited must be exactly those added so far:
+        auto checkRegular = [&fromVertices](ArrayOfEdges &array, int count)
+        {
+            std::vector<Vertex *> visited;
+            array.ForEachRegular([&visited](Vertex *vtx) { visited.push_back(vtx); return true; });
+
+            std::vector<Vertex *> expected(fromVertices.begin(), fromVertices.begin() + count);
+            std::sort(expected.begin(), expected.end());
+            EXPECT_EQ(expected, visited);
+        };
+
+        // grow one edge of each kind at a time, from inline to heap storage:
+        for (int total = 1; total <= n; ++total)
+        {
+            ArrayOfEdges array;
+
+            for (int idx = 0; idx < total; ++idx)
+            {
+                array.AddEdge(fromVertices[idx]);
+                array.AddEdge(&someVars[idx]);
+                EXPECT_EQ(2 * (idx + 1), array.Size());
+                EXPECT_TRUE(array.HasRootEdges());
+                checkRegular(array, idx + 1);
+            }
+
+            // removal of root edges leaves the regular ones untouched:
+            for (int idx = 0; idx < total; ++idx)
+            {
+                array.RemoveEdge(&someVars[idx]);
+                EXPECT_EQ(idx + 1 < total, array.HasRootEdges());
+                checkRegular(array, total);
+            }
+
+            for (int idx = total - 1; idx >= 0; --idx)
+            {
+                array.RemoveEdge(fromVertices[idx]);
+                checkRegular(array, idx);
+            }
+
+            EXPECT_EQ(0, array.Size());
+        }
+
+        // a single root edge must not be visited as regular:
+        ArrayOfEdges array;
+        array.AddEdge(&someVars[0]);
+        checkRegular(array, 0);
+        array.AddEdge(fromVertices[0]);
+        checkRegular(array, 1);
+        array.Clear();
+        EXPECT_EQ(0, array.Size());
+        EXPECT_FALSE(array.HasRootEdges());
+
         for (auto vtx : fromVertices)
             delete vtx;
     }
@@ -0,0 +1,118 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#include "pch.h"
+#include <3fd/core/runtime.h>
+#include <3fd/core/gc_digraphshards.h>
+#include <3fd/core/gc_memorydigraph.h>
+#include <3fd/core/gc_heap.h>
+
+#include <vector>
+
+namespace _3fd
+{
+namespace unit_tests
+{
+    using memory::Message;
+    using memory::MessageType;
+
+    /// <summary>
+    /// An object with room for one pointer, as seen by the GC.
+    /// </summary>
+    struct RingNode
+    {
+        void *next;
+    };
+
+    static size_t freedRingNodesCount(0);
+
+    static void FreeRingNode(void *addr, bool)
+    {
+        ++freedRingNodesCount;
+        memory::FreeMemoryFromGCHeap(addr);
+    }
+
+    /// <summary>
+    /// Tests <see cref="memory::DigraphShards"/> class executing batches of messages, large
+    /// enough to be split among threads, then small enough for the requesting thread alone.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, DigraphShards_BatchesTest)
+    {
+        // Ensures proper initialization/finalization of the framework
+        core::FrameworkInstance _framework;
+
+        const size_t n = 512;
+        void *roots[n];
+        void *copies[n];
+        void *moved[n];
+        std::vector<RingNode *> nodes;
+
+        memory::MemoryDigraph graph;
+        memory::DigraphShards shards(4);
+        EXPECT_EQ(4U, shards.GetNumShards());
+
+        auto enqueue = [&shards, &graph](MessageType type, void *sptrObjAddr, void *otherAddr)
+        {
+            shards.Enqueue(Message{ type, sptrObjAddr, otherAddr, sizeof(RingNode), &FreeRingNode }, graph);
+        };
+
+        // Roots referencing new objects, which reference each other in a ring:
+        for (size_t idx = 0; idx < n; ++idx)
+        {
+            auto node = new (memory::GCHeap::GetInstance().Allocate(sizeof(RingNode))) RingNode();
+            nodes.push_back(node);
+            enqueue(MessageType::SptrNewObjectRegistration, &roots[idx], node);
+            enqueue(MessageType::SptrRegistration, &node->next, nullptr);
+        }
+
+        for (size_t idx = 0; idx < n; ++idx)
+            enqueue(MessageType::ReferenceUpdate, &nodes[idx]->next, &roots[(idx + 1) % n]);
+
+        // Copy the roots, then move the copies:
+        for (size_t idx = 0; idx < n; ++idx)
+        {
+            enqueue(MessageType::SptrCopyRegistration, &copies[idx], &roots[idx]);
+            enqueue(MessageType::SptrMoveRegistration, &moved[idx], &copies[idx]);
+            enqueue(MessageType::SptrUnregistration, &copies[idx], nullptr);
+        }
+
+        shards.ExecuteBatch(graph);
+        EXPECT_TRUE(shards.IsBatchEmpty());
+        EXPECT_EQ(n, graph.GetVerticesCount());
+        EXPECT_EQ(3 * n, shards.GetPointersCount());
+        EXPECT_EQ(0, graph.GetCandidatesCount());
+
+        // Dropping the roots leaves an unreachable ring:
+        freedRingNodesCount = 0;
+        for (size_t idx = 0; idx < n; ++idx)
+        {
+            enqueue(MessageType::SptrUnregistration, &roots[idx], nullptr);
+            enqueue(MessageType::ReferenceRelease, &moved[idx], nullptr);
+        }
+
+        shards.ExecuteBatch(graph);
+        EXPECT_EQ(n, graph.GetVerticesCount());
+        EXPECT_EQ(n, graph.GetCandidatesCount());
+        EXPECT_EQ(0, freedRingNodesCount);
+
+        EXPECT_TRUE(graph.CollectUnreachableCandidates());
+        EXPECT_EQ(0, graph.GetVerticesCount());
+        EXPECT_EQ(n, freedRingNodesCount);
+
+        // What the destructors would emit, in small batches:
+        for (size_t idx = 0; idx < n; ++idx)
+        {
+            enqueue(MessageType::SptrUnregistration, &nodes[idx]->next, nullptr);
+            enqueue(MessageType::SptrUnregistration, &moved[idx], nullptr);
+
+            if (idx % 16 == 15)
+                shards.ExecuteBatch(graph);
+        }
+
+        EXPECT_EQ(0, shards.GetPointersCount());
+    }
+
+}// end of namespace unit_tests
+}// end of namespace _3fd
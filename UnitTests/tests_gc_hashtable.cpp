@@ -8,6 +8,12 @@
 #include <3fd/core/gc_addresseshashtable.h>
 #include <3fd/core/gc_vertex.h>
 
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <unordered_map>
 #include <vector>
 
 namespace _3fd
@@ -101,5 +107,245 @@ namespace unit_tests
         }
     }
 
+    /// <summary>
+    /// Tests <see cref="memory::AddressesHashTable"/> class under a random mix of insertions
+    /// and removals, which makes the table expand and shrink several times, so lookups often
+    /// happen while the elements are still moving from the old bucket array to the new one.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, AddressesHashTable_ResizeTest)
+    {
+        memory::AddressesHashTable hashtable(4, 0.9F);
+
+        std::vector<void *> keys(1 << 13);
+        for (size_t idx = 0; idx < keys.size(); ++idx)
+            keys[idx] = &keys[idx];
+
+        std::unordered_map<void *, Vertex *> expected;
+        std::mt19937 generator(42);
+
+        // grow to full size, then shrink to nothing, twice:
+        for (int round = 0; round < 4; ++round)
+        {
+            const bool growing = (round % 2 == 0);
+
+            for (size_t count = 0; count < 4 * keys.size(); ++count)
+            {
+                auto key = keys[generator() % keys.size()];
+                auto iter = expected.find(key);
+
+                if (iter == expected.end())
+                {
+                    if (!growing && generator() % 4 != 0)
+                        continue;
+
+                    auto pointedVtx = reinterpret_cast<Vertex *> (generator() | 1);
+                    auto &ref = hashtable.Insert(key, pointedVtx, nullptr);
+                    EXPECT_EQ(key, ref.GetSptrObjectAddr());
+                    EXPECT_EQ(pointedVtx, ref.GetPointedMemBlock());
+                    expected[key] = pointedVtx;
+                }
+                else
+                {
+                    if (growing && generator() % 4 != 0)
+                        continue;
+
+                    auto &ref = hashtable.Lookup(key);
+                    ASSERT_EQ(key, ref.GetSptrObjectAddr());
+                    ASSERT_EQ(iter->second, ref.GetPointedMemBlock());
+                    hashtable.Remove(ref);
+                    expected.erase(iter);
+                }
+
+                // look up a few present keys after every change:
+                if (!expected.empty() && count % 256 == 0)
+                {
+                    for (auto &entry : expected)
+                    {
+                        auto &ref = hashtable.Lookup(entry.first);
+                        ASSERT_EQ(entry.first, ref.GetSptrObjectAddr());
+                        ASSERT_EQ(entry.second, ref.GetPointedMemBlock());
+                    }
+                }
+            }
+        }
+
+        for (auto &entry : expected)
+        {
+            auto &ref = hashtable.Lookup(entry.first);
+            ASSERT_EQ(entry.second, ref.GetPointedMemBlock());
+            hashtable.Remove(entry.first);
+        }
+    }
+
+    /// <summary>
+    /// The hash table with linear probing formerly used for the
+    /// <see cref="sptr"/> objects, kept here for comparison.
+    /// </summary>
+    class LinearProbingHashTable
+    {
+    private:
+
+        std::vector<memory::AddressesHashTable::Element> m_bucketArray;
+        uint32_t m_outHashSizeInBits;
+
+        static size_t Hash(void *key)
+        {
+            uint32_t hash = 2166136261;
+
+            for (int bitsToShift = ((sizeof key) - 1) * 8; bitsToShift >= 0; bitsToShift -= 8)
+            {
+                auto octet = (reinterpret_cast<uintptr_t> (key) >> bitsToShift) & 255;
+                hash ^= octet;
+                hash *= 16777619;
+            }
+
+            return hash;
+        }
+
+        static size_t XorFold(size_t hash, uint32_t outHashSizeInBits)
+        {
+            const uint32_t maskForLowerBits = (1UL << outHashSizeInBits) - 1;
+            return ((hash >> outHashSizeInBits) ^ hash) & maskForLowerBits;
+        }
+
+    public:
+
+        explicit LinearProbingHashTable(uint32_t sizeInBits) :
+            m_bucketArray(static_cast<size_t> (1) << sizeInBits),
+            m_outHashSizeInBits(sizeInBits)
+        {}
+
+        memory::AddressesHashTable::Element &
+        Insert(void *sptrObjectAddr, Vertex *pointedMemBlock, Vertex *containerMemBlock)
+        {
+            auto idx = XorFold(Hash(sptrObjectAddr), m_outHashSizeInBits);
+
+            if (m_bucketArray[idx].GetSptrObjectAddr() == nullptr)
+                return m_bucketArray[idx] = memory::AddressesHashTable::Element(sptrObjectAddr, pointedMemBlock, containerMemBlock);
+
+            auto &element = m_bucketArray[idx];
+            auto displacedElement = element;
+            element = memory::AddressesHashTable::Element(sptrObjectAddr, pointedMemBlock, containerMemBlock);
+
+            do
+            {
+                if (++idx == m_bucketArray.size())
+                    idx = 0;
+            }
+            while (m_bucketArray[idx].GetSptrObjectAddr() != nullptr);
+
+            m_bucketArray[idx] = displacedElement;
+            return element;
+        }
+
+        memory::AddressesHashTable::Element &Lookup(void *sptrObjectAddr)
+        {
+            auto idx = XorFold(Hash(sptrObjectAddr), m_outHashSizeInBits);
+
+            while (m_bucketArray[idx].GetSptrObjectAddr() != sptrObjectAddr)
+            {
+                if (++idx == m_bucketArray.size())
+                    idx = 0;
+            }
+
+            return m_bucketArray[idx];
+        }
+
+        void Remove(memory::AddressesHashTable::Element &element)
+        {
+            element = memory::AddressesHashTable::Element();
+        }
+    };
+
+    /// <summary>
+    /// Measures the insertion, lookup and removal of
+    /// the elements in a hash table with a given load.
+    /// </summary>
+    template <typename HashTableType>
+    static void MeasureHashTable(HashTableType &hashtable,
+                                 const std::vector<void *> &keys,
+                                 const char *name,
+                                 float loadFactor)
+    {
+        typedef std::chrono::duration<double, std::nano> nanoseconds;
+
+        // make sure the bucket array is allocated before measuring:
+        hashtable.Remove(hashtable.Insert(keys[0], nullptr, nullptr));
+
+        auto startTime = std::chrono::steady_clock::now();
+
+        for (auto key : keys)
+            hashtable.Insert(key, reinterpret_cast<Vertex *> (key), nullptr);
+
+        auto insertionEndTime = std::chrono::steady_clock::now();
+
+        uintptr_t checksum(0);
+        for (int repeat = 0; repeat < 4; ++repeat)
+        {
+            for (auto key : keys)
+                checksum += reinterpret_cast<uintptr_t> (hashtable.Lookup(key).GetPointedMemBlock());
+        }
+
+        auto lookupEndTime = std::chrono::steady_clock::now();
+
+        for (auto key : keys)
+            hashtable.Remove(hashtable.Lookup(key));
+
+        auto removalEndTime = std::chrono::steady_clock::now();
+
+        uintptr_t expectedChecksum(0);
+        for (auto key : keys)
+            expectedChecksum += 4 * reinterpret_cast<uintptr_t> (key);
+
+        EXPECT_EQ(expectedChecksum, checksum);
+
+        std::cout << std::setw(8) << name << " @ " << std::setprecision(2) << loadFactor << std::setprecision(4)
+                  << ": insert " << nanoseconds(insertionEndTime - startTime).count() / keys.size()
+                  << " ns, lookup " << nanoseconds(lookupEndTime - insertionEndTime).count() / (4 * keys.size())
+                  << " ns, remove " << nanoseconds(removalEndTime - lookupEndTime).count() / keys.size()
+                  << " ns" << std::endl;
+    }
+
+    /// <summary>
+    /// Compares the speed of <see cref="memory::AddressesHashTable"/> against
+    /// the former implementation with linear probing, for several load factors.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, AddressesHashTable_Speed_Test)
+    {
+        const uint32_t sizeInBits(18);
+
+        // the addresses of sptr objects, spread over several objects in the heap:
+        const size_t numBuckets(static_cast<size_t> (1) << sizeInBits);
+        std::vector<void *> storage(2 * numBuckets);
+        std::vector<void *> allKeys;
+        for (size_t idx = 0; idx + 1 < storage.size(); idx += 3)
+        {
+            allKeys.push_back(&storage[idx]);
+            allKeys.push_back(&storage[idx + 1]);
+        }
+
+        // keys in the order of their addresses, as when objects are allocated in sequence, and then shuffled:
+        for (bool shuffled : { false, true })
+        {
+            if (shuffled)
+                std::shuffle(allKeys.begin(), allKeys.end(), std::mt19937(42));
+
+            std::cout << (shuffled ? "keys in random order:" : "keys in sequence:") << std::endl;
+
+            for (float loadFactor : { 0.5F, 0.6F, 0.7F, 0.8F, 0.9F })
+            {
+                std::vector<void *> keys(allKeys.begin(),
+                                         allKeys.begin() + static_cast<size_t> (loadFactor * numBuckets));
+
+                // neither of the tables resize in this test:
+                memory::AddressesHashTable robinHood(sizeInBits, 0.95F);
+                MeasureHashTable(robinHood, keys, "robin", loadFactor);
+
+                LinearProbingHashTable linearProbing(sizeInBits);
+                MeasureHashTable(linearProbing, keys, "linear", loadFactor);
+            }
+        }
+    }
+
 }// end of namespace unit_tests
 }// end of namespace _3fd
@@ -0,0 +1,196 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#include "pch.h"
+#include <3fd/core/gc_heap.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace _3fd
+{
+namespace unit_tests
+{
+    using memory::GCHeap;
+
+    /// <summary>
+    /// Tests <see cref="memory::GCHeap"/> class for allocation of small and
+    /// large blocks, and for retrieval of the tag of the block containing
+    /// a given address.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, GCHeap_Test)
+    {
+        auto &heap = GCHeap::GetInstance();
+
+        const std::vector<size_t> sizes = {
+            1, 8, 16, 24, 100, 128, 129, 1000, 4096, 5000,
+            GCHeap::maxSmallObjectSize,
+            GCHeap::maxSmallObjectSize + 1,
+            3 * GCHeap::unitSize
+        };
+
+        struct Allocation
+        {
+            char *addr;
+            size_t size;
+            uintptr_t tag;
+        };
+
+        std::vector<Allocation> allocations;
+
+        // allocate many blocks of each size, so several slabs are needed:
+        uintptr_t tag(0);
+        for (auto size : sizes)
+        {
+            for (int count = 0; count < 64; ++count)
+            {
+                auto addr = static_cast<char *> (heap.Allocate(size));
+                ASSERT_NE(nullptr, addr);
+                EXPECT_EQ(0U, reinterpret_cast<uintptr_t> (addr) % GCHeap::blockAlignment);
+
+                memset(addr, 0xAB, size); // must not corrupt anything
+
+                EXPECT_EQ(nullptr, heap.GetTag(addr));
+                ++tag;
+                heap.SetTag(addr, reinterpret_cast<void *> (tag));
+                allocations.push_back(Allocation{ addr, size, tag });
+            }
+        }
+
+        // find the blocks by their own addresses and by addresses inside them:
+        for (auto &allocation : allocations)
+        {
+            auto tag = reinterpret_cast<void *> (allocation.tag);
+            EXPECT_EQ(tag, heap.GetTag(allocation.addr));
+            EXPECT_EQ(tag, heap.GetContainerTag(allocation.addr));
+            EXPECT_EQ(tag, heap.GetContainerTag(allocation.addr + allocation.size / 2));
+            EXPECT_EQ(tag, heap.GetContainerTag(allocation.addr + allocation.size - 1));
+
+            if (allocation.size > 1)
+            {
+                EXPECT_EQ(nullptr, heap.GetTag(allocation.addr + 1));
+            }
+        }
+
+        // addresses out of the heap have no container:
+        int onStack;
+        EXPECT_EQ(nullptr, heap.GetContainerTag(&onStack));
+        EXPECT_EQ(nullptr, heap.GetContainerTag(&heap));
+
+        size_t numTags(0);
+        heap.ForEachTag([&numTags](void *) { ++numTags; });
+        EXPECT_LE(allocations.size(), numTags);
+
+        // free every other block, and then allocate them again:
+        for (size_t idx = 0; idx < allocations.size(); idx += 2)
+        {
+            auto &allocation = allocations[idx];
+            heap.SetTag(allocation.addr, nullptr);
+            heap.Free(allocation.addr);
+
+            if (allocation.size > GCHeap::maxSmallObjectSize)
+            {
+                EXPECT_EQ(nullptr, heap.GetContainerTag(allocation.addr));
+            }
+
+            allocation.addr = static_cast<char *> (heap.Allocate(allocation.size));
+            ASSERT_NE(nullptr, allocation.addr);
+            EXPECT_EQ(nullptr, heap.GetTag(allocation.addr));
+            heap.SetTag(allocation.addr, reinterpret_cast<void *> (allocation.tag));
+        }
+
+        for (auto &allocation : allocations)
+        {
+            auto tag = reinterpret_cast<void *> (allocation.tag);
+            EXPECT_EQ(tag, heap.GetContainerTag(allocation.addr + allocation.size - 1));
+
+            heap.SetTag(allocation.addr, nullptr);
+            heap.Free(allocation.addr);
+        }
+    }
+
+    /// <summary>
+    /// Tests <see cref="memory::GCHeap"/> class for allocation of blocks
+    /// with alignments stricter than the default one.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, GCHeap_Alignment_Test)
+    {
+        auto &heap = GCHeap::GetInstance();
+
+        const std::vector<size_t> sizes = { 1, 48, 100, 1000, 5000, GCHeap::maxSmallObjectSize + 1 };
+        const std::vector<size_t> alignments = { 32, 64, 256, 4096, GCHeap::maxAlignment };
+
+        std::vector<char *> blocks;
+
+        for (auto alignment : alignments)
+        {
+            for (auto size : sizes)
+            {
+                for (int count = 0; count < 3; ++count)
+                {
+                    auto addr = static_cast<char *> (heap.Allocate(size, alignment));
+                    ASSERT_NE(nullptr, addr);
+                    EXPECT_EQ(0U, reinterpret_cast<uintptr_t> (addr) % alignment);
+
+                    memset(addr, 0xAB, size); // must not corrupt anything
+
+                    // the block must be found as usual:
+                    EXPECT_EQ(addr, heap.GetBlockStart(addr + size - 1));
+                    heap.SetTag(addr, addr);
+                    EXPECT_EQ(addr, heap.GetContainerTag(addr + size / 2));
+
+                    blocks.push_back(addr);
+                }
+            }
+        }
+
+        for (auto addr : blocks)
+        {
+            EXPECT_EQ(addr, heap.GetTag(addr));
+            heap.SetTag(addr, nullptr);
+            heap.Free(addr);
+        }
+    }
+
+    /// <summary>
+    /// Tests <see cref="memory::GCHeap"/> class for blocks whose
+    /// size does not fit in 32 bits, where the platform allows.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, GCHeap_HugeBlock_Test)
+    {
+        if (sizeof(size_t) <= sizeof(uint32_t))
+            return;
+
+        auto &heap = GCHeap::GetInstance();
+
+        const uint64_t fourGiB(UINT64_C(1) << 32);
+        const std::vector<uint64_t> sizes = { fourGiB, fourGiB + 3 * GCHeap::unitSize + 8 };
+
+        for (auto size64 : sizes)
+        {
+            auto size = static_cast<size_t> (size64);
+
+            // the memory is reserved, but never touched beyond the extremities:
+            auto addr = static_cast<char *> (heap.Allocate(size));
+            if (addr == nullptr)
+                continue; // not enough address space here
+
+            addr[0] = addr[size - 1] = 42;
+            heap.SetTag(addr, addr);
+
+            EXPECT_EQ(addr, heap.GetTag(addr));
+            EXPECT_EQ(nullptr, heap.GetTag(addr + GCHeap::unitSize));
+            EXPECT_EQ(addr, heap.GetContainerTag(addr + size / 2));
+            EXPECT_EQ(addr, heap.GetContainerTag(addr + size - 1));
+            EXPECT_EQ(addr, heap.GetBlockStart(addr + size - 1));
+
+            heap.SetTag(addr, nullptr);
+            heap.Free(addr);
+        }
+    }
+
+}// end of namespace unit_tests
+}// end of namespace _3fd
@@ -0,0 +1,165 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#include "pch.h"
+#include <3fd/core/gc_messagesring.h>
+
+#include <array>
+#include <thread>
+#include <vector>
+
+namespace _3fd
+{
+namespace unit_tests
+{
+    using memory::Message;
+    using memory::MessageType;
+    using memory::MessagesRing;
+
+    static Message MakeMessage(uintptr_t producer, uintptr_t number)
+    {
+        return Message{
+            MessageType::SptrRegistration,
+            reinterpret_cast<void *> (producer),
+            reinterpret_cast<void *> (number),
+            0,
+            nullptr
+        };
+    }
+
+    /// <summary>
+    /// Tests <see cref="memory::MessagesRing"/> class for insertion / removal
+    /// of batches, detection of full ring and the overflow flag.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, MessagesRing_BasicTest)
+    {
+        MessagesRing ring(4);
+        ASSERT_EQ(16, ring.Capacity());
+
+        std::array<Message, 6> batch;
+        Message message;
+
+        // in several laps around the ring, fill it and then empty it:
+        for (uintptr_t lap = 0; lap < 5; ++lap)
+        {
+            uintptr_t number(0);
+
+            for (int idx = 0; idx < 2; ++idx)
+            {
+                for (auto &entry : batch)
+                    entry = MakeMessage(lap, number++);
+
+                ASSERT_EQ(MessagesRing::AddResult::Okay, ring.Add(batch.data(), batch.size()));
+            }
+
+            // there is room for 4 messages, but not for a whole batch:
+            EXPECT_EQ(MessagesRing::AddResult::Full, ring.Add(batch.data(), batch.size()));
+            ASSERT_EQ(MessagesRing::AddResult::Okay, ring.Add(batch.data(), 4));
+            EXPECT_EQ(MessagesRing::AddResult::Full, ring.Add(batch.data(), 1));
+
+            for (uintptr_t expected = 0; expected < 12; ++expected)
+            {
+                ASSERT_TRUE(ring.Remove(message));
+                EXPECT_EQ(MessageType::SptrRegistration, message.type);
+                EXPECT_EQ(lap, reinterpret_cast<uintptr_t> (message.sptrObjAddr));
+                EXPECT_EQ(expected, reinterpret_cast<uintptr_t> (message.otherAddr));
+            }
+
+            for (int idx = 0; idx < 4; ++idx)
+                ASSERT_TRUE(ring.Remove(message));
+
+            EXPECT_FALSE(ring.Remove(message));
+            EXPECT_TRUE(ring.IsDrained());
+        }
+
+        // once overflowing, no message is accepted until the flag is cleared:
+        ASSERT_EQ(MessagesRing::AddResult::Okay, ring.Add(batch.data(), 1));
+        ring.SetOverflowing();
+        EXPECT_TRUE(ring.IsOverflowing());
+        EXPECT_EQ(MessagesRing::AddResult::Overflowing, ring.Add(batch.data(), 1));
+        EXPECT_FALSE(ring.IsDrained());
+
+        ASSERT_TRUE(ring.Remove(message));
+        EXPECT_FALSE(ring.Remove(message));
+        EXPECT_TRUE(ring.IsDrained());
+
+        ring.ClearOverflowing();
+        EXPECT_FALSE(ring.IsOverflowing());
+        EXPECT_EQ(MessagesRing::AddResult::Okay, ring.Add(batch.data(), batch.size()));
+    }
+
+    /// <summary>
+    /// Tests <see cref="memory::MessagesRing"/> class with several producers
+    /// adding batches in parallel, which must be consumed whole and in order.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, MessagesRing_ParallelProducersTest)
+    {
+        const uintptr_t numProducers = 4;
+        const uintptr_t batchSize = 7;
+        const uintptr_t numBatches = 1UL << 14;
+
+        MessagesRing ring(8);
+
+        std::vector<std::thread> producers;
+
+        for (uintptr_t producer = 0; producer < numProducers; ++producer)
+        {
+            producers.emplace_back([producer, &ring]()
+            {
+                std::array<Message, batchSize> batch;
+                uintptr_t number(0);
+
+                for (uintptr_t count = 0; count < numBatches; ++count)
+                {
+                    for (auto &entry : batch)
+                        entry = MakeMessage(producer, number++);
+
+                    while (ring.Add(batch.data(), batch.size()) != MessagesRing::AddResult::Okay)
+                        std::this_thread::yield();
+                }
+            });
+        }
+
+        // Consume the messages while they are added, checking the order per producer:
+
+        std::array<uintptr_t, numProducers> expected = {};
+        uintptr_t total(0);
+        Message message;
+
+        while (total < numProducers * numBatches * batchSize)
+        {
+            if (!ring.Remove(message))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            auto producer = reinterpret_cast<uintptr_t> (message.sptrObjAddr);
+            ASSERT_LT(producer, numProducers);
+
+            auto number = reinterpret_cast<uintptr_t> (message.otherAddr);
+            ASSERT_EQ(expected[producer]++, number);
+
+            // messages from a batch are never interleaved with others:
+            for (uintptr_t idx = 1; idx < batchSize; ++idx)
+            {
+                while (!ring.Remove(message))
+                    std::this_thread::yield();
+
+                ASSERT_EQ(producer, reinterpret_cast<uintptr_t> (message.sptrObjAddr));
+                ASSERT_EQ(expected[producer]++, reinterpret_cast<uintptr_t> (message.otherAddr));
+            }
+
+            total += batchSize;
+        }
+
+        for (auto &thread : producers)
+            thread.join();
+
+        EXPECT_TRUE(ring.IsDrained());
+    }
+
+}// end of namespace unit_tests
+}// end of namespace _3fd
@@ -0,0 +1,160 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#include "pch.h"
+#include <3fd/core/gc_pagemap.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace _3fd
+{
+namespace unit_tests
+{
+    using memory::pageMapPageSize;
+
+    static const void *PageAddress(uintptr_t pageNumber)
+    {
+        return reinterpret_cast<const void *> (pageNumber * pageMapPageSize);
+    }
+
+    /// <summary>
+    /// Tests a page map for mapping, lookup and iteration.
+    /// </summary>
+    template <typename PageMapType>
+    static void TestPageMap()
+    {
+        PageMapType pageMap;
+
+        // pages spread over the address space, some of them in sequence:
+        const std::vector<uintptr_t> pageNumbers = {
+            1, 2, 3, 1000, 1 << 10, 1 << 11, (1 << 15) - 1, 1 << 15,
+            (static_cast<uintptr_t> (1) << (sizeof(void *) == 8 ? 31 : 15)) + 7
+        };
+
+        std::map<const void *, void *> expected;
+        for (auto pageNumber : pageNumbers)
+        {
+            auto value = reinterpret_cast<void *> (pageNumber * 2 + 1);
+            EXPECT_TRUE(pageMap.Map(PageAddress(pageNumber), pageMapPageSize, value));
+            expected[PageAddress(pageNumber)] = value;
+        }
+
+        // a range of several pages:
+        auto rangeValue = reinterpret_cast<void *> (0xBEEF);
+        EXPECT_TRUE(pageMap.Map(PageAddress(5000), 4 * pageMapPageSize, rangeValue));
+        for (uintptr_t pageNumber = 5000; pageNumber < 5004; ++pageNumber)
+            expected[PageAddress(pageNumber)] = rangeValue;
+
+        for (auto &entry : expected)
+        {
+            auto addr = static_cast<const char *> (entry.first);
+            EXPECT_EQ(entry.second, pageMap.Lookup(addr));
+            EXPECT_EQ(entry.second, pageMap.Lookup(addr + pageMapPageSize / 2));
+            EXPECT_EQ(entry.second, pageMap.Lookup(addr + pageMapPageSize - 1));
+        }
+
+        EXPECT_EQ(nullptr, pageMap.Lookup(PageAddress(0)));
+        EXPECT_EQ(nullptr, pageMap.Lookup(PageAddress(4)));
+        EXPECT_EQ(nullptr, pageMap.Lookup(PageAddress(5004)));
+        EXPECT_EQ(nullptr, pageMap.Lookup(PageAddress(999999)));
+
+        std::map<const void *, void *> visited;
+        pageMap.ForEach([&visited](const void *pageAddr, void *value)
+        {
+            visited[pageAddr] = value;
+        });
+
+        EXPECT_EQ(expected, visited);
+
+        // unmapping leaves the neighbours untouched:
+        pageMap.Unmap(PageAddress(5001), 2 * pageMapPageSize);
+        EXPECT_EQ(rangeValue, pageMap.Lookup(PageAddress(5000)));
+        EXPECT_EQ(nullptr, pageMap.Lookup(PageAddress(5001)));
+        EXPECT_EQ(nullptr, pageMap.Lookup(PageAddress(5002)));
+        EXPECT_EQ(rangeValue, pageMap.Lookup(PageAddress(5003)));
+
+        for (auto pageNumber : pageNumbers)
+        {
+            pageMap.Unmap(PageAddress(pageNumber), pageMapPageSize);
+            EXPECT_EQ(nullptr, pageMap.Lookup(PageAddress(pageNumber)));
+        }
+
+        size_t count(0);
+        pageMap.ForEach([&count](const void *, void *) { ++count; });
+        EXPECT_EQ(2U, count);
+    }
+
+    /// <summary>
+    /// Tests <see cref="memory::RadixPageMap"/> class.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, RadixPageMap_Test)
+    {
+        TestPageMap<memory::RadixPageMap>();
+    }
+
+    /// <summary>
+    /// Tests <see cref="memory::HashedPageMap"/> class.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, HashedPageMap_Test)
+    {
+        TestPageMap<memory::HashedPageMap>();
+    }
+
+    /// <summary>
+    /// Measures the lookups in a page map, for addresses
+    /// spread over a large amount of mapped memory.
+    /// </summary>
+    template <typename PageMapType>
+    static void MeasurePageMapLookup(const char *name)
+    {
+        const uintptr_t firstPage(1 << 12), numPages(1 << 14);
+
+        PageMapType pageMap;
+        for (uintptr_t pageNumber = firstPage; pageNumber < firstPage + numPages; ++pageNumber)
+            pageMap.Map(PageAddress(pageNumber), pageMapPageSize, reinterpret_cast<void *> (pageNumber));
+
+        std::mt19937 generator(42);
+        std::uniform_int_distribution<uintptr_t> distribution(firstPage * pageMapPageSize,
+                                                              (firstPage + numPages) * pageMapPageSize - 1);
+        std::vector<const void *> addresses(1 << 20);
+        for (auto &addr : addresses)
+            addr = reinterpret_cast<const void *> (distribution(generator));
+
+        uintptr_t checksum(0);
+        auto startTime = std::chrono::steady_clock::now();
+
+        for (auto addr : addresses)
+            checksum += reinterpret_cast<uintptr_t> (pageMap.Lookup(addr));
+
+        auto endTime = std::chrono::steady_clock::now();
+
+        std::cout << std::setw(8) << name << ": " << std::setprecision(4)
+                  << std::chrono::duration<double, std::milli>(endTime - startTime).count()
+                  << " ms for " << addresses.size() << " lookups" << std::endl;
+
+        uintptr_t expectedChecksum(0);
+        for (auto addr : addresses)
+            expectedChecksum += reinterpret_cast<uintptr_t> (addr) / pageMapPageSize;
+
+        EXPECT_EQ(expectedChecksum, checksum);
+    }
+
+    /// <summary>
+    /// Compares the speed of lookups in <see cref="memory::RadixPageMap"/>
+    /// against <see cref="memory::HashedPageMap"/>.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, PageMap_Lookup_Speed_Test)
+    {
+        MeasurePageMapLookup<memory::RadixPageMap>("radix");
+        MeasurePageMapLookup<memory::HashedPageMap>("hashed");
+    }
+
+}// end of namespace unit_tests
+}// end of namespace _3fd
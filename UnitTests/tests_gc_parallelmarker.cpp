@@ -0,0 +1,182 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#include "pch.h"
+#include <3fd/core/gc_parallelmarker.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace _3fd
+{
+namespace unit_tests
+{
+    using memory::ParallelMarker;
+
+    /// <summary>
+    /// Generates a graph with random edges.
+    /// </summary>
+    /// <param name="numVertices">How many vertices.</param>
+    /// <param name="maxOutDegree">The maximum amount of outgoing edges per vertex.</param>
+    /// <param name="edges">Receives the outgoing edges of the graph.</param>
+    static void GenerateRandomGraph(uint32_t numVertices,
+                                    uint32_t maxOutDegree,
+                                    ParallelMarker::OutgoingEdges &edges)
+    {
+        std::mt19937 generator(42);
+        std::uniform_int_distribution<uint32_t> degreeDistribution(0, maxOutDegree);
+        std::uniform_int_distribution<uint32_t> vertexDistribution(0, numVertices - 1);
+
+        edges.first.resize(numVertices);
+        edges.last.resize(numVertices);
+        edges.targets.clear();
+
+        for (uint32_t idx = 0; idx < numVertices; ++idx)
+        {
+            edges.first[idx] = static_cast<uint32_t> (edges.targets.size());
+
+            auto degree = degreeDistribution(generator);
+            while (degree-- > 0)
+                edges.targets.push_back(vertexDistribution(generator));
+
+            edges.last[idx] = static_cast<uint32_t> (edges.targets.size());
+        }
+    }
+
+    /// <summary>
+    /// Marks the vertices reachable from the roots with a single thread and no frills.
+    /// </summary>
+    static std::vector<bool> MarkSequentially(const ParallelMarker::OutgoingEdges &edges,
+                                              const std::vector<uint32_t> &roots)
+    {
+        std::vector<bool> marks(edges.first.size(), false);
+        std::vector<uint32_t> stack;
+
+        for (auto root : roots)
+        {
+            if (marks[root])
+                continue;
+
+            marks[root] = true;
+            stack.push_back(root);
+
+            while (!stack.empty())
+            {
+                auto index = stack.back();
+                stack.pop_back();
+
+                for (auto pos = edges.first[index]; pos < edges.last[index]; ++pos)
+                {
+                    auto target = edges.targets[pos];
+                    if (!marks[target])
+                    {
+                        marks[target] = true;
+                        stack.push_back(target);
+                    }
+                }
+            }
+        }
+
+        return marks;
+    }
+
+    /// <summary>
+    /// Tests <see cref="memory::ParallelMarker"/> class, which must
+    /// mark the same vertices regardless of the amount of threads.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, ParallelMarker_Test)
+    {
+        const uint32_t numVertices(1 << 16);
+
+        // a sparse graph, so not everything is reachable:
+        ParallelMarker::OutgoingEdges randomGraph;
+        GenerateRandomGraph(numVertices, 2, randomGraph);
+
+        // a long chain, where there is little to share:
+        ParallelMarker::OutgoingEdges chain;
+        chain.first.resize(numVertices);
+        chain.last.resize(numVertices);
+        for (uint32_t idx = 0; idx < numVertices; ++idx)
+        {
+            chain.first[idx] = idx;
+            chain.last[idx] = std::min(idx + 1, numVertices - 1);
+            if (idx + 1 < numVertices)
+                chain.targets.push_back(idx + 1);
+        }
+
+        const std::vector<uint32_t> roots = { 7, 1000, 1000, 33333 };
+
+        for (uint32_t numThreads : { 1, 2, 4 })
+        {
+            ParallelMarker marker(numThreads);
+            EXPECT_EQ(numThreads, marker.GetNumThreads());
+
+            auto expectedMarks = MarkSequentially(randomGraph, roots);
+            marker.Mark(randomGraph, roots);
+
+            uint32_t markedCount(0);
+            for (uint32_t idx = 0; idx < numVertices; ++idx)
+            {
+                ASSERT_EQ(expectedMarks[idx], marker.IsMarked(idx));
+                markedCount += expectedMarks[idx] ? 1 : 0;
+            }
+
+            EXPECT_LT(0U, markedCount);
+            EXPECT_GT(numVertices, markedCount);
+
+            // marking the chain from the middle leaves the first half unmarked:
+            marker.Mark(chain, std::vector<uint32_t>{ numVertices / 2 });
+
+            for (uint32_t idx = 0; idx < numVertices; ++idx)
+                ASSERT_EQ(idx >= numVertices / 2, marker.IsMarked(idx));
+
+            // with no roots, nothing is marked:
+            marker.Mark(chain, std::vector<uint32_t>());
+
+            for (uint32_t idx = 0; idx < numVertices; ++idx)
+                ASSERT_FALSE(marker.IsMarked(idx));
+        }
+    }
+
+    /// <summary>
+    /// Measures how the marking by <see cref="memory::ParallelMarker"/>
+    /// scales with the amount of threads, in a large graph.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, ParallelMarker_Scaling_Speed_Test)
+    {
+        const uint32_t numVertices(1 << 21);
+
+        ParallelMarker::OutgoingEdges graph;
+        GenerateRandomGraph(numVertices, 4, graph);
+
+        const std::vector<uint32_t> roots = { 0, numVertices / 3, numVertices / 2 };
+        auto expectedMarks = MarkSequentially(graph, roots);
+
+        const uint32_t maxThreads = std::max(std::thread::hardware_concurrency(), 1U);
+
+        for (uint32_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+        {
+            ParallelMarker marker(numThreads);
+
+            auto startTime = std::chrono::steady_clock::now();
+            marker.Mark(graph, roots);
+            auto endTime = std::chrono::steady_clock::now();
+
+            std::cout << std::setw(3) << numThreads << " thread(s): " << std::setprecision(4)
+                      << std::chrono::duration<double, std::milli>(endTime - startTime).count()
+                      << " ms" << std::endl;
+
+            for (uint32_t idx = 0; idx < numVertices; ++idx)
+                ASSERT_EQ(expectedMarks[idx], marker.IsMarked(idx));
+        }
+    }
+
+}// end of namespace unit_tests
+}// end of namespace _3fd
@@ -5,8 +5,14 @@
 //
 #include "pch.h"
 #include <3fd/core/gc_vertex.h>
+#include <3fd/core/gc_edgesets.h>
+#include <3fd/core/gc_weakreferences.h>
+#include <3fd/core/gc_reachabilityanalyzer.h>
+#include <3fd/core/gc_heap.h>
 
 #include <algorithm>
+#include <chrono>
+#include <future>
 #include <vector>
 
 namespace _3fd
@@ -15,19 +21,19 @@ namespace unit_tests
 {
     /// <summary>
     /// Tests resource management in a graph of linked <see cref="Vertex" />
-    /// objects coming from the same pool.
+    /// objects coming from the same table.
     /// </summary>
     TEST(Framework_MemoryGC_TestCase, Vertex_ResourceManTest)
     {
         using namespace memory;
 
-        // Sets the memory pool:
+        // Sets the table of vertices:
 
         const size_t poolSize(512);
 
-        utils::DynamicMemPool myPool(poolSize, sizeof(Vertex), 1.0F);
+        VertexTable myTable(poolSize, sizeof(Vertex));
 
-        Vertex::SetMemoryPool(myPool);
+        Vertex::SetTable(myTable);
 
         // Creates a 'graph' which is a chain of memory blocks:
 
@@ -56,7 +62,7 @@ namespace unit_tests
             delete previousBack;
         }
 
-        myPool.Shrink();
+        myTable.Shrink();
 
         // Expand the graph again:
         index = reinterpret_cast<size_t> (vertices.back()->GetMemoryAddress().Get());
@@ -82,11 +88,11 @@ namespace unit_tests
     {
         using namespace memory;
 
-#    ifdef _WIN32
-        auto ptr = (int *)_aligned_malloc(sizeof (int), 2);
-#    else
-        auto ptr = (int *)aligned_alloc(2, sizeof (int));
-#    endif
+        // the table keeps the callbacks freeing the memory, even for a vertex not taken from it:
+        VertexTable myTable(16, sizeof(Vertex));
+        Vertex::SetTable(myTable);
+
+        auto ptr = (int *)GCHeap::GetInstance().Allocate(sizeof (int));
         Vertex memBlock(ptr, sizeof *ptr, &FreeMemAddr<int>);
 
         EXPECT_EQ(ptr, memBlock.GetMemoryAddress().Get());
@@ -105,10 +111,10 @@ namespace unit_tests
     {
         using namespace memory;
 
-        // Sets the memory pool:
+        // Sets the table of vertices:
         const size_t poolSize(16);
-        utils::DynamicMemPool myPool(poolSize, sizeof(Vertex), 1.0F);
-        Vertex::SetMemoryPool(myPool);
+        VertexTable myTable(poolSize, sizeof(Vertex));
+        Vertex::SetTable(myTable);
 
         // Creates a 'graph' which is a chain of memory blocks:
 
@@ -125,7 +131,6 @@ namespace unit_tests
         // All vertices are regular and unreachable:
         for (auto vtx : vertices)
         {
-            EXPECT_FALSE(vtx->IsMarked());
             EXPECT_FALSE(vtx->HasRootEdges());
             EXPECT_FALSE(vtx->HasAnyEdges());
             EXPECT_FALSE(IsReachable(vtx));
@@ -145,7 +150,6 @@ namespace unit_tests
         index = 0;
         for (auto vtx : vertices)
         {
-            EXPECT_FALSE(vtx->IsMarked());
             EXPECT_FALSE(vtx->HasRootEdges());
             EXPECT_TRUE(vtx->HasAnyEdges());
             EXPECT_FALSE(IsReachable(vtx));
@@ -158,7 +162,6 @@ namespace unit_tests
         index = 0;
         for (auto vtx : vertices)
         {
-            EXPECT_FALSE(vtx->IsMarked());
             EXPECT_EQ((index++ == vertices.size() - 1), vtx->HasRootEdges());
             EXPECT_TRUE(vtx->HasAnyEdges());
             EXPECT_TRUE(IsReachable(vtx));
@@ -170,7 +173,6 @@ namespace unit_tests
         index = 0;
         for (auto vtx : vertices)
         {
-            EXPECT_FALSE(vtx->IsMarked());
             EXPECT_FALSE(vtx->HasRootEdges());
             EXPECT_TRUE(vtx->HasAnyEdges());
             EXPECT_FALSE(IsReachable(vtx));
@@ -188,7 +190,7 @@ namespace unit_tests
         for (; index < vertices.size(); ++index)
             EXPECT_FALSE(IsReachable(vertices[index]));
 
-        // Return vertices to the pool:
+        // Return vertices to the table:
         for (auto vtx : vertices)
             delete vtx;
     }
@@ -201,10 +203,10 @@ namespace unit_tests
     {
         using namespace memory;
 
-        // Sets the memory pool:
+        // Sets the table of vertices:
         const size_t poolSize(16);
-        utils::DynamicMemPool myPool(poolSize, sizeof(Vertex), 1.0F);
-        Vertex::SetMemoryPool(myPool);
+        VertexTable myTable(poolSize, sizeof(Vertex));
+        Vertex::SetTable(myTable);
 
         // Creates a 'graph' which is a chain of memory blocks:
 
@@ -236,7 +238,6 @@ namespace unit_tests
         // Because no root vertex has been added, all vertices are unreachable:
         for (auto vtx : vertices)
         {
-            EXPECT_FALSE(vtx->IsMarked());
             EXPECT_FALSE(vtx->HasRootEdges());
             EXPECT_TRUE(vtx->HasAnyEdges());
             EXPECT_FALSE(IsReachable(vtx));
@@ -249,7 +250,6 @@ namespace unit_tests
         index = 0;
         for (auto vtx : vertices)
         {
-            EXPECT_FALSE(vtx->IsMarked());
             EXPECT_EQ((index++ == vertices.size() - 1), vtx->HasRootEdges());
             EXPECT_TRUE(vtx->HasAnyEdges());
             EXPECT_TRUE(IsReachable(vtx));
@@ -260,16 +260,286 @@ namespace unit_tests
 
         for (auto vtx : vertices)
         {
-            EXPECT_FALSE(vtx->IsMarked());
             EXPECT_FALSE(vtx->HasRootEdges());
             EXPECT_TRUE(vtx->HasAnyEdges());
             EXPECT_FALSE(IsReachable(vtx));
         }
 
-        // Return vertices to the pool:
+        // Return vertices to the table:
+        for (auto vtx : vertices)
+            delete vtx;
+    }
+
+    /// <summary>
+    /// Tests reachability analysis in a long chain of linked <see cref="Vertex"/>
+    /// objects, with results memoized along a pass of <see cref="ReachabilityAnalyzer"/>.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, Vertex_GraphReachabilityAnalysis_MemoizationTest)
+    {
+        using namespace memory;
+
+        // Sets the table of vertices:
+        const size_t poolSize(1024);
+        VertexTable myTable(poolSize, sizeof(Vertex));
+        Vertex::SetTable(myTable);
+
+        // Creates a 'graph' which is a chain of memory blocks, too long for a recursive search:
+
+        std::vector<Vertex *> vertices(poolSize * 256);
+
+        uintptr_t index(sizeof(void *));
+        std::generate(begin(vertices), end(vertices), [&index]()
+        {
+            auto vertex = new Vertex(reinterpret_cast<void *> (index), 42, nullptr);
+            index += sizeof(void *);
+            return vertex;
+        });
+
+        for (index = 0; index < vertices.size() - 1; ++index)
+        {
+            auto thisVtx = vertices[index];
+            auto nextVtx = vertices[index + 1];
+
+            thisVtx->ReceiveEdgeFrom(nextVtx);
+            nextVtx->IncrementOutgoingEdgeCount();
+        }
+
+        ReachabilityAnalyzer analyzer;
+
+        // A search exhausted from the end of the chain memoizes every vertex as unreachable:
+        analyzer.StartPass();
+        EXPECT_FALSE(analyzer.IsReachable(vertices.front()));
+
+        for (auto vtx : vertices)
+            ASSERT_EQ(Vertex::Reachability::Unreachable, vtx->GetReachability());
+
+        for (auto vtx : vertices)
+            EXPECT_FALSE(analyzer.IsReachable(vtx));
+
+        // In a new pass, the memoized results expire:
+        void *fakeRootVtx = &index;
+        vertices.back()->ReceiveEdgeFrom(fakeRootVtx);
+
+        analyzer.StartPass();
+        EXPECT_TRUE(analyzer.IsReachable(vertices.front()));
+        EXPECT_EQ(Vertex::Reachability::Reachable, vertices.front()->GetReachability());
+
+        for (auto vtx : vertices)
+            EXPECT_TRUE(analyzer.IsReachable(vtx));
+
+        // The free function performs an analysis of its own:
+        vertices.back()->RemoveEdgeFrom(fakeRootVtx);
+        EXPECT_FALSE(IsReachable(vertices.front()));
+
+        // Return vertices to the table:
         for (auto vtx : vertices)
             delete vtx;
     }
 
+    /// <summary>
+    /// Tests how <see cref="VertexTable"/> hands out handles to vertices, keeps them
+    /// valid when chunks are released and reused, and indexes the free callbacks.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, VertexTable_Test)
+    {
+        using namespace memory;
+
+        // the size of the chunks is rounded up to a power of 2:
+        VertexTable myTable(10, sizeof(Vertex));
+        Vertex::SetTable(myTable);
+        const uint32_t chunkSize = myTable.GetChunkSize();
+        ASSERT_EQ(16, chunkSize);
+
+        // vertices are taken in order, so the handles are dense:
+        std::vector<Vertex *> vertices(3 * chunkSize);
+        for (uint32_t idx = 0; idx < vertices.size(); ++idx)
+        {
+            vertices[idx] = new Vertex(reinterpret_cast<void *> (idx * sizeof(void *)), 42, nullptr);
+            EXPECT_EQ(idx, vertices[idx]->GetHandle());
+            EXPECT_EQ(vertices[idx], Vertex::FromHandle(idx));
+        }
+
+        EXPECT_EQ(vertices.size(), myTable.GetNumBlocks());
+        EXPECT_EQ(vertices.size(), myTable.GetNumUsedBlocks());
+
+        // releasing the chunk in the middle keeps the handles in the last one valid:
+        for (uint32_t idx = chunkSize; idx < 2 * chunkSize; ++idx)
+            delete vertices[idx];
+
+        myTable.Shrink();
+        EXPECT_EQ(2 * chunkSize, myTable.GetNumBlocks());
+        EXPECT_EQ(2 * chunkSize, myTable.GetNumUsedBlocks());
+        EXPECT_EQ(2 * chunkSize, myTable.GetPeakNumUsedBlocks());
+
+        for (uint32_t idx = 2 * chunkSize; idx < vertices.size(); ++idx)
+            EXPECT_EQ(vertices[idx], Vertex::FromHandle(vertices[idx]->GetHandle()));
+
+        // the chunk released is the first one reused:
+        for (uint32_t idx = chunkSize; idx < 2 * chunkSize; ++idx)
+        {
+            vertices[idx] = new Vertex(reinterpret_cast<void *> (idx * sizeof(void *)), 42, nullptr);
+            EXPECT_EQ(idx, vertices[idx]->GetHandle());
+        }
+
+        for (auto vtx : vertices)
+            delete vtx;
+
+        // room can be kept for growth, in which case the lowest chunks stay:
+        EXPECT_EQ(0, myTable.GetNumUsedBlocks());
+        myTable.Shrink(chunkSize + 1);
+        EXPECT_EQ(2 * chunkSize, myTable.GetNumBlocks());
+
+        vertices[0] = new Vertex(nullptr, 42, nullptr);
+        EXPECT_EQ(0, vertices[0]->GetHandle());
+        delete vertices[0];
+
+        myTable.Shrink();
+        EXPECT_EQ(0, myTable.GetNumBlocks());
+
+        // a vertex not taken from the table has no handle:
+        Vertex stackVertex(nullptr, 0, nullptr);
+        EXPECT_EQ(VertexTable::invalidHandle, stackVertex.GetHandle());
+
+        // each callback gets an index of its own, and no callback has index zero:
+        EXPECT_EQ(0, myTable.GetFreeMemCallbackIndex(nullptr));
+        auto intIndex = myTable.GetFreeMemCallbackIndex(&FreeMemAddr<int>);
+        auto floatIndex = myTable.GetFreeMemCallbackIndex(&FreeMemAddr<float>);
+        EXPECT_NE(0, intIndex);
+        EXPECT_NE(0, floatIndex);
+        EXPECT_NE(intIndex, floatIndex);
+        EXPECT_EQ(intIndex, myTable.GetFreeMemCallbackIndex(&FreeMemAddr<int>));
+        EXPECT_EQ(&FreeMemAddr<int>, myTable.GetFreeMemCallback(intIndex));
+        EXPECT_EQ(&FreeMemAddr<float>, myTable.GetFreeMemCallback(floatIndex));
+        EXPECT_EQ(nullptr, myTable.GetFreeMemCallback(0));
+    }
+
+    /// <summary>
+    /// Tests how <see cref="EdgeSets"/> keeps the edges of the containers of safe
+    /// pointers, and the changes to the vertices it hands out for each update.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, EdgeSets_Test)
+    {
+        using namespace memory;
+
+        VertexTable myTable(16, sizeof(Vertex));
+        Vertex::SetTable(myTable);
+
+        std::vector<Vertex *> vertices(4);
+        for (uint32_t idx = 0; idx < vertices.size(); ++idx)
+            vertices[idx] = new Vertex(reinterpret_cast<void *> ((idx + 1) * sizeof(void *)), 42, nullptr);
+
+        EdgeSets sets;
+        int containerInBlock, containerAsRoot;
+        sets.Insert(&containerInBlock, vertices[0]);
+        sets.Insert(&containerAsRoot, nullptr);
+        EXPECT_EQ(2U, sets.GetCount());
+
+        auto getTargets = [&sets](void *containerAddr)
+        {
+            std::vector<uint32_t> targets;
+            sets.ForEach([containerAddr, &targets](void *addr, const EdgeSets::EdgeSet &set)
+            {
+                if (addr == containerAddr)
+                    targets = set.targets;
+            });
+
+            return targets;
+        };
+
+        // an object can be held more than once, and the handles are kept sorted:
+        std::vector<EdgeSets::EdgeChange> changes;
+        std::vector<uint32_t> batch = { 3, 1, 3, 2 };
+        sets.AddEdges(&containerInBlock, batch, changes);
+        ASSERT_EQ(4U, changes.size());
+        EXPECT_TRUE(std::all_of(changes.begin(), changes.end(), [&vertices](const EdgeSets::EdgeChange &change)
+        {
+            return change.added && change.origin == vertices[0];
+        }));
+        EXPECT_EQ((std::vector<uint32_t>{ 1, 2, 3, 3 }), getTargets(&containerInBlock));
+
+        changes.clear();
+        batch = { 3, 1 };
+        sets.RemoveEdges(&containerInBlock, batch, changes);
+        ASSERT_EQ(2U, changes.size());
+        EXPECT_FALSE(changes[0].added);
+        EXPECT_EQ(vertices[1], changes[0].target);
+        EXPECT_EQ(vertices[3], changes[1].target);
+        EXPECT_EQ((std::vector<uint32_t>{ 2, 3 }), getTargets(&containerInBlock));
+
+        // swapping with a root moves the edges from one origin to the other:
+        changes.clear();
+        sets.Swap(&containerInBlock, &containerAsRoot, changes);
+        ASSERT_EQ(4U, changes.size());
+        EXPECT_TRUE(changes[0].added && changes[0].origin == nullptr && changes[0].containerAddr == &containerAsRoot);
+        EXPECT_TRUE(!changes[3].added && changes[3].origin == vertices[0]);
+        EXPECT_TRUE(getTargets(&containerInBlock).empty());
+        EXPECT_EQ((std::vector<uint32_t>{ 2, 3 }), getTargets(&containerAsRoot));
+
+        // the removal of a container takes its edges along:
+        changes.clear();
+        sets.Remove(&containerAsRoot, changes);
+        EXPECT_EQ(2U, changes.size());
+        EXPECT_EQ(1U, sets.GetCount());
+
+        for (auto vtx : vertices)
+            delete vtx;
+    }
+
+    /// <summary>
+    /// Tests how <see cref="WeakReferences"/> expires the weak references to the vertices
+    /// of a collection, either all of them or none, so that a failed lock is never undone.
+    /// </summary>
+    TEST(Framework_MemoryGC_TestCase, WeakReferences_Test)
+    {
+        using namespace memory;
+
+        VertexTable myTable(16, sizeof(Vertex));
+        Vertex::SetTable(myTable);
+
+        std::vector<Vertex *> vertices(2);
+        std::vector<WeakRefBlock *> blocks(vertices.size());
+        WeakReferences weakRefs;
+
+        for (uint32_t idx = 0; idx < vertices.size(); ++idx)
+        {
+            vertices[idx] = new Vertex(reinterpret_cast<void *> ((idx + 1) * sizeof(void *)), 42, nullptr);
+            vertices[idx]->SetWeakRefState(Vertex::WeakRefState::Referenced);
+
+            bool isNew;
+            blocks[idx] = weakRefs.Acquire(vertices[idx]->GetMemoryAddress().Get(), isNew);
+            EXPECT_TRUE(isNew);
+        }
+
+        // a lock on one of them prevents them all from expiring:
+        ASSERT_TRUE(blocks[1]->TryLock());
+        EXPECT_FALSE(weakRefs.TryExpire(vertices.data(), vertices.size()));
+        EXPECT_FALSE(blocks[0]->IsExpired());
+        EXPECT_TRUE(vertices[1]->IsLockedByWeakReference());
+
+        weakRefs.Unlock(vertices[1]);
+        EXPECT_FALSE(vertices[1]->IsLockedByWeakReference());
+
+        // a lock attempt waits for the decision about the block, rather than failing:
+        ASSERT_TRUE(blocks[0]->TryBeginExpire());
+        auto lockAttempt = std::async(std::launch::async, [block = blocks[0]]() { return block->TryLock(); });
+        EXPECT_EQ(std::future_status::timeout, lockAttempt.wait_for(std::chrono::milliseconds(50)));
+
+        blocks[0]->CancelExpire();
+        EXPECT_TRUE(lockAttempt.get());
+        blocks[0]->Unlock();
+
+        // and fails only once the block has expired for good:
+        EXPECT_TRUE(weakRefs.TryExpire(vertices.data(), vertices.size()));
+        EXPECT_TRUE(blocks[0]->IsExpired() && blocks[1]->IsExpired());
+        EXPECT_FALSE(blocks[0]->TryLock());
+
+        for (uint32_t idx = 0; idx < vertices.size(); ++idx)
+        {
+            weakRefs.Discard(vertices[idx]);
+            blocks[idx]->Release();
+            delete vertices[idx];
+        }
+    }
+
 }// end of namespace unit_tests
 }// end of namespace _3fd
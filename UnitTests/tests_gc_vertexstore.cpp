@@ -6,15 +6,12 @@
 #include "pch.h"
 #include <3fd/core/runtime.h>
 #include <3fd/core/gc_vertexstore.h>
+#include <3fd/core/gc_heap.h>
 #include <3fd/core/sptr.h>
 
 #include <vector>
 
-#ifdef _WIN32
-#    define ALIGNED_NEW(TYPE, INITIALIZER) new (_aligned_malloc(sizeof (TYPE), 2)) TYPE INITIALIZER
-#else
-#    define ALIGNED_NEW(TYPE, INITIALIZER) new (aligned_alloc(2, sizeof (TYPE))) TYPE INITIALIZER
-#endif
+#define GCHEAP_NEW(TYPE, INITIALIZER) new (memory::GCHeap::GetInstance().Allocate(sizeof (TYPE))) TYPE INITIALIZER
 
 namespace _3fd
 {
@@ -43,7 +40,7 @@ namespace unit_tests
         addrs.reserve(n);
         for (int count = 0; count < n; ++count)
         {
-            auto ptr = ALIGNED_NEW(Stuffed, ());
+            auto ptr = GCHEAP_NEW(Stuffed, ());
             addrs.push_back(ptr);
             vtxStore.AddVertex(ptr, sizeof *ptr, &memory::FreeMemAddr<Stuffed>);
         }
@@ -116,5 +116,70 @@ namespace unit_tests
         myPool.Shrink();
     }
 
+    /// <summary>
+    /// Tests how <see cref="utils::DynamicMemPool"/> class keeps the blocks in use packed,
+    /// and how it gives back memory when shrunk, even from pools partially in use.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, DynamicMemPool_ShrinkTest)
+    {
+        const size_t poolSize = 4096;
+        const size_t blockSize = 64;
+
+        utils::DynamicMemPool myPool(poolSize, blockSize, 1.0F);
+
+        std::vector<uint64_t *> blocks(poolSize * 2);
+        for (auto &block : blocks)
+        {
+            block = static_cast<uint64_t *> (myPool.GetFreeBlock());
+            *block = reinterpret_cast<uintptr_t> (block);
+        }
+
+        EXPECT_EQ(2 * poolSize, myPool.GetNumBlocks());
+        EXPECT_EQ(2 * poolSize, myPool.GetNumUsedBlocks());
+
+        // Return all but the first block, in no particular order:
+        for (size_t idx = 1; idx < blocks.size(); idx += 2)
+            myPool.ReturnBlock(blocks[idx]);
+
+        for (size_t idx = blocks.size() - 2; idx > 0; idx -= 2)
+            myPool.ReturnBlock(blocks[idx]);
+
+        EXPECT_EQ(1, myPool.GetNumUsedBlocks());
+        EXPECT_EQ(2 * poolSize, myPool.GetPeakNumUsedBlocks());
+
+        // The pool with no block in use is gone, and the pages of the other are released:
+        auto releasedSize = myPool.Shrink();
+        EXPECT_LE((2 * poolSize - 1) * blockSize - 4096, releasedSize);
+        EXPECT_EQ(poolSize, myPool.GetNumBlocks());
+        EXPECT_EQ(1, myPool.GetPeakNumUsedBlocks());
+        EXPECT_EQ(reinterpret_cast<uintptr_t> (blocks[0]), *blocks[0]);
+
+        // The pages already handed back are not again, until touched:
+        EXPECT_EQ(0, myPool.Shrink());
+
+        // Blocks are taken lowest address first:
+        for (size_t idx = 1; idx < poolSize; ++idx)
+        {
+            blocks[idx] = static_cast<uint64_t *> (myPool.GetFreeBlock());
+            EXPECT_LT(blocks[idx - 1], blocks[idx]);
+            *blocks[idx] = idx;
+        }
+
+        EXPECT_EQ(poolSize, myPool.GetNumBlocks());
+
+        for (size_t idx = 1; idx < poolSize; ++idx)
+            myPool.ReturnBlock(blocks[idx]);
+
+        releasedSize = myPool.Shrink();
+        EXPECT_LE((poolSize - 1) * blockSize - 4096, releasedSize);
+        EXPECT_GE((poolSize - 1) * blockSize, releasedSize);
+        EXPECT_EQ(0, myPool.Shrink());
+        EXPECT_EQ(reinterpret_cast<uintptr_t> (blocks[0]), *blocks[0]);
+
+        myPool.ReturnBlock(blocks[0]);
+        myPool.Shrink();
+        EXPECT_EQ(0, myPool.GetNumBlocks());
+    }
+
 }// end of namespace unit_tests
 }// end of namespace _3fd